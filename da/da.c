@@ -3,22 +3,290 @@
 #include <string.h>
 #include <stdio.h>
 
-void* da_reserve_impl(void* arr, size_t capacity, size_t elem_size) {
+#ifdef DA_TRACE
+#include <pthread.h>
+
+// The public names are macros that pass the call site, see da.h
+#undef da_reserve_impl
+#undef da_grow_impl
+#undef da_init_impl
+#undef da_grow_n_impl
+
+#define DA_TRACE_MAX_SITES 4096
+
+typedef struct {
+    const char* file;
+    int line;
+    size_t arrays;          // number of heap arrays created here
+    size_t reallocs;
+    size_t reserved;        // bytes currently reserved by live arrays
+    size_t peak;            // max of reserved
+    size_t freed_reserved;  // reserved/used bytes of arrays at the time they were freed
+    size_t freed_used;
+} da_site_t;
+
+static da_site_t da_sites[DA_TRACE_MAX_SITES];
+static size_t da_num_sites = 0;
+static da_header_t* da_live_head = NULL;
+// Arrays are allocated on several threads (the parser, compile-threads-test),
+// the lock covers the site table, the live list and the headers in it
+static pthread_mutex_t da_trace_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void da_trace_atexit() {
+    da_trace_report(stderr);
+}
+
+static uint32_t da_trace_site(const char* file, int line) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (const char* c = file; *c; ++c) {
+        hash = (hash ^ (unsigned char)*c) * 1099511628211ULL;
+    }
+    hash = (hash ^ (uint64_t)line) * 1099511628211ULL;
+
+    size_t idx = hash % DA_TRACE_MAX_SITES;
+    for (size_t i = 0; i < DA_TRACE_MAX_SITES; ++i) {
+        da_site_t* site = &da_sites[idx];
+        if (site->file == NULL) {
+            if (da_num_sites++ == 0) atexit(da_trace_atexit);
+            site->file = file;
+            site->line = line;
+            return idx;
+        }
+        if (site->line == line && strcmp(site->file, file) == 0) return idx;
+        idx = (idx + 1) % DA_TRACE_MAX_SITES;
+    }
+    fprintf(stderr, "da: call site table is full\n");
+    abort();
+}
+
+static void da_trace_link(da_header_t* header) {
+    header->trace_prev = NULL;
+    header->trace_next = da_live_head;
+    if (da_live_head) da_live_head->trace_prev = header;
+    da_live_head = header;
+}
+
+static void da_trace_unlink(da_header_t* header) {
+    da_header_t* prev = header->trace_prev;
+    da_header_t* next = header->trace_next;
+    if (prev) prev->trace_next = next;
+    else da_live_head = next;
+    if (next) next->trace_prev = prev;
+}
+#endif
+
+static void* da_reserve_at(void* arr, size_t capacity, size_t elem_size, uint32_t site_idx) {
     da_header_t header = {0};
     da_header_t* old_header = (da_header_t*)arr - 1;
     header.size = arr ? old_header->size : 0;
     header.capacity = capacity;
+    header.growth = arr ? old_header->growth : DA_DEFAULT_GROWTH;
+    header.flags = arr ? old_header->flags & ~DA_FLAG_INLINE : 0;
+#ifdef DA_TRACE
+    int fresh = !arr || (old_header->flags & DA_FLAG_INLINE);
+    // An array belongs to the site that first put it on the heap
+    da_site_t* site = &da_sites[fresh ? site_idx : old_header->site];
+    size_t old_bytes = fresh ? 0 : old_header->capacity * elem_size;
+    if (fresh) {
+        site->arrays++;
+    } else {
+        site->reallocs++;
+        da_trace_unlink(old_header);
+    }
+    site->reserved += capacity * elem_size - old_bytes;
+    if (site->reserved > site->peak) site->peak = site->reserved;
+    header.site = site - da_sites;
+    header.elem_size = elem_size;
+#else
+    (void)site_idx;
+#endif
     void* b;
     if (!arr) {
         b = malloc(capacity * elem_size + sizeof(da_header_t));
+    } else if (old_header->flags & DA_FLAG_INLINE) {
+        // Leaving the small buffer, it belongs to the owner so we can't realloc it
+        b = malloc(capacity * elem_size + sizeof(da_header_t));
+        memcpy((char*)b + sizeof(da_header_t), arr, header.size * elem_size);
     } else {
         b = realloc(old_header, capacity * elem_size + sizeof(da_header_t));
     }
     *(da_header_t*)b = header;
+#ifdef DA_TRACE
+    da_trace_link(b);
+#endif
     b = (char*)b + sizeof(da_header_t);
     return b;
 }
 
+static void* da_grow_at(void* arr, size_t elem_size, uint32_t site_idx) {
+    if (!arr) return da_reserve_at(arr, DA_DEFAULT_CAPACITY, elem_size, site_idx);
+    da_header_t* header = (da_header_t*)arr - 1;
+    uint32_t growth = header->growth > 100 ? header->growth : DA_DEFAULT_GROWTH;
+    size_t capacity = header->capacity * growth / 100;
+    if (capacity <= header->capacity) capacity = header->capacity + 1;
+    return da_reserve_at(arr, capacity, elem_size, site_idx);
+}
+
+static void* da_grow_n_at(void* arr, size_t n, size_t elem_size, uint32_t site_idx) {
+    size_t size = arr ? ((da_header_t*)arr - 1)->size : 0;
+    size_t capacity = arr ? ((da_header_t*)arr - 1)->capacity : 0;
+    if (capacity - size >= n) return arr;
+    if (!arr) {
+        capacity = n > DA_DEFAULT_CAPACITY ? n : DA_DEFAULT_CAPACITY;
+    } else {
+        da_header_t* header = (da_header_t*)arr - 1;
+        uint32_t growth = header->growth > 100 ? header->growth : DA_DEFAULT_GROWTH;
+        capacity = capacity * growth / 100;
+        if (capacity < size + n) capacity = size + n;
+    }
+    return da_reserve_at(arr, capacity, elem_size, site_idx);
+}
+
+static void* da_init_at(void* arr, da_policy_t policy, size_t elem_size, uint32_t site_idx) {
+    if (arr) return arr;
+    size_t capacity = policy.initial_capacity ? policy.initial_capacity : 1;
+    arr = da_reserve_at(NULL, capacity, elem_size, site_idx);
+    if (policy.growth > 100) {
+        da_header(arr)->growth = policy.growth;
+    }
+    return arr;
+}
+
+#ifdef DA_TRACE
+void* da_reserve_trace(void* arr, size_t capacity, size_t elem_size, const char* file, int line) {
+    pthread_mutex_lock(&da_trace_lock);
+    void* b = da_reserve_at(arr, capacity, elem_size, da_trace_site(file, line));
+    pthread_mutex_unlock(&da_trace_lock);
+    return b;
+}
+
+void* da_grow_trace(void* arr, size_t elem_size, const char* file, int line) {
+    pthread_mutex_lock(&da_trace_lock);
+    void* b = da_grow_at(arr, elem_size, da_trace_site(file, line));
+    pthread_mutex_unlock(&da_trace_lock);
+    return b;
+}
+
+void* da_init_trace(void* arr, da_policy_t policy, size_t elem_size, const char* file, int line) {
+    pthread_mutex_lock(&da_trace_lock);
+    void* b = da_init_at(arr, policy, elem_size, da_trace_site(file, line));
+    pthread_mutex_unlock(&da_trace_lock);
+    return b;
+}
+
+void* da_grow_n_trace(void* arr, size_t n, size_t elem_size, const char* file, int line) {
+    pthread_mutex_lock(&da_trace_lock);
+    void* b = da_grow_n_at(arr, n, elem_size, da_trace_site(file, line));
+    pthread_mutex_unlock(&da_trace_lock);
+    return b;
+}
+#endif
+
+void* da_reserve_impl(void* arr, size_t capacity, size_t elem_size) {
+#ifdef DA_TRACE
+    return da_reserve_trace(arr, capacity, elem_size, "<unknown>", 0);
+#else
+    return da_reserve_at(arr, capacity, elem_size, 0);
+#endif
+}
+
+void* da_grow_impl(void* arr, size_t elem_size) {
+#ifdef DA_TRACE
+    return da_grow_trace(arr, elem_size, "<unknown>", 0);
+#else
+    return da_grow_at(arr, elem_size, 0);
+#endif
+}
+
+void* da_init_impl(void* arr, da_policy_t policy, size_t elem_size) {
+#ifdef DA_TRACE
+    return da_init_trace(arr, policy, elem_size, "<unknown>", 0);
+#else
+    return da_init_at(arr, policy, elem_size, 0);
+#endif
+}
+
+void* da_grow_n_impl(void* arr, size_t n, size_t elem_size) {
+#ifdef DA_TRACE
+    return da_grow_n_trace(arr, n, elem_size, "<unknown>", 0);
+#else
+    return da_grow_n_at(arr, n, elem_size, 0);
+#endif
+}
+
+void da_free_impl(void* arr) {
+    if (!arr) return;
+    da_header_t* header = (da_header_t*)arr - 1;
+    if (header->flags & DA_FLAG_INLINE) return;
+#ifdef DA_TRACE
+    pthread_mutex_lock(&da_trace_lock);
+    da_site_t* site = &da_sites[header->site];
+    site->reserved -= header->capacity * header->elem_size;
+    site->freed_reserved += header->capacity * header->elem_size;
+    site->freed_used += header->size * header->elem_size;
+    da_trace_unlink(header);
+    pthread_mutex_unlock(&da_trace_lock);
+#endif
+    free(header);
+}
+
+#ifdef DA_TRACE
+typedef struct {
+    da_site_t* site;
+    size_t reserved;
+    size_t used;
+} da_site_report_t;
+
+static int da_site_report_cmp(const void* a, const void* b) {
+    const da_site_report_t* ra = a;
+    const da_site_report_t* rb = b;
+    size_t waste_a = ra->reserved - ra->used;
+    size_t waste_b = rb->reserved - rb->used;
+    if (waste_a != waste_b) return waste_a < waste_b ? 1 : -1;
+    return 0;
+}
+
+void da_trace_report(FILE* stream) {
+    // Reserved/used bytes are those of live arrays plus those of freed arrays when they were freed
+    da_site_report_t* reports = calloc(DA_TRACE_MAX_SITES, sizeof(da_site_report_t));
+    pthread_mutex_lock(&da_trace_lock);
+    for (size_t i = 0; i < DA_TRACE_MAX_SITES; ++i) {
+        reports[i].site = &da_sites[i];
+        reports[i].reserved = da_sites[i].freed_reserved;
+        reports[i].used = da_sites[i].freed_used;
+    }
+    for (da_header_t* header = da_live_head; header; header = header->trace_next) {
+        reports[header->site].reserved += header->capacity * header->elem_size;
+        reports[header->site].used += header->size * header->elem_size;
+    }
+    qsort(reports, DA_TRACE_MAX_SITES, sizeof(da_site_report_t), da_site_report_cmp);
+
+    size_t total_reserved = 0, total_used = 0;
+    fprintf(stream, "==== da allocations by call site ====\n");
+    fprintf(stream, "%-32s %8s %8s %12s %12s %12s %12s\n",
+            "site", "arrays", "reallocs", "reserved", "used", "wasted", "peak");
+    for (size_t i = 0; i < DA_TRACE_MAX_SITES; ++i) {
+        da_site_t* site = reports[i].site;
+        if (site->file == NULL || site->arrays == 0) continue;
+        char location[256];
+        snprintf(location, sizeof(location), "%s:%d", site->file, site->line);
+        fprintf(stream, "%-32s %8zu %8zu %12zu %12zu %12zu %12zu\n",
+                location, site->arrays, site->reallocs,
+                reports[i].reserved, reports[i].used,
+                reports[i].reserved - reports[i].used, site->peak);
+        total_reserved += reports[i].reserved;
+        total_used += reports[i].used;
+    }
+    fprintf(stream, "Total: %zu bytes reserved, %zu bytes used\n", total_reserved, total_used);
+    pthread_mutex_unlock(&da_trace_lock);
+    free(reports);
+}
+#else
+void da_trace_report(FILE* stream) {
+    fprintf(stream, "da: allocation tracing is disabled, rebuild with -DDA_TRACE\n");
+}
+#endif
+
 int64_t da_indexof_impl(void* arr, void* elem, size_t elem_size) {
     if (!arr) return -1;
     da_header_t* header = (da_header_t*)arr - 1;
@@ -30,13 +298,9 @@ int64_t da_indexof_impl(void* arr, void* elem, size_t elem_size) {
 }
 
 void da_strcat(char **da, char *str) {
-    for (size_t i = 0; str[i] > 0; ++i) {
-        da_append(*da, str[i]);
-    }
+    da_append_n(*da, str, strlen(str));
 }
 
 void da_strncat(char **da, char *str, size_t n) {
-    for (size_t i = 0; i < n; ++i) {
-        da_append(*da, str[i]);
-    }
+    da_append_n(*da, str, n);
 }
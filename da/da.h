@@ -2,20 +2,65 @@
 #define DA_H
 
 #include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
 
 #define DA_DEFAULT_CAPACITY 1000
-#define DA_META_SIZE     (3)
-#define DA_IDX_SIZE      (-DA_META_SIZE+0)
-#define DA_IDX_CAP       (-DA_META_SIZE+1)
-#define DA_IDX_ELEM_SIZE (-DA_META_SIZE+2)
+#define DA_DEFAULT_GROWTH   200 // percent, i.e. double when full
 
+// Header flags
+#define DA_FLAG_INLINE 1 // storage is not heap allocated, never realloc/free it
+
+// The elements start right after the header, so its size is kept a multiple
+// of the alignment malloc gives (16 bytes on x86-64, for long double or SSE)
 typedef struct {
-    size_t size;
+    _Alignas(max_align_t) size_t size;
     size_t capacity;
+    uint32_t growth; // new capacity = capacity * growth / 100 when full
+    uint32_t flags;
+#ifdef DA_TRACE
+    uint32_t site;      // index into the call site table
+    uint32_t elem_size;
+    void* trace_prev;   // live arrays are kept in a list so the report can see their sizes
+    void* trace_next;
+#endif
 } da_header_t;
 
+// Growth policy for arrays that are expected to stay small.
+// Pass to da_init or da_append_policy.
+typedef struct {
+    size_t initial_capacity;
+    uint32_t growth;
+} da_policy_t;
+
+#define DA_POLICY(initial, growth) ((da_policy_t){(initial), (growth)})
+#define DA_POLICY_SMALL DA_POLICY(4, 200)
+
 void* da_reserve_impl(void*, size_t, size_t);
+void* da_grow_impl(void*, size_t);
+void* da_init_impl(void*, da_policy_t, size_t);
+void* da_grow_n_impl(void*, size_t, size_t);
+void da_free_impl(void*);
+
+/*
+ * Allocation tracing. Build everything (including da.c) with -DDA_TRACE to
+ * record every reservation by the call site of the da macro. A report sorted
+ * by wasted bytes is written to stderr at exit, or with da_trace_report.
+ * The trace state is behind a mutex, arrays can be used from any thread.
+ */
+#ifdef DA_TRACE
+void* da_reserve_trace(void*, size_t, size_t, const char*, int);
+void* da_grow_trace(void*, size_t, const char*, int);
+void* da_init_trace(void*, da_policy_t, size_t, const char*, int);
+void* da_grow_n_trace(void*, size_t, size_t, const char*, int);
+#define da_reserve_impl(arr, cap, elem_size) da_reserve_trace(arr, cap, elem_size, __FILE__, __LINE__)
+#define da_grow_impl(arr, elem_size) da_grow_trace(arr, elem_size, __FILE__, __LINE__)
+#define da_init_impl(arr, policy, elem_size) da_init_trace(arr, policy, elem_size, __FILE__, __LINE__)
+#define da_grow_n_impl(arr, n, elem_size) da_grow_n_trace(arr, n, elem_size, __FILE__, __LINE__)
+#endif
+void da_trace_report(FILE* stream);
 
 #define da_header(arr) (((da_header_t*)(arr)) - 1)
 
@@ -27,27 +72,96 @@ void* da_reserve_impl(void*, size_t, size_t);
     da_header(arr)->size = new_size;\
     } while (0);
 
+// Allocate arr according to policy. No-op if arr is already allocated.
+#define da_init(arr, policy) do {\
+    if (!(arr)) (arr) = da_init_impl((arr), (policy), sizeof(*(arr)));\
+    } while (0);
+
 #define da_append(arr, x) do {\
-    if (!(arr)) da_reserve(arr, DA_DEFAULT_CAPACITY);\
-    if (da_header(arr)->size == da_header(arr)->capacity) {\
-        da_reserve(arr, 2 * da_header(arr)->capacity);\
+    if (!(arr) || da_header(arr)->size == da_header(arr)->capacity) {\
+        (arr) = da_grow_impl((arr), sizeof(*(arr)));\
     }\
     (arr)[da_header(arr)->size++] = x;\
     } while (0);
 
+// Like da_append, but the first append allocates according to policy
+#define da_append_policy(arr, x, policy) do {\
+    da_init(arr, policy);\
+    da_append(arr, x);\
+    } while (0);
+
+/*
+ * Bulk operations. These grow at most once and copy with memcpy.
+ * src must not point into arr, since arr may be reallocated.
+ */
+
+// Make room for n more elements, growing by the array's growth factor
+#define da_reserve_n(arr, n) if (!(arr) || da_header(arr)->capacity - da_header(arr)->size < (n)) {\
+    (arr) = da_grow_n_impl((arr), (n), sizeof(*(arr))); }
+
+// Append n elements from src
+#define da_append_n(arr, src, n) do {\
+    size_t da_n_ = (n);\
+    if (da_n_ == 0) break;\
+    da_reserve_n(arr, da_n_);\
+    memcpy((arr) + da_header(arr)->size, (src), da_n_ * sizeof(*(arr)));\
+    da_header(arr)->size += da_n_;\
+    } while (0);
+
+// Append all elements of the da src
+#define da_extend(arr, src) da_append_n(arr, src, da_size(src))
+
+// Insert n elements from src before index idx
+#define da_insert_n(arr, idx, src, n) do {\
+    size_t da_n_ = (n);\
+    size_t da_idx_ = (idx);\
+    if (da_n_ == 0) break;\
+    da_reserve_n(arr, da_n_);\
+    memmove((arr) + da_idx_ + da_n_, (arr) + da_idx_, (da_header(arr)->size - da_idx_) * sizeof(*(arr)));\
+    memcpy((arr) + da_idx_, (src), da_n_ * sizeof(*(arr)));\
+    da_header(arr)->size += da_n_;\
+    } while (0);
+
+/*
+ * Small buffer storage: the first n elements live inside the owning struct.
+ *
+ *   struct foo { int* items; DA_INLINE(int, 4) items_buf; };
+ *   da_init_inline(foo->items, foo->items_buf);
+ *
+ * The array moves to the heap the first time it outgrows the buffer. The
+ * owning struct must not be moved or copied while the array is inline.
+ */
+#define DA_INLINE(type, n) struct { da_header_t header; type data[n]; }
+
+#define da_init_inline(arr, buf) do {\
+    (buf).header = (da_header_t){\
+        .size = 0,\
+        .capacity = sizeof((buf).data) / sizeof((buf).data[0]),\
+        .growth = DA_DEFAULT_GROWTH,\
+        .flags = DA_FLAG_INLINE\
+    };\
+    (arr) = (buf).data;\
+    } while (0);
+
+#define da_is_inline(arr) ((arr) && (da_header(arr)->flags & DA_FLAG_INLINE))
+
 #define da_size(arr) ((arr) ? da_header(arr)->size : 0)
 
 #define da_pop(arr) (arr)[--da_header(arr)->size]
 
 #define da_clear(arr) if (arr) { da_header(arr)->size = 0; }
 
-#define da_deinit(arr) if (arr) { free(da_header(arr)); }
+#ifdef DA_TRACE
+#define da_deinit(arr) if ((arr) && !da_is_inline(arr)) { da_free_impl(arr); }
+#else
+#define da_deinit(arr) if ((arr) && !da_is_inline(arr)) { free(da_header(arr)); }
+#endif
 
 // Elem: pointer to element to find
 #define da_indexof(arr, elem) da_indexof_impl((arr), elem, sizeof (*(arr)))
 
 int64_t da_indexof_impl(void* arr, void* elem, size_t elem_size);
 
-void da_strcat(char **da, char *str); 
+void da_strcat(char **da, char *str);
 void da_strncat(char **da, char *str, size_t n);
 #endif
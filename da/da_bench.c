@@ -0,0 +1,104 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include "da.h"
+
+// Benchmarks of da, kept out of da_test since they take most of a second
+// and close to a gigabyte. Build with e.g. gcc -O2 -I. da_bench.c da.c -o da_bench
+
+#define WALLTIME(t) (((double)(t).tv_sec + 1e-6 * (double)(t).tv_usec)*1000.0)
+
+/*
+ * Benchmark: many short arrays, like AST children or NFA transitions.
+ * Each variant runs in a child so that peak RSS is measured in isolation.
+ */
+
+#define BENCH_ARRAYS 200000
+#define BENCH_ELEMS  3
+
+typedef struct {
+    void** items;
+    DA_INLINE(void*, BENCH_ELEMS) items_buf;
+} bench_owner_t;
+
+static void bench_small_arrays(int variant) {
+    bench_owner_t* owners = malloc(BENCH_ARRAYS * sizeof(bench_owner_t));
+    for (size_t i = 0; i < BENCH_ARRAYS; ++i) {
+        owners[i].items = NULL;
+        if (variant == 2) da_init_inline(owners[i].items, owners[i].items_buf);
+        for (size_t j = 0; j < BENCH_ELEMS; ++j) {
+            if (variant == 0) {
+                da_append(owners[i].items, &owners[i]);
+            } else {
+                da_append_policy(owners[i].items, &owners[i], DA_POLICY_SMALL);
+            }
+        }
+    }
+}
+
+static void bench_fork(const char* name, int variant) {
+    struct timeval t_start, t_end;
+    gettimeofday(&t_start, NULL);
+    pid_t pid = fork();
+    if (pid == 0) {
+        bench_small_arrays(variant);
+        _exit(0);
+    }
+    int status;
+    struct rusage usage;
+    wait4(pid, &status, 0, &usage);
+    gettimeofday(&t_end, NULL);
+    printf("%-16s: %8ld KB peak RSS, %7.3f ms\n", name, usage.ru_maxrss, WALLTIME(t_end) - WALLTIME(t_start));
+}
+
+void da_small_array_benchmark() {
+    printf("%d arrays of %d elements\n", BENCH_ARRAYS, BENCH_ELEMS);
+    bench_fork("default policy", 0);
+    bench_fork("small policy", 1);
+    bench_fork("inline buffer", 2);
+}
+
+/*
+ * Benchmark: copy a MB sized buffer into a da byte by byte, and in
+ * chunks with da_append_n.
+ */
+
+#define BENCH_BYTES (64 << 20)
+#define BENCH_CHUNK 4096
+
+static void bench_throughput(const char* name, const char* src, size_t chunk) {
+    struct timeval t_start, t_end;
+    char* dst = NULL;
+    gettimeofday(&t_start, NULL);
+    if (chunk == 1) {
+        for (size_t i = 0; i < BENCH_BYTES; ++i) {
+            da_append(dst, src[i]);
+        }
+    } else {
+        for (size_t i = 0; i < BENCH_BYTES; i += chunk) {
+            da_append_n(dst, &src[i], chunk);
+        }
+    }
+    gettimeofday(&t_end, NULL);
+    double ms = WALLTIME(t_end) - WALLTIME(t_start);
+    printf("%-16s: %7.3f ms, %8.1f MB/s\n", name, ms, (BENCH_BYTES >> 20) / (ms / 1000.0));
+    da_deinit(dst);
+}
+
+void da_bulk_benchmark() {
+    char* src = malloc(BENCH_BYTES);
+    for (size_t i = 0; i < BENCH_BYTES; ++i) src[i] = (char)i;
+    printf("Appending %d MB\n", BENCH_BYTES >> 20);
+    bench_throughput("da_append", src, 1);
+    bench_throughput("da_append_n", src, BENCH_CHUNK);
+    free(src);
+}
+
+int main() {
+    da_small_array_benchmark();
+    da_bulk_benchmark();
+    return 0;
+}
@@ -0,0 +1,113 @@
+#include "da_bitset.h"
+#include <string.h>
+
+void da_bitset_reserve(da_bitset_t* bs, size_t nbits) {
+    size_t words = (nbits + DA_BITSET_WORD_BITS - 1) / DA_BITSET_WORD_BITS;
+    size_t old_words = da_size(*bs);
+    if (words <= old_words) return;
+    if (!*bs) da_init(*bs, DA_POLICY(words, DA_DEFAULT_GROWTH));
+    da_reserve_n(*bs, words - old_words);
+    da_header(*bs)->size = words;
+    memset(*bs + old_words, 0, (words - old_words) * sizeof(uint64_t));
+}
+
+void da_bitset_clear(da_bitset_t bs) {
+    if (!bs) return;
+    memset(bs, 0, da_size(bs) * sizeof(uint64_t));
+}
+
+void da_bitset_copy(da_bitset_t* dst, da_bitset_t src) {
+    da_bitset_clear(*dst);
+    da_bitset_reserve(dst, da_bitset_capacity(src));
+    if (src) memcpy(*dst, src, da_size(src) * sizeof(uint64_t));
+}
+
+int da_bitset_union(da_bitset_t* dst, da_bitset_t src) {
+    size_t n = da_size(src);
+    // Only grow for words that add bits
+    while (n > 0 && src[n - 1] == 0) --n;
+    da_bitset_reserve(dst, n * DA_BITSET_WORD_BITS);
+
+    uint64_t changed = 0;
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t old = (*dst)[i];
+        (*dst)[i] = old | src[i];
+        changed |= old ^ (*dst)[i];
+    }
+    return changed != 0;
+}
+
+int da_bitset_intersect(da_bitset_t dst, da_bitset_t src) {
+    size_t n_dst = da_size(dst);
+    size_t n_src = da_size(src);
+    uint64_t changed = 0;
+    for (size_t i = 0; i < n_dst; ++i) {
+        uint64_t old = dst[i];
+        dst[i] = i < n_src ? old & src[i] : 0;
+        changed |= old ^ dst[i];
+    }
+    return changed != 0;
+}
+
+int da_bitset_difference(da_bitset_t dst, da_bitset_t src) {
+    size_t n = da_size(dst) < da_size(src) ? da_size(dst) : da_size(src);
+    uint64_t changed = 0;
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t old = dst[i];
+        dst[i] = old & ~src[i];
+        changed |= old ^ dst[i];
+    }
+    return changed != 0;
+}
+
+size_t da_bitset_count(da_bitset_t bs) {
+    size_t count = 0;
+    for (size_t i = 0; i < da_size(bs); ++i) {
+        count += __builtin_popcountll(bs[i]);
+    }
+    return count;
+}
+
+int da_bitset_empty(da_bitset_t bs) {
+    for (size_t i = 0; i < da_size(bs); ++i) {
+        if (bs[i]) return 0;
+    }
+    return 1;
+}
+
+size_t da_bitset_next(da_bitset_t bs, size_t from) {
+    size_t word = from / DA_BITSET_WORD_BITS;
+    size_t n = da_size(bs);
+    if (word >= n) return DA_BITSET_END;
+
+    // Mask off the bits below from in the first word
+    uint64_t cur = bs[word] & (~(uint64_t)0 << (from % DA_BITSET_WORD_BITS));
+    for (;;) {
+        if (cur) return word * DA_BITSET_WORD_BITS + __builtin_ctzll(cur);
+        if (++word >= n) return DA_BITSET_END;
+        cur = bs[word];
+    }
+}
+
+// Number of words up to and including the last nonzero one
+static size_t used_words(da_bitset_t bs) {
+    size_t n = da_size(bs);
+    while (n > 0 && bs[n - 1] == 0) --n;
+    return n;
+}
+
+int da_bitset_equals(da_bitset_t a, da_bitset_t b) {
+    size_t n = used_words(a);
+    if (n != used_words(b)) return 0;
+    return n == 0 || memcmp(a, b, n * sizeof(uint64_t)) == 0;
+}
+
+uint64_t da_bitset_hash(da_bitset_t bs) {
+    size_t n = used_words(bs);
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < n; ++i) {
+        hash = (hash ^ bs[i]) * 1099511628211ULL;
+        hash ^= hash >> 32;
+    }
+    return hash;
+}
@@ -0,0 +1,72 @@
+#ifndef DA_BITSET_H
+#define DA_BITSET_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "da.h"
+
+/*
+ * Bitset on top of da: a da of 64 bit words. A NULL pointer is the empty
+ * set, and bits past the end read as zero, so sets of different length
+ * can be combined freely. Functions that may grow the set take a pointer
+ * to it.
+ *
+ *   da_bitset_t live = NULL;
+ *   da_bitset_set(&live, 42);
+ *   for (size_t i = da_bitset_next(live, 0); i != DA_BITSET_END; i = da_bitset_next(live, i + 1)) ...
+ *   da_bitset_deinit(live);
+ */
+
+typedef uint64_t* da_bitset_t;
+
+#define DA_BITSET_WORD_BITS 64
+#define DA_BITSET_END SIZE_MAX
+
+#define da_bitset_deinit(bs) da_deinit(bs)
+
+// Number of bits the set can hold without growing
+#define da_bitset_capacity(bs) (da_size(bs) * DA_BITSET_WORD_BITS)
+
+// Make room for bit nbits - 1
+void da_bitset_reserve(da_bitset_t* bs, size_t nbits);
+
+static inline int da_bitset_test(da_bitset_t bs, size_t i) {
+    size_t word = i / DA_BITSET_WORD_BITS;
+    if (word >= da_size(bs)) return 0;
+    return (bs[word] >> (i % DA_BITSET_WORD_BITS)) & 1;
+}
+
+static inline void da_bitset_set(da_bitset_t* bs, size_t i) {
+    size_t word = i / DA_BITSET_WORD_BITS;
+    if (word >= da_size(*bs)) da_bitset_reserve(bs, i + 1);
+    (*bs)[word] |= (uint64_t)1 << (i % DA_BITSET_WORD_BITS);
+}
+
+static inline void da_bitset_unset(da_bitset_t bs, size_t i) {
+    size_t word = i / DA_BITSET_WORD_BITS;
+    if (word >= da_size(bs)) return;
+    bs[word] &= ~((uint64_t)1 << (i % DA_BITSET_WORD_BITS));
+}
+
+// Unset all bits, keeping the storage
+void   da_bitset_clear(da_bitset_t bs);
+void   da_bitset_copy(da_bitset_t* dst, da_bitset_t src);
+
+// In place set operations on dst. Return 1 if dst changed, for fixed point iteration.
+int    da_bitset_union(da_bitset_t* dst, da_bitset_t src);
+int    da_bitset_intersect(da_bitset_t dst, da_bitset_t src);
+int    da_bitset_difference(da_bitset_t dst, da_bitset_t src);
+
+size_t da_bitset_count(da_bitset_t bs);
+int    da_bitset_empty(da_bitset_t bs);
+// Index of the first set bit >= from, or DA_BITSET_END
+size_t da_bitset_next(da_bitset_t bs, size_t from);
+
+// Equality and hash ignore trailing zero words, so they only depend on the set contents
+int      da_bitset_equals(da_bitset_t a, da_bitset_t b);
+uint64_t da_bitset_hash(da_bitset_t bs);
+
+#define da_bitset_foreach(bs, i) \
+    for (size_t i = da_bitset_next((bs), 0); i != DA_BITSET_END; i = da_bitset_next((bs), i + 1))
+
+#endif // DA_BITSET_H
@@ -0,0 +1,100 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "da_bitset.h"
+
+void print_bitset(const char* name, da_bitset_t bs) {
+    printf("%s (%zu):", name, da_bitset_count(bs));
+    da_bitset_foreach(bs, i) {
+        printf(" %zu", i);
+    }
+    printf("\n");
+}
+
+void da_bitset_ops_test() {
+    da_bitset_t a = NULL;
+    da_bitset_t b = NULL;
+
+    da_bitset_set(&a, 1);
+    da_bitset_set(&a, 63);
+    da_bitset_set(&a, 64);
+    da_bitset_set(&a, 200);
+    da_bitset_set(&b, 63);
+    da_bitset_set(&b, 100);
+    print_bitset("a", a);
+    print_bitset("b", b);
+
+    da_bitset_t c = NULL;
+    da_bitset_copy(&c, a);
+    printf("union changed: %d\n", da_bitset_union(&c, b));
+    printf("union again changed: %d\n", da_bitset_union(&c, b));
+    print_bitset("a | b", c);
+
+    da_bitset_copy(&c, a);
+    da_bitset_intersect(c, b);
+    print_bitset("a & b", c);
+
+    da_bitset_copy(&c, a);
+    da_bitset_difference(c, b);
+    print_bitset("a - b", c);
+
+    // Equality does not depend on storage length
+    da_bitset_t d = NULL;
+    da_bitset_set(&d, 500);
+    da_bitset_unset(d, 500);
+    da_bitset_set(&d, 63);
+    da_bitset_t e = NULL;
+    da_bitset_set(&e, 63);
+    printf("equal: %d, same hash: %d\n", da_bitset_equals(d, e), da_bitset_hash(d) == da_bitset_hash(e));
+    printf("test 63: %d, test 62: %d, test 10000: %d\n", da_bitset_test(d, 63), da_bitset_test(d, 62), da_bitset_test(d, 10000));
+
+    da_bitset_clear(d);
+    printf("empty after clear: %d\n", da_bitset_empty(d));
+
+    da_bitset_deinit(a);
+    da_bitset_deinit(b);
+    da_bitset_deinit(c);
+    da_bitset_deinit(d);
+    da_bitset_deinit(e);
+}
+
+// Iteration and count checked against a plain array
+void da_bitset_random_test() {
+    enum { N = 10000 };
+    char* ref = calloc(N, 1);
+    da_bitset_t bs = NULL;
+    srand(1);
+    for (int it = 0; it < 50000; ++it) {
+        size_t i = rand() % N;
+        if (rand() % 2) {
+            da_bitset_set(&bs, i);
+            ref[i] = 1;
+        } else {
+            da_bitset_unset(bs, i);
+            ref[i] = 0;
+        }
+    }
+    size_t expected = 0;
+    size_t next = da_bitset_next(bs, 0);
+    for (size_t i = 0; i < N; ++i) {
+        if (!ref[i]) continue;
+        expected++;
+        if (next != i) {
+            printf("Iteration mismatch at %zu\n", i);
+            exit(1);
+        }
+        next = da_bitset_next(bs, i + 1);
+    }
+    if (next != DA_BITSET_END || da_bitset_count(bs) != expected) {
+        printf("Count mismatch\n");
+        exit(1);
+    }
+    printf("Random test OK, %zu bits set\n", expected);
+    free(ref);
+    da_bitset_deinit(bs);
+}
+
+int main() {
+    da_bitset_ops_test();
+    da_bitset_random_test();
+    return 0;
+}
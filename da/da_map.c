@@ -0,0 +1,169 @@
+#include "da_map.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define DA_MAP_DEFAULT_CAPACITY 16
+
+uint64_t da_hash_u64(uint64_t x) {
+    // splitmix64 finalizer
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+uint64_t da_hash_bytes(const void* data, size_t size) {
+    // FNV-1a
+    const unsigned char* bytes = data;
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+uint64_t da_map_hash_str(const void* key) {
+    const char* str = *(const char**)key;
+    return da_hash_bytes(str, strlen(str));
+}
+
+int da_map_eq_str(const void* key_a, const void* key_b) {
+    return strcmp(*(const char**)key_a, *(const char**)key_b) == 0;
+}
+
+uint64_t da_map_hash_ptr(const void* key) {
+    return (uint64_t)(uintptr_t)*(void**)key;
+}
+
+int da_map_eq_ptr(const void* key_a, const void* key_b) {
+    return *(void**)key_a == *(void**)key_b;
+}
+
+// User hashes need not be well mixed (e.g. pointers), so mix before masking.
+// 0 is reserved for empty slots.
+static uint64_t stored_hash(da_map_t* map, const void* key) {
+    uint64_t hash = da_hash_u64(map->hash(key));
+    return hash ? hash : 1;
+}
+
+static void alloc_slots(da_map_t* map, size_t capacity) {
+    map->hashes = calloc(capacity, sizeof(uint64_t));
+    map->keys = malloc(capacity * map->key_size);
+    map->vals = malloc(capacity * map->val_size);
+    map->mask = capacity - 1;
+}
+
+void da_map_init_impl(da_map_t* map, size_t key_size, size_t val_size,
+                      da_map_hash_fn hash, da_map_eq_fn eq, size_t capacity) {
+    size_t cap = DA_MAP_DEFAULT_CAPACITY;
+    while (cap < capacity) cap <<= 1;
+
+    map->key_size = key_size;
+    map->val_size = val_size;
+    map->size = 0;
+    map->hash = hash;
+    map->eq = eq;
+    alloc_slots(map, cap);
+}
+
+void da_map_deinit(da_map_t* map) {
+    free(map->hashes);
+    free(map->keys);
+    free(map->vals);
+    map->hashes = NULL;
+    map->keys = NULL;
+    map->vals = NULL;
+    map->size = 0;
+    map->mask = 0;
+}
+
+void da_map_clear(da_map_t* map) {
+    memset(map->hashes, 0, (map->mask + 1) * sizeof(uint64_t));
+    map->size = 0;
+}
+
+// Slot holding key, or the empty slot where it would go
+static size_t find_slot(da_map_t* map, const void* key, uint64_t hash) {
+    size_t idx = hash & map->mask;
+    for (;;) {
+        uint64_t cur = map->hashes[idx];
+        if (cur == 0) return idx;
+        if (cur == hash && map->eq(da_map_key_at(map, idx), key)) return idx;
+        idx = (idx + 1) & map->mask;
+    }
+}
+
+static void grow(da_map_t* map) {
+    da_map_t old = *map;
+    alloc_slots(map, (old.mask + 1) * 2);
+    for (size_t i = 0; i <= old.mask; ++i) {
+        uint64_t hash = old.hashes[i];
+        if (hash == 0) continue;
+        size_t idx = hash & map->mask;
+        while (map->hashes[idx] != 0) idx = (idx + 1) & map->mask;
+        map->hashes[idx] = hash;
+        memcpy(da_map_key_at(map, idx), da_map_key_at(&old, i), map->key_size);
+        memcpy(da_map_val_at(map, idx), da_map_val_at(&old, i), map->val_size);
+    }
+    free(old.hashes);
+    free(old.keys);
+    free(old.vals);
+}
+
+void* da_map_get(da_map_t* map, const void* key) {
+    if (map->size == 0) return NULL;
+    size_t idx = find_slot(map, key, stored_hash(map, key));
+    if (map->hashes[idx] == 0) return NULL;
+    return da_map_val_at(map, idx);
+}
+
+static void* insert(da_map_t* map, const void* key, const void* val, int overwrite) {
+    // Keep load factor below 3/4
+    if ((map->size + 1) * 4 > (map->mask + 1) * 3) grow(map);
+
+    uint64_t hash = stored_hash(map, key);
+    size_t idx = find_slot(map, key, hash);
+    if (map->hashes[idx] == 0) {
+        map->hashes[idx] = hash;
+        memcpy(da_map_key_at(map, idx), key, map->key_size);
+        map->size++;
+    } else if (!overwrite) {
+        return da_map_val_at(map, idx);
+    }
+    memcpy(da_map_val_at(map, idx), val, map->val_size);
+    return da_map_val_at(map, idx);
+}
+
+void* da_map_put(da_map_t* map, const void* key, const void* val) {
+    return insert(map, key, val, 1);
+}
+
+void* da_map_get_or_put(da_map_t* map, const void* key, const void* val) {
+    return insert(map, key, val, 0);
+}
+
+int da_map_remove(da_map_t* map, const void* key) {
+    if (map->size == 0) return 0;
+    size_t idx = find_slot(map, key, stored_hash(map, key));
+    if (map->hashes[idx] == 0) return 0;
+
+    // Backward shift deletion: pull later entries of the probe run into the hole
+    size_t hole = idx;
+    size_t cur = (idx + 1) & map->mask;
+    while (map->hashes[cur] != 0) {
+        size_t home = map->hashes[cur] & map->mask;
+        // Move cur into hole if its home is not in (hole, cur]
+        if (((cur - home) & map->mask) >= ((cur - hole) & map->mask)) {
+            map->hashes[hole] = map->hashes[cur];
+            memcpy(da_map_key_at(map, hole), da_map_key_at(map, cur), map->key_size);
+            memcpy(da_map_val_at(map, hole), da_map_val_at(map, cur), map->val_size);
+            hole = cur;
+        }
+        cur = (cur + 1) & map->mask;
+    }
+    map->hashes[hole] = 0;
+    map->size--;
+    return 1;
+}
@@ -0,0 +1,75 @@
+#ifndef DA_MAP_H
+#define DA_MAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Open addressing hash map with linear probing.
+ *
+ * Keys and values are stored by value, key_size/val_size bytes each. The
+ * hash function gets a pointer to the key, so for a map keyed on char* it
+ * receives a char**. The full hash of every occupied slot is stored, which
+ * makes probing cheap and growing free of rehashing.
+ *
+ *   da_map_t map;
+ *   da_map_init(&map, char*, int, da_map_hash_str, da_map_eq_str);
+ *   int one = 1;
+ *   char* key = "one";
+ *   da_map_put(&map, &key, &one);
+ *   int* val = da_map_get(&map, &key);
+ */
+
+typedef uint64_t (*da_map_hash_fn)(const void* key);
+typedef int      (*da_map_eq_fn)(const void* key_a, const void* key_b);
+
+typedef struct {
+    uint64_t* hashes; // 0 marks an empty slot
+    char* keys;
+    char* vals;
+    size_t key_size;
+    size_t val_size;
+    size_t size;
+    size_t mask;      // capacity - 1, capacity is a power of two
+    da_map_hash_fn hash;
+    da_map_eq_fn eq;
+} da_map_t;
+
+#define da_map_init(map, key_type, val_type, hash, eq) \
+    da_map_init_impl((map), sizeof(key_type), sizeof(val_type), (hash), (eq), 0)
+
+// Capacity is rounded up to a power of two, 0 picks a default
+void da_map_init_impl(da_map_t* map, size_t key_size, size_t val_size,
+                      da_map_hash_fn hash, da_map_eq_fn eq, size_t capacity);
+void da_map_deinit(da_map_t* map);
+void da_map_clear(da_map_t* map);
+
+#define da_map_size(map) ((map)->size)
+#define da_map_is_init(map) ((map)->hashes != NULL)
+
+// Pointer to the value stored for key, or NULL
+void* da_map_get(da_map_t* map, const void* key);
+// Insert or overwrite. Returns pointer to the stored value.
+void* da_map_put(da_map_t* map, const void* key, const void* val);
+// Insert if key is absent. Returns pointer to the stored value, which is the
+// existing one if key was already present.
+void* da_map_get_or_put(da_map_t* map, const void* key, const void* val);
+// Returns 1 if key was present
+int   da_map_remove(da_map_t* map, const void* key);
+
+// Iteration over slots: for (size_t i = 0; i <= map.mask; ++i) if (da_map_used(&map, i)) ...
+#define da_map_used(map, i) ((map)->hashes[i] != 0)
+#define da_map_key_at(map, i) ((void*)((map)->keys + (i) * (map)->key_size))
+#define da_map_val_at(map, i) ((void*)((map)->vals + (i) * (map)->val_size))
+
+// Hash helpers
+uint64_t da_hash_u64(uint64_t x);
+uint64_t da_hash_bytes(const void* data, size_t size);
+
+// Ready made hash/eq for common key types
+uint64_t da_map_hash_str(const void* key); // key is char*
+int      da_map_eq_str(const void* key_a, const void* key_b);
+uint64_t da_map_hash_ptr(const void* key); // key is any pointer, compared by address
+int      da_map_eq_ptr(const void* key_a, const void* key_b);
+
+#endif // DA_MAP_H
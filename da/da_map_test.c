@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include "da.h"
+#include "da_map.h"
+
+#define WALLTIME(t) (((double)(t).tv_sec + 1e-6 * (double)(t).tv_usec)*1000.0)
+
+uint64_t hash_int(const void* key) {
+    return *(const int*)key;
+}
+
+int eq_int(const void* a, const void* b) {
+    return *(const int*)a == *(const int*)b;
+}
+
+void da_map_str_test() {
+    da_map_t map;
+    da_map_init(&map, char*, int, da_map_hash_str, da_map_eq_str);
+
+    char* keys[] = {"uri", "text", "range", "start", "end", "line", "character"};
+    for (int i = 0; i < 7; ++i) {
+        da_map_put(&map, &keys[i], &i);
+    }
+
+    char lookup[] = "range";
+    char* lookup_ptr = lookup;
+    int* val = da_map_get(&map, &lookup_ptr);
+    printf("range -> %d\n", val ? *val : -1);
+
+    char* missing = "missing";
+    printf("missing -> %s\n", da_map_get(&map, &missing) ? "found" : "NULL");
+
+    int other = 100;
+    val = da_map_get_or_put(&map, &keys[0], &other);
+    printf("get_or_put existing uri -> %d\n", *val);
+    da_map_put(&map, &keys[0], &other);
+    printf("put uri -> %d\n", *(int*)da_map_get(&map, &keys[0]));
+
+    da_map_remove(&map, &keys[1]);
+    printf("Size after remove: %zu, text -> %s\n", da_map_size(&map), da_map_get(&map, &keys[1]) ? "found" : "NULL");
+
+    da_map_deinit(&map);
+}
+
+// Random puts and removes checked against a plain array
+void da_map_random_test() {
+    da_map_t map;
+    da_map_init(&map, int, int, hash_int, eq_int);
+
+    enum { N = 4096 };
+    int* ref = malloc(N * sizeof(int));
+    for (int i = 0; i < N; ++i) ref[i] = -1;
+
+    srand(1);
+    for (int it = 0; it < 200000; ++it) {
+        int key = rand() % N;
+        if (rand() % 3 == 0) {
+            int removed = da_map_remove(&map, &key);
+            if (removed != (ref[key] != -1)) {
+                printf("Remove mismatch on %d\n", key);
+                exit(1);
+            }
+            ref[key] = -1;
+        } else {
+            da_map_put(&map, &key, &it);
+            ref[key] = it;
+        }
+    }
+
+    size_t count = 0;
+    for (int key = 0; key < N; ++key) {
+        int* val = da_map_get(&map, &key);
+        if ((val == NULL) != (ref[key] == -1) || (val && *val != ref[key])) {
+            printf("Lookup mismatch on %d\n", key);
+            exit(1);
+        }
+        count += val != NULL;
+    }
+    printf("Random test OK, %zu keys\n", count);
+    free(ref);
+    da_map_deinit(&map);
+}
+
+/*
+ * Benchmark: string key lookups, linear scan (like json_obj_get) vs. da_map
+ */
+void da_map_benchmark() {
+    int sizes[] = {4, 16, 64, 1024};
+    enum { LOOKUPS = 2000000 };
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+        int n = sizes[s];
+        char** keys = NULL;
+        da_map_t map;
+        da_map_init(&map, char*, int, da_map_hash_str, da_map_eq_str);
+        for (int i = 0; i < n; ++i) {
+            char buf[32];
+            snprintf(buf, sizeof buf, "key_%d", i);
+            char* key = strdup(buf);
+            da_append(keys, key);
+            da_map_put(&map, &key, &i);
+        }
+
+        struct timeval t_start, t_linear, t_map;
+        long sum_linear = 0, sum_map = 0;
+        gettimeofday(&t_start, NULL);
+        for (int it = 0; it < LOOKUPS; ++it) {
+            char* key = keys[(it * 7) % n];
+            for (int i = 0; i < n; ++i) {
+                if (strcmp(keys[i], key) == 0) {
+                    sum_linear += i;
+                    break;
+                }
+            }
+        }
+        gettimeofday(&t_linear, NULL);
+        for (int it = 0; it < LOOKUPS; ++it) {
+            char* key = keys[(it * 7) % n];
+            sum_map += *(int*)da_map_get(&map, &key);
+        }
+        gettimeofday(&t_map, NULL);
+
+        printf("%5d keys: linear %8.3f ms, da_map %8.3f ms%s\n", n,
+               WALLTIME(t_linear) - WALLTIME(t_start),
+               WALLTIME(t_map) - WALLTIME(t_linear),
+               sum_linear == sum_map ? "" : " (MISMATCH)");
+
+        for (int i = 0; i < n; ++i) free(keys[i]);
+        da_deinit(keys);
+        da_map_deinit(&map);
+    }
+}
+
+int main() {
+    da_map_str_test();
+    da_map_random_test();
+    da_map_benchmark();
+    return 0;
+}
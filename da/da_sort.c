@@ -0,0 +1,71 @@
+#include "da_sort.h"
+#include <stdlib.h>
+#include <string.h>
+
+static void insertion_sort(uint64_t* arr, size_t n) {
+    for (size_t i = 1; i < n; ++i) {
+        uint64_t key = arr[i];
+        size_t j = i;
+        while (j > 0 && arr[j - 1] > key) {
+            arr[j] = arr[j - 1];
+            --j;
+        }
+        arr[j] = key;
+    }
+}
+
+static void radix_sort(uint64_t* arr, size_t n) {
+    // One histogram per byte, all filled in a single pass
+    size_t counts[8][256];
+    memset(counts, 0, sizeof(counts));
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t key = arr[i];
+        for (int b = 0; b < 8; ++b) {
+            counts[b][(key >> (8 * b)) & 0xff]++;
+        }
+    }
+
+    uint64_t* tmp = malloc(n * sizeof(uint64_t));
+    uint64_t* src = arr;
+    uint64_t* dst = tmp;
+    for (int b = 0; b < 8; ++b) {
+        size_t* count = counts[b];
+        // All keys share this byte, the pass would not move anything
+        if (count[(src[0] >> (8 * b)) & 0xff] == n) continue;
+
+        size_t offset = 0;
+        for (int d = 0; d < 256; ++d) {
+            size_t c = count[d];
+            count[d] = offset;
+            offset += c;
+        }
+        for (size_t i = 0; i < n; ++i) {
+            uint64_t key = src[i];
+            dst[count[(key >> (8 * b)) & 0xff]++] = key;
+        }
+        uint64_t* swap = src;
+        src = dst;
+        dst = swap;
+    }
+
+    if (src != arr) memcpy(arr, src, n * sizeof(uint64_t));
+    free(tmp);
+}
+
+void da_sort_u64_n(uint64_t* arr, size_t n) {
+    if (n <= DA_SORT_INSERTION_MAX) {
+        insertion_sort(arr, n);
+    } else {
+        radix_sort(arr, n);
+    }
+}
+
+size_t da_sort_unique_u64_n(uint64_t* arr, size_t n) {
+    if (n == 0) return 0;
+    da_sort_u64_n(arr, n);
+    size_t out = 1;
+    for (size_t i = 1; i < n; ++i) {
+        if (arr[i] != arr[out - 1]) arr[out++] = arr[i];
+    }
+    return out;
+}
@@ -0,0 +1,38 @@
+#ifndef DA_SORT_H
+#define DA_SORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "da.h"
+
+/*
+ * Sorting for da arrays of 64 bit keys: integers, size_t indices and
+ * pointers (ordered by address). Small arrays use insertion sort, larger
+ * ones an LSD radix sort that skips byte positions where all keys agree.
+ */
+
+#define DA_SORT_INSERTION_MAX 32
+
+void   da_sort_u64_n(uint64_t* arr, size_t n);
+// Sort and drop duplicates, returns the new length
+size_t da_sort_unique_u64_n(uint64_t* arr, size_t n);
+
+#define DA_SORT_CHECK_KEY(arr) \
+    _Static_assert(sizeof(*(arr)) == sizeof(uint64_t), "da_sort needs 64 bit elements")
+
+// arr: da of uint64_t, int64_t is not supported (negative keys sort last)
+#define da_sort_u64(arr) do {\
+    DA_SORT_CHECK_KEY(arr);\
+    da_sort_u64_n((uint64_t*)(arr), da_size(arr));\
+    } while (0);
+
+// arr: da of pointers
+#define da_sort_ptr(arr) da_sort_u64(arr)
+
+// Sort and remove duplicates in place, for the same element types as above
+#define da_sort_unique(arr) do {\
+    DA_SORT_CHECK_KEY(arr);\
+    if (arr) da_header(arr)->size = da_sort_unique_u64_n((uint64_t*)(arr), da_size(arr));\
+    } while (0);
+
+#endif // DA_SORT_H
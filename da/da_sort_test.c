@@ -0,0 +1,113 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include "da.h"
+#include "da_sort.h"
+
+#define WALLTIME(t) (((double)(t).tv_sec + 1e-6 * (double)(t).tv_usec)*1000.0)
+
+static int comp_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static uint64_t rand_u64() {
+    return ((uint64_t)rand() << 42) ^ ((uint64_t)rand() << 21) ^ (uint64_t)rand();
+}
+
+void da_sort_small_test() {
+    size_t* arr = NULL;
+    size_t values[] = {5, 3, 9, 3, 1, 5, 0, 9};
+    da_append_n(arr, values, 8);
+    da_sort_u64(arr);
+    for (size_t i = 0; i < da_size(arr); ++i) {
+        printf("%zu%c", arr[i], " \n"[i==da_size(arr)-1]);
+    }
+    da_sort_unique(arr);
+    for (size_t i = 0; i < da_size(arr); ++i) {
+        printf("%zu%c", arr[i], " \n"[i==da_size(arr)-1]);
+    }
+    da_clear(arr);
+    da_sort_unique(arr);
+    printf("Size after unique on empty: %zu\n", da_size(arr));
+    da_deinit(arr);
+
+    int a, b, c;
+    int** ptrs = NULL;
+    da_append(ptrs, &c);
+    da_append(ptrs, &a);
+    da_append(ptrs, &b);
+    da_append(ptrs, &a);
+    da_sort_unique(ptrs);
+    int ok = da_size(ptrs) == 3;
+    for (size_t i = 1; i < da_size(ptrs); ++i) ok &= ptrs[i - 1] < ptrs[i];
+    printf("Pointer sort unique: %s\n", ok ? "OK" : "FAIL");
+    da_deinit(ptrs);
+}
+
+// Compare against qsort for sizes around the insertion sort cutoff and large inputs
+void da_sort_random_test() {
+    size_t sizes[] = {0, 1, 2, 31, 32, 33, 100, 1000, 100000};
+    srand(1);
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+        size_t n = sizes[s];
+        uint64_t* arr = malloc((n + 1) * sizeof(uint64_t));
+        uint64_t* ref = malloc((n + 1) * sizeof(uint64_t));
+        for (size_t i = 0; i < n; ++i) {
+            // Mix of small and full width keys
+            arr[i] = ref[i] = (i % 3 == 0) ? rand_u64() : (uint64_t)(rand() % 100);
+        }
+        da_sort_u64_n(arr, n);
+        qsort(ref, n, sizeof(uint64_t), comp_u64);
+        if (memcmp(arr, ref, n * sizeof(uint64_t)) != 0) {
+            printf("Sort mismatch for n = %zu\n", n);
+            exit(1);
+        }
+        free(arr);
+        free(ref);
+    }
+    printf("Random test OK\n");
+}
+
+/*
+ * Benchmark: qsort with a comparator vs. da_sort_u64 on index-like keys
+ */
+void da_sort_benchmark() {
+    size_t sizes[] = {16, 1000, 100000, 1000000};
+    srand(2);
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+        size_t n = sizes[s];
+        size_t reps = 2000000 / n + 1;
+        uint64_t* src = malloc(n * sizeof(uint64_t));
+        uint64_t* arr = malloc(n * sizeof(uint64_t));
+        for (size_t i = 0; i < n; ++i) src[i] = rand() % (4 * n);
+
+        struct timeval t_start, t_qsort, t_radix;
+        gettimeofday(&t_start, NULL);
+        for (size_t r = 0; r < reps; ++r) {
+            memcpy(arr, src, n * sizeof(uint64_t));
+            qsort(arr, n, sizeof(uint64_t), comp_u64);
+        }
+        gettimeofday(&t_qsort, NULL);
+        for (size_t r = 0; r < reps; ++r) {
+            memcpy(arr, src, n * sizeof(uint64_t));
+            da_sort_u64_n(arr, n);
+        }
+        gettimeofday(&t_radix, NULL);
+
+        double per_qsort = (WALLTIME(t_qsort) - WALLTIME(t_start)) / reps;
+        double per_radix = (WALLTIME(t_radix) - WALLTIME(t_qsort)) / reps;
+        printf("%8zu keys: qsort %10.4f ms, da_sort_u64 %10.4f ms\n", n, per_qsort, per_radix);
+        free(src);
+        free(arr);
+    }
+}
+
+int main() {
+    da_sort_small_test();
+    da_sort_random_test();
+    da_sort_benchmark();
+    return 0;
+}
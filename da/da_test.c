@@ -106,11 +106,84 @@ void da_test_2() {
     da_deinit(test_arr);
 }
 
+void da_policy_test() {
+    int* arr = NULL;
+    da_init(arr, DA_POLICY(2, 150));
+    printf("Initial capacity: %zu\n", da_header(arr)->capacity);
+    for (int i = 0; i < 5; ++i) {
+        da_append(arr, i);
+        printf("Size %zu, capacity %zu\n", da_size(arr), da_header(arr)->capacity);
+    }
+    da_deinit(arr);
+}
+
+void da_inline_test() {
+    struct {
+        int* items;
+        DA_INLINE(int, 3) items_buf;
+    } owner;
+    da_init_inline(owner.items, owner.items_buf);
+
+    for (int i = 0; i < 5; ++i) {
+        da_append(owner.items, i);
+        printf("Size %zu, inline %d\n", da_size(owner.items), da_is_inline(owner.items) ? 1 : 0);
+    }
+    for (size_t i = 0; i < da_size(owner.items); ++i) {
+        printf("%d%c", owner.items[i], " \n"[i==da_size(owner.items)-1]);
+    }
+    da_deinit(owner.items);
+}
+
+void da_align_test() {
+    long double* arr = NULL;
+    da_append(arr, 1.0L);
+    printf("Heap aligned: %d\n", (uintptr_t)arr % _Alignof(max_align_t) == 0);
+    da_deinit(arr);
+
+    struct {
+        long double* items;
+        DA_INLINE(long double, 2) items_buf;
+    } owner;
+    da_init_inline(owner.items, owner.items_buf);
+    printf("Inline aligned: %d\n", (uintptr_t)owner.items % _Alignof(max_align_t) == 0);
+}
+
+void da_bulk_test() {
+    int* arr = NULL;
+    int a[] = {1, 2, 3};
+    int b[] = {10, 20};
+    da_append_n(arr, a, 3);
+    da_insert_n(arr, 1, b, 2);
+    da_insert_n(arr, da_size(arr), b, 1);
+    int* other = NULL;
+    da_append(other, 42);
+    da_extend(arr, other);
+    da_deinit(other);
+    for (size_t i = 0; i < da_size(arr); ++i) {
+        printf("%d%c", arr[i], " \n"[i==da_size(arr)-1]);
+    }
+
+    char* str = NULL;
+    da_strcat(&str, "Hello, ");
+    da_strncat(&str, "World!!!", 6);
+    da_append(str, '\0');
+    printf("%s\n", str);
+
+    da_deinit(str);
+    da_deinit(arr);
+}
+
 int main() {
     da_int_test();
     da_string_test();
     da_indexof_test();
     da_resize_test();
     da_test_2();
+    da_policy_test();
+    da_inline_test();
+    da_align_test();
+    da_bulk_test();
+    // Build with -DDA_TRACE for a per call site report
+    da_trace_report(stdout);
     return 0;
 }
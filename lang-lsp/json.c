@@ -91,7 +91,7 @@ json_arr_t* parse_array() {
         char tok = peek();
 
         json_any_t el = parse_any();
-        da_append(arr->elements, el);
+        da_append_policy(arr->elements, el, DA_POLICY_SMALL);
 
         tok = peek();
 
@@ -240,8 +240,13 @@ char peek_expect_advance(char tok) {
 
 /* ------------------------------ JSON interface ------------------------------ */
 
-// TODO: trie or hashmap if necessary
 json_any_t json_obj_get(struct json_obj_t *obj, char *key) {
+    if (da_map_is_init(&obj->index)) {
+        size_t *idx = da_map_get(&obj->index, &key);
+        if (idx == NULL) return (json_any_t){.kind = JSON_NONE };
+        return obj->entries[*idx].val;
+    }
+
     for (size_t i = 0; i < da_size(obj->entries); ++i) {
         if (strcmp(key, obj->entries[i].key) == 0) {
             return obj->entries[i].val;
@@ -256,14 +261,28 @@ void json_obj_put(struct json_obj_t *obj, char *key, struct json_any_t val) {
         .key = key,
         .val = val
     };
-    da_append(obj->entries, kv);
+    da_append_policy(obj->entries, kv, DA_POLICY_SMALL);
+
+    size_t num_entries = da_size(obj->entries);
+    if (num_entries <= JSON_OBJ_INDEX_THRESHOLD) return;
+
+    if (!da_map_is_init(&obj->index)) {
+        da_map_init(&obj->index, char*, size_t, da_map_hash_str, da_map_eq_str);
+        for (size_t i = 0; i < num_entries; ++i) {
+            // First entry wins on duplicate keys, same as the linear scan
+            da_map_get_or_put(&obj->index, &obj->entries[i].key, &i);
+        }
+    } else {
+        size_t idx = num_entries - 1;
+        da_map_get_or_put(&obj->index, &obj->entries[idx].key, &idx);
+    }
 }
 
 void json_dumps(char **str, struct json_any_t json) {
     switch(json.kind) {
     case JSON_NONE:
         {
-            da_strncat(str, "null", 4);
+            da_append_n(*str, "null", 4);
         }
         break;
     case JSON_OBJ:
@@ -277,9 +296,8 @@ void json_dumps(char **str, struct json_any_t json) {
                 }
                 char *key = obj->entries[i].key;
                 da_append(*str, '"');
-                da_strncat(str, key, strlen(key));
-                da_append(*str, '"');
-                da_append(*str, ':');
+                da_append_n(*str, key, strlen(key));
+                da_append_n(*str, "\":", 2);
                 json_dumps(str, obj->entries[i].val);
             }
             da_append(*str, '}');
@@ -303,25 +321,24 @@ void json_dumps(char **str, struct json_any_t json) {
     case JSON_NUM:
         {
             // uuh
-            char buf[16];
-            memset(buf, 0, sizeof buf);
-            sprintf(buf, "%ld", json.num);
-            da_strncat(str, buf, strlen(buf));
+            char buf[32];
+            int len = snprintf(buf, sizeof buf, "%ld", json.num);
+            da_append_n(*str, buf, len);
         }
         break;
     case JSON_STR:
         {
             da_append(*str, '"');
-            da_strncat(str, json.str, strlen(json.str));
+            da_append_n(*str, json.str, strlen(json.str));
             da_append(*str, '"');
         }
         break;
     case JSON_BOL:
         {
             if (json.bol == true) {
-                da_strncat(str, "true", 4);
+                da_append_n(*str, "true", 4);
             } else {
-                da_strncat(str, "false", 5);
+                da_append_n(*str, "false", 5);
             }
         }
         break;
@@ -4,6 +4,8 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "da_map.h"
+
 enum JSON_TYPE {
     JSON_NONE,
     JSON_OBJ,
@@ -36,8 +38,12 @@ struct kv_pair_t {
 };
 
 
+// Objects with more entries than this get a hash index for json_obj_get
+#define JSON_OBJ_INDEX_THRESHOLD 8
+
 struct json_obj_t {
     struct kv_pair_t* entries; // da
+    da_map_t index; // key -> entry index, only initialized past JSON_OBJ_INDEX_THRESHOLD entries
 };
 
 struct json_arr_t {
@@ -62,9 +62,11 @@ void write_response(int64_t id, json_any_t result) {
     char *out = 0;
     json_dumps(&out, msg);
 
+    // out is not NUL terminated
     fprintf(stdout, "Content-Length: %zu\r\n\r\n", da_size(out));
-    fprintf(stdout, "%s", out);
+    fwrite(out, 1, da_size(out), stdout);
     fflush(stdout);
+    da_deinit(out);
 }
 
 void write_notification(char *method, json_any_t params) {
@@ -79,9 +81,11 @@ void write_notification(char *method, json_any_t params) {
     char *out = 0;
     json_dumps(&out, msg);
 
+    // out is not NUL terminated
     fprintf(stdout, "Content-Length: %zu\r\n\r\n", da_size(out));
-    fprintf(stdout, "%s", out);
+    fwrite(out, 1, da_size(out), stdout);
     fflush(stdout);
+    da_deinit(out);
 }
 
 void next_line() {
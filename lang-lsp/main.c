@@ -11,6 +11,7 @@
 #include "log.h"
 #include "semantic_tokens.h"
 
+#include "compilation.h"
 #include "fail.h"
 #include "lex.h"
 #include "parser.h"
@@ -21,7 +22,7 @@
 #include "type.h"
 #include "util.h"
 
-void publish_diagnostics(char *uri) {
+void publish_diagnostics(char *uri, struct diagnostic_t *diagnostics) {
     json_obj_t msg = {0};
     json_obj_put(&msg, "uri", JSON_ANY_STR(uri));
     json_arr_t diags = {0};
@@ -42,10 +43,11 @@ void publish_diagnostics(char *uri) {
     write_notification("textDocument/publishDiagnostics", params);
 
     // TODO: free memory or something
-    da_clear(diagnostics);
 }
 
-node_t *current_root = 0;
+// The last document that compiled, and the content it was lexed from
+compilation_t current = {0};
+char *current_content = 0;
 char *current_uri = 0;
 
 void handle_document(char *uri, char *content) {
@@ -58,6 +60,13 @@ void handle_document(char *uri, char *content) {
     da_reserve(content_da, content_len);
 
     for (size_t i = 0; i < content_len; ++i) {
+        // Copy everything up to the next escape in one go
+        char *escape = memchr(&content[i], '\\', content_len - i);
+        size_t run = escape ? (size_t)(escape - &content[i]) : content_len - i;
+        da_append_n(content_da, &content[i], run);
+        i += run;
+        if (i == content_len) break;
+
         if (i < content_len - 1 && content[i] == '\\') {
             switch(content[i+1]) {
                 case 'n':
@@ -87,40 +96,54 @@ void handle_document(char *uri, char *content) {
 
 
 
-    int err = setjmp(FAIL_JMP_ENV);
+    // Compile into a fresh compilation, it replaces current if it gets through.
+    // Static so it is intact after the longjmp.
+    static compilation_t next;
+    compilation_init(&next);
+    fail_init_diagnostic(&next);
+
+    int err = setjmp(next.fail_jmp_env);
 
     if (!err) {
         LOG("Init lex");
         // Not returned from longjmp
-        lexer_init(uri, content_da);
+        lexer_init(&next, uri, content_da, da_size(content_da));
 
         LOG("Parse");
 
-        parse();
+        parse(&next);
 
         LOG("Symbol");
 
-        create_symbol_tables();
+        create_symbol_tables(&next);
 
         LOG("Types");
 
-        register_types();
+        register_types(&next);
 
         LOG("Transform");
 
-        tree_transform(root);
+        tree_transform(&next);
 
         LOG("Tac");
 
         // sadly some checks are done in tac as well
-        generate_function_codes();
+        generate_function_codes(&next);
+    }
+    // publish to flush
+    publish_diagnostics(uri, next.diagnostics);
 
+    if (!err) {
         // should we copy to make sure not deleted?
-        current_root = root;
         current_uri = uri;
+        compilation_release(&current);
+        da_deinit(current_content);
+        current = next;
+        current_content = content_da;
+    } else {
+        compilation_release(&next);
+        da_deinit(content_da);
     }
-    // publish to flush
-    publish_diagnostics(uri);
 }
 
 void handle_notification(char *method, json_any_t params) {
@@ -182,7 +205,7 @@ void handle_request(int64_t id, char *method, json_any_t params) {
         char *uri = json_obj_get(text_document, "uri").str;
 
         if (uri_eq(uri, current_uri)) {
-            handle_semantic_tokens(id, current_root);
+            handle_semantic_tokens(id, &current);
         }
     }
 }
@@ -190,10 +213,6 @@ void handle_request(int64_t id, char *method, json_any_t params) {
 int main() {
     setvbuf(stdin, NULL, _IONBF, 0);
     log_init();
-    fail_init_diagnostic();
-
-    LOG("Fail mode: %d", fail_mode);
-
     for (;;) {
         json_obj_t *obj = next_request();
 
@@ -1,6 +1,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "compilation.h"
 #include "da.h"
 #include "json.h"
 #include "json_rpc.h"
@@ -12,7 +13,7 @@
 #include "tree.h"
 #include "type.h"
 
-static void traverse_semantic_tokens(node_t *node, json_any_t **data);
+static void traverse_semantic_tokens(node_id_t node, json_any_t **data);
 static int64_t prev_line;
 static int64_t prev_char;
 
@@ -55,12 +56,13 @@ json_obj_t* get_semantic_tokens_options() {
 /*
  * TODO: It is possible to be smart and only compute the necessary token (usually just like one)
  */
-void handle_semantic_tokens(int64_t request_id, node_t *root) {
+void handle_semantic_tokens(int64_t request_id, compilation_t* c) {
+    compilation = c;
     json_arr_t token_data = {0};
     prev_line = 0;
     prev_char = 0;
 
-    traverse_semantic_tokens(root, &token_data.elements);
+    traverse_semantic_tokens(c->root, &token_data.elements);
 
     json_obj_t result = {0};
 
@@ -71,7 +73,8 @@ void handle_semantic_tokens(int64_t request_id, node_t *root) {
     char *str = 0;
     json_dumps(&str, JSON_ANY_OBJ(&result));
 
-    LOG("%s", str);
+    LOG("%.*s", (int)da_size(str), str);
+    da_deinit(str);
 }
 
 void append_token(json_any_t **data, char *type_name, range_t range) {
@@ -110,32 +113,32 @@ void append_token(json_any_t **data, char *type_name, range_t range) {
     prev_char = range.start.character;
 }
 
-void traverse_semantic_tokens(node_t *node, json_any_t **data) {
-    if (node->leaf) {
-        if (node->type == STRING_LITERAL || node->type == CHAR_LITERAL) {
+void traverse_semantic_tokens(node_id_t node, json_any_t **data) {
+    if (NODE(node).leaf) {
+        if (NODE(node).type == STRING_LITERAL || NODE(node).type == CHAR_LITERAL) {
             range_t range = {
-                .start = lexer_offset_location(node->pos.begin_offset),
-                .end = lexer_offset_location(node->pos.end_offset)
+                .start = lexer_offset_location(node_pos(node).begin_offset),
+                .end = lexer_offset_location(node_pos(node).end_offset)
             };
 
             append_token(data, "string", range);
         }
 
-        if (node->type == INTEGER_LITERAL) {
+        if (NODE(node).type == INTEGER_LITERAL) {
             range_t range = {
-                .start = lexer_offset_location(node->pos.begin_offset),
-                .end = lexer_offset_location(node->pos.end_offset)
+                .start = lexer_offset_location(node_pos(node).begin_offset),
+                .end = lexer_offset_location(node_pos(node).end_offset)
             };
 
             append_token(data, "number", range);
         }
 
-        if (node->type == IDENTIFIER) {
-            if (node->symbol != NULL && node->type_info != NULL) {
-                type_info_t* type_info = node->type_info;
+        if (NODE(node).type == IDENTIFIER) {
+            if (node_symbol(node) != NULL && node_type_info(node) != NULL) {
+                type_info_t* type_info = node_type_info(node);
                 range_t range = {
-                    .start = lexer_offset_location(node->pos.begin_offset),
-                    .end = lexer_offset_location(node->pos.end_offset)
+                    .start = lexer_offset_location(node_pos(node).begin_offset),
+                    .end = lexer_offset_location(node_pos(node).end_offset)
                 };
 
                 if (type_info->type_class == TC_BASIC) {
@@ -143,21 +146,21 @@ void traverse_semantic_tokens(node_t *node, json_any_t **data) {
                 } else if (type_info->type_class == TC_FUNCTION) {
                     append_token(data, "function", range);
                 }
-            } else if (node->symbol != NULL) {
+            } else if (node_symbol(node) != NULL) {
                 // most likely a builtin
-            } else if (node->parent != NULL && node->parent->type == TYPE) {
+            } else if (node_parent(node) != 0 && NODE(node_parent(node)).type == TYPE) {
                 range_t range = {
-                    .start = lexer_offset_location(node->pos.begin_offset),
-                    .end = lexer_offset_location(node->pos.end_offset)
+                    .start = lexer_offset_location(node_pos(node).begin_offset),
+                    .end = lexer_offset_location(node_pos(node).end_offset)
                 };
                 append_token(data, "type", range);
             }
         }
 
-        if (node->type == BREAK_STATEMENT) {
+        if (NODE(node).type == BREAK_STATEMENT) {
             range_t range = {
-                .start = lexer_offset_location(node->pos.begin_offset),
-                .end = lexer_offset_location(node->pos.end_offset)
+                .start = lexer_offset_location(node_pos(node).begin_offset),
+                .end = lexer_offset_location(node_pos(node).end_offset)
             };
             append_token(data, "keyword", range);
         }
@@ -167,31 +170,31 @@ void traverse_semantic_tokens(node_t *node, json_any_t **data) {
     }
 
     // non-leaf handling (should be mostly keywords)
-    if (node->type == RETURN_STATEMENT && node->pos.type == LEX_RETURN) {
+    if (NODE(node).type == RETURN_STATEMENT && node_pos(node).type == LEX_RETURN) {
         // pos.type must be return when it is not fake
         range_t range = {
-            .start = lexer_offset_location(node->pos.begin_offset),
-            .end = lexer_offset_location(node->pos.end_offset)
+            .start = lexer_offset_location(node_pos(node).begin_offset),
+            .end = lexer_offset_location(node_pos(node).end_offset)
         };
         append_token(data, "keyword", range);
     }
 
-    if (node->type == IF_STATEMENT && node->pos.type == LEX_IF) {
+    if (NODE(node).type == IF_STATEMENT && node_pos(node).type == LEX_IF) {
         range_t range = {
-            .start = lexer_offset_location(node->pos.begin_offset),
-            .end = lexer_offset_location(node->pos.end_offset)
+            .start = lexer_offset_location(node_pos(node).begin_offset),
+            .end = lexer_offset_location(node_pos(node).end_offset)
         };
         append_token(data, "keyword", range);
 
         // expression
-        traverse_semantic_tokens(node->children[0], data);
+        traverse_semantic_tokens(node_child(node, 0), data);
 
         // block
-        traverse_semantic_tokens(node->children[1], data);
+        traverse_semantic_tokens(node_child(node, 1), data);
 
-        if (da_size(node->children) == 3) {
+        if (node_n_children(node) == 3) {
             // else!!
-            token_t else_pos = node->children[2]->pos;
+            token_t else_pos = node_pos(node_child(node, 2));
             if (else_pos.type == LEX_ELSE) {
                 range_t range = {
                     .start = lexer_offset_location(else_pos.begin_offset),
@@ -199,29 +202,29 @@ void traverse_semantic_tokens(node_t *node, json_any_t **data) {
                 };
                 append_token(data, "keyword", range);
             }
-            traverse_semantic_tokens(node->children[2], data);
+            traverse_semantic_tokens(node_child(node, 2), data);
         }
 
         return;
     }
 
-    if (node->type == WHILE_STATEMENT && node->pos.type == LEX_WHILE) {
+    if (NODE(node).type == WHILE_STATEMENT && node_pos(node).type == LEX_WHILE) {
         range_t range = {
-            .start = lexer_offset_location(node->pos.begin_offset),
-            .end = lexer_offset_location(node->pos.end_offset)
+            .start = lexer_offset_location(node_pos(node).begin_offset),
+            .end = lexer_offset_location(node_pos(node).end_offset)
         };
         append_token(data, "keyword", range);
     }
 
-    if (node->type == OPERATOR && node->pos.type == LEX_OPERATOR) {
+    if (NODE(node).type == OPERATOR && node_pos(node).type == LEX_OPERATOR) {
         range_t range = {
-            .start = lexer_offset_location(node->pos.begin_offset),
-            .end = lexer_offset_location(node->pos.end_offset)
+            .start = lexer_offset_location(node_pos(node).begin_offset),
+            .end = lexer_offset_location(node_pos(node).end_offset)
         };
         append_token(data, "operator", range);
     }
 
-    for (size_t i = 0; i < da_size(node->children); ++i) {
-        traverse_semantic_tokens(node->children[i], data);
+    for (size_t i = 0; i < node_n_children(node); ++i) {
+        traverse_semantic_tokens(node_child(node, i), data);
     }
 }
@@ -8,6 +8,6 @@
 
 json_obj_t* get_semantic_tokens_options();
 
-void handle_semantic_tokens(int64_t request_id, node_t *root);
+void handle_semantic_tokens(int64_t request_id, compilation_t* c);
 
 #endif // SEMANTIC_TOKENS_H
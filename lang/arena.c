@@ -0,0 +1,83 @@
+#include "arena.h"
+#include "da.h"
+
+#include <stdalign.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_BLOCK_SIZE (64 * 1024)
+#define ARENA_ALIGN alignof(max_align_t)
+
+struct arena_block_t {
+    arena_block_t* next;
+    alignas(max_align_t) char data[];
+};
+
+static size_t align_up(size_t size) {
+    return (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+}
+
+static arena_block_t* block_create(size_t size) {
+    arena_block_t* block = malloc(sizeof(arena_block_t) + size);
+    if (!block) {
+        abort();
+    }
+    return block;
+}
+
+void* arena_alloc(arena_t* arena, size_t size) {
+    size = align_up(size ? size : 1);
+    arena->bytes += size;
+    if (size <= (size_t)(arena->end - arena->ptr)) {
+        void* result = arena->ptr;
+        arena->ptr += size;
+        return result;
+    }
+
+    // Oversized objects get their own block behind the current one,
+    // so the free space of the current block is kept
+    if (size > ARENA_BLOCK_SIZE / 4) {
+        arena_block_t* block = block_create(size);
+        if (arena->blocks) {
+            block->next = arena->blocks->next;
+            arena->blocks->next = block;
+        } else {
+            block->next = NULL;
+            arena->blocks = block;
+        }
+        return block->data;
+    }
+
+    arena_block_t* block = block_create(ARENA_BLOCK_SIZE);
+    block->next = arena->blocks;
+    arena->blocks = block;
+    arena->ptr = block->data + size;
+    arena->end = block->data + ARENA_BLOCK_SIZE;
+    return block->data;
+}
+
+void* arena_calloc(arena_t* arena, size_t size) {
+    void* result = arena_alloc(arena, size);
+    memset(result, 0, size);
+    return result;
+}
+
+void arena_own_da(arena_t* arena, void* da_ptr) {
+    da_append(arena->owned_das, (void**)da_ptr);
+}
+
+void arena_release(arena_t* arena) {
+    for (size_t i = 0; i < da_size(arena->owned_das); ++i) {
+        void* arr = *arena->owned_das[i];
+        da_deinit(arr);
+    }
+    da_deinit(arena->owned_das);
+
+    arena_block_t* block = arena->blocks;
+    while (block) {
+        arena_block_t* next = block->next;
+        free(block);
+        block = next;
+    }
+    *arena = (arena_t){0};
+}
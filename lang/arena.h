@@ -0,0 +1,38 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// Region allocator.
+// Objects are bump-allocated from large blocks and are never freed one by one,
+// arena_release frees everything in the arena with a single call.
+//
+// The da's that hang off arena objects (array dims, struct fields, ...) are
+// still malloc'ed. Register them with arena_own_da so they go with the arena.
+
+typedef struct arena_block_t arena_block_t;
+
+typedef struct {
+    arena_block_t* blocks; // newest first
+    char* ptr;             // free space of the current block
+    char* end;
+    void*** owned_das;     // da of addresses of da's, deinit'ed on release
+    size_t bytes;          // bytes handed out since the last release
+} arena_t;
+
+// Aligned for any object. Memory is uninitialized.
+void* arena_alloc(arena_t* arena, size_t size);
+void* arena_calloc(arena_t* arena, size_t size);
+
+// One zeroed object of the given type
+#define arena_new(arena, type) ((type*)arena_calloc((arena), sizeof(type)))
+
+// da_ptr is the address of a da (e.g. &tuple->elems). Whatever da it points
+// to when the arena is released is deinit'ed then.
+void arena_own_da(arena_t* arena, void* da_ptr);
+
+// Frees every object and owned da, the arena can be used again afterwards.
+// Pointers into the arena are dangling from here on.
+void arena_release(arena_t* arena);
+
+#endif // ARENA_H
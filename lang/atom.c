@@ -0,0 +1,120 @@
+#include "atom.h"
+#include "da_map.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ATOM_BLOCK_SIZE (64 * 1024)
+
+typedef struct {
+    const char* str;
+    size_t len;
+} atom_key_t;
+
+static pthread_mutex_t atom_lock = PTHREAD_MUTEX_INITIALIZER; // guards everything below
+static da_map_t atom_map; // atom_key_t -> char*
+static char* block = NULL;  // atoms are carved out of large blocks instead of one malloc each
+static size_t block_left = 0;
+static size_t total_bytes = 0;
+
+static uint64_t atom_key_hash(const void* key) {
+    const atom_key_t* k = key;
+    return da_hash_bytes(k->str, k->len);
+}
+
+static int atom_key_eq(const void* key_a, const void* key_b) {
+    const atom_key_t* a = key_a;
+    const atom_key_t* b = key_b;
+    return a->len == b->len && memcmp(a->str, b->str, a->len) == 0;
+}
+
+static char* atom_store(const char* str, size_t len) {
+    size_t size = len + 1;
+    if (size > block_left) {
+        // Oversized atoms get their own allocation, the current block is kept
+        if (size > ATOM_BLOCK_SIZE / 4) {
+            total_bytes += size;
+            char* atom = malloc(size);
+            memcpy(atom, str, len);
+            atom[len] = '\0';
+            return atom;
+        }
+        block = malloc(ATOM_BLOCK_SIZE);
+        block_left = ATOM_BLOCK_SIZE;
+    }
+    char* atom = block;
+    memcpy(atom, str, len);
+    atom[len] = '\0';
+    block += size;
+    block_left -= size;
+    total_bytes += size;
+    return atom;
+}
+
+char* atom_intern(const char* str, size_t len) {
+    pthread_mutex_lock(&atom_lock);
+    if (!da_map_is_init(&atom_map)) {
+        da_map_init_impl(&atom_map, sizeof(atom_key_t), sizeof(char*), atom_key_hash, atom_key_eq, 1024);
+    }
+
+    atom_key_t key = {str, len};
+    char** existing = da_map_get(&atom_map, &key);
+    char* atom;
+    if (existing) {
+        atom = *existing;
+    } else {
+        atom = atom_store(str, len);
+        key.str = atom; // the key must outlive the caller's buffer
+        da_map_put(&atom_map, &key, &atom);
+    }
+    pthread_mutex_unlock(&atom_lock);
+    return atom;
+}
+
+char* atom_cache_intern(atom_cache_t* cache, const char* str, size_t len) {
+    if (!da_map_is_init(&cache->map)) {
+        da_map_init_impl(&cache->map, sizeof(atom_key_t), sizeof(char*), atom_key_hash, atom_key_eq, 256);
+    }
+
+    atom_key_t key = {str, len};
+    char** existing = da_map_get(&cache->map, &key);
+    if (existing) return *existing;
+
+    char* atom = atom_intern(str, len);
+    key.str = atom;
+    da_map_put(&cache->map, &key, &atom);
+    return atom;
+}
+
+char* atom_cache_find(const atom_cache_t* cache, const char* str, size_t len) {
+    if (!da_map_is_init(&cache->map)) return NULL;
+    atom_key_t key = {str, len};
+    char** existing = da_map_get((da_map_t*)&cache->map, &key);
+    return existing ? *existing : NULL;
+}
+
+void atom_cache_release(atom_cache_t* cache) {
+    if (da_map_is_init(&cache->map)) {
+        da_map_deinit(&cache->map);
+    }
+    *cache = (atom_cache_t){0};
+}
+
+char* atom_intern_cstr(const char* str) {
+    return atom_intern(str, strlen(str));
+}
+
+size_t atom_count() {
+    pthread_mutex_lock(&atom_lock);
+    size_t count = da_map_size(&atom_map);
+    pthread_mutex_unlock(&atom_lock);
+    return count;
+}
+
+size_t atom_bytes() {
+    pthread_mutex_lock(&atom_lock);
+    size_t bytes = total_bytes;
+    pthread_mutex_unlock(&atom_lock);
+    return bytes;
+}
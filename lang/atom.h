@@ -0,0 +1,36 @@
+#ifndef ATOM_H
+#define ATOM_H
+
+#include <stddef.h>
+
+#include "da_map.h"
+
+// Interned strings.
+// Every distinct spelling is stored once, and interning the same spelling
+// again returns the same pointer. Atoms can therefore be compared with ==.
+// They live for the rest of the program and must not be modified or freed.
+// The table is shared by all threads, interning takes a lock.
+
+char* atom_intern(const char* str, size_t len);
+char* atom_intern_cstr(const char* str);
+
+// Unlocked front of the atom table for one compilation.
+// Spellings seen before are found here, new ones go to atom_intern.
+typedef struct {
+    da_map_t map; // atom_key_t -> char*
+} atom_cache_t;
+
+char* atom_cache_intern(atom_cache_t* cache, const char* str, size_t len);
+
+// The atom for a spelling if the cache has it, NULL otherwise.
+// Only reads the cache, so threads may look up at once as long as nobody interns.
+char* atom_cache_find(const atom_cache_t* cache, const char* str, size_t len);
+
+// Frees the cache, the atoms stay
+void atom_cache_release(atom_cache_t* cache);
+
+// Number of distinct atoms, and bytes used to store them
+size_t atom_count();
+size_t atom_bytes();
+
+#endif // ATOM_H
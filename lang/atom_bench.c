@@ -0,0 +1,103 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "atom.h"
+#include "compilation.h"
+#include "da.h"
+#include "fail.h"
+#include "lex.h"
+
+#define WALLTIME(t) (((double)(t).tv_sec + 1e-6 * (double)(t).tv_usec)*1000.0)
+
+// Benchmark: copying every identifier/operator/string token with strndup
+// (the old lexer_substring path) vs. interning it.
+
+static char* read_file(const char* file_path) {
+    FILE* file = fopen(file_path, "r");
+    if (!file) {
+        fprintf(stderr, "Failed to open file: %s\n", file_path);
+        exit(1);
+    }
+    char* content = 0;
+    char buffer[65536];
+    size_t num_read;
+    while ((num_read = fread(buffer, 1, sizeof buffer, file)) > 0) {
+        da_append_n(content, buffer, num_read);
+    }
+    fclose(file);
+    return content;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <file>\n", argv[0]);
+        return 1;
+    }
+    compilation_t bench;
+    compilation_init(&bench);
+    fail_init_exit(&bench, stderr);
+    char* content = read_file(argv[1]);
+
+    // Collect the tokens first so only the string handling is timed
+    token_t* tokens = 0;
+    lexer_init(&bench, argv[1], content, da_size(content));
+    for (token_t token = lexer_peek(); token.type != LEX_END; token = lexer_peek()) {
+        if (token.type == LEX_IDENTIFIER || token.type == LEX_OPERATOR || token.type == LEX_STRING) {
+            da_append(tokens, token);
+        }
+        lexer_advance();
+    }
+
+    enum { REPS = 50 };
+    struct timeval t_start, t_dup, t_atom;
+    size_t dup_bytes = 0;
+    char** dups = malloc(da_size(tokens) * sizeof(char*));
+
+    gettimeofday(&t_start, NULL);
+    for (int r = 0; r < REPS; ++r) {
+        for (size_t i = 0; i < da_size(tokens); ++i) {
+            dups[i] = lexer_substring(tokens[i].begin_offset, tokens[i].end_offset);
+            if (r == 0) dup_bytes += tokens[i].end_offset - tokens[i].begin_offset + 1;
+        }
+        for (size_t i = 0; i < da_size(tokens); ++i) free(dups[i]);
+    }
+    gettimeofday(&t_dup, NULL);
+    for (int r = 0; r < REPS; ++r) {
+        for (size_t i = 0; i < da_size(tokens); ++i) {
+            dups[i] = lexer_atom(tokens[i].begin_offset, tokens[i].end_offset);
+        }
+    }
+    gettimeofday(&t_atom, NULL);
+
+    // Name comparisons as done by symbol lookup, strcmp on copies vs. pointer equality
+    size_t matches_strcmp = 0, matches_ptr = 0;
+    char** copies = malloc(da_size(tokens) * sizeof(char*));
+    for (size_t i = 0; i < da_size(tokens); ++i) {
+        copies[i] = lexer_substring(tokens[i].begin_offset, tokens[i].end_offset);
+    }
+    struct timeval t_cmp_start, t_strcmp, t_ptr;
+    gettimeofday(&t_cmp_start, NULL);
+    for (int r = 0; r < REPS; ++r) {
+        for (size_t i = 1; i < da_size(tokens); ++i) {
+            matches_strcmp += strcmp(copies[i], copies[i / 2]) == 0;
+        }
+    }
+    gettimeofday(&t_strcmp, NULL);
+    for (int r = 0; r < REPS; ++r) {
+        for (size_t i = 1; i < da_size(tokens); ++i) {
+            matches_ptr += dups[i] == dups[i / 2];
+        }
+    }
+    gettimeofday(&t_ptr, NULL);
+
+    printf("%s: %zu identifier/operator/string tokens, %zu distinct\n", argv[1], da_size(tokens), atom_count());
+    printf("Bytes          : strndup %zu, atoms %zu\n", dup_bytes, atom_bytes());
+    printf("Per pass       : strndup+free %7.3f ms, atom_intern %7.3f ms\n",
+           (WALLTIME(t_dup) - WALLTIME(t_start)) / REPS, (WALLTIME(t_atom) - WALLTIME(t_dup)) / REPS);
+    printf("Name compares  : strcmp %7.3f ms, pointer %7.3f ms%s\n",
+           (WALLTIME(t_strcmp) - WALLTIME(t_cmp_start)) / REPS, (WALLTIME(t_ptr) - WALLTIME(t_strcmp)) / REPS,
+           matches_strcmp == matches_ptr ? "" : " (MISMATCH)");
+    return 0;
+}
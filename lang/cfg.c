@@ -0,0 +1,335 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cfg.h"
+#include "compilation.h"
+#include "da.h"
+#include "da_bitset.h"
+#include "symbol.h"
+#include "tac.h"
+
+static void split_blocks(cfg_t* cfg, tac_t* tac_list);
+static void connect_blocks(cfg_t* cfg, tac_t* tac_list);
+static void order_blocks(cfg_t* cfg);
+static void compute_dominators(cfg_t* cfg);
+static void find_loops(cfg_t* cfg);
+static size_t jump_target(tac_t* tac_list, tac_t tac);
+
+void generate_cfgs(compilation_t* c) {
+    compilation = c;
+    for (size_t i = 0; i < da_size(compilation->function_codes); ++i) {
+        cfg_build(&compilation->function_codes[i]);
+    }
+}
+
+void cfg_build(function_code_t* function_code) {
+    cfg_t* cfg = &function_code->cfg;
+    cfg_release(cfg);
+    if (da_size(function_code->tac_list) == 0) return;
+
+    split_blocks(cfg, function_code->tac_list);
+    connect_blocks(cfg, function_code->tac_list);
+    order_blocks(cfg);
+    compute_dominators(cfg);
+    find_loops(cfg);
+}
+
+void cfg_release(cfg_t* cfg) {
+    for (size_t i = 0; i < da_size(cfg->blocks); ++i) {
+        da_deinit(cfg->blocks[i].preds);
+        da_deinit(cfg->blocks[i].succs);
+        da_deinit(cfg->blocks[i].dom_children);
+    }
+    da_deinit(cfg->blocks);
+    da_deinit(cfg->block_of);
+    da_deinit(cfg->rpo);
+    for (size_t i = 0; i < da_size(cfg->loops); ++i) {
+        da_bitset_deinit(cfg->loops[i].body);
+    }
+    da_deinit(cfg->loops);
+    *cfg = (cfg_t){0};
+}
+
+bool cfg_dominates(cfg_t* cfg, size_t a, size_t b) {
+    if (cfg->blocks[b].rpo == CFG_NONE) return false;
+    // Dominators come earlier in reverse postorder, so the walk up can stop there
+    while (b != CFG_NONE && cfg->blocks[b].rpo >= cfg->blocks[a].rpo) {
+        if (b == a) return true;
+        b = cfg->blocks[b].idom;
+    }
+    return false;
+}
+
+size_t cfg_loop_depth(cfg_t* cfg, size_t block) {
+    size_t loop = cfg->blocks[block].loop;
+    return loop == CFG_NONE ? 0 : cfg->loops[loop].depth;
+}
+
+// Instruction index the jump goes to. Every instruction has its own label and
+// the labels of a function are consecutive, so that is a subtraction.
+// A jump past the last instruction gives da_size(tac_list), it leaves the function.
+static size_t jump_target(tac_t* tac_list, tac_t tac) {
+    size_t label = compilation->addr_list[tac.dst].data.label;
+    assert(label >= tac_list[0].label && "Jump out of the function");
+    size_t idx = label - tac_list[0].label;
+    assert((idx == da_size(tac_list) || tac_list[idx].label == label) && "Labels of a function are not consecutive");
+    return idx;
+}
+
+static bool ends_block(instruction_t instr) {
+    return instr == TAC_GOTO || instr == TAC_IF_FALSE || instr == TAC_RETURN;
+}
+
+static void split_blocks(cfg_t* cfg, tac_t* tac_list) {
+    size_t n = da_size(tac_list);
+
+    da_bitset_t leaders = NULL;
+    da_bitset_set(&leaders, 0);
+    for (size_t i = 0; i < n; ++i) {
+        if (tac_list[i].instr == TAC_GOTO || tac_list[i].instr == TAC_IF_FALSE) {
+            da_bitset_set(&leaders, jump_target(tac_list, tac_list[i]));
+        }
+        if (ends_block(tac_list[i].instr)) {
+            da_bitset_set(&leaders, i + 1);
+        }
+    }
+
+    da_resize(cfg->block_of, n);
+    da_reserve(cfg->blocks, da_bitset_count(leaders));
+    for (size_t begin = 0; begin < n;) {
+        size_t end = da_bitset_next(leaders, begin + 1);
+        if (end > n) end = n;
+
+        basic_block_t block = {
+            .begin = begin,
+            .end = end,
+            .rpo = CFG_NONE,
+            .idom = CFG_NONE,
+            .loop = CFG_NONE,
+        };
+        for (size_t i = begin; i < end; ++i) {
+            cfg->block_of[i] = da_size(cfg->blocks);
+        }
+        da_append(cfg->blocks, block);
+        begin = end;
+    }
+    da_bitset_deinit(leaders);
+}
+
+static void add_edge(cfg_t* cfg, size_t from, size_t to) {
+    da_append_policy(cfg->blocks[from].succs, to, DA_POLICY_SMALL);
+    da_append_policy(cfg->blocks[to].preds, from, DA_POLICY_SMALL);
+}
+
+static void connect_blocks(cfg_t* cfg, tac_t* tac_list) {
+    size_t n_blocks = da_size(cfg->blocks);
+    for (size_t b = 0; b < n_blocks; ++b) {
+        tac_t last = tac_list[cfg->blocks[b].end - 1];
+
+        if (last.instr != TAC_GOTO && last.instr != TAC_RETURN && b + 1 < n_blocks) {
+            add_edge(cfg, b, b + 1);
+        }
+        if (last.instr == TAC_GOTO || last.instr == TAC_IF_FALSE) {
+            size_t target = jump_target(tac_list, last);
+            // A conditional jump to the next instruction has one successor
+            if (target < da_size(tac_list) && !(last.instr == TAC_IF_FALSE && cfg->block_of[target] == b + 1)) {
+                add_edge(cfg, b, cfg->block_of[target]);
+            }
+        }
+    }
+}
+
+// Depth first from the entry, without recursion since functions can be long
+static void order_blocks(cfg_t* cfg) {
+    size_t n_blocks = da_size(cfg->blocks);
+    size_t* postorder = 0;
+    size_t* stack = 0;      // blocks being visited
+    size_t* next_succ = calloc(n_blocks, sizeof(size_t));
+    da_bitset_t visited = NULL;
+    da_reserve(postorder, n_blocks);
+    da_reserve(stack, n_blocks);
+
+    da_append(stack, 0);
+    da_bitset_set(&visited, 0);
+    while (da_size(stack) > 0) {
+        size_t b = stack[da_size(stack) - 1];
+        if (next_succ[b] < da_size(cfg->blocks[b].succs)) {
+            size_t s = cfg->blocks[b].succs[next_succ[b]++];
+            if (!da_bitset_test(visited, s)) {
+                da_bitset_set(&visited, s);
+                da_append(stack, s);
+            }
+        } else {
+            da_append(postorder, b);
+            (void)da_pop(stack);
+        }
+    }
+
+    da_reserve(cfg->rpo, da_size(postorder));
+    for (size_t i = da_size(postorder); i-- > 0;) {
+        cfg->blocks[postorder[i]].rpo = da_size(cfg->rpo);
+        da_append(cfg->rpo, postorder[i]);
+    }
+
+    da_deinit(postorder);
+    da_deinit(stack);
+    da_bitset_deinit(visited);
+    free(next_succ);
+}
+
+static size_t intersect(cfg_t* cfg, size_t a, size_t b) {
+    while (a != b) {
+        while (cfg->blocks[a].rpo > cfg->blocks[b].rpo) a = cfg->blocks[a].idom;
+        while (cfg->blocks[b].rpo > cfg->blocks[a].rpo) b = cfg->blocks[b].idom;
+    }
+    return a;
+}
+
+// Cooper, Harvey and Kennedy, "A Simple, Fast Dominance Algorithm".
+// The entry is its own idom while iterating.
+static void compute_dominators(cfg_t* cfg) {
+    cfg->blocks[0].idom = 0;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t r = 1; r < da_size(cfg->rpo); ++r) {
+            basic_block_t* block = &cfg->blocks[cfg->rpo[r]];
+            size_t new_idom = CFG_NONE;
+            for (size_t i = 0; i < da_size(block->preds); ++i) {
+                size_t p = block->preds[i];
+                if (cfg->blocks[p].idom == CFG_NONE) continue; // not processed yet, or unreachable
+                new_idom = new_idom == CFG_NONE ? p : intersect(cfg, p, new_idom);
+            }
+            if (block->idom != new_idom) {
+                block->idom = new_idom;
+                changed = true;
+            }
+        }
+    }
+    cfg->blocks[0].idom = CFG_NONE;
+
+    for (size_t r = 1; r < da_size(cfg->rpo); ++r) {
+        size_t b = cfg->rpo[r];
+        da_append_policy(cfg->blocks[cfg->blocks[b].idom].dom_children, b, DA_POLICY_SMALL);
+    }
+}
+
+static int compare_loop_size(const void* a, const void* b) {
+    const loop_t* loop_a = a;
+    const loop_t* loop_b = b;
+    size_t size_a = da_bitset_count(loop_a->body);
+    size_t size_b = da_bitset_count(loop_b->body);
+    if (size_a != size_b) return size_a > size_b ? -1 : 1;
+    return loop_a->header < loop_b->header ? -1 : loop_a->header > loop_b->header;
+}
+
+static void find_loops(cfg_t* cfg) {
+    size_t* loop_of_header = malloc(da_size(cfg->blocks) * sizeof(size_t));
+    for (size_t b = 0; b < da_size(cfg->blocks); ++b) {
+        loop_of_header[b] = CFG_NONE;
+    }
+    size_t* worklist = 0;
+
+    for (size_t r = 0; r < da_size(cfg->rpo); ++r) {
+        size_t tail = cfg->rpo[r];
+        for (size_t i = 0; i < da_size(cfg->blocks[tail].succs); ++i) {
+            size_t header = cfg->blocks[tail].succs[i];
+            if (!cfg_dominates(cfg, header, tail)) continue;
+
+            // Back edge tail -> header
+            if (loop_of_header[header] == CFG_NONE) {
+                loop_of_header[header] = da_size(cfg->loops);
+                loop_t loop = { .header = header, .parent = CFG_NONE, .body = NULL };
+                da_bitset_set(&loop.body, header);
+                da_append_policy(cfg->loops, loop, DA_POLICY_SMALL);
+            }
+            loop_t* loop = &cfg->loops[loop_of_header[header]];
+
+            // Everything reaching the tail without going through the header
+            da_append(worklist, tail);
+            while (da_size(worklist) > 0) {
+                size_t b = da_pop(worklist);
+                if (da_bitset_test(loop->body, b)) continue;
+                da_bitset_set(&loop->body, b);
+                for (size_t j = 0; j < da_size(cfg->blocks[b].preds); ++j) {
+                    size_t p = cfg->blocks[b].preds[j];
+                    if (cfg->blocks[p].rpo != CFG_NONE && !da_bitset_test(loop->body, p)) {
+                        da_append(worklist, p);
+                    }
+                }
+            }
+        }
+    }
+    da_deinit(worklist);
+    free(loop_of_header);
+
+    // A loop containing another one has the larger body, so sorting by size
+    // puts every loop after the loops around it
+    if (da_size(cfg->loops) > 1) {
+        qsort(cfg->loops, da_size(cfg->loops), sizeof(loop_t), compare_loop_size);
+    }
+    for (size_t i = 0; i < da_size(cfg->loops); ++i) {
+        loop_t* loop = &cfg->loops[i];
+        for (size_t j = i; j-- > 0;) {
+            if (da_bitset_test(cfg->loops[j].body, loop->header)) {
+                loop->parent = j;
+                break;
+            }
+        }
+        loop->depth = loop->parent == CFG_NONE ? 1 : cfg->loops[loop->parent].depth + 1;
+        // Inner loops come later and overwrite this
+        da_bitset_foreach(loop->body, b) {
+            cfg->blocks[b].loop = i;
+        }
+    }
+}
+
+static void print_block_list(const char* what, size_t* blocks) {
+    printf(" %s:", what);
+    if (da_size(blocks) == 0) printf(" -");
+    for (size_t i = 0; i < da_size(blocks); ++i) {
+        printf(" B%zu", blocks[i]);
+    }
+}
+
+void print_cfg(compilation_t* c) {
+    compilation = c;
+    for (size_t func_idx = 0; func_idx < da_size(compilation->function_codes); ++func_idx) {
+        function_code_t* function_code = &compilation->function_codes[func_idx];
+        cfg_t* cfg = &function_code->cfg;
+        printf("=== CFG %s ===\n", function_code->function_symbol->name);
+
+        for (size_t b = 0; b < da_size(cfg->blocks); ++b) {
+            basic_block_t* block = &cfg->blocks[b];
+            printf("B%zu:", b);
+            print_block_list("preds", block->preds);
+            print_block_list("succs", block->succs);
+            if (block->rpo == CFG_NONE) {
+                printf(" unreachable");
+            } else if (block->idom != CFG_NONE) {
+                printf(" idom: B%zu", block->idom);
+            }
+            if (block->loop != CFG_NONE) {
+                printf(" loop: L%zu depth %zu", block->loop, cfg_loop_depth(cfg, b));
+            }
+            puts("");
+            for (size_t i = block->begin; i < block->end; ++i) {
+                printf("%5zu:  ", function_code->tac_list[i].label);
+                print_tac_instruction(function_code->tac_list[i]);
+            }
+        }
+
+        for (size_t l = 0; l < da_size(cfg->loops); ++l) {
+            loop_t* loop = &cfg->loops[l];
+            printf("L%zu: header B%zu, depth %zu", l, loop->header, loop->depth);
+            if (loop->parent != CFG_NONE) printf(", in L%zu", loop->parent);
+            printf(", blocks");
+            da_bitset_foreach(loop->body, b) {
+                printf(" B%zu", b);
+            }
+            puts("");
+        }
+    }
+}
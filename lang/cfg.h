@@ -0,0 +1,66 @@
+#ifndef CFG_H
+#define CFG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "langc.h"
+#include "da_bitset.h"
+
+// Control flow graph of one function, over its tac_list.
+//
+// A basic block is a run of instructions that is only entered at the top
+// and only left at the bottom. Blocks start at the first instruction, at
+// every jump target, and after every GOTO, IF_FALSE and RETURN.
+// Blocks are numbered in instruction order, block 0 is the entry.
+//
+// The CFG indexes into the tac_list, anything that edits the list has to
+// build it again with cfg_build.
+
+#define CFG_NONE SIZE_MAX
+
+struct basic_block_t {
+    size_t begin;          // tac_list[begin, end)
+    size_t end;
+    size_t* preds;         // da of blocks
+    size_t* succs;         // da of blocks, fall through first, then the jump target
+    size_t rpo;            // position in cfg->rpo, CFG_NONE when unreachable
+    size_t idom;           // immediate dominator, CFG_NONE for the entry and unreachable blocks
+    size_t* dom_children;  // da, the blocks this one immediately dominates
+    size_t loop;           // innermost loop containing the block, CFG_NONE if none
+};
+
+// Natural loop: the header and every block that reaches a back edge into
+// it without passing the header. Back edges into the same header make one loop.
+struct loop_t {
+    size_t header;
+    size_t parent;         // innermost enclosing loop, CFG_NONE at the top
+    size_t depth;          // 1 for a loop that is not nested
+    da_bitset_t body;      // blocks of the loop, the header included
+};
+
+struct cfg_t {
+    basic_block_t* blocks; // da
+    size_t* block_of;      // da, the block of each instruction
+    size_t* rpo;           // da, the reachable blocks in reverse postorder
+    loop_t* loops;         // da, every loop comes after the loops containing it
+};
+
+// Builds the CFG of every function code in the compilation
+void generate_cfgs(compilation_t* c);
+
+// (Re)builds function_code->cfg from its tac_list
+void cfg_build(function_code_t* function_code);
+
+void cfg_release(cfg_t* cfg);
+
+// Whether every path from the entry to block b passes block a
+bool cfg_dominates(cfg_t* cfg, size_t a, size_t b);
+
+// Number of loops around the block, 0 outside loops
+size_t cfg_loop_depth(cfg_t* cfg, size_t block);
+
+void print_cfg(compilation_t* c);
+
+#endif // CFG_H
@@ -0,0 +1,58 @@
+#include "compilation.h"
+
+#include "da.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+_Thread_local compilation_t* compilation = NULL;
+
+void compilation_init(compilation_t* c) {
+    memset(c, 0, sizeof *c);
+    c->fail_mode = FAIL_EXIT;
+    c->fail_stream = stderr;
+}
+
+void compilation_release(compilation_t* c) {
+    da_deinit(c->line_start);
+    da_deinit(c->tokens);
+    atom_cache_release(&c->atoms);
+
+    node_pool_release(&c->node_pool);
+    arena_release(&c->arena);
+    scope_table_release(&c->scopes);
+    da_map_deinit(&c->type_intern);
+    da_deinit(c->global_string_list);
+    da_map_deinit(&c->string_list_index);
+
+    for (size_t i = 0; i < da_size(c->function_codes); ++i) {
+        da_deinit(c->function_codes[i].tac_list);
+        cfg_release(&c->function_codes[i].cfg);
+    }
+    da_deinit(c->function_codes);
+    for (size_t i = 0; i < da_size(c->addr_list); ++i) {
+        if (c->addr_list[i].type == ADDR_ARG_LIST) {
+            da_deinit(c->addr_list[i].data.arg_addr_list);
+        }
+    }
+    da_deinit(c->addr_list);
+    da_deinit(c->break_statement_idxs);
+    da_deinit(c->continue_statement_idxs);
+
+    free(c->addr_frame_location);
+    free(c->addr_reg);
+    da_deinit(c->current_saved_regs);
+    da_bitset_deinit(c->current_placed_addrs);
+    da_deinit(c->current_used_addrs);
+    da_bitset_deinit(c->is_jmp_dst);
+
+    for (size_t i = 0; i < da_size(c->diagnostics); ++i) {
+        free(c->diagnostics[i].message);
+    }
+    da_deinit(c->diagnostics);
+
+    if (compilation == c) {
+        compilation = NULL;
+    }
+    compilation_init(c);
+}
@@ -0,0 +1,86 @@
+#ifndef COMPILATION_H
+#define COMPILATION_H
+
+#include <setjmp.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "langc.h"
+#include "arena.h"
+#include "atom.h"
+#include "da_bitset.h"
+#include "da_map.h"
+#include "fail.h"
+#include "lex.h"
+#include "symbol_table.h"
+#include "tac.h"
+#include "tree.h"
+
+// Everything one compilation of one file owns, from the source bytes to
+// the TAC. Compilations share nothing but the atom table (see atom.h), so
+// any number of them can run at once, one per thread.
+//
+// The entry point of each pass takes the compilation and makes it the
+// thread's current one, the code below an entry point reaches it through
+// `compilation`. NODE() and the other node accessors do too.
+struct compilation_t {
+    // Lexer, see lex.h
+    char* file_name;
+    const char* content;      // not NUL terminated, see lexer_init
+    int content_size;
+    int content_ptr;
+    int* line_start;          // da, for each line, records which offset it starts
+    int last_line;            // line of the previous lexer_offset_location
+    token_t* tokens;          // da of every token in the file, the last one is LEX_END
+    size_t token_idx;         // parser cursor into tokens
+    atom_cache_t atoms;       // the atoms of this file
+
+    // Syntax tree, see tree.h
+    node_pool_t node_pool;
+    node_id_t root;           // LIST node of either FUNCTION_DECLARATION or VARIABLE_DECLARATION
+
+    // Symbols, symbol tables, scopes and types are allocated in arena
+    arena_t arena;
+    symbol_table_t* global_symbol_table;
+    symbol_table_t* global_type_table;
+    scope_table_t scopes;         // names visible in the function being bound
+    da_map_t type_intern;         // canonical type_info_t* of every type, see type.h
+    char** global_string_list;    // da
+    da_map_t string_list_index;   // atom -> index in global_string_list
+    node_id_t current_function_type_node; // DECLARATION of the function being type checked
+
+    // TAC, see tac.h
+    function_code_t* function_codes; // da
+    addr_t* addr_list;               // da
+    size_t next_label;
+    size_t next_temp;
+    size_t* break_statement_idxs;    // da
+    size_t* continue_statement_idxs; // da
+
+    // Code generation, see gen.h
+    FILE* gen_outfile;
+    size_t* addr_frame_location;
+    reg_t* addr_reg;             // register of each addr of the current function, see regalloc.h
+    reg_t* current_saved_regs;   // da, callee-saved registers the current function uses
+    da_bitset_t current_placed_addrs; // addrs of the current function regalloc gave a register or slot
+    symbol_t* current_function;
+    size_t* current_used_addrs;  // da
+    da_bitset_t is_jmp_dst;      // set of labels used as a jump destination
+
+    // Errors, see fail.h
+    enum FAIL_MODE fail_mode;
+    FILE* fail_stream;
+    jmp_buf fail_jmp_env;
+    struct diagnostic_t* diagnostics; // da
+};
+
+// The compilation the calling thread works on, set by the pass entry points
+extern _Thread_local compilation_t* compilation;
+
+// Zeroes c, failures exit with a message to stderr until fail_init_* says otherwise
+void compilation_init(compilation_t* c);
+
+// Frees everything c owns. The content and file name belong to the caller.
+void compilation_release(compilation_t* c);
+
+#endif // COMPILATION_H
@@ -0,0 +1,183 @@
+#include <pthread.h>
+#include <setjmp.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "cfg.h"
+#include "compilation.h"
+#include "da.h"
+#include "fail.h"
+#include "gen.h"
+#include "lex.h"
+#include "opt.h"
+#include "parser.h"
+#include "symbol.h"
+#include "tac.h"
+#include "tree_transform.h"
+#include "type.h"
+
+// Checks that compilations running at the same time on several threads
+// give the same assembly, or the same diagnostics, as one at a time.
+//
+//   compile-threads-test [-t threads] <file>...
+
+#define ROUNDS 4
+
+typedef struct {
+    char* name;
+    char* content;   // da
+    char* expected;  // output of the compilation on its own
+} source_t;
+
+typedef struct {
+    source_t* sources; // da
+    int thread;
+    size_t* mismatches; // per source
+} worker_t;
+
+static char* read_file(const char* file_path) {
+    FILE* file = fopen(file_path, "r");
+    if (!file) {
+        fprintf(stderr, "Failed to open file: %s\n", file_path);
+        exit(1);
+    }
+    char* content = 0;
+    char buffer[65536];
+    size_t num_read;
+    while ((num_read = fread(buffer, 1, sizeof buffer, file)) > 0) {
+        da_append_n(content, buffer, num_read);
+    }
+    fclose(file);
+    return content;
+}
+
+// The assembly for the source, or its diagnostics if it does not compile.
+// Heap allocated, NUL terminated.
+static char* compile(const source_t* source) {
+    // On the heap so it is intact after the longjmp
+    compilation_t* c = malloc(sizeof *c);
+    compilation_init(c);
+    fail_init_diagnostic(c);
+
+    char* out = NULL;
+    size_t out_size = 0;
+    FILE* stream = open_memstream(&out, &out_size);
+    if (!setjmp(c->fail_jmp_env)) {
+        lexer_init(c, source->name, source->content, da_size(source->content));
+        parse(c);
+        create_symbol_tables(c);
+        register_types(c);
+        tree_transform(c);
+        generate_function_codes(c);
+        generate_cfgs(c);
+        optimize(c);
+        generate_program(c, stream);
+    } else {
+        for (size_t i = 0; i < da_size(c->diagnostics); ++i) {
+            range_t range = c->diagnostics[i].range;
+            fprintf(stream, "%d:%d-%d:%d: %s\n", range.start.line + 1, range.start.character + 1,
+                    range.end.line + 1, range.end.character + 1, c->diagnostics[i].message);
+        }
+    }
+    fclose(stream);
+    compilation_release(c);
+    free(c);
+    return out;
+}
+
+// Some inputs still exit or abort instead of failing with a diagnostic,
+// those would take the test down with them
+static bool compiles_in_child(const source_t* source) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        free(compile(source));
+        _exit(0);
+    }
+    int status;
+    return pid > 0 && waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static void* worker(void* arg) {
+    worker_t* w = arg;
+    size_t n = da_size(w->sources);
+    for (int r = 0; r < ROUNDS; ++r) {
+        // Threads start at different files so different code runs at once
+        for (size_t i = 0; i < n; ++i) {
+            size_t s = (i + w->thread) % n;
+            char* out = compile(&w->sources[s]);
+            if (strcmp(out, w->sources[s].expected) != 0) {
+                ++w->mismatches[s];
+            }
+            free(out);
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char** argv) {
+    int n_threads = 8;
+    int first = 1;
+    if (argc > 2 && strcmp(argv[1], "-t") == 0) {
+        n_threads = atoi(argv[2]);
+        first = 3;
+    }
+    // Small files are parsed sequentially anyway, this keeps it that way
+    parser_use_threads(1);
+
+    source_t* sources = 0;
+    for (int f = first; f < argc; ++f) {
+        source_t source = { .name = argv[f], .content = read_file(argv[f]) };
+        if (!compiles_in_child(&source)) {
+            printf("Skipping %s: does not compile without exiting\n", argv[f]);
+            da_deinit(source.content);
+            continue;
+        }
+        source.expected = compile(&source);
+        da_append(sources, source);
+    }
+    size_t n = da_size(sources);
+
+    worker_t* workers = calloc(n_threads, sizeof(worker_t));
+    pthread_t* threads = calloc(n_threads, sizeof(pthread_t));
+    for (int t = 0; t < n_threads; ++t) {
+        workers[t] = (worker_t){ .sources = sources, .thread = t, .mismatches = calloc(n, sizeof(size_t)) };
+        if (pthread_create(&threads[t], NULL, worker, &workers[t]) != 0) {
+            fprintf(stderr, "Failed to start thread %d\n", t);
+            return 1;
+        }
+    }
+    for (int t = 0; t < n_threads; ++t) {
+        pthread_join(threads[t], NULL);
+    }
+
+    int failed = 0;
+    for (size_t s = 0; s < n; ++s) {
+        size_t mismatches = 0;
+        for (int t = 0; t < n_threads; ++t) {
+            mismatches += workers[t].mismatches[s];
+        }
+        if (mismatches == 0) {
+            printf("\x1b[1;32m[OK]: %s (%d threads x %d)\x1b[0m\n", sources[s].name, n_threads, ROUNDS);
+        } else {
+            printf("\x1b[1;31m[FAIL]: %s (%zu of %d differ)\x1b[0m\n", sources[s].name, mismatches, n_threads * ROUNDS);
+            failed = 1;
+        }
+    }
+
+    for (int t = 0; t < n_threads; ++t) {
+        free(workers[t].mismatches);
+    }
+    for (size_t s = 0; s < n; ++s) {
+        da_deinit(sources[s].content);
+        free(sources[s].expected);
+    }
+    da_deinit(sources);
+    free(workers);
+    free(threads);
+    return failed;
+}
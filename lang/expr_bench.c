@@ -0,0 +1,83 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+
+#include "compilation.h"
+#include "da.h"
+#include "fail.h"
+#include "lex.h"
+#include "parser.h"
+#include "tree.h"
+
+#define WALLTIME(t) (((double)(t).tv_sec + 1e-6 * (double)(t).tv_usec)*1000.0)
+
+// Benchmark: parsing long generated operator chains.
+// A parser that is linear in the number of terms keeps the ns/term column flat.
+//
+//   expr-bench [terms]...   default 1000 10000 100000
+
+typedef struct {
+    char* name;
+    const char* operators[8];
+    int n_operators;
+} shape_t;
+
+static const shape_t SHAPES[] = {
+    {"same precedence", {"+"}, 1},
+    {"mixed precedence", {"+", "*", "-", "/", "<", "&&", "==", "||"}, 8},
+    {"unary and dots", {"* -", "+ !", ". ", "- *"}, 4},
+};
+
+// main: () -> void = { x: int = t0 <op> t1 <op> ... ; }
+// Operands repeat every 64 terms so the atom table stays small and the parser is what is timed
+static char* expression_source(const shape_t* shape, int terms) {
+    char* content = 0;
+    char buffer[64];
+    const char* head = "main: () -> void = {\n    x: int = t0";
+    da_append_n(content, head, strlen(head));
+    for (int i = 1; i < terms; ++i) {
+        int len = snprintf(buffer, sizeof buffer, " %s t%d", shape->operators[i % shape->n_operators], i % 64);
+        da_append_n(content, buffer, len);
+    }
+    const char* tail = ";\n}\n";
+    da_append_n(content, tail, strlen(tail));
+    return content;
+}
+
+int main(int argc, char** argv) {
+    int default_terms[] = {1000, 10000, 100000};
+    int n_terms = argc > 1 ? argc - 1 : 3;
+
+    compilation_t bench;
+    compilation_init(&bench);
+
+    for (size_t s = 0; s < sizeof SHAPES / sizeof SHAPES[0]; ++s) {
+        printf("%s\n", SHAPES[s].name);
+        for (int t = 0; t < n_terms; ++t) {
+            int terms = argc > 1 ? atoi(argv[t + 1]) : default_terms[t];
+            char* content = expression_source(&SHAPES[s], terms);
+            int reps = terms >= 100000 ? 5 : 50;
+
+            double total_ms = 0;
+            for (int r = 0; r < reps; ++r) {
+                lexer_init(&bench, SHAPES[s].name, content, da_size(content));
+                struct timeval t_start, t_end;
+                gettimeofday(&t_start, NULL);
+                parse(&bench);
+                gettimeofday(&t_end, NULL);
+                total_ms += WALLTIME(t_end) - WALLTIME(t_start);
+                compilation_release(&bench);
+            }
+            double ms = total_ms / reps;
+            printf("  %7d terms : %9.3f ms per parse, %7.1f ns/term\n", terms, ms, ms * 1e6 / terms);
+            da_deinit(content);
+        }
+    }
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    printf("Peak RSS        : %8ld KB\n", usage.ru_maxrss);
+    return 0;
+}
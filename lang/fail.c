@@ -1,5 +1,6 @@
 #include "fail.h"
 
+#include "compilation.h"
 #include "da.h"
 #include "lex.h"
 #include "tree.h"
@@ -13,29 +14,24 @@
 #define FAIL_BUF_SZ 4096
 typedef struct diagnostic_t diagnostic_t;
 
-FILE *out_stream;
-enum FAIL_MODE fail_mode;
-
-char fail_buf[FAIL_BUF_SZ];
-jmp_buf FAIL_JMP_ENV;
-diagnostic_t *diagnostics;
+static _Thread_local char fail_buf[FAIL_BUF_SZ];
 
 // fprintf(stream, "file:line:col: ")
-void print_node_location(FILE* stream, node_t* node) {
-    if (!node->leaf) {
-        assert((da_size(node->children) > 0) && "non leafs should have children!");
+void print_node_location(FILE* stream, node_id_t node) {
+    if (!NODE(node).leaf) {
+        assert((node_n_children(node) > 0) && "non leafs should have children!");
 
         // First child should be earliest ? 
-        print_node_location(stream, node->children[0]);
+        print_node_location(stream, node_child(node, 0));
         return;
     }
-    location_t loc = lexer_offset_location(node->pos.begin_offset);
+    location_t loc = lexer_offset_location(node_pos(node).begin_offset);
     fprintf(stream, "%s: ", location_str(loc));
 }
 
 //  9 | void foo() {
 //           ^~~
-void print_visual_node_error(FILE* stream, node_t* node) {
+void print_visual_node_error(FILE* stream, node_id_t node) {
     range_t node_range;
     node_find_range(node, &node_range);
 
@@ -58,15 +54,23 @@ void print_visual_node_error(FILE* stream, node_t* node) {
     }
 }
 
+// Failures in FAIL_SILENT mode are reported when the caller redoes the work
+static void fail_silent() {
+    if (compilation->fail_mode == FAIL_SILENT) {
+        longjmp(compilation->fail_jmp_env, 1);
+    }
+}
+
 char* location_str(location_t loc) {
-    static char BUFFER[1024];
-    snprintf(BUFFER, sizeof BUFFER, "%s:%d:%d", CURRENT_FILE_NAME, loc.line+1, loc.character + 1);
+    static _Thread_local char BUFFER[1024];
+    snprintf(BUFFER, sizeof BUFFER, "%s:%d:%d", compilation->file_name, loc.line+1, loc.character + 1);
 
     return BUFFER;
 }
 
 void fail_token(token_t token) {
-    if (fail_mode == FAIL_EXIT) {
+    fail_silent();
+    if (compilation->fail_mode == FAIL_EXIT) {
         location_t loc;
         loc = lexer_offset_location(token.begin_offset);
         fprintf(stderr, "%s: Unexpected token '%s'\n", location_str(loc), TOKEN_TYPE_NAMES[token.type]);
@@ -80,13 +84,14 @@ void fail_token(token_t token) {
             .message = strdup(fail_buf),
             .range = range
         };
-        da_append(diagnostics, diag);
-        longjmp(FAIL_JMP_ENV, 1);
+        da_append(compilation->diagnostics, diag);
+        longjmp(compilation->fail_jmp_env, 1);
     }
 }
 
 void fail_character(location_t loc, char unexpected_char) {
-    if (fail_mode == FAIL_EXIT) {
+    fail_silent();
+    if (compilation->fail_mode == FAIL_EXIT) {
         fprintf(stderr, "%s: Unexpected character '%c'\n", location_str(loc), unexpected_char);
         exit(1);
     } else {
@@ -99,13 +104,14 @@ void fail_character(location_t loc, char unexpected_char) {
             .message = strdup(fail_buf),
             .range = range
         };
-        da_append(diagnostics, diag);
-        longjmp(FAIL_JMP_ENV, 1);
+        da_append(compilation->diagnostics, diag);
+        longjmp(compilation->fail_jmp_env, 1);
     }
 }
 
 void fail_token_expected(token_t token, token_type_t expected) {
-    if (fail_mode == FAIL_EXIT) {
+    fail_silent();
+    if (compilation->fail_mode == FAIL_EXIT) {
         location_t loc;
         loc = lexer_offset_location(token.begin_offset);
         fprintf(stderr, "%s: Expected '%s', got '%s'\n",location_str(loc),  TOKEN_TYPE_NAMES[expected], TOKEN_TYPE_NAMES[token.type]);
@@ -119,20 +125,21 @@ void fail_token_expected(token_t token, token_type_t expected) {
             .message = strdup(fail_buf),
             .range = range
         };
-        da_append(diagnostics, diag);
-        longjmp(FAIL_JMP_ENV, 1);
+        da_append(compilation->diagnostics, diag);
+        longjmp(compilation->fail_jmp_env, 1);
     }
 }
 
-void fail_node(node_t *node, const char *fmt, ...) {
+void fail_node(node_id_t node, const char *fmt, ...) {
+    fail_silent();
     va_list args;
-    if (fail_mode == FAIL_EXIT) {
-        print_node_location(out_stream, node);
+    if (compilation->fail_mode == FAIL_EXIT) {
+        print_node_location(compilation->fail_stream, node);
         va_start(args, fmt);
-        vfprintf(out_stream, fmt, args);
+        vfprintf(compilation->fail_stream, fmt, args);
         va_end(args);
-        fprintf(out_stream, "\n");
-        print_visual_node_error(out_stream, node);
+        fprintf(compilation->fail_stream, "\n");
+        print_visual_node_error(compilation->fail_stream, node);
 
         exit(EXIT_FAILURE);
     } else {
@@ -148,16 +155,16 @@ void fail_node(node_t *node, const char *fmt, ...) {
             .message = strdup(fail_buf),
             .range = range
         };
-        da_append(diagnostics, diag);
-        longjmp(FAIL_JMP_ENV, 1);
+        da_append(compilation->diagnostics, diag);
+        longjmp(compilation->fail_jmp_env, 1);
     }
 }
 
-void fail_init_exit(FILE *stream) {
-    fail_mode = FAIL_EXIT;
-    out_stream = stream;
+void fail_init_exit(compilation_t* c, FILE *stream) {
+    c->fail_mode = FAIL_EXIT;
+    c->fail_stream = stream;
 }
 
-void fail_init_diagnostic() {
-    fail_mode = FAIL_DIAGNOSTIC;
+void fail_init_diagnostic(compilation_t* c) {
+    c->fail_mode = FAIL_DIAGNOSTIC;
 }
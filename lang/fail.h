@@ -9,7 +9,8 @@
 
 enum FAIL_MODE {
     FAIL_EXIT,
-    FAIL_DIAGNOSTIC
+    FAIL_DIAGNOSTIC,
+    FAIL_SILENT // only longjmp to fail_jmp_env, the work is redone to report the error
 };
 
 struct diagnostic_t {
@@ -17,23 +18,23 @@ struct diagnostic_t {
     char *message;
 };
 
-extern jmp_buf FAIL_JMP_ENV;
-extern struct diagnostic_t *diagnostics;
-extern enum FAIL_MODE fail_mode;
+// Failures go to the current compilation (see compilation.h): its fail_mode
+// says what to do, FAIL_DIAGNOSTIC appends to its diagnostics and all modes
+// but FAIL_EXIT longjmp to its fail_jmp_env.
 
 // fprintf(stream, "file:line:col: ")
-void print_node_location(FILE* stream, node_t* node);
+void print_node_location(FILE* stream, node_id_t node);
 
 //  9 | void foo() {
 //           ^~~
-void print_visual_node_error(FILE* stream, node_t* node);
+void print_visual_node_error(FILE* stream, node_id_t node);
 
-void fail_node(node_t *node, const char* fmt, ...);
+void fail_node(node_id_t node, const char* fmt, ...);
 
 char* location_str(location_t loc);
 
-void fail_init_exit(FILE *stream);
-void fail_init_diagnostic();
+void fail_init_exit(compilation_t* c, FILE *stream);
+void fail_init_diagnostic(compilation_t* c);
 
 void fail_token(token_t);
 void fail_token_expected(token_t, token_type_t);
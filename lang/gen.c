@@ -4,36 +4,37 @@
 #include <string.h>
 
 #include "gen.h"
+#include "compilation.h"
 #include "da.h"
+#include "da_bitset.h"
+#include "da_sort.h"
 #include "fail.h"
 #include "langc.h"
+#include "regalloc.h"
 #include "symbol.h"
 #include "symbol_table.h"
 #include "tree.h"
 #include "type.h"
 #include "tac.h"
 
-FILE *gen_outfile = 0;
 
 #define NUM_REGISTER_PARAMS 6
 static const char* REGISTER_PARAMS[6] = {RDI, RSI, RDX, RCX, R8, R9};
 
-// node** : 
-#define FUNCTION_ARGS(func) ((func)->node->children[1]->children[0]->children)
+// DECLARATION_LIST node of the parameters
+#define FUNCTION_ARGS(func) (node_child(node_child((func)->node, 1), 0))
 
 static void generate_stringtable();
 static void generate_global_variables();
 static void generate_constants();
-static void generate_function(function_code_t);
+static void generate_function(function_code_t*);
 static void generate_tac(tac_t);
 static void preprocess_tac_list(tac_t* tac_list);
 static void generate_safe_putchar();
 static void generate_safe_printf();
 static void generate_main_function();
 
-static size_t* addr_frame_location;
-
-char* REG64[18] = {
+char* REG64[NUM_REGS] = {
     "%rax",
     "%rbx",
     "%rcx",
@@ -52,30 +53,58 @@ char* REG64[18] = {
     "%r15",
     "%xmm0",
     "%xmm1",
+    "%xmm2",
+    "%xmm3",
+    "%xmm4",
+    "%xmm5",
+    "%xmm6",
+    "%xmm7",
+    "%xmm8",
+    "%xmm9",
+    "%xmm10",
+    "%xmm11",
+    "%xmm12",
+    "%xmm13",
+    "%xmm14",
+    "%xmm15",
 };
 
-char* REG32[18] = {
-    "%eax"
-    "%ebx"
-    "%ecx"
-    "%edx"
-    "%esi"
-    "%edi"
-    "%esp"
-    "%ebp"
-    "%r8d"
-    "%r9d"
-    "%r10d"
-    "%r11d"
-    "%r12d"
-    "%r13d"
-    "%r14d"
-    "%r15d"
+char* REG32[NUM_REGS] = {
+    "%eax",
+    "%ebx",
+    "%ecx",
+    "%edx",
+    "%esi",
+    "%edi",
+    "%esp",
+    "%ebp",
+    "%r8d",
+    "%r9d",
+    "%r10d",
+    "%r11d",
+    "%r12d",
+    "%r13d",
+    "%r14d",
+    "%r15d",
     "%xmm0",
     "%xmm1",
+    "%xmm2",
+    "%xmm3",
+    "%xmm4",
+    "%xmm5",
+    "%xmm6",
+    "%xmm7",
+    "%xmm8",
+    "%xmm9",
+    "%xmm10",
+    "%xmm11",
+    "%xmm12",
+    "%xmm13",
+    "%xmm14",
+    "%xmm15",
 };
 
-char* REG16[18] = {
+char* REG16[NUM_REGS] = {
     "%ax",
     "%bx",
     "%cx",
@@ -94,9 +123,23 @@ char* REG16[18] = {
     "%r15w",
     "%xmm0",
     "%xmm1",
+    "%xmm2",
+    "%xmm3",
+    "%xmm4",
+    "%xmm5",
+    "%xmm6",
+    "%xmm7",
+    "%xmm8",
+    "%xmm9",
+    "%xmm10",
+    "%xmm11",
+    "%xmm12",
+    "%xmm13",
+    "%xmm14",
+    "%xmm15",
 };
 
-char* REG8[18] = {
+char* REG8[NUM_REGS] = {
     "%al",
     "%bl",
     "%cl",
@@ -115,12 +158,25 @@ char* REG8[18] = {
     "%r15b",
     "%xmm0",
     "%xmm1",
+    "%xmm2",
+    "%xmm3",
+    "%xmm4",
+    "%xmm5",
+    "%xmm6",
+    "%xmm7",
+    "%xmm8",
+    "%xmm9",
+    "%xmm10",
+    "%xmm11",
+    "%xmm12",
+    "%xmm13",
+    "%xmm14",
+    "%xmm15",
 };
 
-void generate_program() {
-    if (gen_outfile == 0) {
-        gen_outfile = stdout;
-    }
+void generate_program(compilation_t* c, FILE* outfile) {
+    compilation = c;
+    compilation->gen_outfile = outfile;
 
     generate_stringtable();
     generate_constants();
@@ -129,10 +185,14 @@ void generate_program() {
 
     DIRECTIVE(".text");
 
-    addr_frame_location = malloc(sizeof(size_t) * da_size(addr_list));
+    compilation->addr_frame_location = malloc(sizeof(size_t) * da_size(compilation->addr_list));
+    compilation->addr_reg = malloc(sizeof(reg_t) * da_size(compilation->addr_list));
+    for (size_t i = 0; i < da_size(compilation->addr_list); ++i) {
+        compilation->addr_reg[i] = REG_NONE;
+    }
 
-    for (size_t i = 0; i < da_size(function_codes); ++i) {
-        generate_function(function_codes[i]);
+    for (size_t i = 0; i < da_size(compilation->function_codes); ++i) {
+        generate_function(&compilation->function_codes[i]);
     }
 
     generate_main_function();
@@ -149,8 +209,8 @@ static void generate_stringtable() {
     // This string is used by the entry point-wrapper
     DIRECTIVE("errout: .asciz \"%s\"", "Wrong number of arguments");
 
-    for (size_t i = 0; i < da_size(global_string_list); i++)
-        DIRECTIVE("string%ld: \t.asciz \"%s\"", i, global_string_list[i]);
+    for (size_t i = 0; i < da_size(compilation->global_string_list); i++)
+        DIRECTIVE("string%ld: \t.asciz \"%s\"", i, compilation->global_string_list[i]);
 
 }
 
@@ -158,12 +218,12 @@ static void generate_global_variables() {
     DIRECTIVE(".section %s", ASM_BSS_SECTION);
     DIRECTIVE(".align 8");
 
-    for (size_t i = 0; i < global_symbol_table->n_symbols; ++i) {
-        symbol_t *sym = global_symbol_table->symbols[i];
+    for (size_t i = 0; i < compilation->global_symbol_table->n_symbols; ++i) {
+        symbol_t *sym = compilation->global_symbol_table->symbols[i];
         if (sym->type != SYMBOL_GLOBAL_VAR)
             continue;
 
-        type_info_t* type = sym->node->type_info;
+        type_info_t* type = node_type_info(sym->node);
         assert(type != NULL);
 
         // TODO: Currently no initial values
@@ -172,8 +232,8 @@ static void generate_global_variables() {
 }
 
 static void generate_constants() {
-    for (size_t i = 0; i < da_size(addr_list); ++i) {
-        addr_t addr = addr_list[i];
+    for (size_t i = 0; i < da_size(compilation->addr_list); ++i) {
+        addr_t addr = compilation->addr_list[i];
 
         switch (addr.type) {
             case ADDR_REAL_CONST:
@@ -194,14 +254,10 @@ static void generate_constants() {
     }
 }
 
-static symbol_t* current_function;
-static size_t* current_used_addrs = 0;
-static int* is_jmp_dst = 0; // true if label is used as a jump destination
+static void generate_function(function_code_t* func_code) {
+    compilation->current_function = func_code->function_symbol;
 
-static void generate_function(function_code_t func_code) {
-    current_function = func_code.function_symbol;
-
-    LABEL(".%s", current_function->name);
+    LABEL(".%s", compilation->current_function->name);
     PUSHQ(RBP);
     MOVQ(RSP, RBP);
 
@@ -210,34 +266,41 @@ static void generate_function(function_code_t func_code) {
     size_t local_space = 0;
     size_t home_space = 0;
 
-    for (size_t i = 0; i < da_size(FUNCTION_ARGS(current_function)) && i < NUM_REGISTER_PARAMS; ++i) {
+    for (size_t i = 0; i < node_n_children(FUNCTION_ARGS(compilation->current_function)) && i < NUM_REGISTER_PARAMS; ++i) {
         // lol
-        EMIT("pushq %s // %s", REGISTER_PARAMS[i], FUNCTION_ARGS(current_function)[i]->children[0]->symbol->name);
+        EMIT("pushq %s // %s", REGISTER_PARAMS[i], node_symbol(node_child(node_child(FUNCTION_ARGS(compilation->current_function), i), 0))->name);
         home_space += 8;
     }
 
-    preprocess_tac_list(func_code.tac_list);
+    preprocess_tac_list(func_code->tac_list);
+    // Registers and the shared slots of the scalars, right below the home slots
+    local_space = allocate_registers(func_code, home_space);
+    size_t unshared_space = 0;
 
-    for (size_t i = 0; i < da_size(current_used_addrs); ++i) {
-        addr_t addr = addr_list[current_used_addrs[i]];
+    for (size_t i = 0; i < da_size(compilation->current_used_addrs); ++i) {
+        addr_t addr = compilation->addr_list[compilation->current_used_addrs[i]];
+        bool placed = da_bitset_test(compilation->current_placed_addrs, compilation->current_used_addrs[i]);
         switch (addr.type) {
         case ADDR_SYMBOL:
             {
                 symbol_t* sym = addr.data.symbol;
                 
                 if (sym->type == SYMBOL_LOCAL_VAR || sym->type == SYMBOL_LOCAL_STRUCT) {
-                    assert(sym->node != NULL);
-                    assert(sym->node->type_info != NULL);
-                    local_space += type_sizeof(sym->node->type_info);
-                    addr_frame_location[current_used_addrs[i]] = local_space + home_space;
+                    assert(sym->node != 0);
+                    assert(node_type_info(sym->node) != NULL);
+                    unshared_space += type_sizeof(node_type_info(sym->node));
+                    if (placed) break;
+                    local_space += type_sizeof(node_type_info(sym->node));
+                    compilation->addr_frame_location[compilation->current_used_addrs[i]] = local_space + home_space;
                 }
             }
             break;
         case ADDR_TEMP:
             {
-                // TODO: temporary with other size?
-                local_space += 8;
-                addr_frame_location[current_used_addrs[i]] = local_space + home_space;
+                unshared_space += 8;
+                if (placed) break;
+                local_space += type_sizeof(type_create_basic(addr.type_info));
+                compilation->addr_frame_location[compilation->current_used_addrs[i]] = local_space + home_space;
             }
             break;
         case ADDR_ARG_LIST:
@@ -256,30 +319,43 @@ static void generate_function(function_code_t func_code) {
         }
     }
 
+    // The callee-saved registers the function uses are kept below the locals
+    local_space = (local_space + 7) & (~7);
+    size_t saved_regs_location = local_space + home_space;
+    local_space += 8 * da_size(compilation->current_saved_regs);
+
     size_t frame_space = local_space + home_space;
 
     // align
     frame_space = (frame_space + 15) & (~15);
+    func_code->frame_size = frame_space;
+    func_code->unshared_frame_size = (unshared_space + home_space + 15) & (~15);
 
     EMIT("subq $%zu, %s", frame_space - home_space, RSP);
 
+    for (size_t i = 0; i < da_size(compilation->current_saved_regs); ++i) {
+        EMIT("movq %s, -%zu(%s)", REG64[compilation->current_saved_regs[i]], saved_regs_location + 8 * (i + 1), RBP);
+    }
 
-    for (size_t i = 0; i < da_size(func_code.tac_list); ++i) {
-        tac_t tac = func_code.tac_list[i];
-        if (tac.label < da_size(is_jmp_dst) && is_jmp_dst[tac.label]) {
+    for (size_t i = 0; i < da_size(func_code->tac_list); ++i) {
+        tac_t tac = func_code->tac_list[i];
+        if (da_bitset_test(compilation->is_jmp_dst, tac.label)) {
             LABEL("L%zu", tac.label);
         }
         generate_tac(tac);
     }
 
-    LABEL(".%s.epilogue", current_function->name);
+    LABEL(".%s.epilogue", compilation->current_function->name);
+    for (size_t i = 0; i < da_size(compilation->current_saved_regs); ++i) {
+        EMIT("movq -%zu(%s), %s", saved_regs_location + 8 * (i + 1), RBP, REG64[compilation->current_saved_regs[i]]);
+    }
     MOVQ(RBP, RSP);
     POPQ(RBP);
     RET;
 }
 
 static long get_addr_rbp_offset(size_t addr_idx) {
-    addr_t addr = addr_list[addr_idx];
+    addr_t addr = compilation->addr_list[addr_idx];
     if (addr.type == ADDR_SYMBOL && addr.data.symbol->type == SYMBOL_PARAMETER) {
         if (addr.data.symbol->sequence_number >= NUM_REGISTER_PARAMS) {
             long offs = (long)addr.data.symbol->sequence_number - NUM_REGISTER_PARAMS + 2;
@@ -292,13 +368,27 @@ static long get_addr_rbp_offset(size_t addr_idx) {
         return -offs;
     }
 
-    return -(long)addr_frame_location[addr_idx];
+    return -(long)compilation->addr_frame_location[addr_idx];
+}
+
+static bool is_xmm(const char* reg) {
+    return strncmp(reg, "%xmm", 4) == 0;
+}
+
+// Register the addr lives in, REG_NONE if it is in memory or a constant
+static reg_t addr_reg(size_t addr_idx) {
+    return compilation->addr_reg[addr_idx];
 }
 
+// The addr as an instruction operand: an immediate, a register or memory
 static const char* generate_addr_access(size_t addr_idx) {
-    static char result[420];
-    addr_t addr = addr_list[addr_idx];
+    static _Thread_local char result[420];
+    addr_t addr = compilation->addr_list[addr_idx];
     memset(result, 0, sizeof result);
+    if (addr_reg(addr_idx) != REG_NONE) {
+        snprintf(result, sizeof result, "%s", REG64[addr_reg(addr_idx)]);
+        return result;
+    }
     switch (addr.type) {
         case ADDR_INT_CONST:
             {
@@ -358,7 +448,7 @@ static const char* generate_addr_access(size_t addr_idx) {
 }
 
 static void emit_mov_addr_to_reg(size_t addr_idx, const char* reg) {
-    addr_t addr = addr_list[addr_idx];
+    addr_t addr = compilation->addr_list[addr_idx];
     switch (addr.type) {
         case ADDR_INT_CONST:
         case ADDR_SIZE_CONST:
@@ -373,10 +463,19 @@ static void emit_mov_addr_to_reg(size_t addr_idx, const char* reg) {
         case ADDR_SYMBOL:
         case ADDR_TEMP:
             {
+                if (addr_reg(addr_idx) != REG_NONE) {
+                    // Registers hold chars zero extended
+                    const char* from = REG64[addr_reg(addr_idx)];
+                    if (strcmp(from, reg) != 0) {
+                        EMIT("%s %s, %s", is_xmm(from) && is_xmm(reg) ? "movapd" : "movq", from, reg);
+                    }
+                    break;
+                }
+
                 char* size_suf = "q";
                 if (addr.type_info == TYPE_CHAR) {
                     size_suf = "zbq";
-                } else if (addr.type_info == TYPE_REAL && reg[1] == 'x') { // UUH
+                } else if (addr.type_info == TYPE_REAL && is_xmm(reg)) {
                     size_suf = "sd";
                 }
 
@@ -390,7 +489,7 @@ static void emit_mov_addr_to_reg(size_t addr_idx, const char* reg) {
 }
 
 static void emit_mov_reg_to_addr(reg_t reg, size_t addr_idx) {
-    addr_t addr = addr_list[addr_idx];
+    addr_t addr = compilation->addr_list[addr_idx];
     switch (addr.type) {
         case ADDR_INT_CONST:
         case ADDR_SIZE_CONST:
@@ -405,6 +504,17 @@ static void emit_mov_reg_to_addr(reg_t reg, size_t addr_idx) {
         case ADDR_SYMBOL:
         case ADDR_TEMP:
             {
+                if (addr_reg(addr_idx) != REG_NONE) {
+                    reg_t to = addr_reg(addr_idx);
+                    if (addr.type_info == TYPE_CHAR) {
+                        // Truncates like the one byte store to memory does
+                        EMIT("movzbq %s, %s", REG8[reg], REG64[to]);
+                    } else if (reg != to) {
+                        EMIT("%s %s, %s", reg >= REG_XMM0 && to >= REG_XMM0 ? "movapd" : "movq", REG64[reg], REG64[to]);
+                    }
+                    break;
+                }
+
                 char* size_suf = "q";
                 char* reg_str = REG64[reg];
                 if (addr.type_info == TYPE_CHAR) {
@@ -423,17 +533,200 @@ static void emit_mov_reg_to_addr(reg_t reg, size_t addr_idx) {
     }
 }
 
+static bool is_gpr(reg_t reg) {
+    return reg < REG_XMM0;
+}
+
+static bool is_xmm_reg(reg_t reg) {
+    return reg >= REG_XMM0 && reg != REG_NONE;
+}
+
+// Constants an instruction can take as a 32 bit immediate
+static bool is_imm32(size_t addr_idx) {
+    addr_t addr = compilation->addr_list[addr_idx];
+    switch (addr.type) {
+        case ADDR_INT_CONST:
+            return addr.data.int_const >= INT32_MIN && addr.data.int_const <= INT32_MAX;
+        case ADDR_SIZE_CONST:
+            return addr.data.size_const <= INT32_MAX;
+        case ADDR_BOOL_CONST:
+        case ADDR_CHAR_CONST:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Writes the addr as the source operand of an integer instruction to operand:
+// its register, an immediate if allowed, or else scratch after loading it there
+static void int_operand(size_t addr_idx, const char* scratch, bool allow_immediate, char* operand, size_t size) {
+    if (is_gpr(addr_reg(addr_idx))) {
+        snprintf(operand, size, "%s", REG64[addr_reg(addr_idx)]);
+    } else if (allow_immediate && is_imm32(addr_idx)) {
+        snprintf(operand, size, "%s", generate_addr_access(addr_idx));
+    } else {
+        emit_mov_addr_to_reg(addr_idx, scratch);
+        snprintf(operand, size, "%s", scratch);
+    }
+}
+
+// Register to compute the result of tac in. The destination's own when it
+// is in a register of the right kind that holds none of the other operands.
+static reg_t result_reg(tac_t tac, bool xmm) {
+    reg_t reg = addr_reg(tac.dst);
+    bool fits = xmm ? is_xmm_reg(reg) : is_gpr(reg) && compilation->addr_list[tac.dst].type_info != TYPE_CHAR;
+    if (!fits || (tac.src2 != 0 && reg == addr_reg(tac.src2))) {
+        return xmm ? REG_XMM0 : REG_RAX;
+    }
+    return reg;
+}
+
+static void generate_int_binary(tac_t tac) {
+    char src2[32];
+    switch (tac.instr) {
+        case TAC_BINARY_ADD:
+        case TAC_BINARY_SUB:
+        case TAC_BINARY_MUL:
+            {
+                int_operand(tac.src2, RCX, true, src2, sizeof src2);
+                reg_t result = result_reg(tac, false);
+                emit_mov_addr_to_reg(tac.src1, REG64[result]);
+                const char* op = tac.instr == TAC_BINARY_ADD ? "addq" : tac.instr == TAC_BINARY_SUB ? "subq" : "imulq";
+                EMIT("%s %s, %s", op, src2, REG64[result]);
+                emit_mov_reg_to_addr(result, tac.dst);
+            }
+            break;
+        case TAC_BINARY_DIV:
+        case TAC_BINARY_MOD:
+            {
+                int_operand(tac.src2, RCX, false, src2, sizeof src2);
+                emit_mov_addr_to_reg(tac.src1, RAX);
+                CQO; // sign extend rax to rdx:rax
+                IDIVQ(src2); // rdx:rax /= src2, remainder in rdx
+                emit_mov_reg_to_addr(tac.instr == TAC_BINARY_DIV ? REG_RAX : REG_RDX, tac.dst);
+            }
+            break;
+        default:
+            {
+                int_operand(tac.src2, RCX, true, src2, sizeof src2);
+                const char* src1 = RAX;
+                if (is_gpr(addr_reg(tac.src1))) {
+                    src1 = REG64[addr_reg(tac.src1)];
+                } else {
+                    emit_mov_addr_to_reg(tac.src1, RAX);
+                }
+                CMPQ(src2, src1);
+                switch (tac.instr) {
+                    case TAC_BINARY_GT:  SETG(AL);  break;
+                    case TAC_BINARY_LT:  SETL(AL);  break;
+                    case TAC_BINARY_GEQ: SETGE(AL); break;
+                    case TAC_BINARY_LEQ: SETLE(AL); break;
+                    case TAC_BINARY_EQ:  SETE(AL);  break;
+                    case TAC_BINARY_NEQ: SETNE(AL); break;
+                    default: assert(false);
+                }
+                reg_t result = result_reg(tac, false);
+                MOVZBQ(AL, REG64[result]);
+                emit_mov_reg_to_addr(result, tac.dst);
+            }
+            break;
+    }
+}
+
+static void generate_real_binary(tac_t tac) {
+    const char* src2 = XMM1;
+    if (is_xmm_reg(addr_reg(tac.src2))) {
+        src2 = REG64[addr_reg(tac.src2)];
+    } else {
+        emit_mov_addr_to_reg(tac.src2, XMM1);
+    }
+    reg_t result = result_reg(tac, true);
+    emit_mov_addr_to_reg(tac.src1, REG64[result]);
+
+    switch (tac.instr) {
+        case TAC_BINARY_ADD:
+            EMIT("addsd %s, %s", src2, REG64[result]);
+            break;
+        case TAC_BINARY_SUB:
+            EMIT("subsd %s, %s", src2, REG64[result]);
+            break;
+        case TAC_BINARY_MUL:
+            EMIT("mulsd %s, %s", src2, REG64[result]);
+            break;
+        case TAC_BINARY_DIV:
+            EMIT("divsd %s, %s", src2, REG64[result]);
+            break;
+        case TAC_BINARY_MOD:
+            fprintf(stderr, "Cannot mod floats\n");
+            exit(EXIT_FAILURE);
+        default:
+            // Comparisons give a bool
+            assert(false && "Comparison with a real result");
+    }
+    emit_mov_reg_to_addr(result, tac.dst);
+}
+
+// Pushes the arguments from the last to the first and pops the first
+// NUM_REGISTER_PARAMS of them into their registers. Returns the bytes of
+// arguments left on the stack.
+static size_t emit_call_arguments(size_t arg_list_idx) {
+    addr_t addr_arg_list = compilation->addr_list[arg_list_idx];
+    long num_params = da_size(addr_arg_list.data.arg_addr_list);
+
+    size_t stack_arg_space = 0;
+
+    if (num_params > NUM_REGISTER_PARAMS) {
+        stack_arg_space = (num_params - NUM_REGISTER_PARAMS) * 8;
+    }
+
+    if (stack_arg_space & 0xF) {
+        PUSHQ("$0");
+        stack_arg_space += 8;
+    }
+
+    for (long i = num_params - 1; i >= 0; --i) {
+        size_t arg_idx = addr_arg_list.data.arg_addr_list[i];
+        addr_t arg = compilation->addr_list[arg_idx];
+        if (arg.type_info == TYPE_CHAR || arg.type_info == TYPE_INT
+          || arg.type_info == TYPE_SIZE || arg.type_info == TYPE_REAL) {
+            // Reals go in the integer registers too, the callee stores them with the rest
+            if (is_gpr(addr_reg(arg_idx))) {
+                PUSHQ(REG64[addr_reg(arg_idx)]);
+            } else {
+                emit_mov_addr_to_reg(arg_idx, RAX);
+                PUSHQ(RAX);
+            }
+        } else {
+            assert(false && "Not implemented");
+        }
+    }
+
+    for (long i = 0; i < num_params && i < NUM_REGISTER_PARAMS; ++i) {
+        POPQ(REGISTER_PARAMS[i]);
+    }
+    return stack_arg_space;
+}
+
 static void generate_tac(tac_t tac) {
     switch (tac.instr) {
     case TAC_NOP:
-    case TAC_DECLARE_PARAM:
         return;
+    case TAC_DECLARE_PARAM:
+        {
+            // Parameters arrive on the stack, see generate_function
+            reg_t reg = addr_reg(tac.src1);
+            if (reg != REG_NONE) {
+                char* size_suf = is_xmm_reg(reg) ? "sd" : compilation->addr_list[tac.src1].type_info == TYPE_CHAR ? "zbq" : "q";
+                EMIT("mov%s %ld(%s), %s", size_suf, get_addr_rbp_offset(tac.src1), RBP, REG64[reg]);
+            }
+        }
+        break;
     case TAC_RETURN:
         {
             if (tac.src1 != 0) {
                 MOVQ(generate_addr_access(tac.src1), RAX);
             }
-            EMIT("jmp .%s.epilogue", current_function->name);
+            EMIT("jmp .%s.epilogue", compilation->current_function->name);
         }
         break;
     case TAC_BINARY_ADD:
@@ -448,127 +741,20 @@ static void generate_tac(tac_t tac) {
     case TAC_BINARY_EQ:
     case TAC_BINARY_NEQ:
         {
-            // TODO: clean up this mess
-            char* SRC1_REG = RAX;
-            char* SRC2_REG = RCX;
-            reg_t src1_reg_t = REG_RAX;
-            reg_t src2_reg_t = REG_RCX;
-            char* TYPE_SUF = "q";
-            bool is_float = 0;
-
-            if (addr_list[tac.dst].type_info == TYPE_REAL) {
-                SRC1_REG = XMM0;
-                SRC2_REG = XMM1;
-                src1_reg_t = REG_XMM0;
-                src2_reg_t = REG_XMM1;
-                TYPE_SUF = "sd";
-                is_float = 1;
-            }
-
-            emit_mov_addr_to_reg(tac.src1, SRC1_REG);
-            emit_mov_addr_to_reg(tac.src2, SRC2_REG);
-
-
-            switch (tac.instr) {
-                case TAC_BINARY_ADD:
-                    EMIT("add%s %s, %s", TYPE_SUF, SRC2_REG, SRC1_REG); // rax += rcx
-                    break;
-                case TAC_BINARY_SUB:
-                    EMIT("sub%s %s, %s", TYPE_SUF, SRC2_REG, SRC1_REG); // rax -= rcx
-                    break;
-                case TAC_BINARY_MUL:
-                    if (is_float) {
-                        EMIT("mulsd %s, %s", SRC2_REG, SRC1_REG);
-                    } else {
-                        IMULQ(SRC2_REG, SRC1_REG); // rax *= rcx
-                    }
-                    break;
-                case TAC_BINARY_DIV:
-                    if (is_float) {
-                        EMIT("divsd %s, %s", SRC2_REG, SRC1_REG);
-                    } else {
-                        CQO; // sign extend rax to rdx:rax
-                        IDIVQ(SRC2_REG); // rdx:rax /= rcx
-                    }
-                    break;
-                case TAC_BINARY_MOD:
-                    if (is_float) {
-                        fprintf(stderr, "Cannot mod floats\n");
-                        exit(EXIT_FAILURE);
-                    } else {
-                        CQO;
-                        IDIVQ(SRC2_REG); // rdx:rax /= rcx
-                        MOVQ(RDX, SRC1_REG);
-                    }
-                    break;
-                case TAC_BINARY_GT:
-                    if (is_float) {
-                        EMIT("comisd %s, %s", SRC2_REG, SRC1_REG);
-                    } else {
-                        CMPQ(SRC2_REG, SRC1_REG);
-                    }
-                    SETG(AL);
-                    MOVZBQ(AL, SRC1_REG);
-                    break;
-                case TAC_BINARY_LT:
-                    if (is_float) {
-                        EMIT("comisd %s, %s", SRC2_REG, SRC1_REG);
-                    } else {
-                        CMPQ(SRC2_REG, SRC1_REG);
-                    }
-                    SETL(AL);
-                    MOVZBQ(AL, SRC1_REG);
-                    break;
-                case TAC_BINARY_GEQ:
-                    if (is_float) {
-                        EMIT("comisd %s, %s", SRC2_REG, SRC1_REG);
-                    } else {
-                        CMPQ(SRC2_REG, SRC1_REG);
-                    }
-                    SETGE(AL);
-                    MOVZBQ(AL, SRC1_REG);
-                    break;
-                case TAC_BINARY_LEQ:
-                    if (is_float) {
-                        EMIT("comisd %s, %s", SRC2_REG, SRC1_REG);
-                    } else {
-                        CMPQ(SRC2_REG, SRC1_REG);
-                    }
-                    SETLE(AL);
-                    MOVZBQ(AL, SRC1_REG);
-                    break;
-                case TAC_BINARY_EQ:
-                    if (is_float) {
-                        EMIT("comisd %s, %s", SRC2_REG, SRC1_REG);
-                    } else {
-                        CMPQ(SRC2_REG, SRC1_REG);
-                    }
-                    SETE(AL);
-                    MOVZBQ(AL, SRC1_REG);
-                    break;
-                case TAC_BINARY_NEQ:
-                    if (is_float) {
-                        EMIT("comisd %s, %s", SRC2_REG, SRC1_REG);
-                    } else {
-                        CMPQ(SRC2_REG, SRC1_REG);
-                    }
-                    SETNE(AL);
-                    MOVZBQ(AL, SRC1_REG);
-                    break;
-                default:
-                    assert(false);
+            if (compilation->addr_list[tac.dst].type_info == TYPE_REAL) {
+                generate_real_binary(tac);
+            } else {
+                generate_int_binary(tac);
             }
-
-            emit_mov_reg_to_addr(src1_reg_t, tac.dst);
         }
         break;
     case TAC_CALL_VOID:
         {
-            addr_t called_addr = addr_list[tac.src1];
+            addr_t called_addr = compilation->addr_list[tac.src1];
             symbol_t* called_func = called_addr.data.symbol;
             if (called_func->is_builtin) {
                 if (strncmp(called_func->name, "print", 5) == 0) {
-                    addr_t addr_arg_list = addr_list[tac.src2];
+                    addr_t addr_arg_list = compilation->addr_list[tac.src2];
 
                     for (size_t i = 0; i < da_size(addr_arg_list.data.arg_addr_list); ++i) {
                         if (i > 0) {
@@ -578,7 +764,7 @@ static void generate_tac(tac_t tac) {
 
 
                         size_t arg_idx = addr_arg_list.data.arg_addr_list[i];
-                        addr_t arg = addr_list[arg_idx];
+                        addr_t arg = compilation->addr_list[arg_idx];
 
                         // TODO: Only works with string constants (not variables)
                         if (arg.type_info == TYPE_STRING) {
@@ -611,7 +797,7 @@ static void generate_tac(tac_t tac) {
                         EMIT("call safe_putchar");
                     }
                 } else if (strcmp(called_func->name, "delete") == 0) {
-                    addr_t addr_arg_list = addr_list[tac.src2];
+                    addr_t addr_arg_list = compilation->addr_list[tac.src2];
                     size_t arg_idx = addr_arg_list.data.arg_addr_list[0];
                     emit_mov_addr_to_reg(arg_idx, RDI);
                     EMIT("call safe_free");
@@ -620,59 +806,19 @@ static void generate_tac(tac_t tac) {
                 }
                 break;
             } 
-            symbol_t* function_symbol = addr_list[tac.src1].data.symbol;
-            addr_t addr_arg_list = addr_list[tac.src2];
-
-            long num_params = da_size(addr_arg_list.data.arg_addr_list);
-
-            size_t stack_arg_space = 0;
-
-            if (num_params > NUM_REGISTER_PARAMS) {
-                // TODO: calculate
-                stack_arg_space = (num_params - NUM_REGISTER_PARAMS) * 8;
-            }
-
-            if (stack_arg_space & 0xF) {
-                PUSHQ("$0");
-                stack_arg_space += 8;
-            }
-
-            for (long i = num_params - 1; i >= 0; --i) {
-                size_t arg_idx = addr_arg_list.data.arg_addr_list[i];
-                addr_t arg = addr_list[arg_idx];
-                if (arg.type_info == TYPE_CHAR) {
-                    EMIT("leaq %s, %s", generate_addr_access(arg_idx), RAX);
-                    PUSHQ(RAX);
-                } else if (arg.type_info == TYPE_INT || arg.type_info == TYPE_SIZE) {
-                    emit_mov_addr_to_reg(arg_idx, RAX);
-                    PUSHQ(RAX);
-                } else if (arg.type_info == TYPE_REAL) {
-                    emit_mov_addr_to_reg(arg_idx, XMM0);
-                    PUSHQ(XMM0);
-                } else if (arg.type_info == TYPE_SIZE) {
-                    emit_mov_addr_to_reg(arg_idx, RAX);
-                    PUSHQ(RAX);
-                } else {
-                    assert(false && "Not implemented");
-                }
-            }
-
-            for (long i = 0; i < num_params && i < NUM_REGISTER_PARAMS; ++i) {
-                POPQ(REGISTER_PARAMS[i]);
-            }
+            symbol_t* function_symbol = compilation->addr_list[tac.src1].data.symbol;
+            size_t stack_arg_space = emit_call_arguments(tac.src2);
             EMIT("call .%s", function_symbol->name);
 
             // restore stack
-            if (num_params > NUM_REGISTER_PARAMS)
-            {
+            if (stack_arg_space > 0) {
                 EMIT("addq $%zu, %s", stack_arg_space, RSP);
             }
         }
         break;
     case TAC_CALL:
         {
-            //assert(false);
-            symbol_t* called_func = addr_list[tac.src1].data.symbol;
+            symbol_t* called_func = compilation->addr_list[tac.src1].data.symbol;
 
             if (called_func->is_builtin) {
                 if (strcmp(called_func->name, "readchar") == 0) {
@@ -684,49 +830,11 @@ static void generate_tac(tac_t tac) {
                 }
             }
 
-            addr_t addr_arg_list = addr_list[tac.src2];
-            long num_params = da_size(addr_arg_list.data.arg_addr_list);
-
-            size_t stack_arg_space = 0;
-
-            if (num_params > NUM_REGISTER_PARAMS) {
-                stack_arg_space = (num_params - NUM_REGISTER_PARAMS) * 8;
-            }
-
-            if (stack_arg_space & 0xF) {
-                PUSHQ("$0");
-                stack_arg_space += 8;
-            }
-
-            for (long i = num_params - 1; i >= 0; --i) {
-                size_t arg_idx = addr_arg_list.data.arg_addr_list[i];
-                addr_t arg = addr_list[arg_idx];
-                if (arg.type_info == TYPE_CHAR) {
-                    EMIT("leaq %s, %s", generate_addr_access(arg_idx), RAX);
-                    PUSHQ(RAX);
-                } else if (arg.type_info == TYPE_INT) {
-                    emit_mov_addr_to_reg(arg_idx, RAX);
-                    PUSHQ(RAX);
-                } else if (arg.type_info == TYPE_REAL) {
-                    emit_mov_addr_to_reg(arg_idx, XMM0);
-                    PUSHQ(XMM0);
-                } else if (arg.type_info == TYPE_SIZE) {
-                    emit_mov_addr_to_reg(arg_idx, RAX);
-                    PUSHQ(RAX);
-                } else {
-                    assert(false && "Not implemented");
-                }
-            }
-
-
-            for (long i = 0; i < num_params && i < NUM_REGISTER_PARAMS; ++i) {
-                POPQ(REGISTER_PARAMS[i]);
-            }
-            EMIT("call .%s", addr_list[tac.src1].data.symbol->name);
+            size_t stack_arg_space = emit_call_arguments(tac.src2);
+            EMIT("call .%s", called_func->name);
 
             // restore stack
-            if (num_params > NUM_REGISTER_PARAMS)
-            {
+            if (stack_arg_space > 0) {
                 EMIT("addq $%zu, %s", stack_arg_space, RSP);
             }
             // store result
@@ -742,27 +850,45 @@ static void generate_tac(tac_t tac) {
         break;
     case TAC_COPY:
         {
-            emit_mov_addr_to_reg(tac.src1, RAX);
-            emit_mov_reg_to_addr(REG_RAX, tac.dst);
+            addr_t src = compilation->addr_list[tac.src1];
+            addr_t dst = compilation->addr_list[tac.dst];
+            if (src.type_info == dst.type_info && dst.type_info != TYPE_CHAR && addr_reg(tac.dst) != REG_NONE) {
+                emit_mov_addr_to_reg(tac.src1, REG64[addr_reg(tac.dst)]);
+            } else if (src.type_info == dst.type_info && addr_reg(tac.src1) != REG_NONE) {
+                emit_mov_reg_to_addr(addr_reg(tac.src1), tac.dst);
+            } else {
+                emit_mov_addr_to_reg(tac.src1, RAX);
+                emit_mov_reg_to_addr(REG_RAX, tac.dst);
+            }
         }
         break;
     case TAC_IF_FALSE:
         {
-            emit_mov_addr_to_reg(tac.src1, RAX);
-            CMPQ("$0", RAX);
-            EMIT("je L%zu", addr_list[tac.dst].data.label);
+            if (is_gpr(addr_reg(tac.src1))) {
+                EMIT("testq %s, %s", REG64[addr_reg(tac.src1)], REG64[addr_reg(tac.src1)]);
+            } else {
+                emit_mov_addr_to_reg(tac.src1, RAX);
+                CMPQ("$0", RAX);
+            }
+            EMIT("je L%zu", compilation->addr_list[tac.dst].data.label);
         }
         break;
     case TAC_GOTO:
         {
-            EMIT("jmp L%zu", addr_list[tac.dst].data.label);
+            EMIT("jmp L%zu", compilation->addr_list[tac.dst].data.label);
         }
         break;
     case TAC_CAST_REAL_INT:
         {
-            emit_mov_addr_to_reg(tac.src1, XMM0);
-            EMIT("cvttsd2si %s, %s", XMM0, RAX);
-            emit_mov_reg_to_addr(REG_RAX, tac.dst);
+            const char* src = XMM0;
+            if (is_xmm_reg(addr_reg(tac.src1))) {
+                src = REG64[addr_reg(tac.src1)];
+            } else {
+                emit_mov_addr_to_reg(tac.src1, XMM0);
+            }
+            reg_t result = result_reg(tac, false);
+            EMIT("cvttsd2si %s, %s", src, REG64[result]);
+            emit_mov_reg_to_addr(result, tac.dst);
         }
         break;
     case TAC_CAST_INT_CHAR:
@@ -774,70 +900,96 @@ static void generate_tac(tac_t tac) {
         break;
     case TAC_LOCOF:
         {
-            EMIT("leaq %s, %s", generate_addr_access(tac.src1), RAX);
-            emit_mov_reg_to_addr(REG_RAX, tac.dst);
+            reg_t result = result_reg(tac, false);
+            EMIT("leaq %s, %s", generate_addr_access(tac.src1), REG64[result]);
+            emit_mov_reg_to_addr(result, tac.dst);
         }
         break;
     case TAC_STORE:
         {
             // src1 -> src2[dst]
-            // Load base of array
-            emit_mov_addr_to_reg(tac.src2, RAX);
-
-            // load index of array
-            emit_mov_addr_to_reg(tac.dst, RCX);
-
-            // store exact memory location in rax
-            // TODO: preceding multiplication can be put in this
-            //       instruction
-            EMIT("leaq (%s, %s, 1), %s", RAX, RCX, RAX);
+            // Base of the array, or the pointer
+            const char* base = RAX;
+            if (is_gpr(addr_reg(tac.src2))) {
+                base = REG64[addr_reg(tac.src2)];
+            } else {
+                emit_mov_addr_to_reg(tac.src2, RAX);
+            }
 
             // What we want to store
-            emit_mov_addr_to_reg(tac.src1, RCX);
+            reg_t value = REG_RDX;
+            if (is_gpr(addr_reg(tac.src1))) {
+                value = addr_reg(tac.src1);
+            } else {
+                emit_mov_addr_to_reg(tac.src1, RDX);
+            }
+
+            // Chars take one byte, a wider store would write over their neighbours
+            bool is_char = compilation->addr_list[tac.src1].type_info == TYPE_CHAR;
+            const char* mov = is_char ? "movb" : "movq";
+            const char* value_str = is_char ? REG8[value] : REG64[value];
 
-            MOVQ(RCX, MEM(RAX));
+            // Offset in bytes, folded into the address when constant
+            if (is_imm32(tac.dst)) {
+                EMIT("%s %s, %s(%s)", mov, value_str, generate_addr_access(tac.dst) + 1, base);
+            } else {
+                char index[32];
+                int_operand(tac.dst, RCX, false, index, sizeof index);
+                EMIT("%s %s, (%s, %s, 1)", mov, value_str, base, index);
+            }
         }
         break;
     case TAC_LOAD:
         {
             // src1[src2] -> dst
-            // Load base
-
-            emit_mov_addr_to_reg(tac.src1, RAX);
-
-            // Load index
-
-            if (tac.src2 > 0) {
-                emit_mov_addr_to_reg(tac.src2, RCX);
+            const char* base = RAX;
+            if (is_gpr(addr_reg(tac.src1))) {
+                base = REG64[addr_reg(tac.src1)];
             } else {
-                MOVQ("$0", RCX);
+                emit_mov_addr_to_reg(tac.src1, RAX);
             }
 
-            // store exact location
-            EMIT("leaq (%s, %s, 1), %s", RAX, RCX, RAX);
-
-            MOVQ(MEM(RAX), RCX);
+            reg_t result = result_reg(tac, false);
+            if (result == REG_RAX) {
+                // Chars and reals go through rcx like before
+                result = REG_RCX;
+            }
+            if (tac.src2 == 0) {
+                EMIT("movq (%s), %s", base, REG64[result]);
+            } else if (is_imm32(tac.src2)) {
+                EMIT("movq %s(%s), %s", generate_addr_access(tac.src2) + 1, base, REG64[result]);
+            } else {
+                char index[32];
+                int_operand(tac.src2, RCX, false, index, sizeof index);
+                EMIT("movq (%s, %s, 1), %s", base, index, REG64[result]);
+            }
 
-            emit_mov_reg_to_addr(REG_RCX, tac.dst);
+            emit_mov_reg_to_addr(result, tac.dst);
         }
         break;
     case TAC_UNARY_NEG:
         {
-            emit_mov_addr_to_reg(tac.src1, RCX);
-            EMIT("xor %s, %s", RAX, RAX);
-            EMIT("test %s, %s", RCX, RCX);
+            if (is_gpr(addr_reg(tac.src1))) {
+                EMIT("xor %s, %s", RAX, RAX);
+                EMIT("test %s, %s", REG64[addr_reg(tac.src1)], REG64[addr_reg(tac.src1)]);
+            } else {
+                emit_mov_addr_to_reg(tac.src1, RCX);
+                EMIT("xor %s, %s", RAX, RAX);
+                EMIT("test %s, %s", RCX, RCX);
+            }
             SETE(AL);
             emit_mov_reg_to_addr(REG_RAX, tac.dst);
         }
         break;
     case TAC_UNARY_SUB:
         {
-            if (addr_list[tac.src1].type_info == TYPE_REAL) {
+            if (compilation->addr_list[tac.src1].type_info == TYPE_REAL) {
                 assert(false && "Not implemented");
             }
-            emit_mov_addr_to_reg(tac.src1, RAX);
-            EMIT("neg %s", RAX);
-            emit_mov_reg_to_addr(REG_RAX, tac.dst);
+            reg_t result = result_reg(tac, false);
+            emit_mov_addr_to_reg(tac.src1, REG64[result]);
+            EMIT("neg %s", REG64[result]);
+            emit_mov_reg_to_addr(result, tac.dst);
         }
         break;
     default:
@@ -846,45 +998,29 @@ static void generate_tac(tac_t tac) {
 
 }
 
-int comp_sizet(const void* a, const void* b) {
-    return ((int)*(size_t*)a - (int)*(size_t*)b);
-}
-
 static void preprocess_tac_list(tac_t* tac_list) {
     // generate unique sorted list of addrs used in the tac_list
-    da_clear(current_used_addrs);
+    da_clear(compilation->current_used_addrs);
 
     for (size_t i = 0; i < da_size(tac_list); ++i) {
         tac_t tac = tac_list[i];
         if (tac.src1 != 0) {
-            da_append(current_used_addrs, tac.src1);
+            da_append(compilation->current_used_addrs, tac.src1);
         }
         if (tac.src2 != 0) {
-            da_append(current_used_addrs, tac.src2);
+            da_append(compilation->current_used_addrs, tac.src2);
         }
         if (tac.dst != 0) {
-            da_append(current_used_addrs, tac.dst);
+            da_append(compilation->current_used_addrs, tac.dst);
         }
 
-        if (addr_list[tac.dst].type == ADDR_LABEL) {
-            // TODO: refactor
-            size_t dst_label = addr_list[tac.dst].data.label;
-            while (da_size(is_jmp_dst) <= dst_label) {
-                da_append(is_jmp_dst, 0);
-            }
-            is_jmp_dst[dst_label] = 1;
+        if (compilation->addr_list[tac.dst].type == ADDR_LABEL) {
+            da_bitset_set(&compilation->is_jmp_dst, compilation->addr_list[tac.dst].data.label);
         }
     }
 
     // Filter unique used addrs
-    qsort(current_used_addrs, da_size(current_used_addrs), sizeof(size_t), comp_sizet);
-    size_t ptr = 0;
-
-    for (size_t i = 1; i < da_size(current_used_addrs); ++i) {
-        if (i > ptr && current_used_addrs[ptr] == current_used_addrs[i]) continue;
-        current_used_addrs[++ptr] = current_used_addrs[i];
-    }
-    da_resize(current_used_addrs, ptr+1);
+    da_sort_unique(compilation->current_used_addrs);
 }
 
 static void generate_safe_putchar(void)
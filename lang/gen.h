@@ -4,7 +4,6 @@
 #include <stdio.h>
 #include "langc.h"
 
-extern FILE * gen_outfile;
 
 // Macros from TDT4205
 #define RAX "%rax"
@@ -33,9 +32,9 @@ extern FILE * gen_outfile;
 #define MEM(reg) "(" reg ")"
 #define ARRAY_MEM(array, index, stride) "(" array "," index "," stride ")"
 
-#define DIRECTIVE(fmt, ...) fprintf(gen_outfile, fmt "\n" __VA_OPT__(, ) __VA_ARGS__)
-#define LABEL(name, ...) fprintf(gen_outfile, name ":\n" __VA_OPT__(, ) __VA_ARGS__)
-#define EMIT(fmt, ...) fprintf(gen_outfile, "\t" fmt "\n" __VA_OPT__(, ) __VA_ARGS__)
+#define DIRECTIVE(fmt, ...) fprintf(compilation->gen_outfile, fmt "\n" __VA_OPT__(, ) __VA_ARGS__)
+#define LABEL(name, ...) fprintf(compilation->gen_outfile, name ":\n" __VA_OPT__(, ) __VA_ARGS__)
+#define EMIT(fmt, ...) fprintf(compilation->gen_outfile, "\t" fmt "\n" __VA_OPT__(, ) __VA_ARGS__)
 
 #define MOVQ(src, dst) EMIT("movq %s, %s", (src), (dst))
 #define MOVSD(src, dst) EMIT("movsd %s, %s", (src), (dst))
@@ -85,7 +84,7 @@ extern FILE * gen_outfile;
 #define ASM_STRING_SECTION ".rodata"
 #define ASM_DECLARE_MAIN ".global main"
 
-typedef enum {
+enum reg_t {
     REG_RAX,
     REG_RBX,
     REG_RCX,
@@ -103,14 +102,31 @@ typedef enum {
     REG_R14,
     REG_R15,
     REG_XMM0,
-    REG_XMM1
-} reg_t;
-
-extern char* REG64[18];
-extern char* REG32[18];
-extern char* REG16[18];
-extern char* REG8[18];
-
-void generate_program(void);
+    REG_XMM1,
+    REG_XMM2,
+    REG_XMM3,
+    REG_XMM4,
+    REG_XMM5,
+    REG_XMM6,
+    REG_XMM7,
+    REG_XMM8,
+    REG_XMM9,
+    REG_XMM10,
+    REG_XMM11,
+    REG_XMM12,
+    REG_XMM13,
+    REG_XMM14,
+    REG_XMM15,
+    REG_NONE // not a register, the addr lives in its stack slot
+};
+
+#define NUM_REGS REG_NONE
+
+extern char* REG64[NUM_REGS];
+extern char* REG32[NUM_REGS];
+extern char* REG16[NUM_REGS];
+extern char* REG8[NUM_REGS];
+
+void generate_program(compilation_t* c, FILE* outfile);
 
 #endif // GEN_H
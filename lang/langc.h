@@ -2,10 +2,13 @@
 #define LANGC_H
 
 #include <stddef.h>
+#include <stdint.h>
 
 // Forward declarations
+typedef struct compilation_t compilation_t;
 typedef struct symbol_table_t symbol_table_t;
 typedef struct node_t node_t;
+typedef uint32_t node_id_t;
 typedef enum symbol_type_t symbol_type_t;
 typedef struct symbol_t symbol_t;
 
@@ -22,6 +25,10 @@ typedef enum instruction_t instruction_t;
 typedef struct addr_t addr_t;
 typedef struct tac_t tac_t;
 typedef struct function_code_t function_code_t;
+typedef struct cfg_t cfg_t;
+typedef struct basic_block_t basic_block_t;
+typedef struct loop_t loop_t;
+typedef enum reg_t reg_t;
 
 typedef struct {
     int line;
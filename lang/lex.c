@@ -1,6 +1,10 @@
 #include "lex.h"
+#include "atom.h"
+#include "compilation.h"
 #include "da.h"
 #include "fail.h"
+#include "lex_scan.h"
+#include "lex_table.h"
 #include <ctype.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -40,278 +44,337 @@ char* TOKEN_TYPE_NAMES[] = {
     "EOF"
 };
 
-int content_ptr;
-int content_size;
-char* content;
-int current_line;
-int* offset_line_number = 0; // for each position of the file, records which line it is
-int* line_start = 0;         // for each line, records which offset it starts.
-
-static void skip_whitespace();
-static void skip_comments();
-static bool isidentifierchar(char c);
-static bool matches_prefix_word(char* pref);
-static size_t matches_identifier();
-static size_t matches_integer();
-static size_t matches_real();
-static size_t matches_string();
-static size_t matches_char();
-static size_t matches_operator();
-static void catchup_lines(size_t);
-
-char* CURRENT_FILE_NAME;
-token_t current_token = (token_t){.begin_offset = -1};
-
-void lexer_init(char* file_name, char* file_content) {
-    CURRENT_FILE_NAME = file_name;
-
-    content = file_content;
-    content_size = da_size(content);
-    content_ptr = 0;
-    current_line = 0;
-    da_clear(line_start);
-    da_clear(offset_line_number);
-    da_append(line_start, 0);
-
-    current_token.begin_offset = -1;
+static void skip_whitespace(compilation_t* c);
+static void skip_comments(compilation_t* c);
+static token_type_t keyword_type(const char* word, size_t len);
+static size_t matches_identifier(compilation_t* c);
+static size_t matches_integer(compilation_t* c);
+static size_t matches_real(compilation_t* c);
+static size_t matches_string(compilation_t* c);
+static size_t matches_char(compilation_t* c);
+static size_t matches_operator(compilation_t* c);
+static void index_lines(compilation_t* c);
+static bool line_contains(compilation_t* c, int line, int offset);
+static token_t scan_token(compilation_t* c);
+static token_t scan_token_table(compilation_t* c);
+
+static bool use_table = false;
+
+void lexer_init(compilation_t* c, char* file_name, const char* file_content, size_t file_size) {
+    compilation = c;
+    c->file_name = file_name;
+
+    c->content = file_content;
+    c->content_size = file_size;
+    c->content_ptr = 0;
+    index_lines(c);
+    lex_scan_init();
+
+    // Lex the whole file up front, peeking and advancing only move token_idx
+    da_clear(c->tokens);
+    c->token_idx = 0;
+    token_t token;
+    do {
+        token = use_table ? scan_token_table(c) : scan_token(c);
+        da_append(c->tokens, token);
+    } while (token.type != LEX_END);
 }
 
+void lexer_use_table(bool enable) {
+    use_table = enable;
+}
 
 token_t lexer_peek() {
-    if (current_token.begin_offset == content_ptr) return current_token;
-
-    skip_whitespace();
-    skip_comments();
+    return compilation->tokens[compilation->token_idx];
+}
 
-    size_t match_len;
-    current_token.begin_offset = content_ptr;
-    if (content_ptr >= content_size) {
-        current_token.type = LEX_END;
-        current_token.end_offset = content_size;
-    } else if (matches_prefix_word("return")) {
-        current_token.type = LEX_RETURN;
-        current_token.end_offset = content_ptr + 6;
-    } else if (matches_prefix_word("cast")) {
-        current_token.type = LEX_CAST;
-        current_token.end_offset = content_ptr + 4;
-    } else if (matches_prefix_word("if")) {
-        current_token.type = LEX_IF;
-        current_token.end_offset = content_ptr + 2;
-    } else if (matches_prefix_word("else")) {
-        current_token.type = LEX_ELSE;
-        current_token.end_offset = content_ptr + 4;
-    } else if (matches_prefix_word("while")) {
-        current_token.type = LEX_WHILE;
-        current_token.end_offset = content_ptr + 5;
-    } else if (matches_prefix_word("true")) {
-        current_token.type = LEX_TRUE;
-        current_token.end_offset = content_ptr + 4;
-    } else if (matches_prefix_word("false")) {
-        current_token.type = LEX_FALSE;
-        current_token.end_offset = content_ptr + 5;
-    } else if (matches_prefix_word("break")) {
-        current_token.type = LEX_BREAK;
-        current_token.end_offset = content_ptr + 5;
-    } else if (matches_prefix_word("continue")) {
-        current_token.type = LEX_CONTINUE;
-        current_token.end_offset = content_ptr + 8;
-    } else if (matches_prefix_word("struct")) {
-        current_token.type = LEX_STRUCT;
-        current_token.end_offset = content_ptr + 6;
-    } else if (matches_prefix_word("alloc")) {
-        current_token.type = LEX_ALLOC;
-        current_token.end_offset = content_ptr + 5;
-    } else if (matches_prefix_word("type")) {
-        current_token.type = LEX_TYPE;
-        current_token.end_offset = content_ptr + 4;
-    } else if ((match_len = matches_identifier())) {
-        current_token.type = LEX_IDENTIFIER;
-        current_token.end_offset = content_ptr + match_len;
-    } else if (content[content_ptr] == ';') {
-        current_token.type = LEX_SEMICOLON;
-        current_token.end_offset = content_ptr + 1;
-    } else if (content_ptr + 1 < content_size && content[content_ptr] == '-' && content[content_ptr+1] == '>') {
-        current_token.type = LEX_ARROW;
-        current_token.end_offset = content_ptr + 2;
-    } else if (content[content_ptr] == '(') {
-        current_token.type = LEX_LPAREN;
-        current_token.end_offset = content_ptr + 1;
-    } else if (content[content_ptr] == ')') {
-        current_token.type = LEX_RPAREN;
-        current_token.end_offset = content_ptr + 1;
-    } else if (content[content_ptr] == '{') {
-        current_token.type = LEX_LBRACE;
-        current_token.end_offset = content_ptr + 1;
-    } else if (content[content_ptr] == '}') {
-        current_token.type = LEX_RBRACE;
-        current_token.end_offset = content_ptr + 1;
-    } else if (content[content_ptr] == '[') {
-        current_token.type = LEX_LBRACKET;
-        current_token.end_offset = content_ptr + 1;
-    } else if (content[content_ptr] == ']') {
-        current_token.type = LEX_RBRACKET;
-        current_token.end_offset = content_ptr + 1;
-    } else if (content[content_ptr] == ',') {
-        current_token.type = LEX_COMMA;
-        current_token.end_offset = content_ptr + 1;
-    } else if ((match_len = matches_operator())) {
-        current_token.type = LEX_OPERATOR;
-        current_token.end_offset = content_ptr + match_len;
-    } else if (content[content_ptr] == ':') {
-        current_token.type = LEX_COLON;
-        current_token.end_offset = content_ptr + 1;
-    } else if ((match_len = matches_integer())) {
-        current_token.type = LEX_INTEGER;
-        current_token.end_offset = content_ptr + match_len;
-    } else if ((match_len = matches_real())) {
-        current_token.type = LEX_REAL;
-        current_token.end_offset = content_ptr + match_len;
-    } else if ((match_len = matches_string())) {
-        current_token.type = LEX_STRING;
-        current_token.end_offset = content_ptr + match_len;
-    } else if ((match_len = matches_char())) {
-        current_token.type = LEX_CHAR;
-        current_token.end_offset = content_ptr + match_len;
-    } else if (content[content_ptr] == '=') {
-        current_token.type = LEX_EQUAL;
-        current_token.end_offset = content_ptr + 1;
-    } else {
-        // TODO: line number information
-        fail_character(lexer_offset_location(content_ptr), content[content_ptr]);
-        exit(1);
-    }
-    return current_token;
+token_t lexer_peek_n(size_t k) {
+    size_t idx = compilation->token_idx + k;
+    if (idx >= da_size(compilation->tokens)) idx = da_size(compilation->tokens) - 1;
+    return compilation->tokens[idx];
 }
 
 void lexer_advance() {
-    lexer_peek(); // ensure current_token goes beyond
-    content_ptr = current_token.end_offset;
+    if (compilation->tokens[compilation->token_idx].type != LEX_END) ++compilation->token_idx;
+}
+
+size_t lexer_index() {
+    return compilation->token_idx;
+}
+
+void lexer_seek(size_t index) {
+    compilation->token_idx = index;
+}
+
+token_t* lexer_tokens() {
+    return compilation->tokens;
 }
 
 char* lexer_substring(int begin_offset, int end_offset) {
-    return strndup(&content[begin_offset], end_offset - begin_offset);
+    return strndup(&compilation->content[begin_offset], end_offset - begin_offset);
+}
+
+const char* lexer_source(int offset) {
+    return &compilation->content[offset];
+}
+
+char* lexer_atom(int begin_offset, int end_offset) {
+    return atom_cache_intern(&compilation->atoms, &compilation->content[begin_offset], end_offset - begin_offset);
 }
 
 char* lexer_linedup(int line_num) {
-    int line_start_offset = line_start[line_num];
-    int line_end_offset = (line_num + 1 >= (int)da_size(line_start)) ? content_size : line_start[line_num + 1];
+    int line_start_offset = compilation->line_start[line_num];
+    int line_end_offset = (line_num + 1 >= (int)da_size(compilation->line_start)) ? compilation->content_size : compilation->line_start[line_num + 1];
     return lexer_substring(line_start_offset, line_end_offset);
 }
 
 location_t lexer_offset_location(int offset) {
-    catchup_lines(offset);
+    compilation_t* c = compilation;
+    if (offset > c->content_size) offset = c->content_size;
 
-    location_t loc;
-    loc.line = offset_line_number[offset];
-    if (offset >= content_size) {
-        loc.line = offset_line_number[da_size(offset_line_number) - 1];
+    // Lookups mostly come in source order, try the previous line and the one after it first
+    int line = c->last_line;
+    if (line_contains(c, line, offset)) {
+        // Same line
+    } else if (line_contains(c, line + 1, offset)) {
+        ++line;
+    } else {
+        // Binary search for the last line starting at or before offset
+        int lo = 0, hi = da_size(c->line_start) - 1;
+        while (lo < hi) {
+            int mid = lo + (hi - lo + 1) / 2;
+            if (c->line_start[mid] <= offset) lo = mid;
+            else hi = mid - 1;
+        }
+        line = lo;
     }
-    loc.character = offset - line_start[loc.line];
+    c->last_line = line;
+
+    location_t loc;
+    loc.line = line;
+    loc.character = offset - c->line_start[line];
     return loc;
 }
 
 // ===== Internal functions =====
-static bool isidentifierchar(char c) {
-    return (
-        ('A' <= c && c <= 'Z')
-     || ('a' <= c && c <= 'z')
-     || ('0' <= c && c <= '9')
-     || (c == '_')
-    );
+// Classify an identifier as a keyword token, or LEX_IDENTIFIER.
+// Length and first character leave at most one candidate to compare.
+static token_type_t keyword_type(const char* word, size_t len) {
+#define KEYWORD(str, type) return memcmp(word, str, len) == 0 ? type : LEX_IDENTIFIER
+    switch (len) {
+        case 2:
+            if (word[0] == 'i') KEYWORD("if", LEX_IF);
+            break;
+        case 4:
+            switch (word[0]) {
+                case 'c': KEYWORD("cast", LEX_CAST);
+                case 'e': KEYWORD("else", LEX_ELSE);
+                case 't':
+                    if (word[1] == 'r') KEYWORD("true", LEX_TRUE);
+                    KEYWORD("type", LEX_TYPE);
+            }
+            break;
+        case 5:
+            switch (word[0]) {
+                case 'a': KEYWORD("alloc", LEX_ALLOC);
+                case 'b': KEYWORD("break", LEX_BREAK);
+                case 'f': KEYWORD("false", LEX_FALSE);
+                case 'w': KEYWORD("while", LEX_WHILE);
+            }
+            break;
+        case 6:
+            switch (word[0]) {
+                case 'r': KEYWORD("return", LEX_RETURN);
+                case 's': KEYWORD("struct", LEX_STRUCT);
+            }
+            break;
+        case 8:
+            if (word[0] == 'c') KEYWORD("continue", LEX_CONTINUE);
+            break;
+    }
+#undef KEYWORD
+    return LEX_IDENTIFIER;
 }
 
-// Returns true if content[content_ptr:] matches pref and 
-// content[len(pref)] is a word boundary
-static bool matches_prefix_word(char* pref) {
-    int len = strlen(pref);
-    if (strncmp(&content[content_ptr], pref, len)) return false;
-    return content_ptr+len >= content_size || !isidentifierchar(content[content_ptr+len]);
+static size_t matches_identifier(compilation_t* c) {
+    unsigned char ch = c->content[c->content_ptr];
+    if ((unsigned char)((ch | 0x20) - 'a') >= 26) return 0;
+    return 1 + lex_scan_identifier(&c->content[c->content_ptr + 1], c->content_size - c->content_ptr - 1);
 }
 
-static size_t matches_identifier() {
-    if (!isalpha(content[content_ptr])) return 0;
-    int ptr = content_ptr;
-    while (ptr < content_size && isidentifierchar(content[ptr]))
-        ++ptr;
-    return ptr - content_ptr;
+// Scan the token at c->content_ptr and move past it
+static token_t scan_token(compilation_t* c) {
+    skip_whitespace(c);
+    skip_comments(c);
+
+    token_t token;
+    size_t match_len;
+    token.begin_offset = c->content_ptr;
+    if (c->content_ptr >= c->content_size) {
+        token.type = LEX_END;
+        token.end_offset = c->content_size;
+    } else if ((match_len = matches_identifier(c))) {
+        token.type = keyword_type(&c->content[c->content_ptr], match_len);
+        token.end_offset = c->content_ptr + match_len;
+    } else if (c->content[c->content_ptr] == ';') {
+        token.type = LEX_SEMICOLON;
+        token.end_offset = c->content_ptr + 1;
+    } else if (c->content_ptr + 1 < c->content_size && c->content[c->content_ptr] == '-' && c->content[c->content_ptr+1] == '>') {
+        token.type = LEX_ARROW;
+        token.end_offset = c->content_ptr + 2;
+    } else if (c->content[c->content_ptr] == '(') {
+        token.type = LEX_LPAREN;
+        token.end_offset = c->content_ptr + 1;
+    } else if (c->content[c->content_ptr] == ')') {
+        token.type = LEX_RPAREN;
+        token.end_offset = c->content_ptr + 1;
+    } else if (c->content[c->content_ptr] == '{') {
+        token.type = LEX_LBRACE;
+        token.end_offset = c->content_ptr + 1;
+    } else if (c->content[c->content_ptr] == '}') {
+        token.type = LEX_RBRACE;
+        token.end_offset = c->content_ptr + 1;
+    } else if (c->content[c->content_ptr] == '[') {
+        token.type = LEX_LBRACKET;
+        token.end_offset = c->content_ptr + 1;
+    } else if (c->content[c->content_ptr] == ']') {
+        token.type = LEX_RBRACKET;
+        token.end_offset = c->content_ptr + 1;
+    } else if (c->content[c->content_ptr] == ',') {
+        token.type = LEX_COMMA;
+        token.end_offset = c->content_ptr + 1;
+    } else if ((match_len = matches_operator(c))) {
+        token.type = LEX_OPERATOR;
+        token.end_offset = c->content_ptr + match_len;
+    } else if (c->content[c->content_ptr] == ':') {
+        token.type = LEX_COLON;
+        token.end_offset = c->content_ptr + 1;
+    } else if ((match_len = matches_integer(c))) {
+        token.type = LEX_INTEGER;
+        token.end_offset = c->content_ptr + match_len;
+    } else if ((match_len = matches_real(c))) {
+        token.type = LEX_REAL;
+        token.end_offset = c->content_ptr + match_len;
+    } else if ((match_len = matches_string(c))) {
+        token.type = LEX_STRING;
+        token.end_offset = c->content_ptr + match_len;
+    } else if ((match_len = matches_char(c))) {
+        token.type = LEX_CHAR;
+        token.end_offset = c->content_ptr + match_len;
+    } else if (c->content[c->content_ptr] == '=') {
+        token.type = LEX_EQUAL;
+        token.end_offset = c->content_ptr + 1;
+    } else {
+        // TODO: line number information
+        fail_character(lexer_offset_location(c->content_ptr), c->content[c->content_ptr]);
+        exit(1);
+    }
+    c->content_ptr = token.end_offset;
+    return token;
 }
 
-static size_t matches_integer() {
-    if (!isdigit(content[content_ptr])) return 0;
-    int ptr = content_ptr;
-    while (ptr < content_size && isdigit(content[ptr]))
+// scan_token with the generated scanner, see lex_gen.c
+static token_t scan_token_table(compilation_t* c) {
+    for (;;) {
+        token_t token;
+        token.begin_offset = c->content_ptr;
+        if (c->content_ptr >= c->content_size) {
+            token.type = LEX_END;
+            token.end_offset = c->content_size;
+            return token;
+        }
+
+        int type;
+        size_t match_len = lex_table_match(&c->content[c->content_ptr], c->content_size - c->content_ptr, &type);
+        if (match_len == 0) {
+            fail_character(lexer_offset_location(c->content_ptr), c->content[c->content_ptr]);
+            exit(1);
+        }
+        c->content_ptr += match_len;
+        if (type == LEX_TABLE_SKIP) continue;
+
+        token.type = type;
+        token.end_offset = c->content_ptr;
+        return token;
+    }
+}
+
+static size_t matches_integer(compilation_t* c) {
+    if (!isdigit(c->content[c->content_ptr])) return 0;
+    int ptr = c->content_ptr;
+    while (ptr < c->content_size && isdigit(c->content[ptr]))
         ++ptr;
     // Real
-    if (ptr < content_size && content[ptr] == '.')
+    if (ptr < c->content_size && c->content[ptr] == '.')
         return 0;
-    return ptr - content_ptr;
+    return ptr - c->content_ptr;
 }
 
-static size_t matches_real() {
-    if (!isdigit(content[content_ptr])) return 0;
-    int ptr = content_ptr;
-    while (ptr < content_size && isdigit(content[ptr]))
+static size_t matches_real(compilation_t* c) {
+    if (!isdigit(c->content[c->content_ptr])) return 0;
+    int ptr = c->content_ptr;
+    while (ptr < c->content_size && isdigit(c->content[ptr]))
         ++ptr;
-    if (ptr < content_size && content[ptr] != '.')
+    if (ptr < c->content_size && c->content[ptr] != '.')
         return 0;
     ++ptr;
-    while (ptr < content_size && isdigit(content[ptr]))
+    while (ptr < c->content_size && isdigit(c->content[ptr]))
         ++ptr;
-    return ptr - content_ptr;
+    return ptr - c->content_ptr;
 }
 
-static size_t matches_string() {
-    if (content[content_ptr] != '"') return 0;
-    int ptr = content_ptr + 1;
-    while (ptr < content_size && content[ptr] != '"') {
-        if (content[ptr] == '\\')
-            ptr += 2;
-        else
-            ptr += 1;
+static size_t matches_string(compilation_t* c) {
+    if (c->content[c->content_ptr] != '"') return 0;
+    int ptr = c->content_ptr + 1;
+    while (ptr < c->content_size) {
+        ptr += lex_scan_until2(&c->content[ptr], c->content_size - ptr, '"', '\\');
+        if (ptr >= c->content_size || c->content[ptr] == '"') break;
+        // Skip the escaped character
+        ptr += 2;
     }
-    if (ptr >= content_size) {
+    if (ptr >= c->content_size) {
         fprintf(stderr, "Unexpected EOF when parsing string literal\n");
         exit(EXIT_FAILURE);
     }
     ++ptr;
-    return ptr - content_ptr;
+    return ptr - c->content_ptr;
 }
 
-static size_t matches_char() {
-    if (content[content_ptr] != '\'') return 0;
-    int ptr = content_ptr + 1;
+static size_t matches_char(compilation_t* c) {
+    if (c->content[c->content_ptr] != '\'') return 0;
+    int ptr = c->content_ptr + 1;
 
-    if (ptr >= content_size) {
+    if (ptr >= c->content_size) {
         fprintf(stderr, "Unexpected EOF when parsing char literal\n");
         exit(EXIT_FAILURE);
     }
 
-    if (content[ptr] == '\\') {
+    if (c->content[ptr] == '\\') {
         ++ptr;
-        if (ptr >= content_size) {
+        if (ptr >= c->content_size) {
             fprintf(stderr, "Unexpected EOF when parsing char literal\n");
             exit(EXIT_FAILURE);
         }
     }
     ++ptr;
-    if (ptr >= content_size) {
+    if (ptr >= c->content_size) {
         fprintf(stderr, "Unexpected EOF when parsing char literal\n");
         exit(EXIT_FAILURE);
     }
 
-    if (content[ptr] != '\'') {
+    if (c->content[ptr] != '\'') {
         fprintf(stderr, "Unclosed char literal\n");
         exit(EXIT_FAILURE);
     }
 
     ++ptr;
-    return ptr - content_ptr;
+    return ptr - c->content_ptr;
 }
 
-static size_t matches_operator() {
+static size_t matches_operator(compilation_t* c) {
     // TODO: *=, **
-    char c = content[content_ptr];
-    switch (c) {
+    char ch = c->content[c->content_ptr];
+    switch (ch) {
         // 1 char operators that also makes sense if followed by '='
         case '!':
         case '/':
@@ -319,8 +382,8 @@ static size_t matches_operator() {
         //case '~':
         //case '^':
             {
-                if (content_ptr + 1 >= content_size) return 1;
-                if (content[content_ptr + 1] == '=') return 2;
+                if (c->content_ptr + 1 >= c->content_size) return 1;
+                if (c->content[c->content_ptr + 1] == '=') return 2;
                 return 1;
             }
         // 1 char operators that also makes sense if followed by itself or '='
@@ -330,8 +393,8 @@ static size_t matches_operator() {
         case '<':
         case '>':
             {
-                if (content_ptr + 1 >= content_size) return 1;
-                if (content[content_ptr+1] == '=') return 2;
+                if (c->content_ptr + 1 >= c->content_size) return 1;
+                if (c->content[c->content_ptr+1] == '=') return 2;
                 // TODO: ++, --, **, <<, >>
                 return 1;
             }
@@ -341,15 +404,15 @@ static size_t matches_operator() {
         case '|': // TODO: also handle '|' (bitwise) and '|='
         case '&': // TODO: also handle '&' (bitwise) and '&='
             {
-                if (content_ptr + 1 >= content_size) return 0;
-                if (content[content_ptr + 1] == c) return 2;
+                if (c->content_ptr + 1 >= c->content_size) return 0;
+                if (c->content[c->content_ptr + 1] == ch) return 2;
                 return 0;
             }
         // something else
         case '.':
             {
-                if (content_ptr + 1 >= content_size) return 1;
-                if (content[content_ptr + 1] == '*') return 2;
+                if (c->content_ptr + 1 >= c->content_size) return 1;
+                if (c->content[c->content_ptr + 1] == '*') return 2;
                 return 1;
             }
         default:
@@ -357,47 +420,54 @@ static size_t matches_operator() {
     }
 }
 
-static void catchup_lines(size_t goal_offset) {
-    if (goal_offset > (size_t)content_size)goal_offset = (size_t)content_size;
-    size_t current_ptr = da_size(offset_line_number);
-    while (current_ptr <= goal_offset) {
-        da_append(offset_line_number, current_line);
-        ++current_ptr;
-        if (current_ptr < (size_t)content_size && content[current_ptr] == '\n') {
-            ++current_line;
-            da_append(line_start, current_ptr+1);
-        }
-    }
+static bool line_contains(compilation_t* c, int line, int offset) {
+    int num_lines = da_size(c->line_start);
+    return line < num_lines
+        && c->line_start[line] <= offset
+        && (line + 1 == num_lines || offset < c->line_start[line + 1]);
 }
 
-static void skip_whitespace() {
-    while (content_ptr < content_size && isspace(content[content_ptr])) {
-        ++content_ptr;
+static void index_lines(compilation_t* c) {
+    da_clear(c->line_start);
+    da_append(c->line_start, 0);
+    c->last_line = 0;
+
+    const char* end = c->content + c->content_size;
+    const char* ptr = c->content;
+    const char* newline;
+    while (ptr < end && (newline = memchr(ptr, '\n', end - ptr))) {
+        ptr = newline + 1;
+        da_append(c->line_start, ptr - c->content);
     }
-    catchup_lines(content_ptr);
 }
 
-static void skip_comments() {
-    if (content[content_ptr] != '/') return;
-    if (content_ptr + 1 < content_size && content[content_ptr+1] == '/') {
+static void skip_whitespace(compilation_t* c) {
+    c->content_ptr += lex_scan_whitespace(&c->content[c->content_ptr], c->content_size - c->content_ptr);
+}
+
+static void skip_comments(compilation_t* c) {
+    if (c->content_ptr >= c->content_size || c->content[c->content_ptr] != '/') return;
+    if (c->content_ptr + 1 < c->content_size && c->content[c->content_ptr+1] == '/') {
         // Single line comment
-        while (content_ptr < content_size && content[content_ptr] != '\n')
-            ++content_ptr;
-    } else if (content_ptr + 1 < content_size && content[content_ptr + 1] == '*') {
+        c->content_ptr += lex_scan_until2(&c->content[c->content_ptr], c->content_size - c->content_ptr, '\n', '\n');
+    } else if (c->content_ptr + 1 < c->content_size && c->content[c->content_ptr + 1] == '*') {
         /*
          * Multi line comment
          */
-        while (content_ptr + 1 < content_size) {
-            if (content[content_ptr] == '*' && content[content_ptr+1] == '/') {
-                content_ptr += 2;
+        while (c->content_ptr + 1 < c->content_size) {
+            // Next '*' that has a character after it
+            c->content_ptr += lex_scan_until2(&c->content[c->content_ptr], c->content_size - 1 - c->content_ptr, '*', '*');
+            if (c->content_ptr + 1 >= c->content_size) break;
+            if (c->content[c->content_ptr+1] == '/') {
+                c->content_ptr += 2;
                 break;
             }
-            ++content_ptr;
+            ++c->content_ptr;
         }
     } else {
         return;
     }
     // Keep going until no more comment and no more whitespace
-    skip_whitespace();
-    skip_comments();
+    skip_whitespace(c);
+    skip_comments(c);
 }
@@ -1,6 +1,7 @@
 #ifndef LEX_H
 #define LEX_H
 
+#include <stdbool.h>
 #include <stddef.h>
 #include "langc.h"
 
@@ -44,20 +45,41 @@ typedef struct {
     int end_offset;
 } token_t;
 
+// Lexes file_content[0:file_size] into the token buffer of c, lexer errors are reported here.
+// The content does not need a NUL terminator and must outlive the compilation,
+// tokens, lexer_source and locations all point into it.
+// The functions below work on the current compilation (see compilation.h).
+void lexer_init(compilation_t* c, char* file_name, const char* file_content, size_t file_size);
 
-extern char* CURRENT_FILE_NAME;
+// Lex with the scanner generated from the token regexes in lex_gen.c
+// instead of the hand-written one, from the next lexer_init on
+void lexer_use_table(bool enable);
 
-void lexer_init(char* file_name, char* file_content);
+// Pointer to offset in the file content, not NUL terminated
+const char* lexer_source(int offset);
 
 // Return a heap allocated substring of the file content.
 char* lexer_substring(int begin_offset, int end_offset);
 
+// Return the interned (see atom.h) substring of the file content.
+char* lexer_atom(int begin_offset, int end_offset);
+
 // 0-indexed line num plz
 char* lexer_linedup(int line_num);
 
 token_t lexer_peek();
+// k tokens past lexer_peek(), LEX_END past the end of the file
+token_t lexer_peek_n(size_t k);
 void lexer_advance();
 
+// Index of lexer_peek() in lexer_tokens(), and moving it.
+// Parser worker threads have a cursor each, the token buffer is shared and only read.
+size_t lexer_index();
+void lexer_seek(size_t index);
+
+// da of all tokens in the file, ending with LEX_END
+token_t* lexer_tokens();
+
 location_t lexer_offset_location(int offset);
 
 #endif // LEX_H
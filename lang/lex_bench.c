@@ -0,0 +1,164 @@
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+
+#include "compilation.h"
+#include "da.h"
+#include "fail.h"
+#include "lex.h"
+#include "lex_scan.h"
+
+#define WALLTIME(t) (((double)(t).tv_sec + 1e-6 * (double)(t).tv_usec)*1000.0)
+
+// Benchmark: lexer throughput for every supported lex_scan level and for the
+// generated table scanner.
+// Every source is lexed to LEX_END REPS times.
+//
+//   lex-bench <file>...   source files, files that do not lex are skipped
+//   lex-bench -s <MB>     a synthetic source of about MB megabytes
+
+typedef struct {
+    char* name;
+    char* content; // da
+} source_t;
+
+static compilation_t bench; // every source is lexed into this one
+
+static char* read_file(const char* file_path) {
+    FILE* file = fopen(file_path, "r");
+    if (!file) {
+        fprintf(stderr, "Failed to open file: %s\n", file_path);
+        exit(1);
+    }
+    char* content = 0;
+    char buffer[65536];
+    size_t num_read;
+    while ((num_read = fread(buffer, 1, sizeof buffer, file)) > 0) {
+        da_append_n(content, buffer, num_read);
+    }
+    fclose(file);
+    return content;
+}
+
+static int lexes(char* name, char* content) {
+    if (setjmp(bench.fail_jmp_env)) return 0;
+    lexer_init(&bench, name, content, da_size(content));
+    return 1;
+}
+
+// Long identifiers, indentation, comments and strings, the parts the scan kernels handle
+static char* synthetic_source(size_t megabytes) {
+    char* content = 0;
+    char buffer[1024];
+    for (int i = 0; da_size(content) < megabytes << 20; ++i) {
+        int len = snprintf(buffer, sizeof buffer,
+            "// Synthetic function number %d, with a comment line that is about as long as the code\n"
+            "/*\n"
+            " * Block comment for process_record_%d, spanning a few lines\n"
+            " */\n"
+            "process_record_%d(input_buffer_value: i64, output_length: i64) -> i64 {\n"
+            "    accumulated_value_total: i64 = input_buffer_value * %d + output_length;\n"
+            "    message_text := \"a string literal with \\\"escapes\\\" and some more text in it\\n\";\n"
+            "    while (accumulated_value_total > output_length) {\n"
+            "        accumulated_value_total = accumulated_value_total - 1;\n"
+            "    }\n"
+            "    return accumulated_value_total;\n"
+            "}\n\n",
+            i, i, i, i % 97);
+        da_append_n(content, buffer, len);
+    }
+    return content;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <file>... | -s <MB>\n", argv[0]);
+        return 1;
+    }
+    // The lexer longjmps out on errors instead of exiting
+    compilation_init(&bench);
+    fail_init_diagnostic(&bench);
+
+    source_t* sources = 0;
+    if (strcmp(argv[1], "-s") == 0 && argc == 3) {
+        da_append(sources, ((source_t){"synthetic", synthetic_source(atoi(argv[2]))}));
+    } else {
+        for (int f = 1; f < argc; ++f) {
+            char* content = read_file(argv[f]);
+            // Some example files use syntax only the self-hosted compiler knows
+            if (!lexes(argv[f], content)) {
+                printf("Skipping %s: does not lex\n", argv[f]);
+                da_deinit(content);
+                continue;
+            }
+            da_append(sources, ((source_t){argv[f], content}));
+        }
+    }
+
+    size_t total_bytes = 0, total_tokens = 0;
+    for (size_t s = 0; s < da_size(sources); ++s) {
+        total_bytes += da_size(sources[s].content);
+        lexer_init(&bench, sources[s].name, sources[s].content, da_size(sources[s].content));
+        total_tokens += da_size(lexer_tokens());
+    }
+    int reps = total_bytes > (1 << 20) ? 10 : 200;
+    printf("%zu sources, %zu bytes, %zu tokens per pass\n", da_size(sources), total_bytes, total_tokens);
+
+    for (lex_scan_level_t level = LEX_SCAN_SCALAR; level <= LEX_SCAN_AVX2; ++level) {
+        if (!lex_scan_select(level)) {
+            printf("%-6s : not supported\n", LEX_SCAN_LEVEL_NAMES[level]);
+            continue;
+        }
+        struct timeval t_start, t_end;
+        gettimeofday(&t_start, NULL);
+        for (int r = 0; r < reps; ++r) {
+            for (size_t s = 0; s < da_size(sources); ++s) {
+                lexer_init(&bench, sources[s].name, sources[s].content, da_size(sources[s].content));
+            }
+        }
+        gettimeofday(&t_end, NULL);
+        double ms = (WALLTIME(t_end) - WALLTIME(t_start)) / reps;
+        printf("%-6s : %8.3f ms per pass, %8.2f Mtokens/s, %8.2f MB/s\n",
+               LEX_SCAN_LEVEL_NAMES[level], ms, total_tokens / ms / 1000.0, total_bytes / ms / 1000.0);
+    }
+
+    // The scanner generated from regexes by lex_gen
+    lexer_use_table(true);
+    struct timeval t_table_start, t_table_end;
+    gettimeofday(&t_table_start, NULL);
+    for (int r = 0; r < reps; ++r) {
+        for (size_t s = 0; s < da_size(sources); ++s) {
+            lexer_init(&bench, sources[s].name, sources[s].content, da_size(sources[s].content));
+        }
+    }
+    gettimeofday(&t_table_end, NULL);
+    lexer_use_table(false);
+    double table_ms = (WALLTIME(t_table_end) - WALLTIME(t_table_start)) / reps;
+    printf("%-6s : %8.3f ms per pass, %8.2f Mtokens/s, %8.2f MB/s\n",
+           "table", table_ms, total_tokens / table_ms / 1000.0, total_bytes / table_ms / 1000.0);
+
+    // Token locations in source order, as langls asks for them
+    struct timeval t_start, t_end;
+    size_t line_sum = 0;
+    gettimeofday(&t_start, NULL);
+    for (int r = 0; r < reps; ++r) {
+        for (size_t s = 0; s < da_size(sources); ++s) {
+            lexer_init(&bench, sources[s].name, sources[s].content, da_size(sources[s].content));
+            token_t* tokens = lexer_tokens();
+            for (size_t i = 0; i < da_size(tokens); ++i) {
+                line_sum += lexer_offset_location(tokens[i].begin_offset).line;
+            }
+        }
+    }
+    gettimeofday(&t_end, NULL);
+    printf("Lex + locations : %8.3f ms per pass%s\n",
+           (WALLTIME(t_end) - WALLTIME(t_start)) / reps, line_sum ? "" : " (all on line 0)");
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    printf("Peak RSS        : %8ld KB\n", usage.ru_maxrss);
+    return 0;
+}
@@ -0,0 +1,151 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dfa.h"
+#include "lex.h"
+#include "lex_table.h"
+
+// Lexer generator: compiles the token specification below into one minimized
+// dfa (see regex/) and prints lex_table.c, a table-driven longest-match scanner.
+//
+//   ./lex_gen > lex_table.c
+//
+// The longest match wins. On equal length the entry listed first wins,
+// so keywords come before identifiers.
+
+typedef struct {
+    char* regex;
+    int type;
+    char* type_name;
+} token_spec_t;
+
+#define TOKEN(regex, type) {regex, type, #type}
+
+// Regex syntax is the one of regex/preprocess.c: no escapes inside [...]
+static token_spec_t spec[] = {
+    TOKEN("[ \t\n\v\f\r]+",                   LEX_TABLE_SKIP),
+    TOKEN("//[^\n]*",                         LEX_TABLE_SKIP),
+    TOKEN("/\\*([^*]|\\*+[^*/])*\\*+/",       LEX_TABLE_SKIP),
+
+    TOKEN("return",                           LEX_RETURN),
+    TOKEN("cast",                             LEX_CAST),
+    TOKEN("if",                               LEX_IF),
+    TOKEN("else",                             LEX_ELSE),
+    TOKEN("while",                            LEX_WHILE),
+    TOKEN("true",                             LEX_TRUE),
+    TOKEN("false",                            LEX_FALSE),
+    TOKEN("break",                            LEX_BREAK),
+    TOKEN("continue",                         LEX_CONTINUE),
+    TOKEN("struct",                           LEX_STRUCT),
+    TOKEN("alloc",                            LEX_ALLOC),
+    TOKEN("type",                             LEX_TYPE),
+    TOKEN("[a-zA-Z]\\w*",                     LEX_IDENTIFIER),
+
+    TOKEN(";",                                LEX_SEMICOLON),
+    TOKEN(":",                                LEX_COLON),
+    TOKEN("=",                                LEX_EQUAL),
+    TOKEN("->",                               LEX_ARROW),
+    TOKEN("{",                                LEX_LBRACE),
+    TOKEN("}",                                LEX_RBRACE),
+    TOKEN("\\(",                              LEX_LPAREN),
+    TOKEN("\\)",                              LEX_RPAREN),
+    TOKEN("\\[",                              LEX_LBRACKET),
+    TOKEN("\\]",                              LEX_RBRACKET),
+    TOKEN(",",                                LEX_COMMA),
+    TOKEN("[!/%]=?|[-+*<>]=?|==|::|\\|\\||&&|\\.\\*?", LEX_OPERATOR),
+
+    TOKEN("\\d+",                             LEX_INTEGER),
+    TOKEN("\\d+\\.\\d*",                      LEX_REAL),
+    TOKEN("\"([^\"\\]|\\\\.)*\"",             LEX_STRING),
+    TOKEN("'(\\\\.|.)'",                      LEX_CHAR),
+};
+
+#define NUM_SPECS (int)(sizeof(spec) / sizeof(spec[0]))
+
+int main() {
+    char* regexes[NUM_SPECS];
+    size_t sizes[NUM_SPECS];
+    for (int i = 0; i < NUM_SPECS; ++i) {
+        regexes[i] = spec[i].regex;
+        sizes[i] = strlen(spec[i].regex);
+    }
+    dfa_t* dfa = dfa_from_regex_set(regexes, sizes, NUM_SPECS);
+
+    // Bytes that every state treats the same share a column in the table
+    int byte_class[256];
+    int class_byte[256]; // a representative byte of each class
+    int num_classes = 0;
+    for (int c = 0; c < 256; ++c) {
+        byte_class[c] = -1;
+        for (int k = 0; k < num_classes && byte_class[c] < 0; ++k) {
+            int same = 1;
+            for (int s = 0; s < dfa->num_nodes && same; ++s) {
+                same = dfa->trans[s][c] == dfa->trans[s][class_byte[k]];
+            }
+            if (same) byte_class[c] = k;
+        }
+        if (byte_class[c] < 0) {
+            class_byte[num_classes] = c;
+            byte_class[c] = num_classes++;
+        }
+    }
+    if (dfa->num_nodes > 256 || num_classes > 256) {
+        fprintf(stderr, "lex_gen: %d states, %d byte classes do not fit in uint8_t\n", dfa->num_nodes, num_classes);
+        return 1;
+    }
+
+    printf("// Generated by lex_gen from the token specification in lex_gen.c, do not edit\n");
+    printf("#include \"lex_table.h\"\n");
+    printf("#include \"lex.h\"\n");
+    printf("#include <stdint.h>\n\n");
+    printf("#define NUM_STATES  %d\n", dfa->num_nodes);
+    printf("#define NUM_CLASSES %d\n\n", num_classes);
+
+    printf("static const uint8_t byte_class[256] = {");
+    for (int c = 0; c < 256; ++c) {
+        printf("%s%d,", c % 16 == 0 ? "\n    " : " ", byte_class[c]);
+    }
+    printf("\n};\n\n");
+
+    // State 0 is the error state, 1 the initial state
+    printf("static const uint8_t trans[NUM_STATES][NUM_CLASSES] = {\n");
+    for (int s = 0; s < dfa->num_nodes; ++s) {
+        printf("    {");
+        for (int k = 0; k < num_classes; ++k) {
+            printf("%s%d", k ? ", " : "", dfa->trans[s][class_byte[k]]);
+        }
+        printf("},\n");
+    }
+    printf("};\n\n");
+
+    printf("static const int8_t accept[NUM_STATES] = {\n");
+    for (int s = 0; s < dfa->num_nodes; ++s) {
+        int token = dfa->node_token[s];
+        printf("    %s,\n", token < 0 ? "LEX_TABLE_NONE" : spec[token].type_name);
+    }
+    printf("};\n\n");
+
+    printf(
+        "size_t lex_table_match(const char* ptr, size_t len, int* token) {\n"
+        "    int state = 1;\n"
+        "    size_t match_len = 0;\n"
+        "    *token = LEX_TABLE_NONE;\n"
+        "    for (size_t i = 0; i < len; ++i) {\n"
+        "        state = trans[state][byte_class[(unsigned char)ptr[i]]];\n"
+        "        if (state == 0) break;\n"
+        "        if (accept[state] != LEX_TABLE_NONE) {\n"
+        "            match_len = i + 1;\n"
+        "            *token = accept[state];\n"
+        "        }\n"
+        "    }\n"
+        "    return match_len;\n"
+        "}\n");
+
+    fprintf(stderr, "lex_gen: %d tokens, %d states, %d byte classes, %d table bytes\n",
+            NUM_SPECS, dfa->num_nodes, num_classes, 256 + dfa->num_nodes * (num_classes + 1));
+
+    dfa_deinit(dfa);
+    free(dfa);
+    return 0;
+}
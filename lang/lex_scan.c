@@ -0,0 +1,213 @@
+#include "lex_scan.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define LEX_SCAN_X86
+#include <immintrin.h>
+#endif
+
+char* LEX_SCAN_LEVEL_NAMES[] = {
+    "scalar",
+    "sse2",
+    "avx2"
+};
+
+// ===== Scalar =====
+static inline bool is_identifier_char(unsigned char c) {
+    return (unsigned char)((c | 0x20) - 'a') < 26
+        || (unsigned char)(c - '0') < 10
+        || c == '_';
+}
+
+static inline bool is_whitespace_char(unsigned char c) {
+    return c == ' ' || (unsigned char)(c - '\t') < 5;
+}
+
+static size_t scalar_identifier(const char* ptr, size_t len) {
+    size_t i = 0;
+    while (i < len && is_identifier_char(ptr[i])) ++i;
+    return i;
+}
+
+static size_t scalar_whitespace(const char* ptr, size_t len) {
+    size_t i = 0;
+    while (i < len && is_whitespace_char(ptr[i])) ++i;
+    return i;
+}
+
+static size_t scalar_until2(const char* ptr, size_t len, char a, char b) {
+    size_t i = 0;
+    while (i < len && ptr[i] != a && ptr[i] != b) ++i;
+    return i;
+}
+
+#ifdef LEX_SCAN_X86
+// ===== SSE2, 16 bytes at a time =====
+// Unsigned lo <= v <= hi, done as a signed compare after shifting lo down to -128
+static inline __m128i sse2_in_range(__m128i v, char lo, char hi) {
+    __m128i shifted = _mm_add_epi8(v, _mm_set1_epi8((char)(0x80 - (unsigned char)lo)));
+    return _mm_cmplt_epi8(shifted, _mm_set1_epi8((char)(0x80 + (unsigned char)(hi - lo) + 1)));
+}
+
+static inline __m128i sse2_identifier_mask(__m128i v) {
+    __m128i alpha = sse2_in_range(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 'z');
+    __m128i digit = sse2_in_range(v, '0', '9');
+    __m128i under = _mm_cmpeq_epi8(v, _mm_set1_epi8('_'));
+    return _mm_or_si128(_mm_or_si128(alpha, digit), under);
+}
+
+static inline __m128i sse2_whitespace_mask(__m128i v) {
+    __m128i space = _mm_cmpeq_epi8(v, _mm_set1_epi8(' '));
+    return _mm_or_si128(space, sse2_in_range(v, '\t', '\r'));
+}
+
+static size_t sse2_identifier(const char* ptr, size_t len) {
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(ptr + i));
+        uint32_t miss = ~_mm_movemask_epi8(sse2_identifier_mask(v)) & 0xffff;
+        if (miss) return i + __builtin_ctz(miss);
+    }
+    return i + scalar_identifier(ptr + i, len - i);
+}
+
+static size_t sse2_whitespace(const char* ptr, size_t len) {
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(ptr + i));
+        uint32_t miss = ~_mm_movemask_epi8(sse2_whitespace_mask(v)) & 0xffff;
+        if (miss) return i + __builtin_ctz(miss);
+    }
+    return i + scalar_whitespace(ptr + i, len - i);
+}
+
+static size_t sse2_until2(const char* ptr, size_t len, char a, char b) {
+    __m128i va = _mm_set1_epi8(a);
+    __m128i vb = _mm_set1_epi8(b);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(ptr + i));
+        uint32_t hit = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)));
+        if (hit) return i + __builtin_ctz(hit);
+    }
+    return i + scalar_until2(ptr + i, len - i, a, b);
+}
+
+// ===== AVX2, 32 bytes at a time =====
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 static inline __m256i avx2_in_range(__m256i v, char lo, char hi) {
+    __m256i shifted = _mm256_add_epi8(v, _mm256_set1_epi8((char)(0x80 - (unsigned char)lo)));
+    return _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(0x80 + (unsigned char)(hi - lo) + 1)), shifted);
+}
+
+AVX2 static size_t avx2_identifier(const char* ptr, size_t len) {
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(ptr + i));
+        __m256i alpha = avx2_in_range(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), 'a', 'z');
+        __m256i digit = avx2_in_range(v, '0', '9');
+        __m256i under = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_'));
+        uint32_t miss = ~(uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(alpha, digit), under));
+        if (miss) return i + __builtin_ctz(miss);
+    }
+    return i + sse2_identifier(ptr + i, len - i);
+}
+
+AVX2 static size_t avx2_whitespace(const char* ptr, size_t len) {
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(ptr + i));
+        __m256i space = _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' '));
+        uint32_t miss = ~(uint32_t)_mm256_movemask_epi8(_mm256_or_si256(space, avx2_in_range(v, '\t', '\r')));
+        if (miss) return i + __builtin_ctz(miss);
+    }
+    return i + sse2_whitespace(ptr + i, len - i);
+}
+
+AVX2 static size_t avx2_until2(const char* ptr, size_t len, char a, char b) {
+    __m256i va = _mm256_set1_epi8(a);
+    __m256i vb = _mm256_set1_epi8(b);
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(ptr + i));
+        uint32_t hit = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, va), _mm256_cmpeq_epi8(v, vb)));
+        if (hit) return i + __builtin_ctz(hit);
+    }
+    return i + sse2_until2(ptr + i, len - i, a, b);
+}
+#endif // LEX_SCAN_X86
+
+// ===== Dispatch =====
+size_t (*lex_scan_identifier)(const char*, size_t) = scalar_identifier;
+size_t (*lex_scan_whitespace)(const char*, size_t) = scalar_whitespace;
+size_t (*lex_scan_until2)(const char*, size_t, char, char) = scalar_until2;
+
+static lex_scan_level_t current_level = LEX_SCAN_SCALAR;
+static bool selected = false;
+
+static bool supported(lex_scan_level_t level) {
+    switch (level) {
+        case LEX_SCAN_SCALAR:
+            return true;
+#ifdef LEX_SCAN_X86
+        case LEX_SCAN_SSE2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("sse2");
+        case LEX_SCAN_AVX2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+int lex_scan_select(lex_scan_level_t level) {
+    if (!supported(level)) return 0;
+    selected = true;
+    current_level = level;
+    switch (level) {
+        case LEX_SCAN_SCALAR:
+            lex_scan_identifier = scalar_identifier;
+            lex_scan_whitespace = scalar_whitespace;
+            lex_scan_until2     = scalar_until2;
+            break;
+#ifdef LEX_SCAN_X86
+        case LEX_SCAN_SSE2:
+            lex_scan_identifier = sse2_identifier;
+            lex_scan_whitespace = sse2_whitespace;
+            lex_scan_until2     = sse2_until2;
+            break;
+        case LEX_SCAN_AVX2:
+            lex_scan_identifier = avx2_identifier;
+            lex_scan_whitespace = avx2_whitespace;
+            lex_scan_until2     = avx2_until2;
+            break;
+#endif
+        default:
+            break;
+    }
+    return 1;
+}
+
+static void select_default() {
+    if (selected) return;
+    // Most runs are shorter than 16 bytes, so AVX2 measures no faster than SSE2
+    // on source code (see make lex-bench). It is only used when selected.
+    if (!lex_scan_select(LEX_SCAN_SSE2)) {
+        lex_scan_select(LEX_SCAN_SCALAR);
+    }
+}
+
+void lex_scan_init() {
+    // Compilations on several threads all get here
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+    pthread_once(&once, select_default);
+}
+
+lex_scan_level_t lex_scan_level() {
+    return current_level;
+}
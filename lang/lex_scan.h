@@ -0,0 +1,38 @@
+#ifndef LEX_SCAN_H
+#define LEX_SCAN_H
+
+#include <stddef.h>
+
+/*
+ * Byte scanning kernels used by the lexer. They work on [ptr, ptr + len)
+ * and never read past it. Character classes follow the "C" locale,
+ * so whitespace is " \t\n\v\f\r" and identifier characters are [A-Za-z0-9_].
+ *
+ * The kernels are function pointers. They start out scalar, lex_scan_init
+ * switches them to SSE2 and lex_scan_select to any level the cpu supports.
+ */
+
+typedef enum {
+    LEX_SCAN_SCALAR,
+    LEX_SCAN_SSE2,
+    LEX_SCAN_AVX2
+} lex_scan_level_t;
+
+extern char* LEX_SCAN_LEVEL_NAMES[];
+
+// Length of the run of identifier characters at ptr
+extern size_t (*lex_scan_identifier)(const char* ptr, size_t len);
+// Length of the run of whitespace at ptr
+extern size_t (*lex_scan_whitespace)(const char* ptr, size_t len);
+// Index of the first a or b, len if there is none
+extern size_t (*lex_scan_until2)(const char* ptr, size_t len, char a, char b);
+
+// Picks SSE2 if the cpu supports it, unless lex_scan_select was called.
+// Called by lexer_init.
+void lex_scan_init();
+
+// Returns 0 if the cpu does not support level
+int lex_scan_select(lex_scan_level_t level);
+lex_scan_level_t lex_scan_level();
+
+#endif // LEX_SCAN_H
@@ -0,0 +1,16 @@
+#ifndef LEX_TABLE_H
+#define LEX_TABLE_H
+
+#include <stddef.h>
+
+// Scanner generated by lex_gen (see lex_gen.c) into lex_table.c
+
+// Token values besides token_type_t
+#define LEX_TABLE_NONE -1 // no match
+#define LEX_TABLE_SKIP -2 // whitespace and comments
+
+// Longest match at ptr. Returns its length, 0 if nothing matches,
+// and sets token to its token_type_t or one of the values above.
+size_t lex_table_match(const char* ptr, size_t len, int* token);
+
+#endif // LEX_TABLE_H
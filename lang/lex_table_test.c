@@ -0,0 +1,76 @@
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "compilation.h"
+#include "da.h"
+#include "fail.h"
+#include "lex.h"
+
+// Checks that the generated table scanner (lex_gen.c) and the hand-written
+// one produce the same tokens, or both reject the file.
+
+static compilation_t test;
+
+static char* read_file(const char* file_path) {
+    FILE* file = fopen(file_path, "r");
+    if (!file) {
+        fprintf(stderr, "Failed to open file: %s\n", file_path);
+        exit(1);
+    }
+    char* content = 0;
+    char buffer[65536];
+    size_t num_read;
+    while ((num_read = fread(buffer, 1, sizeof buffer, file)) > 0) {
+        da_append_n(content, buffer, num_read);
+    }
+    fclose(file);
+    return content;
+}
+
+// da copy of the tokens, or 0 if the file does not lex
+static token_t* lex(char* name, char* content, bool use_table) {
+    if (setjmp(test.fail_jmp_env)) return 0;
+    lexer_use_table(use_table);
+    lexer_init(&test, name, content, da_size(content));
+    token_t* tokens = 0;
+    da_append_n(tokens, lexer_tokens(), da_size(lexer_tokens()));
+    return tokens;
+}
+
+int main(int argc, char** argv) {
+    compilation_init(&test);
+    fail_init_diagnostic(&test);
+
+    int failed = 0;
+    for (int f = 1; f < argc; ++f) {
+        char* content = read_file(argv[f]);
+        token_t* hand = lex(argv[f], content, false);
+        token_t* table = lex(argv[f], content, true);
+
+        bool same = (hand == 0) == (table == 0) && da_size(hand) == da_size(table);
+        for (size_t i = 0; same && i < da_size(hand); ++i) {
+            same = hand[i].type == table[i].type
+                && hand[i].begin_offset == table[i].begin_offset
+                && hand[i].end_offset == table[i].end_offset;
+            if (!same) {
+                location_t loc = lexer_offset_location(hand[i].begin_offset);
+                printf("%s:%d:%d: %s vs %s\n", argv[f], loc.line + 1, loc.character + 1,
+                       TOKEN_TYPE_NAMES[hand[i].type], TOKEN_TYPE_NAMES[table[i].type]);
+            }
+        }
+
+        if (same) {
+            if (hand) printf("\x1b[1;32m[OK]: %s (%zu tokens)\x1b[0m\n", argv[f], da_size(hand));
+            else      printf("\x1b[1;32m[OK]: %s (both reject it)\x1b[0m\n", argv[f]);
+        } else {
+            printf("\x1b[1;31m[FAIL]: %s\x1b[0m\n", argv[f]);
+            failed = 1;
+        }
+        da_deinit(hand);
+        da_deinit(table);
+        da_deinit(content);
+    }
+    return failed;
+}
@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include "compilation.h"
 #include "da.h"
 #include "lex.h"
 
@@ -31,7 +32,9 @@ int main() {
     char* filename = "./test-files/euler3.lang";
     read_file(filename, &file_content);
 
-    lexer_init(filename, file_content);
+    compilation_t c;
+    compilation_init(&c);
+    lexer_init(&c, filename, file_content, da_size(file_content));
 
     for (;;) {
         token_t token = lexer_peek();
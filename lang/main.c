@@ -1,13 +1,21 @@
 #include <stdio.h>
 #include <stdbool.h>
 #include <getopt.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/time.h>
+#include <sys/resource.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
+#include "cfg.h"
+#include "compilation.h"
 #include "gen.h"
 #include "lex.h"
+#include "opt.h"
 #include "parser.h"
+#include "regalloc.h"
 #include "tac.h"
 #include "tree.h"
 #include "da.h"
@@ -16,39 +24,45 @@
 #include "type.h"
 #include "fail.h"
 
-#define BUFSIZE 1024
-
 static bool opt_print_tree = false;
 static bool opt_print_tac  = false;
+static bool opt_print_cfg  = false;
 static bool opt_print_transformed_tree = false;
+static bool opt_print_stats = false;
 static char* outfile_name = "a.out";
 
-void read_file(const char* file_path, char** content) {
-    FILE* file = fopen(file_path, "r");
-
-    if (!file) {
+// Maps the file read-only. If it can not be mapped (empty file, pipe, ...)
+// it is read into a buffer of exactly the file size instead.
+void read_file(const char* file_path, char** content, size_t* size) {
+    int fd = open(file_path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0) {
         fprintf(stderr, "Failed to open file: %s\n", file_path);
         exit(1);
     }
-
-    *content = 0;
-
-    char buffer[BUFSIZE];
-    for (;;) {
-        size_t num_read = fread(buffer, 1, BUFSIZE, file);
-        if (num_read == 0) break;
-
-        for (size_t i = 0; i < num_read; ++i) {
-            da_append(*content, buffer[i]);
+    *size = st.st_size;
+
+    *content = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (*content == MAP_FAILED) {
+        *content = malloc(*size);
+        if (read(fd, *content, *size) != (ssize_t)*size) {
+            fprintf(stderr, "Failed to read file: %s\n", file_path);
+            exit(1);
         }
     }
 
-    fclose(file);
+    close(fd);
 }
 
+static const struct option long_options[] = {
+    {"stats", no_argument, NULL, 'S'},
+    {"no-opt", no_argument, NULL, 'O'},
+    {0, 0, 0, 0}
+};
+
 static void options(int argc, char **argv) {
     for (;;) {
-        switch (getopt(argc, argv, "tpTo:")) {
+        switch (getopt_long(argc, argv, "tpcTLRj:o:", long_options, NULL)) {
             case 't':
                 opt_print_tree = true;
                 break;
@@ -58,6 +72,29 @@ static void options(int argc, char **argv) {
             case 'p':
                 opt_print_tac = true;
                 break;
+            case 'c':
+                opt_print_cfg = true;
+                break;
+            case 'L':
+                // Generated table scanner instead of the hand-written one
+                lexer_use_table(true);
+                break;
+            case 'R':
+                // Every temp and local in its stack slot, for comparing
+                regalloc_use_registers(false);
+                break;
+            case 'S':
+                // Frame size and instruction count of every function, before and after the work on them
+                opt_print_stats = true;
+                break;
+            case 'O':
+                // The TAC as generated, for comparing
+                optimize_use_passes(false);
+                break;
+            case 'j':
+                // Threads for parsing, 1 is sequential
+                parser_use_threads(atoi(optarg));
+                break;
             case 'o':
                 outfile_name = optarg;
                 break;
@@ -102,19 +139,19 @@ int assemble_and_link() {
     return 1;
 }
 
-void rec(node_t* node) {
-    if (node->type_info != NULL) {
-        type_print(stdout, node->type_info);
+void rec(node_id_t node) {
+    if (node_type_info(node) != NULL) {
+        type_print(stdout, node_type_info(node));
         printf("\n");
     }
 
-    for (size_t i = 0; i < da_size(node->children); ++i) {
-        rec(node->children[i]);
+    for (size_t i = 0; i < node_n_children(node); ++i) {
+        rec(node_child(node, i));
     }
 }
 
 int main(int argc, char** argv) {
-    struct timeval t_start, t_parse, t_create_symbols, t_types, t_transform, t_ir, t_gen, t_gcc, t_end;
+    struct timeval t_start, t_parse, t_create_symbols, t_types, t_transform, t_ir, t_opt, t_gen, t_gcc, t_end;
 
     gettimeofday ( &t_start, NULL );
 
@@ -125,54 +162,65 @@ int main(int argc, char** argv) {
     }
     options(argc, argv);
 
-    fail_init_exit(stderr);
+    compilation_t c;
+    compilation_init(&c);
+    fail_init_exit(&c, stderr);
 
     char* file_content;
-    read_file(argv[optind], &file_content);
+    size_t file_size;
+    read_file(argv[optind], &file_content, &file_size);
 
-    lexer_init(argv[optind], file_content);
+    lexer_init(&c, argv[optind], file_content, file_size);
 
-    parse();
+    parse(&c);
 
     gettimeofday(&t_parse, NULL);
 
-    create_symbol_tables();
+    create_symbol_tables(&c);
 
     gettimeofday(&t_create_symbols, NULL);
 
     if (opt_print_tree) {
         printf("===== Syntax tree ===== \n");
-        print_tree(stdout, root);
+        print_tree(stdout, c.root);
         printf("\n\n");
     }
 
-    register_types();
+    register_types(&c);
 
     gettimeofday(&t_types, NULL);
 
 
-    tree_transform(root);
+    tree_transform(&c);
 
     gettimeofday(&t_transform, NULL);
 
     if (opt_print_transformed_tree) {
         printf("===== Transformed syntax tree ===== \n");
-        print_tree(stdout, root);
+        print_tree(stdout, c.root);
         printf("\n\n");
     }
 
-    generate_function_codes();
+    generate_function_codes(&c);
+    generate_cfgs(&c);
 
     gettimeofday(&t_ir, NULL);
 
+    optimize(&c);
+    gettimeofday(&t_opt, NULL);
+
     if (opt_print_tac) {
-        print_tac();
+        print_tac(&c);
+    }
+
+    if (opt_print_cfg) {
+        print_cfg(&c);
     }
 
-    gen_outfile = fopen("tmp.S", "w");
-    generate_program();
+    FILE* outfile = fopen("tmp.S", "w");
+    generate_program(&c, outfile);
     gettimeofday(&t_gen, NULL);
-    fclose(gen_outfile);
+    fclose(outfile);
 
 
     if (assemble_and_link()) {
@@ -191,11 +239,40 @@ int main(int argc, char** argv) {
     printf("Type checking : %7.3f ms\n", WALLTIME(t_types) - WALLTIME(t_create_symbols));
     printf("Transform tree: %7.3f ms\n", WALLTIME(t_transform) - WALLTIME(t_types));
     printf("IR gen        : %7.3f ms\n", WALLTIME(t_ir) - WALLTIME(t_transform));
-    printf("ASM gen       : %7.3f ms\n", WALLTIME(t_gen) - WALLTIME(t_ir));
+    printf("Optimize      : %7.3f ms\n", WALLTIME(t_opt) - WALLTIME(t_ir));
+    printf("ASM gen       : %7.3f ms\n", WALLTIME(t_gen) - WALLTIME(t_opt));
     printf("GCC           : %7.3f ms\n", WALLTIME(t_gcc) - WALLTIME(t_gen));
     printf("Total time    : %7.3f ms\n", WALLTIME(t_end) - WALLTIME(t_start));
 
-    printf("\nDone compiling %s (%zu bytes)\n", CURRENT_FILE_NAME, da_size(file_content));
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    printf("Peak RSS      : %7ld KB\n", usage.ru_maxrss);
+
+    if (opt_print_stats) {
+        size_t total_before = 0, total_after = 0;
+        printf("\n==== Frame sizes ====\n");
+        for (size_t i = 0; i < da_size(c.function_codes); ++i) {
+            function_code_t* function_code = &c.function_codes[i];
+            printf("%-24s: %6zu -> %6zu bytes\n", function_code->function_symbol->name,
+                   function_code->unshared_frame_size, function_code->frame_size);
+            total_before += function_code->unshared_frame_size;
+            total_after += function_code->frame_size;
+        }
+        printf("%-24s: %6zu -> %6zu bytes\n", "Total", total_before, total_after);
+
+        total_before = total_after = 0;
+        printf("\n==== Instructions ====\n");
+        for (size_t i = 0; i < da_size(c.function_codes); ++i) {
+            function_code_t* function_code = &c.function_codes[i];
+            printf("%-24s: %6zu -> %6zu\n", function_code->function_symbol->name,
+                   function_code->generated_size, da_size(function_code->tac_list));
+            total_before += function_code->generated_size;
+            total_after += da_size(function_code->tac_list);
+        }
+        printf("%-24s: %6zu -> %6zu\n", "Total", total_before, total_after);
+    }
+
+    printf("\nDone compiling %s (%zu bytes)\n", c.file_name, file_size);
     printf("\nOutput written to %s\n", outfile_name);
 
     return 0;
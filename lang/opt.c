@@ -0,0 +1,289 @@
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "opt.h"
+#include "cfg.h"
+#include "compilation.h"
+#include "da.h"
+#include "da_bitset.h"
+#include "sccp.h"
+#include "ssa.h"
+#include "tac.h"
+
+static bool use_passes = true;
+
+static bool propagate_copies(function_code_t* function_code, ssa_t* ssa);
+static bool eliminate_dead_code(function_code_t* function_code, ssa_t* ssa);
+static bool remove_nops(function_code_t* function_code);
+
+void optimize_use_passes(bool enable) {
+    use_passes = enable;
+}
+
+void optimize(compilation_t* c) {
+    compilation = c;
+    for (size_t i = 0; i < da_size(compilation->function_codes); ++i) {
+        function_code_t* function_code = &compilation->function_codes[i];
+        function_code->generated_size = da_size(function_code->tac_list);
+        if (!use_passes) continue;
+
+        // A folded branch leaves blocks unreachable, their values no longer
+        // meet the others at the joins and more folds, and so on
+        bool changed = true;
+        while (changed) {
+            changed = propagate_constants(function_code);
+
+            ssa_t ssa;
+            ssa_build(&ssa, function_code);
+            changed |= propagate_copies(function_code, &ssa);
+            changed |= eliminate_dead_code(function_code, &ssa);
+            ssa_release(&ssa);
+
+            changed |= remove_nops(function_code);
+        }
+    }
+}
+
+static basic_type_t type_of(size_t addr) {
+    return compilation->addr_list[addr].type_info;
+}
+
+// The COPY at i writes the value source computed by the instruction right
+// before it, in the same block, and nothing else reads source. That
+// instruction can write the destination itself.
+static bool fold_into_previous(function_code_t* function_code, ssa_t* ssa, size_t i) {
+    tac_t* tac_list = function_code->tac_list;
+    cfg_t* cfg = &function_code->cfg;
+    size_t source = ssa->instrs[i].uses[0];
+    size_t prev = i - 1;
+
+    if (i == 0 || cfg->block_of[prev] != cfg->block_of[i]) return false;
+    if (ssa->values[source].is_phi || ssa->values[source].def != prev) return false;
+    if (da_size(ssa->values[source].used_by) != 1 || da_size(ssa->values[source].used_by_phis) != 0) return false;
+    if (tac_list[prev].instr == TAC_DECLARE_PARAM || type_of(tac_list[prev].dst) != type_of(tac_list[i].dst)) return false;
+
+    // The old version of the destination is dead from prev on, the COPY was going to overwrite it
+    size_t value = ssa->instrs[i].def;
+    tac_list[prev].dst = tac_list[i].dst;
+    tac_list[i] = (tac_t){ .label = tac_list[i].label, .instr = TAC_NOP };
+    ssa->instrs[prev].def = value;
+    ssa->values[value].def = prev;
+    ssa->values[source].def = SSA_NONE;
+    da_clear(ssa->values[source].used_by);
+    ssa->instrs[i].def = SSA_NONE;
+    da_clear(ssa->instrs[i].uses);
+    return true;
+}
+
+// A variable written once holds that value wherever it is read, so a read
+// of a COPY of it can read it directly. The SSA form keeps up with the
+// replacements for eliminate_dead_code.
+static bool propagate_copies(function_code_t* function_code, ssa_t* ssa) {
+    tac_t* tac_list = function_code->tac_list;
+    size_t n_vars = da_size(ssa->vars);
+    size_t* n_writes = calloc(n_vars, sizeof(size_t));
+    for (size_t v = n_vars; v < da_size(ssa->values); ++v) {
+        ++n_writes[ssa->values[v].var];
+    }
+    size_t** slots = 0;
+    bool changed = false;
+
+    for (size_t i = 0; i < da_size(ssa->instrs); ++i) {
+        tac_t* tac = &tac_list[i];
+        ssa_instr_t* instr = &ssa->instrs[i];
+        // Copies into and out of variables, in blocks that can run
+        if (tac->instr != TAC_COPY || instr->def == SSA_NONE || instr->uses[0] == SSA_NONE) continue;
+
+        // Gets rid of the COPY for every read, the phis included
+        if (fold_into_previous(function_code, ssa, i)) {
+            changed = true;
+            continue;
+        }
+
+        size_t source = instr->uses[0];
+        if (n_writes[ssa->values[source].var] != 1 || ssa->values[source].def == SSA_NONE) continue;
+        if (type_of(tac->src1) != type_of(tac->dst)) continue;
+
+        // The phis keep reading the COPY
+        ssa_value_t* copied = &ssa->values[instr->def];
+        for (size_t u = 0; u < da_size(copied->used_by); ++u) {
+            size_t user = copied->used_by[u];
+            da_clear(slots);
+            tac_use_slots(&tac_list[user], &slots);
+            for (size_t k = 0; k < da_size(slots); ++k) {
+                if (ssa->instrs[user].uses[k] != instr->def) continue;
+                *slots[k] = tac->src1;
+                ssa->instrs[user].uses[k] = source;
+                da_append_policy(ssa->values[source].used_by, user, DA_POLICY_SMALL);
+                changed = true;
+            }
+        }
+        da_clear(copied->used_by);
+    }
+
+    free(n_writes);
+    da_deinit(slots);
+    return changed;
+}
+
+// Instructions that have to stay even when nothing reads what they write
+static bool has_effect(tac_t tac, ssa_instr_t instr) {
+    switch (tac.instr) {
+        case TAC_NOP:
+            return false;
+        case TAC_RETURN:
+        case TAC_CALL_VOID:
+        case TAC_CALL:
+        case TAC_IF_FALSE:
+        case TAC_GOTO:
+        case TAC_STORE:
+            return true;
+        case TAC_BINARY_DIV:
+        case TAC_BINARY_MOD:
+            {
+                // idiv traps on 0 and on LONG_MIN / -1, only a constant divisor rules that out
+                if (type_of(tac.dst) == TYPE_REAL) return false;
+                addr_t divisor = compilation->addr_list[tac.src2];
+                bool safe = (divisor.type == ADDR_INT_CONST && divisor.data.int_const != 0 && divisor.data.int_const != -1)
+                         || (divisor.type == ADDR_SIZE_CONST && divisor.data.size_const != 0 && divisor.data.size_const != (size_t)-1);
+                return !safe;
+            }
+        default:
+            // What it writes is in memory, a global, an array, ...
+            return instr.def == SSA_NONE;
+    }
+}
+
+typedef struct {
+    ssa_t* ssa;
+    da_bitset_t live_instrs;
+    da_bitset_t live_phis;
+    da_bitset_t read_values;  // values some live instruction or phi reads
+    size_t* worklist;         // da of read values whose definition is not yet live
+} liveness_t;
+
+static void read_value(liveness_t* live, size_t value) {
+    if (value == SSA_NONE || da_bitset_test(live->read_values, value)) return;
+    da_bitset_set(&live->read_values, value);
+    da_append(live->worklist, value);
+}
+
+static void mark_instruction(liveness_t* live, size_t i) {
+    if (da_bitset_test(live->live_instrs, i)) return;
+    da_bitset_set(&live->live_instrs, i);
+    for (size_t u = 0; u < da_size(live->ssa->instrs[i].uses); ++u) {
+        read_value(live, live->ssa->instrs[i].uses[u]);
+    }
+}
+
+// Mark and sweep: what has an effect is live, and so is the definition of
+// every value something live reads, through the phis.
+static bool eliminate_dead_code(function_code_t* function_code, ssa_t* ssa) {
+    tac_t* tac_list = function_code->tac_list;
+    cfg_t* cfg = &function_code->cfg;
+    liveness_t live = { .ssa = ssa };
+    bool changed = false;
+
+    for (size_t i = 0; i < da_size(ssa->instrs); ++i) {
+        if (cfg->blocks[cfg->block_of[i]].rpo == CFG_NONE) continue;
+        if (has_effect(tac_list[i], ssa->instrs[i])) mark_instruction(&live, i);
+    }
+
+    while (da_size(live.worklist) > 0) {
+        ssa_value_t* value = &ssa->values[da_pop(live.worklist)];
+        if (value->def == SSA_NONE) continue;
+        if (!value->is_phi) {
+            mark_instruction(&live, value->def);
+        } else if (!da_bitset_test(live.live_phis, value->def)) {
+            da_bitset_set(&live.live_phis, value->def);
+            ssa_phi_t* phi = &ssa->phis[value->def];
+            for (size_t k = 0; k < da_size(phi->args); ++k) {
+                read_value(&live, phi->args[k]);
+            }
+        }
+    }
+
+    // Unreachable blocks have no SSA form, remove_nops takes them out
+    for (size_t i = 0; i < da_size(ssa->instrs); ++i) {
+        tac_t* tac = &tac_list[i];
+        if (cfg->blocks[cfg->block_of[i]].rpo == CFG_NONE || tac->instr == TAC_NOP) continue;
+        size_t def = ssa->instrs[i].def;
+        if (!da_bitset_test(live.live_instrs, i)) {
+            *tac = (tac_t){ .label = tac->label, .instr = TAC_NOP };
+            changed = true;
+        } else if (tac->instr == TAC_CALL && def != SSA_NONE && !da_bitset_test(live.read_values, def)) {
+            tac->instr = TAC_CALL_VOID;
+            tac->dst = 0;
+            changed = true;
+        }
+    }
+
+    da_bitset_deinit(live.live_instrs);
+    da_bitset_deinit(live.live_phis);
+    da_bitset_deinit(live.read_values);
+    da_deinit(live.worklist);
+    return changed;
+}
+
+static bool is_jump(tac_t tac) {
+    return tac.instr == TAC_GOTO || tac.instr == TAC_IF_FALSE;
+}
+
+// Takes out the NOPs, the instructions of unreachable blocks and the jumps
+// to the instruction that comes next anyway. The labels of a function stay
+// consecutive (see cfg.h), so the ones left are numbered again from the
+// first label on and every jump is pointed at the label its target got.
+// Every jump has its own label addr (see tac.c), so it can be changed in place.
+static bool remove_nops(function_code_t* function_code) {
+    tac_t* tac_list = function_code->tac_list;
+    cfg_t* cfg = &function_code->cfg;
+    size_t n = da_size(tac_list);
+    if (n == 0) return false;
+    size_t first_label = tac_list[0].label;
+
+    // The first instruction from i on that stays, n for the end of the function
+    size_t* next_kept = malloc((n + 1) * sizeof(size_t));
+    next_kept[n] = n;
+    for (size_t i = n; i-- > 0;) {
+        tac_t tac = tac_list[i];
+        bool keep = tac.instr != TAC_NOP && cfg->blocks[cfg->block_of[i]].rpo != CFG_NONE;
+        if (keep && is_jump(tac)) {
+            size_t target = compilation->addr_list[tac.dst].data.label - first_label;
+            // A jump backwards, or to itself, goes somewhere else than the next instruction
+            if (target > i && next_kept[target] == next_kept[i + 1]) keep = false;
+        }
+        next_kept[i] = keep ? i : next_kept[i + 1];
+    }
+
+    size_t* new_index = malloc((n + 1) * sizeof(size_t));
+    size_t kept = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (next_kept[i] == i) new_index[i] = kept++;
+    }
+    new_index[n] = kept;
+
+    bool jumps_to_end = false;
+    for (size_t i = 0; i < n; ++i) {
+        if (next_kept[i] != i) continue;
+        tac_t tac = tac_list[i];
+        if (is_jump(tac)) {
+            size_t* label = &compilation->addr_list[tac.dst].data.label;
+            size_t target = next_kept[*label - first_label];
+            *label = first_label + new_index[target];
+            jumps_to_end |= target == n;
+        }
+        tac.label = first_label + new_index[i];
+        tac_list[new_index[i]] = tac;
+    }
+    da_resize(function_code->tac_list, kept);
+    // gen.c puts the labels on instructions, a jump to the end needs one to land on
+    if (jumps_to_end && kept < n) {
+        da_append(function_code->tac_list, ((tac_t){ .label = first_label + kept, .instr = TAC_NOP }));
+    }
+
+    free(next_kept);
+    free(new_index);
+    if (da_size(function_code->tac_list) == n) return false;
+    cfg_build(function_code);
+    return true;
+}
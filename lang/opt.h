@@ -0,0 +1,27 @@
+#ifndef OPT_H
+#define OPT_H
+
+#include <stdbool.h>
+
+#include "langc.h"
+
+// Optimizations on the TAC of every function, between generate_cfgs and
+// generate_asm. Each round runs
+//
+//  - constant propagation, see sccp.h,
+//  - copy propagation: a read of what a COPY wrote reads the source instead,
+//    when the source is a variable written once. A COPY right after the
+//    instruction computing its only source writes the destination there,
+//  - dead code elimination: instructions whose values nobody reads and that
+//    do nothing else go, and so does the result of a call nobody reads,
+//  - cleanup: NOPs, unreachable blocks and jumps to where control goes
+//    anyway are removed and the labels numbered again,
+//
+// over the SSA form of ssa.h, until a round changes nothing.
+// function_code->generated_size keeps the instruction count from before.
+void optimize(compilation_t* c);
+
+// With false the TAC stays as generated, the default is true
+void optimize_use_passes(bool enable);
+
+#endif // OPT_H
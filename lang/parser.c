@@ -2,8 +2,13 @@
 #include <stdbool.h>
 #include <assert.h>
 #include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
 
 #include "parser.h"
+#include "atom.h"
+#include "compilation.h"
 #include "da.h"
 #include "fail.h"
 #include "lex.h"
@@ -11,39 +16,78 @@
 #include "type.h"
 
 static token_t peek_expect_advance(token_type_t);
-static node_t* parse_global_statement();
-static node_t* parse_declaration_list();
-static node_t* parse_type();
-static node_t* parse_declaration(node_t*);
-static node_t* parse_type_declaration();
-static node_t* parse_block();
-static node_t* parse_struct_body();
-static node_t* parse_function_type();
-static node_t* parse_expression();
-static node_t* parse_function_call(node_t*);
-static node_t* parse_cast();
-static node_t* parse_assignment(node_t*);
-static node_t* parse_block_operation(node_t*);
-static node_t* parse_scope_resolution(node_t*);
-static node_t* parse_dot_access(node_t*);
-static node_t* parse_deref(node_t*);
-static node_t* parse_array_indexing(node_t*);
-static node_t* parse_alloc();
-static operator_t parse_operator_str(char* operator_str, bool);
-
-void parse() {
-    root = node_create(LIST);
-
-    node_t* node;
+static node_id_t parse_global_statement();
+static node_id_t parse_declaration_list();
+static node_id_t parse_type();
+static node_id_t parse_declaration(node_id_t);
+static node_id_t parse_type_declaration();
+static node_id_t parse_block();
+static node_id_t parse_struct_body();
+static node_id_t parse_function_type();
+static node_id_t parse_expression();
+static node_id_t parse_binary_expression(int);
+static node_id_t parse_primary();
+static node_id_t parse_function_call(node_id_t);
+static node_id_t parse_cast();
+static node_id_t parse_assignment(node_id_t);
+static node_id_t parse_block_operation(node_id_t);
+static node_id_t parse_scope_resolution(node_id_t);
+static node_id_t parse_dot_access(node_id_t);
+static node_id_t parse_deref(node_id_t);
+static node_id_t parse_array_indexing(node_id_t);
+static node_id_t parse_alloc();
+static operator_t parse_operator(token_t, bool);
+static long parse_integer_literal(token_t);
+static double parse_real_literal(token_t);
+
+// Top-level declarations are parsed on worker threads when the file has
+// at least this many tokens, fewer are not worth starting threads for
+#define PARALLEL_MIN_TOKENS 8192
+#define CHUNKS_PER_THREAD   4
+
+typedef struct {
+    size_t begin, end;     // token range of whole top-level declarations
+    node_pool_t pool;      // the chunk's own nodes, spliced into node_pool in order
+    node_id_t* statements; // da, ids in pool
+    bool failed;           // parse error, or the declarations did not end at `end`
+} parse_chunk_t;
+
+typedef struct {
+    compilation_t* compilation;
+    parse_chunk_t* chunks; // da
+    atomic_size_t next;
+} parse_work_t;
+
+static int parse_threads = 0;
+static _Thread_local bool in_worker = false;
+
+static char* parser_atom(int begin_offset, int end_offset);
+static bool parse_parallel(compilation_t* c);
+
+void parser_use_threads(int n_threads) {
+    parse_threads = n_threads;
+}
+
+void parse(compilation_t* c) {
+    compilation = c;
+    c->root = node_create(LIST);
+
+    if (parse_parallel(c)) {
+        node_compact_children(c->root);
+        return;
+    }
+
+    node_id_t node;
     for (;;) {
         node = parse_global_statement();
         if (!node) break;
-        node_add_child(root, node);
+        node_add_child(c->root, node);
 
         token_t token;
         for (;;) {
             token = lexer_peek();
             if (token.type == LEX_END) {
+                node_compact_children(c->root);
                 return;
             } else if (token.type == LEX_SEMICOLON) {
                 lexer_advance();
@@ -54,11 +98,166 @@ void parse() {
     }
 }
 
-static node_t* parse_global_statement() {
+// Identifiers and string literals. Worker threads only look the atoms up,
+// parse_parallel interned them all before starting the threads.
+static char* parser_atom(int begin_offset, int end_offset) {
+    if (!in_worker) {
+        return lexer_atom(begin_offset, end_offset);
+    }
+    char* atom = atom_cache_find(&compilation->atoms, lexer_source(begin_offset), end_offset - begin_offset);
+    if (!atom) {
+        fail_token(lexer_peek());
+    }
+    return atom;
+}
+
+// Parses the chunk into a fresh node_pool of the worker
+static void parse_chunk(parse_chunk_t* chunk) {
+    compilation->node_pool = (node_pool_t){0};
+
+    if (setjmp(compilation->fail_jmp_env)) {
+        chunk->failed = true;
+        chunk->pool = compilation->node_pool;
+        return;
+    }
+
+    lexer_seek(chunk->begin);
+    while (lexer_index() < chunk->end) {
+        node_id_t node = parse_global_statement();
+        da_append(chunk->statements, node);
+        while (lexer_peek().type == LEX_SEMICOLON) {
+            lexer_advance();
+        }
+    }
+    chunk->failed = lexer_index() != chunk->end;
+    chunk->pool = compilation->node_pool;
+}
+
+static void* parse_worker(void* arg) {
+    parse_work_t* work = arg;
+    in_worker = true;
+
+    // The worker's own cursor, node pool and failure mode.
+    // The tokens and atoms are shared with the other workers and only read.
+    compilation_t worker = *work->compilation;
+    worker.fail_mode = FAIL_SILENT;
+    compilation = &worker;
+
+    size_t i;
+    while ((i = atomic_fetch_add(&work->next, 1)) < da_size(work->chunks)) {
+        parse_chunk(&work->chunks[i]);
+    }
+    return NULL;
+}
+
+// Splits the tokens from the cursor on into chunks of whole top-level
+// declarations, by brace matching: a declaration starts at depth 0 after
+// a `;` or `}`. Interns the atoms the parser asks for on the way.
+// A wrong split only makes a chunk fail, see parse_chunk.
+static parse_chunk_t* split_declarations(size_t chunk_tokens) {
+    token_t* tokens = lexer_tokens();
+    size_t end = da_size(tokens) - 1; // LEX_END
+
+    parse_chunk_t* chunks = NULL;
+    size_t begin = lexer_index();
+    int depth = 0;
+    for (size_t i = begin; i < end; ++i) {
+        token_t token = tokens[i];
+        if (token.type == LEX_LBRACE || token.type == LEX_LPAREN || token.type == LEX_LBRACKET) {
+            ++depth;
+        } else if (token.type == LEX_RBRACE || token.type == LEX_RPAREN || token.type == LEX_RBRACKET) {
+            --depth;
+        } else if (token.type == LEX_IDENTIFIER) {
+            lexer_atom(token.begin_offset, token.end_offset);
+        } else if (token.type == LEX_STRING) {
+            lexer_atom(token.begin_offset + 1, token.end_offset - 1);
+        }
+
+        bool declaration_start = depth == 0 && i > begin
+            && (token.type == LEX_IDENTIFIER || token.type == LEX_TYPE)
+            && (tokens[i-1].type == LEX_SEMICOLON || tokens[i-1].type == LEX_RBRACE);
+        if (declaration_start && i - begin >= chunk_tokens) {
+            da_append(chunks, ((parse_chunk_t){ .begin = begin, .end = i }));
+            begin = i;
+        }
+    }
+    da_append(chunks, ((parse_chunk_t){ .begin = begin, .end = end }));
+
+    // `. *` spells the field `*`, see parse_dot_access
+    atom_cache_intern(&compilation->atoms, "*", 1);
+    return chunks;
+}
+
+// Parses the top-level declarations on worker threads and adds them to c->root
+// in source order. Returns false without having moved the cursor when the
+// file is too small or a chunk failed, then the caller parses sequentially,
+// which also reports the first error in the file.
+static bool parse_parallel(compilation_t* c) {
+    long n_threads = parse_threads > 0 ? parse_threads : sysconf(_SC_NPROCESSORS_ONLN);
+    size_t n_tokens = da_size(lexer_tokens()) - lexer_index();
+    if (n_threads < 2 || n_tokens < PARALLEL_MIN_TOKENS) {
+        return false;
+    }
+
+    parse_work_t work = { .compilation = c, .chunks = split_declarations(n_tokens / (n_threads * CHUNKS_PER_THREAD)) };
+    atomic_init(&work.next, 0);
+    size_t n_chunks = da_size(work.chunks);
+    if ((size_t)n_threads > n_chunks) {
+        n_threads = n_chunks;
+    }
+
+    pthread_t* threads = NULL;
+    if (n_chunks > 1) {
+        for (long t = 0; t < n_threads; ++t) {
+            pthread_t thread;
+            if (pthread_create(&thread, NULL, parse_worker, &work) != 0) break;
+            da_append(threads, thread);
+        }
+    }
+    for (size_t t = 0; t < da_size(threads); ++t) {
+        pthread_join(threads[t], NULL);
+    }
+
+    // No threads means no chunk was parsed
+    bool ok = da_size(threads) > 0;
+    for (size_t k = 0; k < n_chunks && ok; ++k) {
+        ok = !work.chunks[k].failed;
+    }
+
+    if (ok) {
+        size_t n_nodes = 0, n_children = 0;
+        for (size_t k = 0; k < n_chunks; ++k) {
+            n_nodes += da_size(work.chunks[k].pool.nodes);
+            n_children += da_size(work.chunks[k].pool.children);
+        }
+        node_pool_reserve(n_nodes, n_children);
+    }
+
+    for (size_t k = 0; k < n_chunks; ++k) {
+        parse_chunk_t* chunk = &work.chunks[k];
+        if (ok) {
+            node_id_t offset = node_pool_splice(&chunk->pool);
+            for (size_t i = 0; i < da_size(chunk->statements); ++i) {
+                node_add_child(c->root, chunk->statements[i] + offset);
+            }
+        }
+        node_pool_release(&chunk->pool);
+        da_deinit(chunk->statements);
+    }
+    da_deinit(threads);
+    da_deinit(work.chunks);
+
+    if (ok) {
+        lexer_seek(da_size(lexer_tokens()) - 1);
+    }
+    return ok;
+}
+
+static node_id_t parse_global_statement() {
     token_t token = lexer_peek();
 
     if (token.type == LEX_IDENTIFIER) {
-        return parse_declaration(NULL);
+        return parse_declaration(0);
     } else if (token.type == LEX_TYPE) {
         return parse_type_declaration();
     }
@@ -68,23 +267,23 @@ static node_t* parse_global_statement() {
     assert(false && "Unreachable");
 }
 
-// If identifier is not NULL, expects IDENTIFIER token to be consumed
+// If identifier is not 0, expects IDENTIFIER token to be consumed
 // FOLLOW: RPAREN, SEMICOLON
-static node_t* parse_declaration(node_t* identifier) {
+static node_id_t parse_declaration(node_id_t identifier) {
     // function name, assign the identifier
     token_t token;
 
-    if (identifier == NULL) {
+    if (identifier == 0) {
         token = peek_expect_advance(LEX_IDENTIFIER);
 
         identifier = node_create_leaf(IDENTIFIER, token);
-        identifier->data.identifier_str = lexer_substring(token.begin_offset, token.end_offset);
+        NODE(identifier).data.identifier_str = parser_atom(token.begin_offset, token.end_offset);
     }
 
     peek_expect_advance(LEX_COLON);
 
 
-    node_t* declaration = node_create(DECLARATION);
+    node_id_t declaration = node_create(DECLARATION);
     node_add_child(declaration, identifier);
 
     token = lexer_peek();
@@ -95,7 +294,7 @@ static node_t* parse_declaration(node_t* identifier) {
 
         token = lexer_peek();
 
-        node_t* rhs;
+        node_id_t rhs;
         if (token.type == LEX_LBRACE) {
             // assign to function??
             rhs = parse_block();
@@ -109,7 +308,7 @@ static node_t* parse_declaration(node_t* identifier) {
         return declaration;
     }
 
-    node_t* type_node = parse_type();
+    node_id_t type_node = parse_type();
     node_add_child(declaration, type_node);
 
     token = lexer_peek();
@@ -122,15 +321,15 @@ static node_t* parse_declaration(node_t* identifier) {
 
     token = lexer_peek();
 
-    node_t* rhs = 0;
+    node_id_t rhs = 0;
     if (token.type == LEX_LBRACE) {
         rhs = parse_block();
         token_t rbrace_token = peek_expect_advance(LEX_RBRACE);
         // TODO: insert return statement if not exists
-        if (da_size(rhs->children) == 0 || rhs->children[da_size(rhs->children)-1]->type != RETURN_STATEMENT) {
-            node_t* fake_return_node = node_create_leaf(RETURN_STATEMENT, rbrace_token);
+        if (node_n_children(rhs) == 0 || NODE(node_child(rhs, node_n_children(rhs)-1)).type != RETURN_STATEMENT) {
+            node_id_t fake_return_node = node_create_leaf(RETURN_STATEMENT, rbrace_token);
             // TODO: check if setting rbrace as location makes sense
-            fake_return_node->pos = rbrace_token;
+            node_pos(fake_return_node) = rbrace_token;
             node_add_child(rhs, fake_return_node);
         }
     } else {
@@ -142,17 +341,17 @@ static node_t* parse_declaration(node_t* identifier) {
     return declaration;
 }
 
-static node_t* parse_type_declaration() {
+static node_id_t parse_type_declaration() {
     peek_expect_advance(LEX_TYPE);
 
     token_t token = peek_expect_advance(LEX_IDENTIFIER);
-    node_t* identifier_node = node_create_leaf(IDENTIFIER, token);
-    identifier_node->data.identifier_str = lexer_substring(token.begin_offset, token.end_offset);
+    node_id_t identifier_node = node_create_leaf(IDENTIFIER, token);
+    NODE(identifier_node).data.identifier_str = parser_atom(token.begin_offset, token.end_offset);
     peek_expect_advance(LEX_EQUAL);
-    node_t* type_node = parse_type();
+    node_id_t type_node = parse_type();
 
     peek_expect_advance(LEX_SEMICOLON);
-    node_t* type_decl_node = node_create(TYPE_DECLARATION);
+    node_id_t type_decl_node = node_create(TYPE_DECLARATION);
 
     node_add_child(type_decl_node, identifier_node);
     node_add_child(type_decl_node, type_node);
@@ -160,10 +359,10 @@ static node_t* parse_type_declaration() {
     return type_decl_node;
 }
 
-static node_t* parse_block() {
+static node_id_t parse_block() {
     token_t token = peek_expect_advance(LEX_LBRACE);
 
-    node_t* block_node = node_create(BLOCK);
+    node_id_t block_node = node_create(BLOCK);
     for (;;) {
         token = lexer_peek();
         if (token.type == LEX_RBRACE) break;
@@ -171,9 +370,9 @@ static node_t* parse_block() {
         if (token.type == LEX_RETURN) {
             // <RETURN> <EXPRESSION>? ';' -> RETURN_STATEMENT[expression]
             lexer_advance();
-            node_t* return_node = node_create(RETURN_STATEMENT);
+            node_id_t return_node = node_create(RETURN_STATEMENT);
 
-            return_node->pos = token; // store keyword token
+            node_pos(return_node) = token; // store keyword token
 
             if (lexer_peek().type != LEX_SEMICOLON) {
                 node_add_child(return_node, parse_expression());
@@ -191,8 +390,8 @@ static node_t* parse_block() {
         //    peek_expect_advance(LEX_SEMICOLON);
 
         } else if (token.type == LEX_IDENTIFIER) {
-            node_t* identifier_node = node_create_leaf(IDENTIFIER, token);
-            identifier_node->data.identifier_str = lexer_substring(token.begin_offset, token.end_offset);
+            node_id_t identifier_node = node_create_leaf(IDENTIFIER, token);
+            NODE(identifier_node).data.identifier_str = parser_atom(token.begin_offset, token.end_offset);
 
             lexer_advance();
 
@@ -210,7 +409,7 @@ static node_t* parse_block() {
                 node_add_child(block_node, parse_block_operation(identifier_node));
                 peek_expect_advance(LEX_SEMICOLON);
             } else if (token.type == LEX_LBRACKET) {
-                node_t* indexing_node = parse_array_indexing(identifier_node);
+                node_id_t indexing_node = parse_array_indexing(identifier_node);
                 token = lexer_peek();
 
                 if (token.type == LEX_EQUAL) {
@@ -239,9 +438,9 @@ static node_t* parse_block() {
             // if ( EXPRESSION ) BLOCK 
             // if ( EXPRESSION ) BLOCK else BLOCK
             lexer_advance();
-            node_t* if_node = node_create(IF_STATEMENT);
+            node_id_t if_node = node_create(IF_STATEMENT);
 
-            if_node->pos = token; // store keyword token
+            node_pos(if_node) = token; // store keyword token
 
             peek_expect_advance(LEX_LPAREN);
             node_add_child(if_node, parse_expression());
@@ -256,8 +455,8 @@ static node_t* parse_block() {
             if (token.type == LEX_ELSE) {
                 lexer_advance();
 
-                node_t* block_node = parse_block();
-                block_node->pos = token; // store keyword token (ugly edition)
+                node_id_t block_node = parse_block();
+                node_pos(block_node) = token; // store keyword token (ugly edition)
 
                 node_add_child(if_node, block_node);
 
@@ -268,9 +467,9 @@ static node_t* parse_block() {
         } else if (token.type == LEX_WHILE) {
             // while (expression) BLOCK
             lexer_advance();
-            node_t* while_node = node_create(WHILE_STATEMENT);
+            node_id_t while_node = node_create(WHILE_STATEMENT);
 
-            while_node->pos = token; // store keyword token
+            node_pos(while_node) = token; // store keyword token
 
             peek_expect_advance(LEX_LPAREN);
             node_add_child(while_node, parse_expression());
@@ -284,7 +483,7 @@ static node_t* parse_block() {
         } else if (token.type == LEX_BREAK) {
             lexer_advance();
 
-            node_t* break_node = node_create_leaf(BREAK_STATEMENT, token);
+            node_id_t break_node = node_create_leaf(BREAK_STATEMENT, token);
 
             node_add_child(block_node, break_node);
 
@@ -292,7 +491,7 @@ static node_t* parse_block() {
         } else if (token.type == LEX_CONTINUE) {
             lexer_advance();
 
-            node_t* continue_node = node_create_leaf(CONTINUE_STATEMENT, token);
+            node_id_t continue_node = node_create_leaf(CONTINUE_STATEMENT, token);
 
             node_add_child(block_node, continue_node);
 
@@ -307,13 +506,13 @@ static node_t* parse_block() {
 
 // FOLLOW: RPAREN
 // TODO: semicolon in follow set
-static node_t* parse_declaration_list() {
-    node_t* decl_list = node_create(DECLARATION_LIST);
+static node_id_t parse_declaration_list() {
+    node_id_t decl_list = node_create(DECLARATION_LIST);
     token_t token = lexer_peek();
     if (token.type == LEX_RPAREN) {
         return decl_list;
     }
-    node_t* decl = parse_declaration(NULL);
+    node_id_t decl = parse_declaration(0);
     node_add_child(decl_list, decl);
 
     // decl [, decl]*
@@ -325,12 +524,12 @@ static node_t* parse_declaration_list() {
         }
 
         peek_expect_advance(LEX_COMMA);
-        decl = parse_declaration(NULL);
+        decl = parse_declaration(0);
         node_add_child(decl_list, decl);
     }
 }
 
-static node_t* parse_type() {
+static node_id_t parse_type() {
 
     token_t token = lexer_peek();
 
@@ -342,9 +541,7 @@ static node_t* parse_type() {
 
     if (token.type == LEX_OPERATOR) {
         // pointer type
-        char * operator_str = lexer_substring(token.begin_offset, token.end_offset);
-        operator_t op = parse_operator_str(operator_str, false);
-        free(operator_str);
+        operator_t op = parse_operator(token, false);
 
         if (op != UNARY_STAR) {
             fail_token(token);
@@ -352,19 +549,19 @@ static node_t* parse_type() {
 
         lexer_advance();
 
-        node_t* inner_type = parse_type();
+        node_id_t inner_type = parse_type();
 
-        node_t* ptr_type = node_create(TYPE);
-        ptr_type->data.type_class = TC_POINTER;
+        node_id_t ptr_type = node_create(TYPE);
+        NODE(ptr_type).data.type_class = TC_POINTER;
         node_add_child(ptr_type, inner_type);
         return ptr_type;
     } else if (token.type == LEX_STRUCT) {
         lexer_advance();
 
-        node_t* type_node = node_create(TYPE);
-        type_node->data.type_class = TC_STRUCT;
+        node_id_t type_node = node_create(TYPE);
+        NODE(type_node).data.type_class = TC_STRUCT;
 
-        node_t* struct_def = parse_struct_body();
+        node_id_t struct_def = parse_struct_body();
         node_add_child(type_node, struct_def);
 
         peek_expect_advance(LEX_RBRACE);
@@ -377,11 +574,11 @@ static node_t* parse_type() {
 
     lexer_advance();
 
-    node_t* identifier_node = node_create_leaf(IDENTIFIER, token);
-    identifier_node->data.identifier_str = lexer_substring(token.begin_offset, token.end_offset);
+    node_id_t identifier_node = node_create_leaf(IDENTIFIER, token);
+    NODE(identifier_node).data.identifier_str = parser_atom(token.begin_offset, token.end_offset);
 
-    node_t* type_node = node_create(TYPE);
-    type_node->data.type_class = TC_UNKNOWN;
+    node_id_t type_node = node_create(TYPE);
+    NODE(type_node).data.type_class = TC_UNKNOWN;
 
     node_add_child(type_node, identifier_node);
 
@@ -389,19 +586,17 @@ static node_t* parse_type() {
     if (lexer_peek().type == LEX_LBRACKET) {
         lexer_advance();
 
-        node_t* array_type_node = node_create(TYPE);
-        array_type_node->data.type_class = TC_ARRAY;
+        node_id_t array_type_node = node_create(TYPE);
+        NODE(array_type_node).data.type_class = TC_ARRAY;
 
         node_add_child(array_type_node, type_node);
-        node_t* dim_list = node_create(LIST);
+        node_id_t dim_list = node_create(LIST);
 
         for (;;) {
             token_t literal_token = peek_expect_advance(LEX_INTEGER);
-            char* literal_str = lexer_substring(literal_token.begin_offset, literal_token.end_offset);
-            node_t* literal_node = node_create_leaf(INTEGER_LITERAL, literal_token);
-            literal_node->data.int_literal_value = atol(literal_str);
+            node_id_t literal_node = node_create_leaf(INTEGER_LITERAL, literal_token);
+            NODE(literal_node).data.int_literal_value = parse_integer_literal(literal_token);
             node_add_child(dim_list, literal_node);
-            free(literal_str);
 
             token_t nxt = lexer_peek();
             if (nxt.type == LEX_COMMA) {
@@ -421,9 +616,9 @@ static node_t* parse_type() {
 }
 
 // FOLLOW: LEX_RBRACE
-static node_t* parse_struct_body() {
+static node_id_t parse_struct_body() {
     peek_expect_advance(LEX_LBRACE);
-    node_t* decls = node_create(DECLARATION_LIST);
+    node_id_t decls = node_create(DECLARATION_LIST);
 
     token_t token;
 
@@ -433,9 +628,9 @@ static node_t* parse_struct_body() {
 
         if (token.type == LEX_IDENTIFIER) {
             lexer_advance();
-            node_t* identifier = node_create_leaf(IDENTIFIER, token);
-            identifier->data.identifier_str = lexer_substring(token.begin_offset, token.end_offset);
-            node_t* decl = parse_declaration(identifier);
+            node_id_t identifier = node_create_leaf(IDENTIFIER, token);
+            NODE(identifier).data.identifier_str = parser_atom(token.begin_offset, token.end_offset);
+            node_id_t decl = parse_declaration(identifier);
             peek_expect_advance(LEX_SEMICOLON);
             node_add_child(decls, decl);
 
@@ -446,19 +641,19 @@ static node_t* parse_struct_body() {
     return decls;
 }
 
-static node_t* parse_function_type() {
+static node_id_t parse_function_type() {
     // (DECLARATION_LIST) -> type
     peek_expect_advance(LEX_LPAREN);
 
-    node_t* declaration_list = parse_declaration_list();
+    node_id_t declaration_list = parse_declaration_list();
 
     peek_expect_advance(LEX_RPAREN);
     peek_expect_advance(LEX_ARROW);
 
-    node_t* return_type = parse_type();
+    node_id_t return_type = parse_type();
 
-    node_t* function_type = node_create(TYPE);
-    function_type->data.type_class = TC_FUNCTION;
+    node_id_t function_type = node_create(TYPE);
+    NODE(function_type).data.type_class = TC_FUNCTION;
 
     node_add_child(function_type, declaration_list);
     node_add_child(function_type, return_type);
@@ -470,155 +665,134 @@ static bool has_precedence(operator_t operator_1, operator_t operator_2) {
     return OPERATOR_PRECEDENCE[operator_1] < OPERATOR_PRECEDENCE[operator_2];
 }
 
-// Find the correct place in `rhs` to insert `lhs`, preserving operator precedence.
-static node_t* merge_subtrees(token_t operator_token, node_t* lhs, node_t* rhs) {
-    char* lhs_operator_str = lexer_substring(operator_token.begin_offset, operator_token.end_offset);
-    operator_t lhs_operator = parse_operator_str(lhs_operator_str, true);
-    free(lhs_operator_str);
-
-    if (rhs->type != OPERATOR || da_size(rhs->children) != 2 || has_precedence(rhs->data.operator, lhs_operator)) {
-        node_t* operator_node;
-        if (lhs_operator == BINARY_DOT) {
-            if (rhs->type == DOT_ACCESS) {
-                rhs->children[0] = merge_subtrees(operator_token, lhs, rhs->children[0]);
-                return rhs;
-            }
-            //rhs->children[0] = merge_subtrees(operator_token, lhs, rhs->children[0]);
-            operator_node = node_create(DOT_ACCESS);
-        } else {
-            operator_node = node_create(OPERATOR);
-            operator_node->data.operator = lhs_operator;
-            operator_node->pos = operator_token;
+// Classify an operator token straight from the source, without interning it
+static operator_t parse_operator(token_t token, bool binary) {
+    const char* s = lexer_source(token.begin_offset);
+    size_t len = token.end_offset - token.begin_offset;
+
+    if (len == 1) {
+        switch (s[0]) {
+            case '+': if (binary) return BINARY_ADD; break;
+            case '-': return binary ? BINARY_SUB : UNARY_SUB;
+            case '*': return binary ? BINARY_MUL : UNARY_STAR;
+            case '/': if (binary) return BINARY_DIV; break;
+            case '%': if (binary) return BINARY_MOD; break;
+            case '>': if (binary) return BINARY_GT; break;
+            case '<': if (binary) return BINARY_LT; break;
+            case '.': if (binary) return BINARY_DOT; break;
+            case '!': if (!binary) return UNARY_NEG; break;
         }
-        node_add_child(operator_node, lhs);
-        node_add_child(operator_node, rhs);
-        return operator_node;
-    }
-
-
-    rhs->children[0] = merge_subtrees(operator_token, lhs, rhs->children[0]);
-    rhs->children[0]->parent = rhs;
-    return rhs;
-}
-
-static operator_t parse_operator_str(char* operator_str, bool binary) {
-    if (binary) {
-        if (strcmp(operator_str, "+") == 0) {
-            return BINARY_ADD;
-        } else if (strcmp(operator_str, "-") == 0) {
-            return BINARY_SUB;
-        } else if (strcmp(operator_str, "*") == 0) {
-            return BINARY_MUL;
-        } else if (strcmp(operator_str, "/") == 0) {
-            return BINARY_DIV;
-        } else if (strcmp(operator_str, "%") == 0) {
-            return BINARY_MOD;
-        } else if (strcmp(operator_str, ">") == 0) {
-            return BINARY_GT;
-        } else if (strcmp(operator_str, "<") == 0) {
-            return BINARY_LT;
-        } else if (strcmp(operator_str, "+=") == 0) {
-            return BINARY_ASS_ADD;
-        } else if (strcmp(operator_str, "-=") == 0) {
-            return BINARY_ASS_SUB;
-        } else if (strcmp(operator_str, "*=") == 0) {
-            return BINARY_ASS_MUL;
-        } else if (strcmp(operator_str, "/=") == 0) {
-            return BINARY_ASS_DIV;
-        } else if (strcmp(operator_str, "%=") == 0) {
-            return BINARY_ASS_MOD;
-        } else if (strcmp(operator_str, "==") == 0) {
-            return BINARY_EQ;
-        } else if (strcmp(operator_str, "<=") == 0) {
-            return BINARY_LEQ;
-        } else if (strcmp(operator_str, ">=") == 0) {
-            return BINARY_GEQ;
-        } else if (strcmp(operator_str, "!=") == 0) {
-            return BINARY_NEQ;
-        } else if (strcmp(operator_str, "::") == 0) {
-            return BINARY_SCOPE_RES;
-        } else if (strcmp(operator_str, ".") == 0) {
-            return BINARY_DOT;
-        } else if (strcmp(operator_str, "||") == 0) {
-            return BINARY_OR;
-        } else if (strcmp(operator_str, "&&") == 0) {
-            return BINARY_AND;
-        } else if (strcmp(operator_str, ".*") == 0) { // eeeeh
-            return UNARY_DEREF;
+    } else if (len == 2 && s[1] == '=') {
+        if (binary) {
+            switch (s[0]) {
+                case '+': return BINARY_ASS_ADD;
+                case '-': return BINARY_ASS_SUB;
+                case '*': return BINARY_ASS_MUL;
+                case '/': return BINARY_ASS_DIV;
+                case '%': return BINARY_ASS_MOD;
+                case '=': return BINARY_EQ;
+                case '<': return BINARY_LEQ;
+                case '>': return BINARY_GEQ;
+                case '!': return BINARY_NEQ;
+            }
         }
-    } else {
-        if (strcmp(operator_str, "-") == 0) {
-            return UNARY_SUB;
-        } else if (strcmp(operator_str, "!") == 0) {
-            return UNARY_NEG;
-        } else if (strcmp(operator_str, "*") == 0) {
-            return UNARY_STAR;
-        } else if (strcmp(operator_str, ".*") == 0) {
-            return UNARY_DEREF;
+    } else if (len == 2) {
+        if (s[0] == '.' && s[1] == '*') return UNARY_DEREF; // eeeeh
+        if (binary) {
+            if (s[0] == ':' && s[1] == ':') return BINARY_SCOPE_RES;
+            if (s[0] == '|' && s[1] == '|') return BINARY_OR;
+            if (s[0] == '&' && s[1] == '&') return BINARY_AND;
         }
     }
-    // TODO: proper
-    fail_token(lexer_peek());
+    fail_token(token);
     assert(false);
-    // fprintf(stderr, "Parse operator str unhandled: %s, %d\n", operator_str, binary);
-    // exit(1);
 }
 
-static node_t* merge_unary_op(token_t operator_token, node_t* rhs) {
-    char* operator_str = lexer_substring(operator_token.begin_offset, operator_token.end_offset);
-    operator_t operator = parse_operator_str(operator_str, false);
-    free(operator_str);
+inline static bool token_is_expression_end(token_t token) {
+    return token.type == LEX_SEMICOLON
+        || token.type == LEX_COMMA
+        || token.type == LEX_RPAREN
+        || token.type == LEX_RBRACKET;
+}
 
-    if (rhs->type != OPERATOR || da_size(rhs->children) != 2 || has_precedence(rhs->data.operator, operator)) {
-        node_t* operator_node = node_create(OPERATOR);
-        operator_node->data.operator = operator;
+// Whether `next` goes into the right operand of `operator`.
+// Equal precedence does not, so binary operators associate to the left.
+// A dot access is always taken by the operand of any other operator, also `::`.
+static bool binds_into(operator_t operator, operator_t next) {
+    if (next == BINARY_DOT) {
+        return operator != BINARY_DOT;
+    }
+    return has_precedence(next, operator);
+}
 
-        operator_node->pos = operator_token; // store keyword token
+// Prefix operators take the operand to their right, postfix `.*` the primary before it
+static node_id_t parse_unary_expression() {
+    token_t token = lexer_peek();
 
-        node_add_child(operator_node, rhs);
+    if (token.type == LEX_OPERATOR) {
+        operator_t operator = parse_operator(token, false);
+        lexer_advance();
+
+        node_id_t operand = parse_binary_expression(operator);
 
+        node_id_t operator_node = node_create(OPERATOR);
+        NODE(operator_node).data.operator = operator;
+        node_pos(operator_node) = token; // store keyword token
+        node_add_child(operator_node, operand);
         return operator_node;
     }
 
-    rhs->children[0] = merge_unary_op(operator_token, rhs->children[0]);
-    return rhs;
-}
+    node_id_t node = parse_primary();
 
-inline static bool token_is_expression_end(token_t token) {
-    return token.type == LEX_SEMICOLON
-        || token.type == LEX_COMMA
-        || token.type == LEX_RPAREN
-        || token.type == LEX_RBRACKET;
+    // TODO: more post operators
+    for (token = lexer_peek(); token.type == LEX_OPERATOR && parse_operator(token, true) == UNARY_DEREF; token = lexer_peek()) {
+        lexer_advance();
+        node_id_t deref_node = node_create(OPERATOR);
+        NODE(deref_node).data.operator = UNARY_DEREF;
+        node_pos(deref_node) = token; // store keyword token
+        node_add_child(deref_node, node);
+        node = deref_node;
+    }
+
+    return node;
 }
 
-static node_t* expression_continuation(token_t operator_token, node_t* lhs) {
-    char *operator_str = lexer_substring(operator_token.begin_offset, operator_token.end_offset);
-    operator_t operator = parse_operator_str(operator_str, true);
-    free(operator_str);
+// Precedence climbing: take binary operators as long as they bind into the
+// operand of `outer`, an operator_t, or all of them when `outer` is -1.
+// Each operator is looked at once, so long chains parse in linear time.
+static node_id_t parse_binary_expression(int outer) {
+    node_id_t lhs = parse_unary_expression();
 
-    // TODO: more post operators
-    if (operator == UNARY_DEREF) {
-        node_t* new = node_create(OPERATOR);
-        new->data.operator = operator;
-        new->pos = operator_token; // store keyword token
-        node_add_child(new, lhs);
-
-        token_t nxt = lexer_peek();
-        if (token_is_expression_end(nxt)) {
-            return new;
+    for (;;) {
+        token_t token = lexer_peek();
+
+        if (token.type != LEX_OPERATOR) {
+            if (token_is_expression_end(token)) {
+                return lhs;
+            }
+            fail_token(token);
         }
 
-        if (nxt.type == LEX_OPERATOR) {
-            lexer_advance();
-            return expression_continuation(nxt, new);
-        } else {
-            fail_token_expected(nxt, LEX_OPERATOR);
+        operator_t operator = parse_operator(token, true);
+        if (outer >= 0 && !binds_into(outer, operator)) {
+            return lhs;
         }
-    }
+        lexer_advance();
 
-    node_t* rhs = parse_expression();
+        node_id_t rhs = parse_binary_expression(operator);
 
-    return merge_subtrees(operator_token, lhs, rhs);
+        node_id_t operator_node;
+        if (operator == BINARY_DOT) {
+            operator_node = node_create(DOT_ACCESS);
+        } else {
+            operator_node = node_create(OPERATOR);
+            NODE(operator_node).data.operator = operator;
+            node_pos(operator_node) = token;
+        }
+        node_add_child(operator_node, lhs);
+        node_add_child(operator_node, rhs);
+        lhs = operator_node;
+    }
 }
 
 static bool token_is_literal(token_t token) {
@@ -631,6 +805,26 @@ static bool token_is_literal(token_t token) {
      || token.type == LEX_CHAR;
 }
 
+// The lexer only lets digits into integer literals
+static long parse_integer_literal(token_t token) {
+    const char* digits = lexer_source(token.begin_offset);
+    long value = 0;
+    for (int i = 0; i < token.end_offset - token.begin_offset; ++i) {
+        value = value * 10 + (digits[i] - '0');
+    }
+    return value;
+}
+
+// The source is not NUL terminated, atof gets a copy
+static double parse_real_literal(token_t token) {
+    char buffer[64];
+    size_t len = token.end_offset - token.begin_offset;
+    if (len >= sizeof buffer) len = sizeof buffer - 1;
+    memcpy(buffer, lexer_source(token.begin_offset), len);
+    buffer[len] = '\0';
+    return atof(buffer);
+}
+
 static char parse_char_escaped(const char *s) {
     if (s[0] == '\\') {
         switch (s[1]) {
@@ -648,141 +842,81 @@ static char parse_char_escaped(const char *s) {
 }
 
 
-static node_t* parse_expression() {
+static node_id_t parse_expression() {
+    return parse_binary_expression(-1);
+}
+
+static node_id_t parse_primary() {
     // Expression: Numeric_literal
     // Expression: Identifier
     // Expression: Array indexing
     // Expression: ( Expression )
-    // Expression: Expression + Expression
     token_t token = lexer_peek();
     if (token.type == LEX_IDENTIFIER) {
-        node_t* node = node_create_leaf(IDENTIFIER, token);
-        node->data.identifier_str = lexer_substring(token.begin_offset, token.end_offset);
+        node_id_t node = node_create_leaf(IDENTIFIER, token);
+        NODE(node).data.identifier_str = parser_atom(token.begin_offset, token.end_offset);
         lexer_advance();
         token = lexer_peek();
 
         if (token.type == LEX_LPAREN) {
             node = parse_function_call(node);
-            token = lexer_peek();
         } else if (token.type == LEX_LBRACKET) {
             node = parse_array_indexing(node);
-            token = lexer_peek();
-        }
-
-        if (token.type == LEX_OPERATOR) {
-            lexer_advance();
-            return expression_continuation(token, node);
-        } else if (token_is_expression_end(token)) {
-            return node;
-        } else {
-            fail_token(token);
         }
+        return node;
     } else if (token_is_literal(token)) {
-        node_t* node = node_create_leaf(INTEGER_LITERAL, token);
-        // TODO: unnecessary malloc
+        node_id_t node = node_create_leaf(INTEGER_LITERAL, token);
         if (token.type == LEX_INTEGER) {
-            char* literal_str = lexer_substring(token.begin_offset, token.end_offset);
-            node->data.int_literal_value = atol(literal_str);
-            free(literal_str);
+            NODE(node).data.int_literal_value = parse_integer_literal(token);
         } else if (token.type == LEX_STRING) {
-            node->type = STRING_LITERAL;
-            node->data.string_literal_value = lexer_substring(token.begin_offset+1, token.end_offset-1);
+            NODE(node).type = STRING_LITERAL;
+            NODE(node).data.string_literal_value = parser_atom(token.begin_offset+1, token.end_offset-1);
         } else if (token.type == LEX_REAL) {
-            node->type = REAL_LITERAL;
-            char* literal_str = lexer_substring(token.begin_offset, token.end_offset);
-            node->data.real_literal_value = atof(literal_str);
-            free(literal_str);
+            NODE(node).type = REAL_LITERAL;
+            NODE(node).data.real_literal_value = parse_real_literal(token);
         } else if (token.type == LEX_TRUE) {
-            node->type = BOOL_LITERAL;
-            node->data.bool_literal_value = true;
+            NODE(node).type = BOOL_LITERAL;
+            NODE(node).data.bool_literal_value = true;
         } else if (token.type == LEX_FALSE) {
-            node->type = BOOL_LITERAL;
-            node->data.bool_literal_value = false;
+            NODE(node).type = BOOL_LITERAL;
+            NODE(node).data.bool_literal_value = false;
         } else if (token.type == LEX_CHAR) {
-            node->type = CHAR_LITERAL;
-            char* substr = lexer_substring(token.begin_offset + 1, token.end_offset - 1);
-            node->data.char_literal_value = parse_char_escaped(substr);
-            free(substr);
+            NODE(node).type = CHAR_LITERAL;
+            NODE(node).data.char_literal_value = parse_char_escaped(lexer_source(token.begin_offset + 1));
         } else {
             assert(false && "Not implemented");
         }
         lexer_advance();
-
-        token = lexer_peek();
-
-        if (token.type == LEX_OPERATOR) {
-            lexer_advance();
-            return expression_continuation(token, node);
-        } else if (token_is_expression_end(token)) {
-            return node;
-        } else {
-            fail_token(token);
-        }
+        return node;
     } else if (token.type == LEX_LPAREN) {
         lexer_advance();
-        node_t* expr = parse_expression();
+        node_id_t expr = parse_expression();
         peek_expect_advance(LEX_RPAREN);
 
-        node_t* ret = node_create(PARENTHESIZED_EXPRESSION);
+        node_id_t ret = node_create(PARENTHESIZED_EXPRESSION);
         node_add_child(ret, expr);
-
-        token = lexer_peek();
-
-        if (token.type == LEX_OPERATOR) {
-            lexer_advance();
-            return expression_continuation(token, ret);
-        } else if (token_is_expression_end(token)) {
-            return ret;
-        } else {
-            fail_token(token);
-        }
-    } else if (token.type == LEX_OPERATOR) {
-        lexer_advance();
-
-        node_t* expr = parse_expression();
-
-        return merge_unary_op(token, expr);
+        return ret;
     } else if (token.type == LEX_CAST) {
         lexer_advance();
         peek_expect_advance(LEX_LPAREN);
-        node_t* cast_expr = parse_cast();
+        node_id_t cast_expr = parse_cast();
         peek_expect_advance(LEX_RPAREN);
-
-        token = lexer_peek();
-
-        if (token.type == LEX_OPERATOR) {
-            lexer_advance();
-            return expression_continuation(token, cast_expr);
-        } else if (token_is_expression_end(token)) {
-            return cast_expr;
-        } else {
-            fail_token(token);
-        }
+        return cast_expr;
     } else if (token.type == LEX_ALLOC) {
-        node_t* alloc_node = parse_alloc();
-        token = lexer_peek();
-        if (token.type == LEX_OPERATOR) {
-            lexer_advance();
-            return expression_continuation(token, alloc_node);
-        } else if (token_is_expression_end(token)) {
-            return alloc_node;
-        } else {
-            fail_token(token);
-        }
-    } else {
-        fail_token(token);
+        return parse_alloc();
     }
+    fail_token(token);
     assert(false && "Unreachable");
 }
 
 // Expects identifier node to be consumed and given to us
-static node_t* parse_function_call(node_t* identifier_node) {
+static node_id_t parse_function_call(node_id_t identifier_node) {
     token_t token = peek_expect_advance(LEX_LPAREN);
 
-    node_t* ret = node_create(FUNCTION_CALL);
+    node_id_t ret = node_create(FUNCTION_CALL);
     node_add_child(ret, identifier_node);
 
-    node_t* list_node = node_create(LIST);
+    node_id_t list_node = node_create(LIST);
 
     token = lexer_peek();
     while (token.type != LEX_RPAREN) {
@@ -797,21 +931,21 @@ static node_t* parse_function_call(node_t* identifier_node) {
     return ret;
 }
 
-static node_t* parse_cast() {
+static node_id_t parse_cast() {
     // typename, 
-    node_t* typename_node = parse_type();
+    node_id_t typename_node = parse_type();
     peek_expect_advance(LEX_COMMA);
-    node_t* expr_node = parse_expression();
-    node_t* ret = node_create(CAST_EXPRESSION);
+    node_id_t expr_node = parse_expression();
+    node_id_t ret = node_create(CAST_EXPRESSION);
     node_add_child(ret, typename_node);
     node_add_child(ret, expr_node);
     return ret;
 }
 
 // lvalue = expression
-static node_t* parse_assignment(node_t* lhs_node) {
+static node_id_t parse_assignment(node_id_t lhs_node) {
     peek_expect_advance(LEX_EQUAL);
-    node_t* ret = node_create(ASSIGNMENT_STATEMENT);
+    node_id_t ret = node_create(ASSIGNMENT_STATEMENT);
     node_add_child(ret, lhs_node);
 
     token_t token = lexer_peek();
@@ -827,12 +961,10 @@ static node_t* parse_assignment(node_t* lhs_node) {
 
 // For when there is <something> <operator> <something>
 // as a block statement
-static node_t* parse_block_operation(node_t* lhs_node) {
+static node_id_t parse_block_operation(node_id_t lhs_node) {
     token_t operator_token = peek_expect_advance(LEX_OPERATOR);
 
-    char* operator_str = lexer_substring(operator_token.begin_offset, operator_token.end_offset);
-    operator_t op = parse_operator_str(operator_str, true);
-    free(operator_str);
+    operator_t op = parse_operator(operator_token, true);
 
     if (op == BINARY_SCOPE_RES) {
         return parse_scope_resolution(lhs_node);
@@ -844,33 +976,33 @@ static node_t* parse_block_operation(node_t* lhs_node) {
     
     // For now: assume this is a += or similar
 
-    node_t* assignment_node = node_create(ASSIGNMENT_STATEMENT);
+    node_id_t assignment_node = node_create(ASSIGNMENT_STATEMENT);
     node_add_child(assignment_node, lhs_node);
 
-    node_t* rhs_node = parse_expression();
+    node_id_t rhs_node = parse_expression();
 
-    node_t* operator_node = node_create(OPERATOR);
+    node_id_t operator_node = node_create(OPERATOR);
 
-    operator_node->pos = operator_token;
+    node_pos(operator_node) = operator_token;
 
     node_add_child(operator_node, node_deep_copy(lhs_node));
     node_add_child(operator_node, rhs_node);
 
     switch(op) {
         case BINARY_ASS_ADD:
-            operator_node->data.operator = BINARY_ADD;
+            NODE(operator_node).data.operator = BINARY_ADD;
             break;
         case BINARY_ASS_SUB:
-            operator_node->data.operator = BINARY_SUB;
+            NODE(operator_node).data.operator = BINARY_SUB;
             break;
         case BINARY_ASS_MUL:
-            operator_node->data.operator = BINARY_MUL;
+            NODE(operator_node).data.operator = BINARY_MUL;
             break;
         case BINARY_ASS_DIV:
-            operator_node->data.operator = BINARY_DIV;
+            NODE(operator_node).data.operator = BINARY_DIV;
             break;
         case BINARY_ASS_MOD:
-            operator_node->data.operator = BINARY_MOD;
+            NODE(operator_node).data.operator = BINARY_MOD;
             break;
 
         default:
@@ -881,17 +1013,17 @@ static node_t* parse_block_operation(node_t* lhs_node) {
     return assignment_node;
 }
 
-static node_t* parse_scope_resolution(node_t* lhs_node) {
+static node_id_t parse_scope_resolution(node_id_t lhs_node) {
     token_t token = lexer_peek();
     if (token.type != LEX_IDENTIFIER) 
         fail_token_expected(token, LEX_IDENTIFIER);
 
-    node_t* identifier = node_create_leaf(IDENTIFIER, token);
-    identifier->data.identifier_str = lexer_substring(token.begin_offset, token.end_offset);
+    node_id_t identifier = node_create_leaf(IDENTIFIER, token);
+    NODE(identifier).data.identifier_str = parser_atom(token.begin_offset, token.end_offset);
 
     lexer_advance();
 
-    node_t* merged = node_create(SCOPE_RESOLUTION);
+    node_id_t merged = node_create(SCOPE_RESOLUTION);
     node_add_child(merged, lhs_node);
     node_add_child(merged, identifier);
 
@@ -909,26 +1041,26 @@ static node_t* parse_scope_resolution(node_t* lhs_node) {
     assert(false); // unreachable
 }
 
-static node_t* parse_dot_access(node_t* lhs_node) {
+static node_id_t parse_dot_access(node_id_t lhs_node) {
     token_t token = lexer_peek();
 
     if (token.type != LEX_IDENTIFIER && token.type != LEX_OPERATOR) {
         fail_token(token);
     }
     
-    char* image = lexer_substring(token.begin_offset, token.end_offset);
+    char* image = parser_atom(token.begin_offset, token.end_offset);
     if (token.type == LEX_OPERATOR) {
-        if (parse_operator_str(image, true) != BINARY_MUL) {
+        if (parse_operator(token, true) != BINARY_MUL) {
             fail_token(token);
         }
         // from here pretend it is an identifier
     }
 
-    node_t* identifier = node_create_leaf(IDENTIFIER, token);
-    identifier->data.identifier_str = image;
+    node_id_t identifier = node_create_leaf(IDENTIFIER, token);
+    NODE(identifier).data.identifier_str = image;
     lexer_advance();
 
-    node_t* merged = node_create(DOT_ACCESS);
+    node_id_t merged = node_create(DOT_ACCESS);
     node_add_child(merged, lhs_node);
     node_add_child(merged, identifier);
 
@@ -948,9 +1080,9 @@ static node_t* parse_dot_access(node_t* lhs_node) {
     assert(false); // unreachable
 }
 
-static node_t* parse_deref(node_t* lhs_node) {
-    node_t* deref_node = node_create(OPERATOR);
-    deref_node->data.operator = UNARY_DEREF;
+static node_id_t parse_deref(node_id_t lhs_node) {
+    node_id_t deref_node = node_create(OPERATOR);
+    NODE(deref_node).data.operator = UNARY_DEREF;
     node_add_child(deref_node, lhs_node);
 
     token_t token = lexer_peek();
@@ -969,15 +1101,15 @@ static node_t* parse_deref(node_t* lhs_node) {
     assert(false); // unreachable
 }
 
-static node_t* parse_array_indexing(node_t* identifier_node) {
+static node_id_t parse_array_indexing(node_id_t identifier_node) {
     peek_expect_advance(LEX_LBRACKET);
-    node_t* indexing = node_create(ARRAY_INDEXING);
+    node_id_t indexing = node_create(ARRAY_INDEXING);
     node_add_child(indexing, identifier_node);
 
-    node_t* index_list = node_create(LIST);
+    node_id_t index_list = node_create(LIST);
 
     for (;;) {
-        node_t* expr = parse_expression();
+        node_id_t expr = parse_expression();
         node_add_child(index_list, expr);
         token_t token = lexer_peek();
 
@@ -993,16 +1125,16 @@ static node_t* parse_array_indexing(node_t* identifier_node) {
     return indexing;
 }
 
-static node_t* parse_alloc() {
+static node_id_t parse_alloc() {
     peek_expect_advance(LEX_ALLOC);
     peek_expect_advance(LEX_LPAREN);
-    node_t* type_node = parse_type();
+    node_id_t type_node = parse_type();
     token_t token = lexer_peek();
-    node_t* alloc_node = node_create(ALLOC_EXPRESSION);
+    node_id_t alloc_node = node_create(ALLOC_EXPRESSION);
     node_add_child(alloc_node, type_node);
     if (token.type == LEX_COMMA) {
         lexer_advance();
-        node_t* count = parse_expression();
+        node_id_t count = parse_expression();
         node_add_child(alloc_node, count);
     }
     peek_expect_advance(LEX_RPAREN);
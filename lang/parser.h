@@ -1,7 +1,13 @@
 #ifndef PARSER_H
 #define PARSER_H
 
-// Parse the stuff
-void parse();
+#include "langc.h"
+
+// Parse the stuff, the tree goes to c->root
+void parse(compilation_t* c);
+
+// Parse top-level declarations of large files on up to n_threads threads.
+// 0 (the default) uses one per core, 1 parses sequentially.
+void parser_use_threads(int n_threads);
 
 #endif // PARSER_H
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "compilation.h"
 #include "da.h"
 #include "lex.h"
 #include "parser.h"
@@ -36,9 +37,11 @@ int main() {
     char* filename = "./test-files/hello.lang";
     read_file(filename, &file_content);
 
-    lexer_init(filename, file_content);
+    compilation_t c;
+    compilation_init(&c);
+    lexer_init(&c, filename, file_content, da_size(file_content));
 
-    parse();
+    parse(&c);
 
-    print_tree(root);
+    print_tree(stdout, c.root);
 }
@@ -0,0 +1,403 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "regalloc.h"
+#include "cfg.h"
+#include "compilation.h"
+#include "da.h"
+#include "da_bitset.h"
+#include "symbol.h"
+#include "tac.h"
+#include "tree.h"
+#include "type.h"
+
+// Caller-saved ones first, a function that does not call across them
+// gets them for free. The rest of the caller-saved registers are scratch
+// for gen.c or carry arguments.
+static const reg_t CALLER_SAVED_GPRS[] = {REG_R10, REG_R11, REG_R8, REG_R9, REG_RSI, REG_RDI};
+static const reg_t CALLEE_SAVED_GPRS[] = {REG_RBX, REG_R12, REG_R13, REG_R14, REG_R15};
+#define FIRST_ALLOCATABLE_XMM REG_XMM2
+
+// A use in a loop counts this many times more than one outside it,
+// up to MAX_WEIGHTED_DEPTH levels
+#define LOOP_WEIGHT 8
+#define MAX_WEIGHTED_DEPTH 4
+
+typedef struct {
+    size_t addr;
+    size_t start;      // first and last instruction the value is live at
+    size_t end;
+    size_t weight;     // uses and defs, weighted by the loops around them
+    bool is_real;
+    bool crosses_call; // live while a call clobbers the caller-saved registers
+    reg_t reg;
+    size_t size;       // bytes of its stack slot
+    size_t slot;       // among the shared slots of its size, when it is not in a register
+} interval_t;
+
+typedef struct {
+    size_t* candidates;   // da, sorted addrs
+    interval_t* intervals; // da, one per candidate, the same order
+    interval_t** order;    // the intervals by start
+    da_bitset_t* live_in;  // per block, over candidate indices
+    da_bitset_t* live_out;
+    size_t* calls;        // da, sorted positions of the calls
+    da_bitset_t reads_after_call; // calls that read arguments after calling out, see crosses_call
+} regalloc_t;
+
+static bool use_registers = true;
+
+static void collect_candidates(regalloc_t* ra, tac_t* tac_list);
+static void compute_liveness(regalloc_t* ra, cfg_t* cfg, tac_t* tac_list);
+static void build_intervals(regalloc_t* ra, cfg_t* cfg, tac_t* tac_list);
+static void linear_scan(regalloc_t* ra);
+static size_t share_stack_slots(regalloc_t* ra, size_t frame_base);
+
+void regalloc_use_registers(bool enable) {
+    use_registers = enable;
+}
+
+static int compare_start(const void* a, const void* b);
+
+size_t allocate_registers(function_code_t* function_code, size_t frame_base) {
+    da_clear(compilation->current_saved_regs);
+    da_bitset_clear(compilation->current_placed_addrs);
+    if (da_size(function_code->cfg.blocks) == 0) return 0;
+
+    regalloc_t ra = {0};
+    size_t slot_space = 0;
+    collect_candidates(&ra, function_code->tac_list);
+    if (da_size(ra.candidates) > 0) {
+        compute_liveness(&ra, &function_code->cfg, function_code->tac_list);
+        build_intervals(&ra, &function_code->cfg, function_code->tac_list);
+
+        size_t n = da_size(ra.intervals);
+        ra.order = malloc(n * sizeof(interval_t*));
+        for (size_t i = 0; i < n; ++i) {
+            ra.order[i] = &ra.intervals[i];
+        }
+        qsort(ra.order, n, sizeof(interval_t*), compare_start);
+
+        if (use_registers) {
+            linear_scan(&ra);
+        }
+        slot_space = share_stack_slots(&ra, frame_base);
+    }
+
+    for (size_t i = 0; i < da_size(ra.intervals); ++i) {
+        compilation->addr_reg[ra.intervals[i].addr] = ra.intervals[i].reg;
+        da_bitset_set(&compilation->current_placed_addrs, ra.intervals[i].addr);
+    }
+
+    for (size_t b = 0; b < da_size(function_code->cfg.blocks) && ra.live_in; ++b) {
+        da_bitset_deinit(ra.live_in[b]);
+        da_bitset_deinit(ra.live_out[b]);
+    }
+    free(ra.live_in);
+    free(ra.live_out);
+    free(ra.order);
+    da_deinit(ra.candidates);
+    da_deinit(ra.intervals);
+    da_deinit(ra.calls);
+    da_bitset_deinit(ra.reads_after_call);
+    return slot_space;
+}
+
+// Index of addr among the candidates, or da_size(candidates) if it is none
+static size_t candidate_index(regalloc_t* ra, size_t addr) {
+    return tac_var_index(ra->candidates, addr);
+}
+
+static bool is_parameter(size_t addr_idx) {
+    addr_t addr = compilation->addr_list[addr_idx];
+    return addr.type == ADDR_SYMBOL && addr.data.symbol->type == SYMBOL_PARAMETER;
+}
+
+// Bytes the value takes in memory
+static size_t slot_size(size_t addr_idx) {
+    addr_t addr = compilation->addr_list[addr_idx];
+    if (addr.type == ADDR_SYMBOL) {
+        return type_sizeof(node_type_info(addr.data.symbol->node));
+    }
+    return type_sizeof(type_create_basic(addr.type_info));
+}
+
+static bool is_call(tac_t tac) {
+    return tac.instr == TAC_CALL || tac.instr == TAC_CALL_VOID || tac.instr == TAC_ALLOC;
+}
+
+static void collect_candidates(regalloc_t* ra, tac_t* tac_list) {
+    tac_scalar_vars(tac_list, &ra->candidates);
+
+    for (size_t i = 0; i < da_size(tac_list); ++i) {
+        tac_t tac = tac_list[i];
+        if (is_call(tac)) {
+            da_append_policy(ra->calls, i, DA_POLICY_SMALL);
+            // print and the other builtins call out between their arguments
+            if (tac.instr == TAC_CALL_VOID && compilation->addr_list[tac.src1].data.symbol->is_builtin) {
+                da_bitset_set(&ra->reads_after_call, i);
+            }
+        }
+    }
+}
+
+// Backwards dataflow over the blocks:
+//   live_out(b) = union of live_in(s) over the successors s
+//   live_in(b)  = uses(b) + (live_out(b) - defs(b))
+// where uses(b) are the candidates read in b before any write in b.
+static void compute_liveness(regalloc_t* ra, cfg_t* cfg, tac_t* tac_list) {
+    size_t n_blocks = da_size(cfg->blocks);
+    size_t n = da_size(ra->candidates);
+    da_bitset_t* use = calloc(n_blocks, sizeof(da_bitset_t));
+    da_bitset_t* def = calloc(n_blocks, sizeof(da_bitset_t));
+    ra->live_in = calloc(n_blocks, sizeof(da_bitset_t));
+    ra->live_out = calloc(n_blocks, sizeof(da_bitset_t));
+
+    size_t* uses = 0;
+    for (size_t b = 0; b < n_blocks; ++b) {
+        for (size_t i = cfg->blocks[b].begin; i < cfg->blocks[b].end; ++i) {
+            da_clear(uses);
+            tac_uses(tac_list[i], &uses);
+            for (size_t u = 0; u < da_size(uses); ++u) {
+                size_t c = candidate_index(ra, uses[u]);
+                if (c < n && !da_bitset_test(def[b], c)) da_bitset_set(&use[b], c);
+            }
+            size_t c = candidate_index(ra, tac_def(tac_list[i]));
+            if (c < n) da_bitset_set(&def[b], c);
+        }
+    }
+    da_deinit(uses);
+
+    // Blocks in reverse order see most of their successors' changes in the same round
+    da_bitset_t in = NULL;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t b = n_blocks; b-- > 0;) {
+            for (size_t s = 0; s < da_size(cfg->blocks[b].succs); ++s) {
+                da_bitset_union(&ra->live_out[b], ra->live_in[cfg->blocks[b].succs[s]]);
+            }
+            da_bitset_copy(&in, ra->live_out[b]);
+            da_bitset_difference(in, def[b]);
+            da_bitset_union(&in, use[b]);
+            if (!da_bitset_equals(in, ra->live_in[b])) {
+                da_bitset_copy(&ra->live_in[b], in);
+                changed = true;
+            }
+        }
+    }
+    da_bitset_deinit(in);
+
+    for (size_t b = 0; b < n_blocks; ++b) {
+        da_bitset_deinit(use[b]);
+        da_bitset_deinit(def[b]);
+    }
+    free(use);
+    free(def);
+}
+
+static void extend(interval_t* interval, size_t position) {
+    if (position < interval->start) interval->start = position;
+    if (position > interval->end) interval->end = position;
+}
+
+// Whether one of the calls clobbers the caller-saved registers while the
+// interval still needs its value. A call defining the value writes it after
+// returning, and one that only reads it has read it before calling out,
+// except for the builtins that call out between their arguments.
+static bool crosses_call(regalloc_t* ra, interval_t* interval) {
+    size_t lo = 0, hi = da_size(ra->calls);
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (ra->calls[mid] <= interval->start) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo == da_size(ra->calls)) return false;
+    size_t call = ra->calls[lo]; // first call after the start
+    return call < interval->end || (call == interval->end && da_bitset_test(ra->reads_after_call, call));
+}
+
+// One interval per candidate covering every point it is live at. Live
+// ranges with holes, like a temp reused in two places, get one interval
+// over the whole stretch.
+static void build_intervals(regalloc_t* ra, cfg_t* cfg, tac_t* tac_list) {
+    size_t n = da_size(ra->candidates);
+    da_reserve(ra->intervals, n);
+    for (size_t c = 0; c < n; ++c) {
+        interval_t interval = {
+            .addr = ra->candidates[c],
+            .start = SIZE_MAX,
+            .end = 0,
+            .is_real = compilation->addr_list[ra->candidates[c]].type_info == TYPE_REAL,
+            .reg = REG_NONE,
+            .size = slot_size(ra->candidates[c]),
+        };
+        da_append(ra->intervals, interval);
+    }
+
+    size_t* uses = 0;
+    for (size_t b = 0; b < da_size(cfg->blocks); ++b) {
+        basic_block_t* block = &cfg->blocks[b];
+        da_bitset_foreach(ra->live_in[b], c) {
+            extend(&ra->intervals[c], block->begin);
+        }
+        da_bitset_foreach(ra->live_out[b], c) {
+            extend(&ra->intervals[c], block->end - 1);
+        }
+
+        size_t weight = 1;
+        for (size_t d = 0; d < cfg_loop_depth(cfg, b) && d < MAX_WEIGHTED_DEPTH; ++d) {
+            weight *= LOOP_WEIGHT;
+        }
+        for (size_t i = block->begin; i < block->end; ++i) {
+            da_clear(uses);
+            tac_uses(tac_list[i], &uses);
+            da_append(uses, tac_def(tac_list[i]));
+            for (size_t u = 0; u < da_size(uses); ++u) {
+                size_t c = candidate_index(ra, uses[u]);
+                if (c == n) continue;
+                extend(&ra->intervals[c], i);
+                ra->intervals[c].weight += weight;
+            }
+        }
+    }
+    da_deinit(uses);
+
+    for (size_t c = 0; c < n; ++c) {
+        ra->intervals[c].crosses_call = crosses_call(ra, &ra->intervals[c]);
+    }
+}
+
+static int compare_start(const void* a, const void* b) {
+    const interval_t* interval_a = *(const interval_t**)a;
+    const interval_t* interval_b = *(const interval_t**)b;
+    if (interval_a->start != interval_b->start) return interval_a->start < interval_b->start ? -1 : 1;
+    return interval_a->addr < interval_b->addr ? -1 : interval_a->addr > interval_b->addr;
+}
+
+static bool is_callee_saved(reg_t reg) {
+    for (size_t i = 0; i < sizeof CALLEE_SAVED_GPRS / sizeof CALLEE_SAVED_GPRS[0]; ++i) {
+        if (CALLEE_SAVED_GPRS[i] == reg) return true;
+    }
+    return false;
+}
+
+// Whether the interval may live in the register
+static bool fits(interval_t* interval, reg_t reg) {
+    if (interval->is_real) return reg >= FIRST_ALLOCATABLE_XMM && !interval->crosses_call;
+    if (reg >= REG_XMM0) return false;
+    return !interval->crosses_call || is_callee_saved(reg);
+}
+
+static reg_t free_register(interval_t* interval, bool* in_use) {
+    if (interval->is_real) {
+        for (reg_t reg = FIRST_ALLOCATABLE_XMM; reg < NUM_REGS; ++reg) {
+            if (!in_use[reg] && fits(interval, reg)) return reg;
+        }
+        return REG_NONE;
+    }
+    for (size_t i = 0; i < sizeof CALLER_SAVED_GPRS / sizeof CALLER_SAVED_GPRS[0]; ++i) {
+        if (!in_use[CALLER_SAVED_GPRS[i]] && fits(interval, CALLER_SAVED_GPRS[i])) return CALLER_SAVED_GPRS[i];
+    }
+    for (size_t i = 0; i < sizeof CALLEE_SAVED_GPRS / sizeof CALLEE_SAVED_GPRS[0]; ++i) {
+        if (!in_use[CALLEE_SAVED_GPRS[i]]) return CALLEE_SAVED_GPRS[i];
+    }
+    return REG_NONE;
+}
+
+static void linear_scan(regalloc_t* ra) {
+    size_t n = da_size(ra->intervals);
+    interval_t** order = ra->order;
+    interval_t** active = 0; // da, the intervals holding a register
+    da_reserve(active, NUM_REGS);
+    bool in_use[NUM_REGS] = {0};
+    bool saved[NUM_REGS] = {0};
+
+    for (size_t i = 0; i < n; ++i) {
+        interval_t* current = order[i];
+
+        // An interval ending where this one starts still holds its register,
+        // an instruction never writes its result over one of its operands
+        size_t kept = 0;
+        for (size_t a = 0; a < da_size(active); ++a) {
+            if (active[a]->end < current->start) {
+                in_use[active[a]->reg] = false;
+            } else {
+                active[kept++] = active[a];
+            }
+        }
+        if (active) da_header(active)->size = kept;
+
+        reg_t reg = free_register(current, in_use);
+        if (reg == REG_NONE) {
+            // Out of registers, the cheapest of the intervals that could give
+            // this one its register goes to memory
+            size_t victim = SIZE_MAX;
+            for (size_t a = 0; a < da_size(active); ++a) {
+                if (!fits(current, active[a]->reg)) continue;
+                if (victim == SIZE_MAX || active[a]->weight < active[victim]->weight) victim = a;
+            }
+            if (victim == SIZE_MAX || active[victim]->weight >= current->weight) continue;
+
+            reg = active[victim]->reg;
+            active[victim]->reg = REG_NONE;
+            active[victim] = active[da_size(active) - 1];
+            (void)da_pop(active);
+        }
+
+        current->reg = reg;
+        in_use[reg] = true;
+        if (is_callee_saved(reg)) saved[reg] = true;
+        da_append(active, current);
+    }
+
+    for (size_t i = 0; i < sizeof CALLEE_SAVED_GPRS / sizeof CALLEE_SAVED_GPRS[0]; ++i) {
+        if (saved[CALLEE_SAVED_GPRS[i]]) da_append(compilation->current_saved_regs, CALLEE_SAVED_GPRS[i]);
+    }
+
+    da_deinit(active);
+}
+
+// The same scan over the stack: intervals left in memory that do not
+// overlap share a slot of their size. Parameters have theirs already.
+// The 8 byte slots come first so they stay aligned, then the 1 byte ones.
+static size_t share_stack_slots(regalloc_t* ra, size_t frame_base) {
+    size_t n = da_size(ra->intervals);
+    size_t n_slots[2] = {0};  // 8 byte and 1 byte slots
+    size_t* free_slots[2] = {0}; // da each
+    interval_t** active = 0;  // da, the intervals holding a slot
+
+    for (size_t i = 0; i < n; ++i) {
+        interval_t* current = ra->order[i];
+        if (current->reg != REG_NONE || is_parameter(current->addr)) continue;
+        assert((current->size == 8 || current->size == 1) && "Scalar of unexpected size");
+
+        size_t kept = 0;
+        for (size_t a = 0; a < da_size(active); ++a) {
+            if (active[a]->end < current->start) {
+                da_append_policy(free_slots[active[a]->size == 8 ? 0 : 1], active[a]->slot, DA_POLICY_SMALL);
+            } else {
+                active[kept++] = active[a];
+            }
+        }
+        if (active) da_header(active)->size = kept;
+
+        size_t class = current->size == 8 ? 0 : 1;
+        current->slot = da_size(free_slots[class]) > 0 ? da_pop(free_slots[class]) : n_slots[class]++;
+        da_append_policy(active, current, DA_POLICY_SMALL);
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        interval_t* interval = &ra->intervals[i];
+        if (interval->reg != REG_NONE || is_parameter(interval->addr)) continue;
+        size_t offset = interval->size == 8 ? 8 * (interval->slot + 1) : 8 * n_slots[0] + interval->slot + 1;
+        compilation->addr_frame_location[interval->addr] = frame_base + offset;
+    }
+
+    da_deinit(free_slots[0]);
+    da_deinit(free_slots[1]);
+    da_deinit(active);
+    return 8 * n_slots[0] + n_slots[1];
+}
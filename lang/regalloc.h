@@ -0,0 +1,36 @@
+#ifndef REGALLOC_H
+#define REGALLOC_H
+
+#include <stdbool.h>
+
+#include "langc.h"
+#include "gen.h"
+
+// Linear scan register allocation (Poletto and Sarkar) for one function.
+//
+// Temps, scalar locals and parameters whose location is never taken are
+// candidates. Each gets one live interval, the instructions from its first
+// to its last live point in tac_list order, with liveness computed over the
+// function's CFG (see cfg.h). Intervals are handed registers in order of
+// their start, and when there are none left the one with the lowest
+// use count, weighted by loop depth, goes to the stack for its whole life.
+//
+// RAX, RCX, RDX, XMM0 and XMM1 stay free for gen.c to work in. Calls clobber
+// the caller-saved registers, so intervals live across a call only get
+// callee-saved ones. Reals go in XMM2-XMM15, which are all caller-saved.
+//
+// The candidates left in memory get stack slots the same way: intervals
+// that do not overlap share a slot, sized by the value's type.
+
+// Fills compilation->addr_reg for the addrs of the function, REG_NONE for
+// those that stay in memory, and compilation->current_saved_regs with the
+// callee-saved registers the function has to preserve.
+// The shared slots start frame_base bytes below rbp, their addr_frame_location
+// is filled in and every addr handled is set in compilation->current_placed_addrs.
+// Returns the bytes the shared slots take.
+size_t allocate_registers(function_code_t* function_code, size_t frame_base);
+
+// With false every addr stays in its stack slot, the default is true
+void regalloc_use_registers(bool enable);
+
+#endif // REGALLOC_H
@@ -0,0 +1,119 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define WALLTIME(t) (((double)(t).tv_sec + 1e-6 * (double)(t).tv_usec)*1000.0)
+
+// Benchmark: run time of the compiled programs, with every temp and local
+// in its stack slot (langc -R) and with registers allocated.
+// Each file is compiled both ways with ./langc and each executable runs a
+// few times, the fastest run counts. The stack operands in the assembly
+// are the loads and stores the allocator could not remove.
+// Programs that finish in a millisecond or two mostly time the process start.
+//
+//   run-bench [-r runs] <file>...
+
+#define EXECUTABLE "run-bench.out"
+
+// Runs argv with stdout and stderr discarded, returns the exit status
+static int run(char** argv, double* ms) {
+    struct timeval t_start, t_end;
+    gettimeofday(&t_start, NULL);
+    pid_t pid = fork();
+    if (pid < 0) {
+        fprintf(stderr, "Fork failed\n");
+        exit(EXIT_FAILURE);
+    }
+    if (pid == 0) {
+        int null = open("/dev/null", O_WRONLY);
+        dup2(null, STDOUT_FILENO);
+        dup2(null, STDERR_FILENO);
+        execv(argv[0], argv);
+        _exit(127);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    gettimeofday(&t_end, NULL);
+    if (ms) *ms = WALLTIME(t_end) - WALLTIME(t_start);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+}
+
+// Operands addressed through rbp in the assembly langc left in tmp.S
+static size_t stack_operands(void) {
+    FILE* file = fopen("tmp.S", "r");
+    if (!file) return 0;
+    size_t count = 0;
+    char line[512];
+    while (fgets(line, sizeof line, file)) {
+        if (strstr(line, "(%rbp)")) ++count;
+    }
+    fclose(file);
+    return count;
+}
+
+typedef struct {
+    size_t stack_operands;
+    double best_ms;
+} result_t;
+
+static int measure(char* file, char* flag, int runs, result_t* result) {
+    char* compile_argv[6];
+    int n = 0;
+    compile_argv[n++] = "./langc";
+    if (flag) compile_argv[n++] = flag;
+    compile_argv[n++] = "-o";
+    compile_argv[n++] = EXECUTABLE;
+    compile_argv[n++] = file;
+    compile_argv[n] = NULL;
+    if (run(compile_argv, NULL) != 0) {
+        fprintf(stderr, "Failed to compile %s\n", file);
+        return 1;
+    }
+    result->stack_operands = stack_operands();
+
+    char* program_argv[] = {"./" EXECUTABLE, NULL};
+    result->best_ms = 0;
+    for (int r = 0; r < runs; ++r) {
+        double ms;
+        if (run(program_argv, &ms) != 0) {
+            fprintf(stderr, "%s exited with an error\n", file);
+            return 1;
+        }
+        if (r == 0 || ms < result->best_ms) result->best_ms = ms;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    int runs = 5;
+    int first = 1;
+    if (argc > 2 && strcmp(argv[1], "-r") == 0) {
+        runs = atoi(argv[2]);
+        first = 3;
+    }
+    if (first >= argc) {
+        fprintf(stderr, "Usage: %s [-r runs] <file>...\n", argv[0]);
+        return 1;
+    }
+
+    int failed = 0;
+    for (int f = first; f < argc; ++f) {
+        result_t stack, registers;
+        if (measure(argv[f], "-R", runs, &stack) || measure(argv[f], NULL, runs, &registers)) {
+            failed = 1;
+            continue;
+        }
+        printf("%s\n", argv[f]);
+        printf("  stack operands : %7zu -> %7zu\n", stack.stack_operands, registers.stack_operands);
+        printf("  run time       : %9.3f ms -> %9.3f ms (%.2fx)\n", stack.best_ms, registers.best_ms,
+               stack.best_ms / registers.best_ms);
+    }
+
+    unlink(EXECUTABLE);
+    return failed;
+}
@@ -0,0 +1,444 @@
+#include <assert.h>
+#include <limits.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sccp.h"
+#include "cfg.h"
+#include "compilation.h"
+#include "da.h"
+#include "da_bitset.h"
+#include "ssa.h"
+#include "tac.h"
+#include "type.h"
+
+typedef enum {
+    LATTICE_UNKNOWN,  // no executable definition seen yet
+    LATTICE_CONSTANT,
+    LATTICE_VARYING,
+} lattice_level_t;
+
+typedef struct {
+    lattice_level_t level;
+    bool is_real;
+    long int_value;   // ints, sizes, bools and chars, as a register holds them
+    double real_value;
+} lattice_t;
+
+static const lattice_t VARYING = { .level = LATTICE_VARYING };
+static const lattice_t UNKNOWN = { .level = LATTICE_UNKNOWN };
+
+typedef struct {
+    size_t block;
+    size_t pred;      // position in the preds of block
+} edge_t;
+
+typedef struct {
+    function_code_t* function_code;
+    ssa_t ssa;
+    lattice_t* lattice;            // per value
+    da_bitset_t* executable_preds; // per block, the positions in its preds of the executable edges
+    da_bitset_t visited;           // blocks whose instructions have been evaluated
+    edge_t* flow_worklist;         // da, edges that became executable
+    size_t* value_worklist;        // da, values that went down
+} sccp_t;
+
+static void visit_instruction(sccp_t* sccp, size_t i);
+static void visit_phi(sccp_t* sccp, size_t p);
+static bool rewrite_tac(sccp_t* sccp);
+
+bool propagate_constants(function_code_t* function_code) {
+    cfg_t* cfg = &function_code->cfg;
+    if (da_size(cfg->blocks) == 0) return false;
+
+    sccp_t sccp = { .function_code = function_code };
+    ssa_build(&sccp.ssa, function_code);
+
+    size_t n_values = da_size(sccp.ssa.values);
+    sccp.lattice = malloc(n_values * sizeof(lattice_t));
+    for (size_t v = 0; v < n_values; ++v) {
+        // Nothing is known about the variables at the entry
+        sccp.lattice[v] = v < da_size(sccp.ssa.vars) ? VARYING : UNKNOWN;
+    }
+    sccp.executable_preds = calloc(da_size(cfg->blocks), sizeof(da_bitset_t));
+
+    // The function entry is the first executable edge, into the phis of block 0
+    da_bitset_set(&sccp.visited, 0);
+    for (size_t p = 0; p < da_size(sccp.ssa.block_phis[0]); ++p) {
+        visit_phi(&sccp, sccp.ssa.block_phis[0][p]);
+    }
+    for (size_t i = cfg->blocks[0].begin; i < cfg->blocks[0].end; ++i) {
+        visit_instruction(&sccp, i);
+    }
+
+    while (da_size(sccp.flow_worklist) > 0 || da_size(sccp.value_worklist) > 0) {
+        if (da_size(sccp.flow_worklist) > 0) {
+            edge_t edge = da_pop(sccp.flow_worklist);
+            // What comes in over the edge counts for the phis from now on
+            for (size_t p = 0; p < da_size(sccp.ssa.block_phis[edge.block]); ++p) {
+                visit_phi(&sccp, sccp.ssa.block_phis[edge.block][p]);
+            }
+            if (!da_bitset_test(sccp.visited, edge.block)) {
+                da_bitset_set(&sccp.visited, edge.block);
+                for (size_t i = cfg->blocks[edge.block].begin; i < cfg->blocks[edge.block].end; ++i) {
+                    visit_instruction(&sccp, i);
+                }
+            }
+            continue;
+        }
+
+        size_t v = da_pop(sccp.value_worklist);
+        ssa_value_t* value = &sccp.ssa.values[v];
+        for (size_t u = 0; u < da_size(value->used_by); ++u) {
+            if (da_bitset_test(sccp.visited, cfg->block_of[value->used_by[u]])) {
+                visit_instruction(&sccp, value->used_by[u]);
+            }
+        }
+        for (size_t u = 0; u < da_size(value->used_by_phis); ++u) {
+            if (da_bitset_test(sccp.visited, sccp.ssa.phis[value->used_by_phis[u]].block)) {
+                visit_phi(&sccp, value->used_by_phis[u]);
+            }
+        }
+    }
+
+    bool changed = rewrite_tac(&sccp);
+    if (changed) cfg_build(function_code);
+
+    for (size_t b = 0; b < da_size(cfg->blocks); ++b) {
+        da_bitset_deinit(sccp.executable_preds[b]);
+    }
+    free(sccp.executable_preds);
+    free(sccp.lattice);
+    da_bitset_deinit(sccp.visited);
+    da_deinit(sccp.flow_worklist);
+    da_deinit(sccp.value_worklist);
+    ssa_release(&sccp.ssa);
+    return changed;
+}
+
+static bool same_constant(lattice_t a, lattice_t b) {
+    if (a.is_real != b.is_real) return false;
+    if (a.is_real) return memcmp(&a.real_value, &b.real_value, sizeof(double)) == 0;
+    return a.int_value == b.int_value;
+}
+
+static lattice_t meet(lattice_t a, lattice_t b) {
+    if (a.level == LATTICE_UNKNOWN) return b;
+    if (b.level == LATTICE_UNKNOWN) return a;
+    if (a.level == LATTICE_VARYING || b.level == LATTICE_VARYING) return VARYING;
+    return same_constant(a, b) ? a : VARYING;
+}
+
+static lattice_t int_constant(long value) {
+    return (lattice_t){ .level = LATTICE_CONSTANT, .int_value = value };
+}
+
+static lattice_t real_constant(double value) {
+    return (lattice_t){ .level = LATTICE_CONSTANT, .is_real = true, .real_value = value };
+}
+
+// The constant as a value of type, the way gen.c stores it
+static lattice_t to_type(lattice_t value, basic_type_t type) {
+    if (value.level != LATTICE_CONSTANT) return value;
+    switch (type) {
+        case TYPE_REAL:
+            return value.is_real ? value : VARYING;
+        case TYPE_INT:
+        case TYPE_SIZE:
+            return value.is_real ? VARYING : value;
+        case TYPE_BOOL:
+            return value.is_real || (value.int_value != 0 && value.int_value != 1) ? VARYING : value;
+        case TYPE_CHAR:
+            if (value.is_real) return VARYING;
+            // One byte, read back zero extended. Char constants go in as
+            // immediates sign extended from a char, so keep to ASCII.
+            value.int_value &= 0xff;
+            return value.int_value <= 127 ? value : VARYING;
+        default:
+            return VARYING;
+    }
+}
+
+// An operand that is no variable: a constant, or a global, array, ... that can hold anything
+static lattice_t addr_lattice(size_t addr_idx) {
+    addr_t addr = compilation->addr_list[addr_idx];
+    switch (addr.type) {
+        case ADDR_INT_CONST:
+            return int_constant(addr.data.int_const);
+        case ADDR_SIZE_CONST:
+            return int_constant((long)addr.data.size_const);
+        case ADDR_BOOL_CONST:
+            return int_constant(addr.data.bool_const);
+        case ADDR_CHAR_CONST:
+            return to_type(int_constant(addr.data.char_const), TYPE_CHAR);
+        case ADDR_REAL_CONST:
+            return real_constant(addr.data.real_const);
+        default:
+            return VARYING;
+    }
+}
+
+// Operand u of instruction i, whose addr is addr_idx
+static lattice_t operand(sccp_t* sccp, size_t i, size_t u, size_t addr_idx) {
+    size_t value = sccp->ssa.instrs[i].uses[u];
+    return value == SSA_NONE ? addr_lattice(addr_idx) : sccp->lattice[value];
+}
+
+static lattice_t fold_binary(instruction_t instr, lattice_t a, lattice_t b, basic_type_t type) {
+    if (a.level == LATTICE_VARYING || b.level == LATTICE_VARYING) return VARYING;
+    if (a.level == LATTICE_UNKNOWN || b.level == LATTICE_UNKNOWN) return UNKNOWN;
+
+    if (a.is_real || b.is_real) {
+        // gen.c compares reals by their bits, leave that to it
+        if (!a.is_real || !b.is_real || type != TYPE_REAL) return VARYING;
+        switch (instr) {
+            case TAC_BINARY_ADD: return real_constant(a.real_value + b.real_value);
+            case TAC_BINARY_SUB: return real_constant(a.real_value - b.real_value);
+            case TAC_BINARY_MUL: return real_constant(a.real_value * b.real_value);
+            case TAC_BINARY_DIV: return real_constant(a.real_value / b.real_value);
+            default: return VARYING;
+        }
+    }
+
+    // 64 bit two's complement like the instructions, without the undefined overflow of long
+    unsigned long x = a.int_value, y = b.int_value;
+    long result;
+    switch (instr) {
+        case TAC_BINARY_ADD: result = (long)(x + y); break;
+        case TAC_BINARY_SUB: result = (long)(x - y); break;
+        case TAC_BINARY_MUL: result = (long)(x * y); break;
+        case TAC_BINARY_DIV:
+        case TAC_BINARY_MOD:
+            // idiv traps on these, at run time
+            if (b.int_value == 0 || (a.int_value == LONG_MIN && b.int_value == -1)) return VARYING;
+            result = instr == TAC_BINARY_DIV ? a.int_value / b.int_value : a.int_value % b.int_value;
+            break;
+        case TAC_BINARY_GT:  result = a.int_value >  b.int_value; break;
+        case TAC_BINARY_LT:  result = a.int_value <  b.int_value; break;
+        case TAC_BINARY_GEQ: result = a.int_value >= b.int_value; break;
+        case TAC_BINARY_LEQ: result = a.int_value <= b.int_value; break;
+        case TAC_BINARY_EQ:  result = a.int_value == b.int_value; break;
+        case TAC_BINARY_NEQ: result = a.int_value != b.int_value; break;
+        default: return VARYING;
+    }
+    return to_type(int_constant(result), type);
+}
+
+static lattice_t fold_unary(instruction_t instr, lattice_t a, basic_type_t type) {
+    if (a.level != LATTICE_CONSTANT) return a;
+    switch (instr) {
+        case TAC_COPY:
+        case TAC_CAST_INT_CHAR:
+        case TAC_CAST_CHAR_INT:
+            return to_type(a, type);
+        case TAC_UNARY_SUB:
+            // gen.c has no negation of reals
+            return a.is_real ? VARYING : to_type(int_constant((long)-(unsigned long)a.int_value), type);
+        case TAC_UNARY_NEG:
+            return a.is_real ? VARYING : to_type(int_constant(a.int_value == 0), type);
+        case TAC_CAST_REAL_INT:
+            // cvttsd2si truncates like C, out of range it gives LONG_MIN where C is undefined
+            if (!a.is_real || isnan(a.real_value) || a.real_value <= -0x1p63 || a.real_value >= 0x1p63) return VARYING;
+            return to_type(int_constant((long)a.real_value), type);
+        default:
+            return VARYING;
+    }
+}
+
+static bool is_foldable(instruction_t instr) {
+    switch (instr) {
+        case TAC_BINARY_ADD:
+        case TAC_BINARY_SUB:
+        case TAC_BINARY_MUL:
+        case TAC_BINARY_DIV:
+        case TAC_BINARY_MOD:
+        case TAC_BINARY_GT:
+        case TAC_BINARY_LT:
+        case TAC_BINARY_GEQ:
+        case TAC_BINARY_LEQ:
+        case TAC_BINARY_EQ:
+        case TAC_BINARY_NEQ:
+        case TAC_UNARY_SUB:
+        case TAC_UNARY_NEG:
+        case TAC_COPY:
+        case TAC_CAST_REAL_INT:
+        case TAC_CAST_INT_CHAR:
+        case TAC_CAST_CHAR_INT:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static lattice_t evaluate(sccp_t* sccp, size_t i) {
+    tac_t tac = sccp->function_code->tac_list[i];
+    if (!is_foldable(tac.instr)) return VARYING;
+
+    basic_type_t type = compilation->addr_list[tac.dst].type_info;
+    lattice_t a = operand(sccp, i, 0, tac.src1);
+    if (tac.src2 == 0) return fold_unary(tac.instr, a, type);
+    return fold_binary(tac.instr, a, operand(sccp, i, 1, tac.src2), type);
+}
+
+static void lower(sccp_t* sccp, size_t value, lattice_t to) {
+    lattice_t lowered = meet(sccp->lattice[value], to);
+    if (lowered.level != sccp->lattice[value].level) {
+        sccp->lattice[value] = lowered;
+        da_append(sccp->value_worklist, value);
+    }
+}
+
+static void mark_edge(sccp_t* sccp, size_t from, size_t to) {
+    basic_block_t* block = &sccp->function_code->cfg.blocks[to];
+    size_t pred = 0;
+    while (block->preds[pred] != from) ++pred;
+    if (da_bitset_test(sccp->executable_preds[to], pred)) return;
+    da_bitset_set(&sccp->executable_preds[to], pred);
+    da_append(sccp->flow_worklist, ((edge_t){ .block = to, .pred = pred }));
+}
+
+// Block the jump goes to, CFG_NONE when it leaves the function
+static size_t jump_block(sccp_t* sccp, tac_t tac) {
+    tac_t* tac_list = sccp->function_code->tac_list;
+    size_t target = compilation->addr_list[tac.dst].data.label - tac_list[0].label;
+    return target < da_size(tac_list) ? sccp->function_code->cfg.block_of[target] : CFG_NONE;
+}
+
+static void visit_instruction(sccp_t* sccp, size_t i) {
+    cfg_t* cfg = &sccp->function_code->cfg;
+    tac_t tac = sccp->function_code->tac_list[i];
+    size_t b = cfg->block_of[i];
+    size_t next = b + 1 < da_size(cfg->blocks) ? b + 1 : CFG_NONE;
+
+    switch (tac.instr) {
+        case TAC_IF_FALSE:
+            {
+                lattice_t cond = operand(sccp, i, 0, tac.src1);
+                if (cond.level == LATTICE_UNKNOWN) return;
+                bool taken = cond.level == LATTICE_VARYING || cond.is_real || cond.int_value == 0;
+                bool falls = cond.level == LATTICE_VARYING || cond.is_real || cond.int_value != 0;
+                size_t target = jump_block(sccp, tac);
+                if (taken && target != CFG_NONE) mark_edge(sccp, b, target);
+                if (falls && next != CFG_NONE) mark_edge(sccp, b, next);
+            }
+            return;
+        case TAC_GOTO:
+            {
+                size_t target = jump_block(sccp, tac);
+                if (target != CFG_NONE) mark_edge(sccp, b, target);
+            }
+            return;
+        case TAC_RETURN:
+            return;
+        default:
+            break;
+    }
+
+    if (sccp->ssa.instrs[i].def != SSA_NONE) {
+        lower(sccp, sccp->ssa.instrs[i].def, evaluate(sccp, i));
+    }
+    if (i + 1 == cfg->blocks[b].end && next != CFG_NONE) {
+        mark_edge(sccp, b, next);
+    }
+}
+
+static void visit_phi(sccp_t* sccp, size_t p) {
+    ssa_phi_t* phi = &sccp->ssa.phis[p];
+    lattice_t merged = UNKNOWN;
+    size_t n_preds = da_size(sccp->function_code->cfg.blocks[phi->block].preds);
+    for (size_t k = 0; k < da_size(phi->args); ++k) {
+        // The last arg of an entry block phi comes from the function entry, that always runs
+        if (k < n_preds && !da_bitset_test(sccp->executable_preds[phi->block], k)) continue;
+        merged = meet(merged, sccp->lattice[phi->args[k]]);
+    }
+    lower(sccp, phi->value, merged);
+}
+
+static size_t new_constant(lattice_t value, basic_type_t type) {
+    addr_t addr = { .type_info = type };
+    switch (type) {
+        case TYPE_REAL:
+            addr.type = ADDR_REAL_CONST;
+            addr.data.real_const = value.real_value;
+            break;
+        case TYPE_INT:
+            addr.type = ADDR_INT_CONST;
+            addr.data.int_const = value.int_value;
+            break;
+        case TYPE_SIZE:
+            addr.type = ADDR_SIZE_CONST;
+            addr.data.size_const = (size_t)value.int_value;
+            break;
+        case TYPE_BOOL:
+            addr.type = ADDR_BOOL_CONST;
+            addr.data.bool_const = value.int_value != 0;
+            break;
+        case TYPE_CHAR:
+            addr.type = ADDR_CHAR_CONST;
+            addr.data.char_const = (char)value.int_value;
+            break;
+        default:
+            assert(false && "No constants of this type");
+    }
+    size_t idx = da_size(compilation->addr_list);
+    da_append(compilation->addr_list, addr);
+    return idx;
+}
+
+// Back to TAC: the phis are dropped, instructions in blocks that never
+// ran are left as they are. Returns whether any instruction changed.
+static bool rewrite_tac(sccp_t* sccp) {
+    tac_t* tac_list = sccp->function_code->tac_list;
+    cfg_t* cfg = &sccp->function_code->cfg;
+    size_t** slots = 0;
+    bool changed = false;
+
+    for (size_t i = 0; i < da_size(tac_list); ++i) {
+        if (!da_bitset_test(sccp->visited, cfg->block_of[i])) continue;
+        tac_t* tac = &tac_list[i];
+        ssa_instr_t* instr = &sccp->ssa.instrs[i];
+
+        if (tac->instr == TAC_IF_FALSE) {
+            lattice_t cond = operand(sccp, i, 0, tac->src1);
+            if (cond.level == LATTICE_CONSTANT && !cond.is_real) {
+                if (cond.int_value == 0) {
+                    *tac = (tac_t){ .label = tac->label, .instr = TAC_GOTO, .dst = tac->dst };
+                } else {
+                    *tac = (tac_t){ .label = tac->label, .instr = TAC_NOP };
+                }
+                changed = true;
+                continue;
+            }
+        }
+
+        if (instr->def != SSA_NONE && is_foldable(tac->instr) && sccp->lattice[instr->def].level == LATTICE_CONSTANT) {
+            // A COPY of a constant is as folded as it gets
+            if (tac->instr == TAC_COPY && instr->uses[0] == SSA_NONE) continue;
+            basic_type_t type = compilation->addr_list[tac->dst].type_info;
+            *tac = (tac_t){
+                .label = tac->label,
+                .instr = TAC_COPY,
+                .src1 = new_constant(sccp->lattice[instr->def], type),
+                .dst = tac->dst,
+            };
+            changed = true;
+            continue;
+        }
+
+        da_clear(slots);
+        tac_use_slots(tac, &slots);
+        for (size_t u = 0; u < da_size(slots); ++u) {
+            if (instr->uses[u] == SSA_NONE) continue;
+            basic_type_t type = compilation->addr_list[*slots[u]].type_info;
+            lattice_t value = to_type(sccp->lattice[instr->uses[u]], type);
+            if (value.level == LATTICE_CONSTANT) {
+                *slots[u] = new_constant(value, type);
+                changed = true;
+            }
+        }
+    }
+    da_deinit(slots);
+    return changed;
+}
@@ -0,0 +1,22 @@
+#ifndef SCCP_H
+#define SCCP_H
+
+#include <stdbool.h>
+
+#include "langc.h"
+
+// Sparse conditional constant propagation (Wegman and Zadeck) over the
+// SSA form of a function, see ssa.h. One of the passes of optimize, opt.h.
+//
+// Every value starts unknown and can only go down, to one constant and then
+// to varying, while the blocks that can run are discovered from the entry.
+// A branch on a constant only makes the side it takes reachable, so values
+// merged from the other side do not count.
+//
+// Afterwards an instruction computing a constant becomes a COPY of it, a
+// read of a variable holding a constant reads the constant, and a branch on
+// a constant becomes a GOTO or a NOP. The CFG is built again.
+// Returns whether the tac_list changed.
+bool propagate_constants(function_code_t* function_code);
+
+#endif // SCCP_H
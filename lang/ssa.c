@@ -0,0 +1,268 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ssa.h"
+#include "cfg.h"
+#include "compilation.h"
+#include "da.h"
+#include "da_bitset.h"
+#include "tac.h"
+
+static void place_phis(ssa_t* ssa, cfg_t* cfg, tac_t* tac_list);
+static void rename_values(ssa_t* ssa, cfg_t* cfg, tac_t* tac_list);
+
+void ssa_build(ssa_t* ssa, function_code_t* function_code) {
+    *ssa = (ssa_t){0};
+    cfg_t* cfg = &function_code->cfg;
+    if (da_size(cfg->blocks) == 0) return;
+
+    tac_scalar_vars(function_code->tac_list, &ssa->vars);
+    // An entry value per variable and at most one per instruction, then the phis
+    da_reserve(ssa->values, da_size(ssa->vars) + da_size(function_code->tac_list));
+    for (size_t v = 0; v < da_size(ssa->vars); ++v) {
+        ssa_value_t entry = { .var = v, .def = SSA_NONE };
+        da_append(ssa->values, entry);
+    }
+
+    da_resize(ssa->block_phis, da_size(cfg->blocks));
+    memset(ssa->block_phis, 0, da_size(cfg->blocks) * sizeof(size_t*));
+    da_resize(ssa->instrs, da_size(function_code->tac_list));
+    for (size_t i = 0; i < da_size(ssa->instrs); ++i) {
+        ssa->instrs[i] = (ssa_instr_t){ .def = SSA_NONE, .uses = NULL };
+    }
+
+    place_phis(ssa, cfg, function_code->tac_list);
+    rename_values(ssa, cfg, function_code->tac_list);
+}
+
+void ssa_release(ssa_t* ssa) {
+    for (size_t v = 0; v < da_size(ssa->values); ++v) {
+        da_deinit(ssa->values[v].used_by);
+        da_deinit(ssa->values[v].used_by_phis);
+    }
+    for (size_t p = 0; p < da_size(ssa->phis); ++p) {
+        da_deinit(ssa->phis[p].args);
+    }
+    for (size_t b = 0; b < da_size(ssa->block_phis); ++b) {
+        da_deinit(ssa->block_phis[b]);
+    }
+    for (size_t i = 0; i < da_size(ssa->instrs); ++i) {
+        da_deinit(ssa->instrs[i].uses);
+    }
+    da_deinit(ssa->vars);
+    da_deinit(ssa->values);
+    da_deinit(ssa->phis);
+    da_deinit(ssa->block_phis);
+    da_deinit(ssa->instrs);
+    *ssa = (ssa_t){0};
+}
+
+// Cooper, Harvey and Kennedy: a join point is in the frontier of every
+// block on the dominator tree path from each of its predecessors up to,
+// not including, its idom.
+// The entry counts the function entry as one more predecessor.
+static da_bitset_t* dominance_frontiers(cfg_t* cfg) {
+    size_t n_blocks = da_size(cfg->blocks);
+    da_bitset_t* frontiers = calloc(n_blocks, sizeof(da_bitset_t));
+    for (size_t b = 0; b < n_blocks; ++b) {
+        basic_block_t* block = &cfg->blocks[b];
+        if (block->rpo == CFG_NONE || da_size(block->preds) + (b == 0) < 2) continue;
+        for (size_t i = 0; i < da_size(block->preds); ++i) {
+            size_t runner = block->preds[i];
+            if (cfg->blocks[runner].rpo == CFG_NONE) continue;
+            while (runner != block->idom) {
+                da_bitset_set(&frontiers[runner], b);
+                runner = cfg->blocks[runner].idom;
+            }
+        }
+    }
+    return frontiers;
+}
+
+static void add_phi(ssa_t* ssa, cfg_t* cfg, size_t var, size_t block) {
+    ssa_value_t value = { .var = var, .def = da_size(ssa->phis), .is_phi = true };
+    ssa_phi_t phi = { .block = block, .value = da_size(ssa->values), .args = NULL };
+    for (size_t i = 0; i < da_size(cfg->blocks[block].preds) + (block == 0); ++i) {
+        da_append_policy(phi.args, SSA_NONE, DA_POLICY_SMALL);
+    }
+    da_append_policy(ssa->block_phis[block], da_size(ssa->phis), DA_POLICY_SMALL);
+    da_append(ssa->values, value);
+    da_append_policy(ssa->phis, phi, DA_POLICY_SMALL);
+}
+
+// A variable gets phis on the iterated dominance frontier of the blocks
+// writing it. Only variables that are read in some block before being
+// written there can be live into a join point, the others get none.
+static void place_phis(ssa_t* ssa, cfg_t* cfg, tac_t* tac_list) {
+    size_t n_vars = da_size(ssa->vars);
+    size_t** def_blocks = calloc(n_vars, sizeof(size_t*)); // da each
+    da_bitset_t live_across = NULL;
+    da_bitset_t written = NULL;  // in the current block
+    size_t* uses = 0;
+
+    for (size_t r = 0; r < da_size(cfg->rpo); ++r) {
+        size_t b = cfg->rpo[r];
+        da_bitset_clear(written);
+        for (size_t i = cfg->blocks[b].begin; i < cfg->blocks[b].end; ++i) {
+            da_clear(uses);
+            tac_uses(tac_list[i], &uses);
+            for (size_t u = 0; u < da_size(uses); ++u) {
+                size_t var = tac_var_index(ssa->vars, uses[u]);
+                if (var < n_vars && !da_bitset_test(written, var)) da_bitset_set(&live_across, var);
+            }
+            size_t var = tac_var_index(ssa->vars, tac_def(tac_list[i]));
+            if (var < n_vars) {
+                da_bitset_set(&written, var);
+                size_t n_defs = da_size(def_blocks[var]);
+                if (n_defs == 0 || def_blocks[var][n_defs - 1] != b) da_append_policy(def_blocks[var], b, DA_POLICY_SMALL);
+            }
+        }
+    }
+
+    da_bitset_t* frontiers = dominance_frontiers(cfg);
+    da_bitset_t has_phi = NULL;
+    da_bitset_t queued = NULL;
+    size_t* worklist = 0;  // a block is queued once per variable
+    da_reserve(worklist, da_size(cfg->blocks));
+    da_bitset_foreach(live_across, var) {
+        da_bitset_clear(has_phi);
+        da_bitset_clear(queued);
+        for (size_t i = 0; i < da_size(def_blocks[var]); ++i) {
+            da_append(worklist, def_blocks[var][i]);
+            da_bitset_set(&queued, def_blocks[var][i]);
+        }
+        while (da_size(worklist) > 0) {
+            size_t b = da_pop(worklist);
+            da_bitset_foreach(frontiers[b], join) {
+                if (da_bitset_test(has_phi, join)) continue;
+                da_bitset_set(&has_phi, join);
+                add_phi(ssa, cfg, var, join);
+                // The phi writes the variable too
+                if (!da_bitset_test(queued, join)) {
+                    da_bitset_set(&queued, join);
+                    da_append(worklist, join);
+                }
+            }
+        }
+    }
+
+    for (size_t v = 0; v < n_vars; ++v) {
+        da_deinit(def_blocks[v]);
+    }
+    free(def_blocks);
+    for (size_t b = 0; b < da_size(cfg->blocks); ++b) {
+        da_bitset_deinit(frontiers[b]);
+    }
+    free(frontiers);
+    da_bitset_deinit(live_across);
+    da_bitset_deinit(written);
+    da_bitset_deinit(has_phi);
+    da_bitset_deinit(queued);
+    da_deinit(worklist);
+    da_deinit(uses);
+}
+
+typedef struct {
+    size_t var;
+    size_t value;       // current value of var before
+} undo_t;
+
+typedef struct {
+    size_t block;
+    size_t next_child;  // in dom_children
+    size_t undo_mark;   // size of the undo log before the block
+} rename_frame_t;
+
+static void define(size_t* current, undo_t** undo, size_t var, size_t value) {
+    da_append(*undo, ((undo_t){ .var = var, .value = current[var] }));
+    current[var] = value;
+}
+
+// uses is scratch space
+static void rename_block(ssa_t* ssa, cfg_t* cfg, tac_t* tac_list, size_t b, size_t* current, undo_t** undo, size_t** uses) {
+    size_t n_vars = da_size(ssa->vars);
+    for (size_t p = 0; p < da_size(ssa->block_phis[b]); ++p) {
+        ssa_phi_t* phi = &ssa->phis[ssa->block_phis[b][p]];
+        define(current, undo, ssa->values[phi->value].var, phi->value);
+    }
+
+    for (size_t i = cfg->blocks[b].begin; i < cfg->blocks[b].end; ++i) {
+        da_clear(*uses);
+        tac_uses(tac_list[i], uses);
+        for (size_t u = 0; u < da_size(*uses); ++u) {
+            size_t var = tac_var_index(ssa->vars, (*uses)[u]);
+            size_t value = var < n_vars ? current[var] : SSA_NONE;
+            da_append_policy(ssa->instrs[i].uses, value, DA_POLICY_SMALL);
+            if (value != SSA_NONE) da_append_policy(ssa->values[value].used_by, i, DA_POLICY_SMALL);
+        }
+
+        size_t var = tac_var_index(ssa->vars, tac_def(tac_list[i]));
+        if (var < n_vars) {
+            ssa->instrs[i].def = da_size(ssa->values);
+            ssa_value_t value = { .var = var, .def = i };
+            da_append(ssa->values, value);
+            define(current, undo, var, ssa->instrs[i].def);
+        }
+    }
+
+    // Fill in what b hands to the phis of its successors
+    for (size_t s = 0; s < da_size(cfg->blocks[b].succs); ++s) {
+        basic_block_t* succ = &cfg->blocks[cfg->blocks[b].succs[s]];
+        size_t pred = 0;
+        while (succ->preds[pred] != b) ++pred;
+        size_t* phis = ssa->block_phis[cfg->blocks[b].succs[s]];
+        for (size_t p = 0; p < da_size(phis); ++p) {
+            ssa_phi_t* phi = &ssa->phis[phis[p]];
+            size_t value = current[ssa->values[phi->value].var];
+            phi->args[pred] = value;
+            da_append_policy(ssa->values[value].used_by_phis, phis[p], DA_POLICY_SMALL);
+        }
+    }
+}
+
+// Walks the dominator tree with the current value of every variable, the
+// undo log takes back what a block defined when the walk leaves it.
+// Without recursion since functions can be long.
+static void rename_values(ssa_t* ssa, cfg_t* cfg, tac_t* tac_list) {
+    size_t* current = malloc(da_size(ssa->vars) * sizeof(size_t));
+    for (size_t v = 0; v < da_size(ssa->vars); ++v) {
+        current[v] = v;
+    }
+    undo_t* undo = 0;
+    rename_frame_t* stack = 0;
+    size_t* uses = 0;
+    da_init(undo, DA_POLICY_SMALL);
+
+    // What the function entry hands to the phis of the entry block
+    for (size_t p = 0; p < da_size(ssa->block_phis[0]); ++p) {
+        ssa_phi_t* phi = &ssa->phis[ssa->block_phis[0][p]];
+        size_t value = ssa->values[phi->value].var;
+        phi->args[da_size(phi->args) - 1] = value;
+        da_append_policy(ssa->values[value].used_by_phis, ssa->block_phis[0][p], DA_POLICY_SMALL);
+    }
+
+    da_reserve(stack, da_size(cfg->blocks));
+    da_append(stack, ((rename_frame_t){ .block = 0, .next_child = 0, .undo_mark = 0 }));
+    rename_block(ssa, cfg, tac_list, 0, current, &undo, &uses);
+    while (da_size(stack) > 0) {
+        rename_frame_t* frame = &stack[da_size(stack) - 1];
+        size_t* children = cfg->blocks[frame->block].dom_children;
+        if (frame->next_child < da_size(children)) {
+            size_t child = children[frame->next_child++];
+            da_append(stack, ((rename_frame_t){ .block = child, .next_child = 0, .undo_mark = da_size(undo) }));
+            rename_block(ssa, cfg, tac_list, child, current, &undo, &uses);
+        } else {
+            while (da_size(undo) > frame->undo_mark) {
+                undo_t last = da_pop(undo);
+                current[last.var] = last.value;
+            }
+            (void)da_pop(stack);
+        }
+    }
+
+    free(current);
+    da_deinit(undo);
+    da_deinit(stack);
+    da_deinit(uses);
+}
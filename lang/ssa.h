@@ -0,0 +1,63 @@
+#ifndef SSA_H
+#define SSA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "langc.h"
+
+// Static single assignment form of one function, built next to its
+// tac_list and CFG (see cfg.h) rather than into them.
+//
+// The variables are the addrs of tac_scalar_vars (see tac.h). Every write
+// to one is a value, and so is the variable at the function entry. Every
+// read refers to the one value that reaches it. Where the values of
+// different predecessors meet, a phi merges them (Cytron et al., with phis
+// only for variables read in some block before being written there).
+//
+// The passes on top only replace reads with constants or with variables
+// written once, and rewrite or drop the instruction of a value in place, so
+// two versions of a variable are never live at once. Going back to TAC is
+// then dropping the phis, ssa_release.
+
+#define SSA_NONE SIZE_MAX
+
+typedef struct ssa_value_t ssa_value_t;
+typedef struct ssa_phi_t ssa_phi_t;
+typedef struct ssa_instr_t ssa_instr_t;
+typedef struct ssa_t ssa_t;
+
+struct ssa_value_t {
+    size_t var;            // index in ssa->vars
+    size_t def;            // instruction, or phi when is_phi, SSA_NONE at the entry
+    bool is_phi;
+    size_t* used_by;       // da of instructions, one entry per operand
+    size_t* used_by_phis;  // da of phis
+};
+
+struct ssa_phi_t {
+    size_t block;
+    size_t value;          // the value it defines
+    size_t* args;          // da, the value coming from each pred of block, SSA_NONE from unreachable ones.
+                           // In the entry block one more, last, from the function entry
+};
+
+struct ssa_instr_t {
+    size_t def;            // value the instruction writes, SSA_NONE if none
+    size_t* uses;          // da, the value of each operand of tac_uses, SSA_NONE if it is no variable
+};
+
+struct ssa_t {
+    size_t* vars;          // da, sorted addrs
+    ssa_value_t* values;   // da, value v < da_size(vars) is variable v at the entry
+    ssa_phi_t* phis;       // da
+    size_t** block_phis;   // da, per block a da of phis
+    ssa_instr_t* instrs;   // da, per instruction of tac_list
+};
+
+// Builds the SSA form of function_code, whose CFG has to be up to date
+void ssa_build(ssa_t* ssa, function_code_t* function_code);
+
+void ssa_release(ssa_t* ssa);
+
+#endif // SSA_H
@@ -5,22 +5,30 @@
 #include <assert.h>
 
 #include "langc.h"
+#include "arena.h"
+#include "atom.h"
+#include "compilation.h"
 #include "symbol.h"
 #include "symbol_table.h"
 #include "tree.h"
 #include "da.h"
+#include "da_map.h"
 #include "fail.h"
 #include "type.h"
 
 
 static void insert_builtin_functions();
-static void create_function_tables(node_t*);
-static void create_insert_variable_declaration(symbol_table_t*, symbol_type_t, node_t*);
-static void bind_references(symbol_table_t*, node_t*);
-static node_t* resolve_type_node(node_t*);
-static symbol_t* symbol_resolve_scope(symbol_table_t*, node_t*);
-static void create_struct_symbol(symbol_table_t* local_symbols, node_t* identifier_node, node_t* type_node);
-static symbol_t* resolve_struct_access(symbol_table_t*, node_t*);
+static void create_function_tables(node_id_t);
+static void create_insert_variable_declaration(symbol_table_t*, symbol_type_t, node_id_t);
+static void bind_references(symbol_table_t*, node_id_t);
+static node_id_t resolve_type_node(node_id_t);
+static symbol_t* symbol_resolve_scope(node_id_t);
+static insert_result_t declare_local(symbol_table_t*, symbol_t*);
+static symbol_t* lookup_reference(const char* name);
+static void create_struct_symbol(symbol_table_t* local_symbols, node_id_t identifier_node, node_id_t type_node);
+static symbol_t* new_struct_symbol(symbol_table_t* table, node_id_t identifier_node);
+static void create_struct_fields(symbol_t* struct_symbol, node_id_t type_node);
+static symbol_t* resolve_struct_access(symbol_table_t*, node_id_t);
 
 typedef struct struct_info_t struct_info_t;
 
@@ -35,52 +43,51 @@ char* SYMBOL_TYPE_NAMES[] = {
     "NAMESPACE",
 };
 
-symbol_table_t* global_symbol_table;
-char** global_string_list = 0;
 
-void create_symbol_tables() {
+void create_symbol_tables(compilation_t* c) {
+    compilation = c;
 
-    global_symbol_table = symbol_table_init();
-    global_type_table = symbol_table_init();
+    compilation->global_symbol_table = symbol_table_init();
+    compilation->global_type_table = symbol_table_init();
 
     insert_builtin_functions();
 
-    for (size_t i = 0; i < da_size(root->children); ++i) {
-        node_t* node = root->children[i];
-        if (node->type == DECLARATION) {
-            node_t* typenode = node->children[1];
-            if (typenode->type == TYPE) {
-                if (typenode->data.type_class == TC_FUNCTION) {
+    for (size_t i = 0; i < node_n_children(compilation->root); ++i) {
+        node_id_t node = node_child(compilation->root, i);
+        if (NODE(node).type == DECLARATION) {
+            node_id_t typenode = node_child(node, 1);
+            if (NODE(typenode).type == TYPE) {
+                if (NODE(typenode).data.type_class == TC_FUNCTION) {
                     create_function_tables(node);
                 } else {
-                    create_insert_variable_declaration(global_symbol_table, SYMBOL_GLOBAL_VAR, node);
+                    create_insert_variable_declaration(compilation->global_symbol_table, SYMBOL_GLOBAL_VAR, node);
                 }
-            } else if (typenode->type == BLOCK) {
-                fail_node(node, "Cannot infer type of %s", node->children[0]->data.identifier_str);
+            } else if (NODE(typenode).type == BLOCK) {
+                fail_node(node, "Cannot infer type of %s", NODE(node_child(node, 0)).data.identifier_str);
             } else {
                 // expression
-                create_insert_variable_declaration(global_symbol_table, SYMBOL_GLOBAL_VAR, node);
+                create_insert_variable_declaration(compilation->global_symbol_table, SYMBOL_GLOBAL_VAR, node);
             }
-        } else if (node->type == TYPE_DECLARATION) {
-            assert(da_size(node->children) == 2);
+        } else if (NODE(node).type == TYPE_DECLARATION) {
+            assert(node_n_children(node) == 2);
 
-            node_t* identifier_node = node->children[0];
-            node_t* type_node = node->children[1];
+            node_id_t identifier_node = node_child(node, 0);
+            node_id_t type_node = node_child(node, 1);
 
-            symbol_t* type_symbol = malloc(sizeof(symbol_t));
-            type_symbol->name = identifier_node->data.identifier_str;
+            symbol_t* type_symbol = arena_new(&compilation->arena, symbol_t);
+            type_symbol->name = NODE(identifier_node).data.identifier_str;
             type_symbol->node = node;
-            node->symbol = type_symbol;
+            node_symbol(node) = type_symbol;
             type_symbol->type = SYMBOL_TYPE;
-            type_symbol->function_symtable = global_type_table; // idk
+            type_symbol->function_symtable = compilation->global_type_table; // idk
             type_symbol->is_builtin = false;
             type_symbol->data.type_node = type_node;
 
-            if (symbol_table_insert(global_type_table, type_symbol) == INSERT_COLLISION) {
+            if (symbol_table_insert(compilation->global_type_table, type_symbol) == INSERT_COLLISION) {
                 fail_node(identifier_node, "Redefinition of type '%s'", type_symbol->name);
             }
 
-            bind_references(global_symbol_table, type_node);
+            bind_references(compilation->global_symbol_table, type_node);
         } else {
             assert(false && "Unexpected node type in global statement list");
         }
@@ -88,13 +95,19 @@ void create_symbol_tables() {
 
     // Ugly but quick extra pass so we can refer to functions defined later
     // TODO: not finished, should do the same for type nodes
-    for (size_t i = 0; i < da_size(root->children); ++i) {
-        node_t* node = root->children[i];
-        if (node->type == DECLARATION) {
-            node_t* typenode = node->children[1];
-            if (typenode->type == TYPE) {
-                if (typenode->data.type_class == TC_FUNCTION) {
-                    bind_references(node->symbol->function_symtable, node->children[2]);
+    for (size_t i = 0; i < node_n_children(compilation->root); ++i) {
+        node_id_t node = node_child(compilation->root, i);
+        if (NODE(node).type == DECLARATION) {
+            node_id_t typenode = node_child(node, 1);
+            if (NODE(typenode).type == TYPE) {
+                if (NODE(typenode).data.type_class == TC_FUNCTION) {
+                    // The parameters make up the outermost scope of the function
+                    symbol_table_t* function_symtable = node_symbol(node)->function_symtable;
+                    for (size_t j = 0; j < function_symtable->n_symbols; ++j) {
+                        scope_table_insert(&compilation->scopes, function_symtable->symbols[j]);
+                    }
+                    bind_references(function_symtable, node_child(node, 2));
+                    scope_table_clear(&compilation->scopes);
                 }
             }
         }
@@ -103,105 +116,121 @@ void create_symbol_tables() {
 
 static void insert_builtin_functions() {
     {
-        symbol_t* symbol = malloc(sizeof(symbol_t));
-        symbol->name = "println";
+        symbol_t* symbol = arena_new(&compilation->arena, symbol_t);
+        symbol->name = atom_intern_cstr("println");
         symbol->type = SYMBOL_FUNCTION;
         symbol->is_builtin = true;
-        assert((symbol_table_insert(global_symbol_table, symbol) == INSERT_OK) && "Error when inserting builtin function");
+        assert((symbol_table_insert(compilation->global_symbol_table, symbol) == INSERT_OK) && "Error when inserting builtin function");
     }
 
     {
-        symbol_t* symbol = malloc(sizeof(symbol_t));
-        symbol->name = "print";
+        symbol_t* symbol = arena_new(&compilation->arena, symbol_t);
+        symbol->name = atom_intern_cstr("print");
         symbol->type = SYMBOL_FUNCTION;
         symbol->is_builtin = true;
-        assert((symbol_table_insert(global_symbol_table, symbol) == INSERT_OK) && "Error when inserting builtin function");
+        assert((symbol_table_insert(compilation->global_symbol_table, symbol) == INSERT_OK) && "Error when inserting builtin function");
     }
 
     {
-        symbol_t* symbol = malloc(sizeof(symbol_t));
-        symbol->name = "delete";
+        symbol_t* symbol = arena_new(&compilation->arena, symbol_t);
+        symbol->name = atom_intern_cstr("delete");
         symbol->type = SYMBOL_FUNCTION;
         symbol->is_builtin = true;
-        assert((symbol_table_insert(global_symbol_table, symbol) == INSERT_OK) && "Error when inserting builtin function");
+        assert((symbol_table_insert(compilation->global_symbol_table, symbol) == INSERT_OK) && "Error when inserting builtin function");
     }
     {
-        symbol_t* symbol = malloc(sizeof(symbol_t));
-        symbol->name = "readchar";
+        symbol_t* symbol = arena_new(&compilation->arena, symbol_t);
+        symbol->name = atom_intern_cstr("readchar");
         symbol->type = SYMBOL_FUNCTION;
         symbol->is_builtin = true;
-        assert((symbol_table_insert(global_symbol_table, symbol) == INSERT_OK) && "Error when inserting builtin function");
+        assert((symbol_table_insert(compilation->global_symbol_table, symbol) == INSERT_OK) && "Error when inserting builtin function");
     }
 }
 
-static void create_function_tables(node_t* function_declaration_node) {
+static void create_function_tables(node_id_t function_declaration_node) {
     symbol_table_t* function_symtable = symbol_table_init();
-    function_symtable->hashmap->backup = global_symbol_table->hashmap;
 
-    node_t* identifier_node = function_declaration_node->children[0];
-    node_t* func_type_node = function_declaration_node->children[1];
+    node_id_t identifier_node = node_child(function_declaration_node, 0);
+    node_id_t func_type_node = node_child(function_declaration_node, 1);
 
-    node_t* param_declaration_list = func_type_node->children[0];
+    node_id_t param_declaration_list = node_child(func_type_node, 0);
 
-    for (size_t i = 0; i < da_size(param_declaration_list->children); ++i) {
-        node_t* param_declaration = param_declaration_list->children[i];
+    for (size_t i = 0; i < node_n_children(param_declaration_list); ++i) {
+        node_id_t param_declaration = node_child(param_declaration_list, i);
         create_insert_variable_declaration(function_symtable, SYMBOL_PARAMETER, param_declaration);
     }
 
-    symbol_t* function_symbol = malloc(sizeof(symbol_t));
-    assert((identifier_node->type == IDENTIFIER) && "Expected identifier_node");
-    function_symbol->name = identifier_node->data.identifier_str;
+    symbol_t* function_symbol = arena_new(&compilation->arena, symbol_t);
+    assert((NODE(identifier_node).type == IDENTIFIER) && "Expected identifier_node");
+    function_symbol->name = NODE(identifier_node).data.identifier_str;
     function_symbol->type = SYMBOL_FUNCTION;
     function_symbol->node = function_declaration_node;
     function_symbol->function_symtable = function_symtable;
     function_symbol->is_builtin = false;
-    function_declaration_node->symbol = function_symbol;
-    if (symbol_table_insert(global_symbol_table, function_symbol) == INSERT_COLLISION) {
+    node_symbol(function_declaration_node) = function_symbol;
+    if (symbol_table_insert(compilation->global_symbol_table, function_symbol) == INSERT_COLLISION) {
         // TODO: Note:
         fail_node(identifier_node, "Error: Redefinition of function '%s'", function_symbol->name);
     }
 
 }
 
-static void create_insert_variable_declaration(symbol_table_t* symtable, symbol_type_t symbol_type, node_t* declaration_node) {
-    if (declaration_node->children[1]->type == TYPE && declaration_node->children[1]->data.type_class == TC_STRUCT) {
+static void create_insert_variable_declaration(symbol_table_t* symtable, symbol_type_t symbol_type, node_id_t declaration_node) {
+    if (NODE(node_child(declaration_node, 1)).type == TYPE && NODE(node_child(declaration_node, 1)).data.type_class == TC_STRUCT) {
         assert(false && "Not implemented");
     }
-    symbol_t* symbol = malloc(sizeof(symbol_t));
-    node_t* identifier_node = declaration_node->children[0];
-    assert((identifier_node->type == IDENTIFIER) && "Expected identifier_node");
-    symbol->name = identifier_node->data.identifier_str;
+    symbol_t* symbol = arena_new(&compilation->arena, symbol_t);
+    node_id_t identifier_node = node_child(declaration_node, 0);
+    assert((NODE(identifier_node).type == IDENTIFIER) && "Expected identifier_node");
+    symbol->name = NODE(identifier_node).data.identifier_str;
     symbol->type = symbol_type;
     symbol->node = identifier_node;
     symbol->function_symtable = NULL;
-    symbol->node->symbol = symbol;
+    node_symbol(symbol->node) = symbol;
     if (symbol_table_insert(symtable, symbol) == INSERT_COLLISION) {
         // TODO: Node:
         fail_node(identifier_node, "Error: Redefinition of variable '%s'", symbol->name);
     }
 }
 
-static void bind_references(symbol_table_t* local_symbols, node_t* node) {
+// Declarations inside a function are bound in the scopes of the compilation,
+// the function's table only lists them. At the top level there are no
+// scopes, the global table is all there is.
+static insert_result_t declare_local(symbol_table_t* local_symbols, symbol_t* symbol) {
+    if (local_symbols == compilation->global_symbol_table) {
+        return symbol_table_insert(local_symbols, symbol);
+    }
+    if (scope_table_insert(&compilation->scopes, symbol) == INSERT_COLLISION) {
+        return INSERT_COLLISION;
+    }
+    symbol_table_append(local_symbols, symbol);
+    return INSERT_OK;
+}
+
+// Innermost visible symbol for the name, the globals are behind the scopes
+static symbol_t* lookup_reference(const char* name) {
+    symbol_t* symbol = scope_table_lookup(&compilation->scopes, name);
+    if (symbol == NULL) {
+        symbol = symbol_hashmap_lookup(compilation->global_symbol_table->hashmap, name);
+    }
+    return symbol;
+}
+
+static void bind_references(symbol_table_t* local_symbols, node_id_t node) {
     if (!node) return;
 
-    if (node->type == BLOCK) {
-        // Scope push
-        symbol_hashmap_t* inner = symbol_hashmap_init();
-        inner->backup = local_symbols->hashmap;
-        local_symbols->hashmap = inner;
+    if (NODE(node).type == BLOCK) {
+        scope_table_enter(&compilation->scopes);
 
-        for (size_t i = 0; i < da_size(node->children); ++i) {
-            bind_references(local_symbols, node->children[i]);
+        for (size_t i = 0; i < node_n_children(node); ++i) {
+            bind_references(local_symbols, node_child(node, i));
         }
 
-        // Scope pop
-        symbol_hashmap_t* outer = local_symbols->hashmap->backup;
-        symbol_hashmap_destroy(local_symbols->hashmap);
-        local_symbols->hashmap = outer;
+        scope_table_leave(&compilation->scopes);
         return;
     }
 
-    switch (node->type) {
+    switch (NODE(node).type) {
         case RETURN_STATEMENT:
         case OPERATOR:
         case INTEGER_LITERAL:
@@ -219,47 +248,47 @@ static void bind_references(symbol_table_t* local_symbols, node_t* node) {
         case BREAK_STATEMENT:
         case CONTINUE_STATEMENT:
             {
-                for (size_t i = 0; i < da_size(node->children); ++i) {
-                    bind_references(local_symbols, node->children[i]);
+                for (size_t i = 0; i < node_n_children(node); ++i) {
+                    bind_references(local_symbols, node_child(node, i));
                 }
             }
             break;
         case DECLARATION:
             {
                 // identifier, type, expression?
-                if (da_size(node->children) == 3) {
-                    bind_references(local_symbols, node->children[2]);
-                } else if (da_size(node->children) == 2 && node->children[1]->type != TYPE) {
-                    bind_references(local_symbols, node->children[1]);
+                if (node_n_children(node) == 3) {
+                    bind_references(local_symbols, node_child(node, 2));
+                } else if (node_n_children(node) == 2 && NODE(node_child(node, 1)).type != TYPE) {
+                    bind_references(local_symbols, node_child(node, 1));
                 }
 
-                if (node->children[1]->type == TYPE) {
-                    node_t* type_node = resolve_type_node(node->children[1]);
-                    if (type_node->data.type_class == TC_STRUCT) {
-                        create_struct_symbol(local_symbols, node->children[0], type_node);
+                if (NODE(node_child(node, 1)).type == TYPE) {
+                    node_id_t type_node = resolve_type_node(node_child(node, 1));
+                    if (NODE(type_node).data.type_class == TC_STRUCT) {
+                        create_struct_symbol(local_symbols, node_child(node, 0), type_node);
                         return;
                     }
                 }
 
 
-                symbol_t* symbol = malloc(sizeof(symbol_t));
-                node_t* identifier = node->children[0];
-                assert((identifier->type == IDENTIFIER) && "Expected identifier_node");
-                symbol->name = identifier->data.identifier_str;
+                symbol_t* symbol = arena_new(&compilation->arena, symbol_t);
+                node_id_t identifier = node_child(node, 0);
+                assert((NODE(identifier).type == IDENTIFIER) && "Expected identifier_node");
+                symbol->name = NODE(identifier).data.identifier_str;
                 symbol->type = SYMBOL_LOCAL_VAR;
                 symbol->node = identifier;
                 symbol->function_symtable = local_symbols;
-                symbol->node->symbol = symbol;
-                if (symbol_table_insert(local_symbols, symbol) == INSERT_COLLISION) {
+                node_symbol(symbol->node) = symbol;
+                if (declare_local(local_symbols, symbol) == INSERT_COLLISION) {
                     fail_node(identifier, "Error: Redefinition of variable '%s'", symbol->name);
                 }
             }
             break;
         case TYPE:
             {
-                if (node->data.type_class != TC_UNKNOWN) {
-                    for (size_t i = 0; i < da_size(node->children); ++i) {
-                        bind_references(local_symbols, node->children[i]);
+                if (NODE(node).data.type_class != TC_UNKNOWN) {
+                    for (size_t i = 0; i < node_n_children(node); ++i) {
+                        bind_references(local_symbols, node_child(node, i));
                     }
                 }
             }
@@ -267,26 +296,26 @@ static void bind_references(symbol_table_t* local_symbols, node_t* node) {
         case IDENTIFIER:
             {
                 // Assumes we didn't arrive here by declaration or function call
-                char* identifier = node->data.identifier_str;
-                symbol_t* symbol_definition = symbol_hashmap_lookup(local_symbols->hashmap, identifier);
+                char* identifier = NODE(node).data.identifier_str;
+                symbol_t* symbol_definition = lookup_reference(identifier);
                 if (symbol_definition == NULL) {
                     fail_node(node, "Error: Unknown reference '%s'", identifier);
                 }
-                node->symbol = symbol_definition;
+                node_symbol(node) = symbol_definition;
             }
             break;
         case FUNCTION_CALL:
             {
-                node_t* lhs_node = node->children[0];
+                node_id_t lhs_node = node_child(node, 0);
 
                 symbol_t* symbol_definition = 0;
-                if (lhs_node->type == IDENTIFIER) {
-                    symbol_definition = symbol_hashmap_lookup(local_symbols->hashmap, lhs_node->data.identifier_str);
+                if (NODE(lhs_node).type == IDENTIFIER) {
+                    symbol_definition = lookup_reference(NODE(lhs_node).data.identifier_str);
                 } else {
-                    symbol_definition = symbol_resolve_scope(local_symbols, lhs_node);
+                    symbol_definition = symbol_resolve_scope(lhs_node);
                 }
                 if (symbol_definition == NULL) {
-                    fail_node(node->children[0], "Error: Unknown function reference '%s'", lhs_node->data.identifier_str);
+                    fail_node(node_child(node, 0), "Error: Unknown function reference '%s'", NODE(lhs_node).data.identifier_str);
                 } 
 
                 if (symbol_definition->type != SYMBOL_FUNCTION) {
@@ -294,50 +323,56 @@ static void bind_references(symbol_table_t* local_symbols, node_t* node) {
                     fail_node(lhs_node, "Error: '%s' is not a function", symbol_definition->name);
                 }
 
-                lhs_node->symbol = symbol_definition;
-                node_t* list_node = node->children[1];
+                node_symbol(lhs_node) = symbol_definition;
+                node_id_t list_node = node_child(node, 1);
 
-                for (size_t i = 0; i < da_size(list_node->children); ++i) {
-                    bind_references(local_symbols, list_node->children[i]);
+                for (size_t i = 0; i < node_n_children(list_node); ++i) {
+                    bind_references(local_symbols, node_child(list_node, i));
                 }
             }
             break;
         case STRING_LITERAL:
             {
-                // Store string data in string table instead
-                size_t idx = da_size(global_string_list);
-                da_append(global_string_list, node->data.string_literal_value);
-                node->data.string_literal_idx = idx;
+                // Store string data in string table instead, equal literals share an entry
+                if (!da_map_is_init(&compilation->string_list_index)) {
+                    da_map_init(&compilation->string_list_index, char*, size_t, da_map_hash_ptr, da_map_eq_ptr);
+                }
+                size_t idx = da_size(compilation->global_string_list);
+                idx = *(size_t*)da_map_get_or_put(&compilation->string_list_index, &NODE(node).data.string_literal_value, &idx);
+                if (idx == da_size(compilation->global_string_list)) {
+                    da_append(compilation->global_string_list, NODE(node).data.string_literal_value);
+                }
+                NODE(node).data.string_literal_idx = idx;
             }
             break;
         case DOT_ACCESS:
             {
-                resolve_struct_access(local_symbols, node);
+                resolve_struct_access(NULL, node);
             }
             break;
         case ALLOC_EXPRESSION:
             {
-                if (da_size(node->children) > 1) {
-                    bind_references(local_symbols, node->children[1]);
+                if (node_n_children(node) > 1) {
+                    bind_references(local_symbols, node_child(node, 1));
                 }
             }
             break;
         default:
             {
-                fprintf(stderr, "bind_references: Unexpected node type: %s\n", NODE_TYPE_NAMES[node->type]);
+                fprintf(stderr, "bind_references: Unexpected node type: %s\n", NODE_TYPE_NAMES[NODE(node).type]);
                 exit(EXIT_FAILURE);
             }
     }
 }
 
-static node_t* resolve_type_node(node_t* node) {
-    if (node->data.type_class != TC_UNKNOWN) {
+static node_id_t resolve_type_node(node_id_t node) {
+    if (NODE(node).data.type_class != TC_UNKNOWN) {
         return node;
     }
 
-    node_t* identifier_node = node->children[0];
-    assert(identifier_node->type == IDENTIFIER);
-    symbol_t* symbol = symbol_hashmap_lookup(global_type_table->hashmap, identifier_node->data.identifier_str);
+    node_id_t identifier_node = node_child(node, 0);
+    assert(NODE(identifier_node).type == IDENTIFIER);
+    symbol_t* symbol = symbol_hashmap_lookup(compilation->global_type_table->hashmap, NODE(identifier_node).data.identifier_str);
     if (symbol != NULL) {
         return symbol->data.type_node;
     }
@@ -345,56 +380,67 @@ static node_t* resolve_type_node(node_t* node) {
 }
 
 // resolve scope resolution
-static symbol_t* symbol_resolve_scope(symbol_table_t* local_symbols, node_t* scope_resolution_node) {
+static symbol_t* symbol_resolve_scope(node_id_t scope_resolution_node) {
 
-    node_t* lhs_node = scope_resolution_node->children[0];
+    node_id_t lhs_node = node_child(scope_resolution_node, 0);
 
-    if (lhs_node->type == IDENTIFIER) {
-        symbol_t* symbol_definition = symbol_hashmap_lookup(local_symbols->hashmap, lhs_node->data.identifier_str);
+    if (NODE(lhs_node).type == IDENTIFIER) {
+        symbol_t* symbol_definition = lookup_reference(NODE(lhs_node).data.identifier_str);
         (void)symbol_definition;
     }
 
     assert(false && "Not done");
 }
 
-static void create_struct_symbol(symbol_table_t* local_symbols, node_t* identifier_node, node_t* type_node) {
-    symbol_t* symbol = malloc(sizeof(symbol_t));
-    symbol->name = identifier_node->data.identifier_str;
-    symbol->type = SYMBOL_LOCAL_STRUCT; // TODO: global struct
-    symbol->node = identifier_node;
-    symbol->function_symtable = local_symbols;
-    symbol->node->symbol = symbol;
-
-    if (symbol_table_insert(local_symbols, symbol) == INSERT_COLLISION) {
+static void create_struct_symbol(symbol_table_t* local_symbols, node_id_t identifier_node, node_id_t type_node) {
+    symbol_t* symbol = new_struct_symbol(local_symbols, identifier_node);
+    if (declare_local(local_symbols, symbol) == INSERT_COLLISION) {
         fail_node(identifier_node, "Error: Redefinition of variable '%s'", symbol->name);
     }
+    create_struct_fields(symbol, type_node);
+}
+
+static symbol_t* new_struct_symbol(symbol_table_t* table, node_id_t identifier_node) {
+    symbol_t* symbol = arena_new(&compilation->arena, symbol_t);
+    symbol->name = NODE(identifier_node).data.identifier_str;
+    symbol->type = SYMBOL_LOCAL_STRUCT; // TODO: global struct
+    symbol->node = identifier_node;
+    symbol->function_symtable = table;
+    node_symbol(symbol->node) = symbol;
+    return symbol;
+}
 
-    node_t* declaration_list = type_node->children[0];
-    symbol->data.struct_info = malloc(sizeof(struct_info_t));
+static void create_struct_fields(symbol_t* symbol, node_id_t type_node) {
+    node_id_t declaration_list = node_child(type_node, 0);
+    symbol->data.struct_info = arena_new(&compilation->arena, struct_info_t);
     symbol->data.struct_info->fields = symbol_table_init();
 
-    for (size_t i = 0; i < da_size(declaration_list->children); ++i) {
-        node_t* decl = declaration_list->children[i];
-        if (decl->children[1]->type != TYPE) {
-            fail_node(decl, "Field '%s' needs to have a type", decl->children[0]->data.identifier_str);
+    for (size_t i = 0; i < node_n_children(declaration_list); ++i) {
+        node_id_t decl = node_child(declaration_list, i);
+        if (NODE(node_child(decl, 1)).type != TYPE) {
+            fail_node(decl, "Field '%s' needs to have a type", NODE(node_child(decl, 0)).data.identifier_str);
         }
-        if (da_size(decl->children) > 2) {
-            fail_node(decl->children[2], "Default values are not supported yet:(");
+        if (node_n_children(decl) > 2) {
+            fail_node(node_child(decl, 2), "Default values are not supported yet:(");
         }
 
-        node_t* decl_type_node = resolve_type_node(decl->children[1]);
-        if (decl_type_node->data.type_class == TC_STRUCT) {
-            create_struct_symbol(symbol->data.struct_info->fields, decl->children[0], decl_type_node);
+        node_id_t decl_type_node = resolve_type_node(node_child(decl, 1));
+        if (NODE(decl_type_node).data.type_class == TC_STRUCT) {
+            symbol_t* field_symbol = new_struct_symbol(symbol->data.struct_info->fields, node_child(decl, 0));
+            if (symbol_table_insert(symbol->data.struct_info->fields, field_symbol) == INSERT_COLLISION) {
+                fail_node(node_child(decl, 0), "Error: Redefinition of variable '%s'", field_symbol->name);
+            }
+            create_struct_fields(field_symbol, decl_type_node);
         } else {
-            symbol_t* field_symbol = malloc(sizeof(symbol_t));
-            node_t* identifier = decl->children[0];
-            assert((identifier->type == IDENTIFIER) && "Expected identifier_node");
-            field_symbol->name = identifier->data.identifier_str;
+            symbol_t* field_symbol = arena_new(&compilation->arena, symbol_t);
+            node_id_t identifier = node_child(decl, 0);
+            assert((NODE(identifier).type == IDENTIFIER) && "Expected identifier_node");
+            field_symbol->name = NODE(identifier).data.identifier_str;
 
             field_symbol->type = SYMBOL_LOCAL_VAR;
             field_symbol->node = identifier;
             field_symbol->function_symtable = symbol->data.struct_info->fields;
-            field_symbol->node->symbol = field_symbol;
+            node_symbol(field_symbol->node) = field_symbol;
             if (symbol_table_insert(symbol->data.struct_info->fields, field_symbol) == INSERT_COLLISION) {
                 fail_node(identifier, "Error: Redefinition of field '%s'", field_symbol->name);
             }
@@ -402,21 +448,24 @@ static void create_struct_symbol(symbol_table_t* local_symbols, node_t* identifi
     }
 }
 
-static symbol_t* resolve_struct_access(symbol_table_t* local_symbols, node_t* dot_access_node) {
-    if (dot_access_node->type == IDENTIFIER) {
-        symbol_t* symbol = symbol_hashmap_lookup(local_symbols->hashmap, dot_access_node->data.identifier_str);
+// fields is the table of the struct on the left of the dot, NULL for the
+// leftmost name, which is looked up in the scopes
+static symbol_t* resolve_struct_access(symbol_table_t* fields, node_id_t dot_access_node) {
+    if (NODE(dot_access_node).type == IDENTIFIER) {
+        char* name = NODE(dot_access_node).data.identifier_str;
+        symbol_t* symbol = fields ? symbol_hashmap_lookup(fields->hashmap, name) : lookup_reference(name);
         if (symbol == NULL) {
-            fail_node(dot_access_node, "Unknown reference to '%s'", dot_access_node->data.identifier_str);
+            fail_node(dot_access_node, "Unknown reference to '%s'", NODE(dot_access_node).data.identifier_str);
         }
-        dot_access_node->symbol = symbol;
+        node_symbol(dot_access_node) = symbol;
         return symbol;
     }
-    assert(dot_access_node->type == DOT_ACCESS);
-    symbol_t* lhs = resolve_struct_access(local_symbols, dot_access_node->children[0]);
+    assert(NODE(dot_access_node).type == DOT_ACCESS);
+    symbol_t* lhs = resolve_struct_access(fields, node_child(dot_access_node, 0));
     if (lhs->type != SYMBOL_LOCAL_STRUCT && lhs->type != SYMBOL_GLOBAL_STRUCT) {
-        fail_node(dot_access_node->children[1], "'%s' is not a struct", lhs->name);
+        fail_node(node_child(dot_access_node, 1), "'%s' is not a struct", lhs->name);
     }
-    symbol_t* result = resolve_struct_access(lhs->data.struct_info->fields, dot_access_node->children[1]);
-    dot_access_node->children[1]->symbol = result;
+    symbol_t* result = resolve_struct_access(lhs->data.struct_info->fields, node_child(dot_access_node, 1));
+    node_symbol(node_child(dot_access_node, 1)) = result;
     return result;
 }
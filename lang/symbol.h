@@ -20,10 +20,10 @@ enum symbol_type_t {
 extern char* SYMBOL_TYPE_NAMES[];
 
 struct symbol_t {
-    char* name; // not owned
+    char* name; // atom, see atom.h
     symbol_type_t type;
     size_t sequence_number;
-    node_t* node;
+    node_id_t node;
     bool is_builtin;
 
     // Mostly for debug/interpretation. Maybe for constant expression evaluation?
@@ -32,7 +32,7 @@ struct symbol_t {
         double real_value;
         char* string_value;
         struct struct_info_t* struct_info;
-        node_t* type_node;
+        node_id_t type_node;
     } data;
 
     // Only if local, param or function
@@ -44,9 +44,7 @@ struct struct_info_t {
     struct symbol_table_t *fields;
 };
 
-extern symbol_table_t* global_symbol_table;
-extern char** global_string_list;
-
-void create_symbol_tables();
+// Fills in the symbol tables and the string list of the compilation
+void create_symbol_tables(compilation_t* c);
 
 #endif // SYMBOL_H
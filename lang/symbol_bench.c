@@ -0,0 +1,82 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+
+#include "compilation.h"
+#include "da.h"
+#include "lex.h"
+#include "parser.h"
+#include "symbol.h"
+
+#define WALLTIME(t) (((double)(t).tv_sec + 1e-6 * (double)(t).tv_usec)*1000.0)
+
+// Benchmark: binding references in deeply nested blocks.
+// Every block declares a variable, shadows `t` and refers to the outermost
+// local and to a global, the names that sit furthest from the innermost scope.
+// Resolution that does not depend on the depth keeps the ns/ref column flat.
+//
+//   symbol-bench [depth]...   default 10 100 1000
+
+#define STATEMENTS_PER_BLOCK 4
+
+// g: int;
+// main: () -> void = { v0: int = g; { v1: int = v0 + g; t: int = v1 + v0; ... { ... } } }
+static char* nested_source(int depth) {
+    char* content = 0;
+    char buffer[256];
+    const char* head = "g: int;\nmain: () -> void = {\n    v0: int = g;\n";
+    da_append_n(content, head, strlen(head));
+    for (int d = 1; d < depth; ++d) {
+        int len = snprintf(buffer, sizeof buffer,
+            "{\n"
+            "    v%d: int = v%d + g;\n"
+            "    t: int = v%d + v0;\n"
+            "    t += v0 + g;\n"
+            "    v%d += t + v0;\n",
+            d, d - 1, d, d);
+        da_append_n(content, buffer, len);
+    }
+    for (int d = 1; d < depth; ++d) {
+        da_append_n(content, "}\n", 2);
+    }
+    da_append_n(content, "}\n", 2);
+    return content;
+}
+
+int main(int argc, char** argv) {
+    int default_depths[] = {10, 100, 1000};
+    int n_depths = argc > 1 ? argc - 1 : 3;
+
+    compilation_t bench;
+    compilation_init(&bench);
+
+    for (int d = 0; d < n_depths; ++d) {
+        int depth = argc > 1 ? atoi(argv[d + 1]) : default_depths[d];
+        char* content = nested_source(depth);
+        int reps = depth >= 1000 ? 20 : 200;
+        // References in the statements above, v0 in the outermost block has one
+        size_t refs = 1 + (size_t)(depth - 1) * 10;
+
+        double total_ms = 0;
+        for (int r = 0; r < reps; ++r) {
+            lexer_init(&bench, "nested", content, da_size(content));
+            parse(&bench);
+            struct timeval t_start, t_end;
+            gettimeofday(&t_start, NULL);
+            create_symbol_tables(&bench);
+            gettimeofday(&t_end, NULL);
+            total_ms += WALLTIME(t_end) - WALLTIME(t_start);
+            compilation_release(&bench);
+        }
+        double ms = total_ms / reps;
+        printf("  depth %5d : %9.3f ms per binding, %7.1f ns/ref\n", depth, ms, ms * 1e6 / refs);
+        da_deinit(content);
+    }
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    printf("Peak RSS        : %8ld KB\n", usage.ru_maxrss);
+    return 0;
+}
@@ -1,4 +1,7 @@
 #include "symbol_table.h"
+#include "arena.h"
+#include "compilation.h"
+#include "da.h"
 #include "assert.h"
 
 #include <stdlib.h>
@@ -11,7 +14,7 @@ static insert_result_t symbol_hashmap_insert(symbol_hashmap_t* hashmap, symbol_t
 // Initializes a symboltable with 0 entries. Will be resized upon first insertion
 symbol_table_t* symbol_table_init(void)
 {
-  symbol_table_t* result = malloc(sizeof(symbol_table_t));
+  symbol_table_t* result = arena_new(&compilation->arena, symbol_table_t);
   *result = (symbol_table_t){.symbols = NULL,
                              .n_symbols = 0,
                              .capacity = 0,
@@ -26,28 +29,26 @@ insert_result_t symbol_table_insert(symbol_table_t* table, symbol_t* symbol)
   if (symbol_hashmap_insert(table->hashmap, symbol) == INSERT_COLLISION)
     return INSERT_COLLISION;
 
-  // If the table is full, resize the list
+  symbol_table_append(table, symbol);
+  return INSERT_OK;
+}
+
+// Adds a symbol to the list of the symbol table only
+void symbol_table_append(symbol_table_t* table, symbol_t* symbol)
+{
+  // If the table is full, move the list to a larger one. The old list stays in the arena.
   if (table->n_symbols + 1 >= table->capacity)
   {
     table->capacity = table->capacity * 2 + 8;
-    table->symbols = realloc(table->symbols, table->capacity * sizeof(symbol_t*));
+    symbol_t** symbols = arena_alloc(&compilation->arena, table->capacity * sizeof(symbol_t*));
+    if (table->n_symbols > 0)
+      memcpy(symbols, table->symbols, table->n_symbols * sizeof(symbol_t*));
+    table->symbols = symbols;
   }
 
   table->symbols[table->n_symbols] = symbol;
   symbol->sequence_number = table->n_symbols;
   table->n_symbols++;
-
-  return INSERT_OK;
-}
-
-// Destroys the given symbol table, its hashmap, and all the symbols it owns
-void symbol_table_destroy(symbol_table_t* table)
-{
-  for (size_t i = 0; i < table->n_symbols; i++)
-    free(table->symbols[i]);
-  free(table->symbols);
-  symbol_hashmap_destroy(table->hashmap);
-  free(table);
 }
 
 // ==================== Hashmap code ====================
@@ -55,18 +56,20 @@ void symbol_table_destroy(symbol_table_t* table)
 // Initializes a hashmap with 0 buckets. Will be resized upon first insertion
 symbol_hashmap_t* symbol_hashmap_init()
 {
-  symbol_hashmap_t* result = malloc(sizeof(symbol_hashmap_t));
-  *result = (symbol_hashmap_t){.buckets = NULL, .n_buckets = 0, .n_entries = 0, .backup = NULL};
+  symbol_hashmap_t* result = arena_new(&compilation->arena, symbol_hashmap_t);
+  *result = (symbol_hashmap_t){.buckets = NULL, .n_buckets = 0, .n_entries = 0};
   return result;
 }
 
-// Calculates a naive 64-bit hash of the given string
-static uint64_t hash_string(const char* string)
+// Symbol names are atoms (see atom.h), so the address identifies the name.
+// The mixing is invertible, so names never hash to 0.
+static uint64_t hash_name(const char* name)
 {
-  assert(string != NULL);
-  uint64_t hash = 31;
-  for (const char* c = string; *c != '\0'; c++)
-    hash = hash * 257 + *c;
+  assert(name != NULL);
+  uint64_t hash = (uintptr_t)name;
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
   return hash;
 }
 
@@ -76,8 +79,8 @@ static void symbol_hashmap_resize(symbol_hashmap_t* hashmap, size_t new_capacity
   symbol_t** old_buckets = hashmap->buckets;
   size_t old_capacity = hashmap->n_buckets;
 
-  // Use calloc, since it initalizes the memory to 0, aka NULL entries
-  hashmap->buckets = calloc(new_capacity, sizeof(symbol_t*));
+  // Zeroed memory, aka NULL entries
+  hashmap->buckets = arena_calloc(&compilation->arena, new_capacity * sizeof(symbol_t*));
   hashmap->n_buckets = new_capacity;
   hashmap->n_entries = 0;
 
@@ -87,8 +90,6 @@ static void symbol_hashmap_resize(symbol_hashmap_t* hashmap, size_t new_capacity
     if (old_buckets[i] != NULL)
       symbol_hashmap_insert(hashmap, old_buckets[i]);
   }
-
-  free(old_buckets);
 }
 
 // Performs insertion into the hashmap.
@@ -99,20 +100,20 @@ static insert_result_t symbol_hashmap_insert(symbol_hashmap_t* hashmap, symbol_t
   // Make sure that the fill ratio of the hashmap never exeeds 1/2
   size_t new_size = hashmap->n_entries + 1;
   if (new_size * 2 > hashmap->n_buckets)
-    symbol_hashmap_resize(hashmap, hashmap->n_buckets * 2 + 8);
+    symbol_hashmap_resize(hashmap, hashmap->n_buckets ? hashmap->n_buckets * 2 : 16);
 
   // Now calculate the position of the new entry
-  uint64_t hash = hash_string(symbol->name);
-  size_t bucket = hash % hashmap->n_buckets;
+  uint64_t hash = hash_name(symbol->name);
+  size_t bucket = hash & (hashmap->n_buckets - 1);
 
   // Iterate until we find an empty bucket
   while (hashmap->buckets[bucket] != NULL)
   {
     // Check if the existing entry is a name collision
-    if (strcmp(hashmap->buckets[bucket]->name, symbol->name) == 0)
+    if (hashmap->buckets[bucket]->name == symbol->name)
       return INSERT_COLLISION; // An entry with the same name already exists
     // Go to the next bucket
-    bucket = (bucket + 1) % hashmap->n_buckets;
+    bucket = (bucket + 1) & (hashmap->n_buckets - 1);
   }
 
   // We found an emoty bucket, insert the symbol here
@@ -126,44 +127,125 @@ static insert_result_t symbol_hashmap_insert(symbol_hashmap_t* hashmap, symbol_t
 // Since the hashmap uses open addressing, the entry can also be in the next bucket,
 // so we iterate until we either find the item, or find an empty bucket.
 //
-// If the key isn't found in this hashmap, but we have a backup, lookup continues there.
-// Otherwise, NULL is returned.
+// If the key isn't found, NULL is returned.
 symbol_t* symbol_hashmap_lookup(symbol_hashmap_t* hashmap, const char* name)
 {
-  uint64_t hash = hash_string(name);
+  // Skip any hashmaps with 0 buckets
+  if (hashmap->n_buckets == 0)
+    return NULL;
 
-  // Loop through the linked list of hashmaps and backup hashmaps
-  while (hashmap != NULL)
+  size_t bucket = hash_name(name) & (hashmap->n_buckets - 1);
+  while (hashmap->buckets[bucket] != NULL)
   {
-    // Skip any hashmaps with 0 buckets
-    if (hashmap->n_buckets == 0)
-    {
-      hashmap = hashmap->backup;
-      continue;
-    }
-
-    size_t bucket = hash % hashmap->n_buckets;
-    while (hashmap->buckets[bucket] != NULL)
-    {
-      // Check if the entry in the bucket has a matching name
-      if (strcmp(hashmap->buckets[bucket]->name, name) == 0)
-        return hashmap->buckets[bucket];
-
-      // Otherwise keep iterating until we find a hit, or an empty bucket
-      bucket = (bucket + 1) % hashmap->n_buckets;
-    }
-
-    // No entry with the required name existed in the hashmap, so go to the backup
-    hashmap = hashmap->backup;
+    // Check if the entry in the bucket has a matching name
+    if (hashmap->buckets[bucket]->name == name)
+      return hashmap->buckets[bucket];
+
+    // Otherwise keep iterating until we find a hit, or an empty bucket
+    bucket = (bucket + 1) & (hashmap->n_buckets - 1);
   }
 
-  // The entry was never found, and we are all out of backups
+  // The entry was never found
   return NULL;
 }
 
-void symbol_hashmap_destroy(symbol_hashmap_t* hashmap)
+// ================== Scope table code ==================
+
+// The slot the name has, or the empty slot where it would go
+static scope_slot_t* scope_table_find(scope_table_t* scopes, const char* name, uint64_t hash)
+{
+  size_t slot = hash & scopes->mask;
+  while (scopes->slots[slot].hash != 0)
+  {
+    if (scopes->slots[slot].name == name)
+      break;
+    slot = (slot + 1) & scopes->mask;
+  }
+  return &scopes->slots[slot];
+}
+
+// Moves every used slot into a table twice the size, the stored hashes save rehashing
+static void scope_table_grow(scope_table_t* scopes)
+{
+  scope_slot_t* old_slots = scopes->slots;
+  size_t old_capacity = old_slots ? scopes->mask + 1 : 0;
+  size_t new_capacity = old_capacity ? old_capacity * 2 : 64;
+
+  scopes->slots = calloc(new_capacity, sizeof(scope_slot_t));
+  scopes->mask = new_capacity - 1;
+  for (size_t i = 0; i < old_capacity; i++)
+  {
+    if (old_slots[i].hash != 0)
+      *scope_table_find(scopes, old_slots[i].name, old_slots[i].hash) = old_slots[i];
+  }
+  free(old_slots);
+}
+
+void scope_table_enter(scope_table_t* scopes)
 {
-  free(hashmap->buckets);
-  free(hashmap);
+  da_append(scopes->marks, da_size(scopes->undo));
 }
 
+void scope_table_leave(scope_table_t* scopes)
+{
+  assert(da_size(scopes->marks) > 0 && "Leaving the outermost scope");
+  size_t mark = da_pop(scopes->marks);
+
+  // Undo the inserts of the scope, newest first
+  while (da_size(scopes->undo) > mark)
+  {
+    scope_undo_t undo = da_pop(scopes->undo);
+    scope_slot_t* slot = scope_table_find(scopes, undo.name, hash_name(undo.name));
+    slot->symbol = undo.symbol;
+    slot->depth = undo.depth;
+  }
+}
+
+insert_result_t scope_table_insert(scope_table_t* scopes, symbol_t* symbol)
+{
+  // Keep the fill ratio at most 1/2
+  if (scopes->slots == NULL || (scopes->n_slots_used + 1) * 2 > scopes->mask + 1)
+    scope_table_grow(scopes);
+
+  uint64_t hash = hash_name(symbol->name);
+  size_t depth = da_size(scopes->marks);
+  scope_slot_t* slot = scope_table_find(scopes, symbol->name, hash);
+  if (slot->hash == 0)
+  {
+    *slot = (scope_slot_t){.hash = hash, .name = symbol->name};
+    scopes->n_slots_used++;
+  }
+  else if (slot->symbol != NULL && slot->depth == depth)
+  {
+    return INSERT_COLLISION;
+  }
+
+  da_append(scopes->undo, ((scope_undo_t){.name = symbol->name, .symbol = slot->symbol, .depth = slot->depth}));
+  slot->symbol = symbol;
+  slot->depth = depth;
+  return INSERT_OK;
+}
+
+symbol_t* scope_table_lookup(scope_table_t* scopes, const char* name)
+{
+  if (scopes->slots == NULL)
+    return NULL;
+  return scope_table_find(scopes, name, hash_name(name))->symbol;
+}
+
+void scope_table_clear(scope_table_t* scopes)
+{
+  if (scopes->slots != NULL)
+    memset(scopes->slots, 0, (scopes->mask + 1) * sizeof(scope_slot_t));
+  scopes->n_slots_used = 0;
+  da_clear(scopes->undo);
+  da_clear(scopes->marks);
+}
+
+void scope_table_release(scope_table_t* scopes)
+{
+  free(scopes->slots);
+  da_deinit(scopes->undo);
+  da_deinit(scopes->marks);
+  *scopes = (scope_table_t){0};
+}
@@ -2,6 +2,7 @@
 #define SYMBOL_TABLE_H
 
 #include <stddef.h>
+#include <stdint.h>
 
 #include "langc.h"
 #include "symbol.h"
@@ -10,20 +11,20 @@
 
 // We use hashmaps to make lookups quick.
 // The entries are symbols, using the name of the symbol as the key.
+// Names must be atoms (see atom.h), they are compared by address.
 // The hashmap logic is already implemented in symbol_table.c
 // NOTE that this hashmap does not support removing entries.
 typedef struct symbol_hashmap
 {
   symbol_t** buckets; // A bucket may contain 0 or 1 entries
-  size_t n_buckets;
+  size_t n_buckets;   // 0 or a power of two
   size_t n_entries;
-
-  // If a key is not found, the lookup function will consult this as a backup
-  struct symbol_hashmap* backup;
 } symbol_hashmap_t;
 
 // A dynamically sized list of symbols, including a hashmap for fast lookups
 // The logic for the symbol table is already implemented in symbol_table.c
+// Tables, hashmaps and symbols live in the arena of the compilation (see
+// compilation.h) and are released with it, there is no per-table destroy.
 struct symbol_table_t
 {
   symbol_t** symbols;
@@ -42,25 +43,72 @@ typedef enum
 symbol_table_t* symbol_table_init(void);
 
 // Tries to insert the given symbol into the symbol table.
-// If the topmost hashmap already contains a symbol with the same name,
+// If the hashmap already contains a symbol with the same name,
 // INSERT_COLLISION is returned, otherwise the result is INSERT_OK.
 //
-// The symbol table takes ownership of the symbol, and assigns it a sequence number.
+// The symbol table assigns the symbol a sequence number.
 // DO NOT change the symbol's name after insertion.
 insert_result_t symbol_table_insert(symbol_table_t* table, symbol_t* symbol);
 
-// Destroys the given symbol table, its hashmap, and all the symbols it owns
-void symbol_table_destroy(symbol_table_t* table);
-
 // Initalizes a new, empty hashmap
 symbol_hashmap_t* symbol_hashmap_init(void);
 
-// Looks for a symbol in the symbol hashmap, matching the given name.
-// If no symbol is found, the hashmap's backup hashmap is checked.
-// If the name can't be found in the backup chain either, NULL is returned.
+// Adds the symbol to the list of the table only, not to its hashmap.
+// For symbols whose visibility is tracked by a scope table, see below.
+void symbol_table_append(symbol_table_t* table, symbol_t* symbol);
+
+// Looks for a symbol in the symbol hashmap, matching the given name (an atom).
+// If no symbol is found, NULL is returned.
 symbol_t* symbol_hashmap_lookup(symbol_hashmap_t* hashmap, const char* name);
 
-// Frees the memory used by the hashmap
-void symbol_hashmap_destroy(symbol_hashmap_t* hashmap);
+// The names visible inside the function being bound, in one flat table.
+// Each name maps to its innermost visible symbol. Every insert logs the
+// binding it replaces, entering a block remembers how long the log is and
+// leaving the block undoes the inserts made since.
+//
+// A name keeps its slot once it has one, leaving the scope it was bound in
+// only clears the symbol. So there is nothing to delete and probing never
+// needs tombstones.
+typedef struct
+{
+  uint64_t hash;     // 0 marks an empty slot
+  const char* name;
+  symbol_t* symbol;  // NULL while the name is not bound
+  size_t depth;      // scope depth the symbol was bound at
+} scope_slot_t;
+
+typedef struct
+{
+  const char* name;
+  symbol_t* symbol;  // the binding before the insert
+  size_t depth;
+} scope_undo_t;
+
+typedef struct
+{
+  scope_slot_t* slots; // mask + 1 many, a power of two
+  size_t mask;
+  size_t n_slots_used;
+  scope_undo_t* undo;  // da
+  size_t* marks;       // da, length of undo when each open scope was entered
+} scope_table_t;
+
+// Opens a nested scope, the outermost scope is depth 0 and always open
+void scope_table_enter(scope_table_t* scopes);
+
+// Closes the innermost scope, its names go back to what they were bound to before
+void scope_table_leave(scope_table_t* scopes);
+
+// Binds the symbol's name in the innermost scope. If that scope already binds
+// the name, INSERT_COLLISION is returned, otherwise the result is INSERT_OK.
+insert_result_t scope_table_insert(scope_table_t* scopes, symbol_t* symbol);
+
+// The innermost symbol for the name (an atom), or NULL
+symbol_t* scope_table_lookup(scope_table_t* scopes, const char* name);
+
+// Unbinds every name and closes every scope, keeping the memory
+void scope_table_clear(scope_table_t* scopes);
+
+void scope_table_release(scope_table_t* scopes);
 
 #endif // SYMBOL_TABLE_H
@@ -3,7 +3,9 @@
 #include <assert.h>
 
 #include "tac.h"
+#include "compilation.h"
 #include "da.h"
+#include "da_sort.h"
 #include "fail.h"
 #include "langc.h"
 #include "symbol.h"
@@ -11,9 +13,6 @@
 #include "tree.h"
 #include "type.h"
 
-function_code_t* function_codes = 0;
-addr_t* addr_list = 0;
-
 static char* TAC_INSTRUCTION_NAMES[] = {
     "NOP",
     "RETURN", 
@@ -46,17 +45,16 @@ static char* TAC_INSTRUCTION_NAMES[] = {
 };
 
 static function_code_t generate_function_code(symbol_t* function_symbol);
-static void generate_param_decls(tac_t** list, node_t* function_node);
-static void generate_node_code(tac_t** list, node_t* node);
+static void generate_param_decls(tac_t** list, node_id_t function_node);
+static void generate_node_code(tac_t** list, node_id_t node);
 // returns addr where return value is stored
-static size_t generate_valued_code(tac_t** list, node_t* node);
-static void generate_function_call_setup(tac_t**, node_t*, size_t*, size_t*);
+static size_t generate_valued_code(tac_t** list, node_id_t node);
+static void generate_function_call_setup(tac_t**, node_id_t, size_t*, size_t*);
 static void generate_cast_expr(tac_t** list, type_info_t* info_src, size_t addr_src, type_info_t* info_dst, size_t addr_dst);
-static size_t generate_indexing(tac_t**, node_t*);
-static size_t generate_or_or_and(tac_t**, node_t*);
-static void get_struct_addr_offset(node_t*, size_t*, size_t*);
+static size_t generate_indexing(tac_t**, node_id_t);
+static size_t generate_or_or_and(tac_t**, node_id_t);
+static void get_struct_addr_offset(node_id_t, size_t*, size_t*);
 
-static size_t TAC_NEXT_LABEL = 0;
 static size_t tac_emit(tac_t**, instruction_t, size_t, size_t, size_t);
 
 static size_t new_temp(basic_type_t);
@@ -72,12 +70,14 @@ static size_t new_arg_list();
 static instruction_t instr_from_node_operator(operator_t);
 static size_t get_symbol_addr(symbol_t* symbol);
 
-void generate_function_codes() {
+void generate_function_codes(compilation_t* c) {
+    compilation = c;
+
     // addr 0: UNUSED
-    da_append(addr_list, (addr_t){.type = ADDR_UNUSED});
+    da_append(compilation->addr_list, (addr_t){.type = ADDR_UNUSED});
 
-    for (size_t i = 0; i < global_symbol_table->n_symbols; ++i) {
-        symbol_t* function_symbol = global_symbol_table->symbols[i];
+    for (size_t i = 0; i < compilation->global_symbol_table->n_symbols; ++i) {
+        symbol_t* function_symbol = compilation->global_symbol_table->symbols[i];
         if (function_symbol->type != SYMBOL_FUNCTION) continue;
 
         if (function_symbol->is_builtin) {
@@ -85,7 +85,7 @@ void generate_function_codes() {
             continue;
         }
 
-        da_append(function_codes, generate_function_code(function_symbol));
+        da_append(compilation->function_codes, generate_function_code(function_symbol));
     }
 }
 
@@ -97,58 +97,55 @@ static function_code_t generate_function_code(symbol_t* function_symbol) {
     ret.tac_list = 0;
     // child idx 2 is BLOCK
     // Register all symbols in this functions symbol table as addrs,
-    // that is, put them in the global addr_list
+    // that is, put them in the addr_list of the compilation
     for (size_t i = 0; i < function_symbol->function_symtable->n_symbols; ++i) {
         symbol_t* local_symbol = function_symbol->function_symtable->symbols[i];
         get_symbol_addr(local_symbol);
     }
     generate_param_decls(&ret.tac_list, function_symbol->node);
-    generate_node_code(&ret.tac_list, function_symbol->node->children[2]);
+    generate_node_code(&ret.tac_list, node_child(function_symbol->node, 2));
     return ret;
 }
 
 // generate DECLARARE_PARAM instructions,
 // which are essentially no-ops that will assist in gode gen
-static void generate_param_decls(tac_t** list, node_t* function_node) {
-    node_t* decl_list = function_node->children[1]->children[0];
-    assert(decl_list->type == DECLARATION_LIST);
-
-    for (size_t i = 0; i < da_size(decl_list->children); ++i) {
-        node_t* identifier = decl_list->children[i]->children[0];
-        assert(identifier->type == IDENTIFIER);
-        size_t addr = get_symbol_addr(identifier->symbol);
+static void generate_param_decls(tac_t** list, node_id_t function_node) {
+    node_id_t decl_list = node_child(node_child(function_node, 1), 0);
+    assert(NODE(decl_list).type == DECLARATION_LIST);
+
+    for (size_t i = 0; i < node_n_children(decl_list); ++i) {
+        node_id_t identifier = node_child(node_child(decl_list, i), 0);
+        assert(NODE(identifier).type == IDENTIFIER);
+        size_t addr = get_symbol_addr(node_symbol(identifier));
         tac_emit(list, TAC_DECLARE_PARAM, addr, 0, 0);
     }
 }
 
-static void generate_function_call_setup(tac_t** list, node_t* node, size_t* addr_function, size_t* addr_arg_list) {
-    symbol_t* function_symbol = node->children[0]->symbol;
+static void generate_function_call_setup(tac_t** list, node_id_t node, size_t* addr_function, size_t* addr_arg_list) {
+    symbol_t* function_symbol = node_symbol(node_child(node, 0));
     *addr_function = get_symbol_addr(function_symbol);
     *addr_arg_list = new_arg_list();
 
-    for (size_t i = 0; i < da_size(node->children[1]->children); ++i) {
-        size_t arg_addr = generate_valued_code(list, node->children[1]->children[i]);
-        da_append(addr_list[*addr_arg_list].data.arg_addr_list, arg_addr);
+    for (size_t i = 0; i < node_n_children(node_child(node, 1)); ++i) {
+        size_t arg_addr = generate_valued_code(list, node_child(node_child(node, 1), i));
+        da_append(compilation->addr_list[*addr_arg_list].data.arg_addr_list, arg_addr);
     }
 }
 
-static size_t* break_statement_idxs = 0;
-static size_t* continue_statement_idxs = 0;
-
-static void generate_node_code(tac_t** list, node_t* node) {
-    switch (node->type) {
+static void generate_node_code(tac_t** list, node_id_t node) {
+    switch (NODE(node).type) {
         case BLOCK:
             {
-                for (size_t i = 0; i < da_size(node->children); ++i) {
-                    generate_node_code(list, node->children[i]);
+                for (size_t i = 0; i < node_n_children(node); ++i) {
+                    generate_node_code(list, node_child(node, i));
                 }
             }
             break;
         case RETURN_STATEMENT:
             {
                 size_t ret_addr = 0;
-                if (da_size(node->children) == 1) {
-                    ret_addr = generate_valued_code(list, node->children[0]);
+                if (node_n_children(node) == 1) {
+                    ret_addr = generate_valued_code(list, node_child(node, 0));
                 }
                 tac_emit(list, TAC_RETURN, ret_addr, 0, 0);
             }
@@ -163,192 +160,192 @@ static void generate_node_code(tac_t** list, node_t* node) {
         case DECLARATION:
             {
                 // Does nothing at this point
-                node_t* rhs;
-                if (da_size(node->children) <= 2) {
-                    if (node->children[1]->type == TYPE)
+                node_id_t rhs;
+                if (node_n_children(node) <= 2) {
+                    if (NODE(node_child(node, 1)).type == TYPE)
                         return;
-                    rhs = node->children[1];
+                    rhs = node_child(node, 1);
                 } else {
-                    rhs = node->children[2];
+                    rhs = node_child(node, 2);
                 }
 
                 size_t assigned_addr = generate_valued_code(list, rhs);
-                assert(node->children[0]->type == IDENTIFIER);
-                tac_emit(list, TAC_COPY, assigned_addr, 0, get_symbol_addr(node->children[0]->symbol));
+                assert(NODE(node_child(node, 0)).type == IDENTIFIER);
+                tac_emit(list, TAC_COPY, assigned_addr, 0, get_symbol_addr(node_symbol(node_child(node, 0))));
             }
             break;
         case ASSIGNMENT_STATEMENT:
             {
-                if (node->children[0]->type == IDENTIFIER) {
-                    if (node->children[0]->type_info->type_class == TC_BASIC
-                      || node->children[0]->type_info->type_class == TC_POINTER) {
-                        size_t dst_addr = get_symbol_addr(node->children[0]->symbol);
-                        size_t src_addr = generate_valued_code(list, node->children[1]);
+                if (NODE(node_child(node, 0)).type == IDENTIFIER) {
+                    if (node_type_info(node_child(node, 0))->type_class == TC_BASIC
+                      || node_type_info(node_child(node, 0))->type_class == TC_POINTER) {
+                        size_t dst_addr = get_symbol_addr(node_symbol(node_child(node, 0)));
+                        size_t src_addr = generate_valued_code(list, node_child(node, 1));
                         tac_emit(list, TAC_COPY, src_addr, 0, dst_addr);
                     } else {
-                        fail_node(node->children[0], "Not something we can assign to. Type is too complex :(");
+                        fail_node(node_child(node, 0), "Not something we can assign to. Type is too complex :(");
                     }
-                } else if (node->children[0]->type == ARRAY_INDEXING) {
-                    size_t src_addr = generate_valued_code(list, node->children[1]);
+                } else if (NODE(node_child(node, 0)).type == ARRAY_INDEXING) {
+                    size_t src_addr = generate_valued_code(list, node_child(node, 1));
 
-                    node_t* indexing_node = node->children[0];
-                    node_t* identifier = indexing_node->children[0];
-                    size_t arr_addr = get_symbol_addr(identifier->symbol);
-                    if (identifier->type_info->type_class != TC_ARRAY) {
+                    node_id_t indexing_node = node_child(node, 0);
+                    node_id_t identifier = node_child(indexing_node, 0);
+                    size_t arr_addr = get_symbol_addr(node_symbol(identifier));
+                    if (node_type_info(identifier)->type_class != TC_ARRAY) {
                         fprintf(stderr, "generate_node_code: Invalid type class for array indexing\n");
                         exit(EXIT_FAILURE);
                     }
-                    assert(identifier->type_info->info.info_array->subtype->type_class == TC_BASIC);
-                    basic_type_t array_type = identifier->type_info->info.info_array->subtype->info.info_basic;
+                    assert(node_type_info(identifier)->info.info_array->subtype->type_class == TC_BASIC);
+                    basic_type_t array_type = node_type_info(identifier)->info.info_array->subtype->info.info_basic;
                     size_t loc_addr = new_temp(TYPE_SIZE);
                     size_t index_addr = generate_indexing(list, indexing_node);
                     tac_emit(list, TAC_LOCOF, arr_addr, 0, loc_addr);
                     tac_emit(list, TAC_STORE, src_addr, loc_addr, index_addr);
-                } else if (node->children[0]->type == OPERATOR) {
+                } else if (NODE(node_child(node, 0)).type == OPERATOR) {
 
-                    if (node->children[0]->data.operator != UNARY_DEREF) {
+                    if (NODE(node_child(node, 0)).data.operator != UNARY_DEREF) {
                         fail_node(node, "I cannot have this on LHS (yet?)");
                     }
 
                     // child 0: operator deref
                     // it should take its child
-                    size_t inside = generate_valued_code(list, node->children[0]->children[0]);
+                    size_t inside = generate_valued_code(list, node_child(node_child(node, 0), 0));
 
-                    size_t src_addr = generate_valued_code(list, node->children[1]);
+                    size_t src_addr = generate_valued_code(list, node_child(node, 1));
 
                     tac_emit(list, TAC_STORE, src_addr, inside, new_size_const(0));
-                } else if (node->children[0]->type == DOT_ACCESS) {
+                } else if (NODE(node_child(node, 0)).type == DOT_ACCESS) {
                     size_t struct_addr = 0;
                     size_t offset = 0;
-                    get_struct_addr_offset(node->children[0], &struct_addr, &offset);
+                    get_struct_addr_offset(node_child(node, 0), &struct_addr, &offset);
 
-                    size_t src_addr = generate_valued_code(list, node->children[1]);
+                    size_t src_addr = generate_valued_code(list, node_child(node, 1));
 
                     size_t ptr_addr = new_temp(TYPE_SIZE);
 
                     tac_emit(list, TAC_LOCOF, struct_addr, 0, ptr_addr);
                     tac_emit(list, TAC_STORE, src_addr, ptr_addr, new_size_const(offset));
                 } else {
-                    fprintf(stderr, "generate_node_code: Unhandled assignment LHS type %s\n", NODE_TYPE_NAMES[node->children[0]->type]);
+                    fprintf(stderr, "generate_node_code: Unhandled assignment LHS type %s\n", NODE_TYPE_NAMES[NODE(node_child(node, 0)).type]);
                     exit(EXIT_FAILURE);
                 }
             }
             break;
         case IF_STATEMENT:
             {
-                size_t cond_addr = generate_valued_code(list, node->children[0]);
+                size_t cond_addr = generate_valued_code(list, node_child(node, 0));
                 size_t if_jmp_idx = tac_emit(list, TAC_IF_FALSE, cond_addr, 0, new_label_ref(0));
                 // 'true' block
-                generate_node_code(list, node->children[1]);
+                generate_node_code(list, node_child(node, 1));
 
-                if (da_size(node->children) == 3) {
+                if (node_n_children(node) == 3) {
                     size_t goto_idx = tac_emit(list, TAC_GOTO, 0, 0, new_label_ref(0));
 
                     // backpatch dst label of if statement
-                    addr_list[(*list)[if_jmp_idx].dst].data.label = TAC_NEXT_LABEL;
-                    generate_node_code(list, node->children[2]);
+                    compilation->addr_list[(*list)[if_jmp_idx].dst].data.label = compilation->next_label;
+                    generate_node_code(list, node_child(node, 2));
 
                     // backpatch dst label of jmp after if
-                    addr_list[(*list)[goto_idx].dst].data.label = TAC_NEXT_LABEL;
+                    compilation->addr_list[(*list)[goto_idx].dst].data.label = compilation->next_label;
                 } else {
                     // backpatch dst label of if statement
-                    addr_list[(*list)[if_jmp_idx].dst].data.label = TAC_NEXT_LABEL;
+                    compilation->addr_list[(*list)[if_jmp_idx].dst].data.label = compilation->next_label;
                 }
                 tac_emit(list, TAC_NOP, 0, 0, 0);
             }
             break;
         case WHILE_STATEMENT:
             {
-                size_t header_start_label = TAC_NEXT_LABEL;
-                size_t cond_addr = generate_valued_code(list, node->children[0]);
+                size_t header_start_label = compilation->next_label;
+                size_t cond_addr = generate_valued_code(list, node_child(node, 0));
                 size_t if_jmp_idx = tac_emit(list, TAC_IF_FALSE, cond_addr, 0, new_label_ref(0));
 
-                size_t curr_break_statement_size = da_size(break_statement_idxs);
-                size_t curr_continue_statement_size = da_size(continue_statement_idxs);
+                size_t curr_break_statement_size = da_size(compilation->break_statement_idxs);
+                size_t curr_continue_statement_size = da_size(compilation->continue_statement_idxs);
 
                 // body
-                generate_node_code(list, node->children[1]);
+                generate_node_code(list, node_child(node, 1));
                 // loop back to head
                 tac_emit(list, TAC_GOTO, 0, 0, new_label_ref(header_start_label));
 
                 size_t loop_end_idx = tac_emit(list, TAC_NOP, 0, 0, 0);
                 size_t loop_end_label = (*list)[loop_end_idx].label;
                 // backpatch iffalse jump
-                addr_list[(*list)[if_jmp_idx].dst].data.label = loop_end_label;
+                compilation->addr_list[(*list)[if_jmp_idx].dst].data.label = loop_end_label;
 
                 // backpatch break statements
-                while (da_size(break_statement_idxs) > curr_break_statement_size) {
-                    size_t break_stmt = da_pop(break_statement_idxs);
-                    addr_list[(*list)[break_stmt].dst].data.label = loop_end_label;
+                while (da_size(compilation->break_statement_idxs) > curr_break_statement_size) {
+                    size_t break_stmt = da_pop(compilation->break_statement_idxs);
+                    compilation->addr_list[(*list)[break_stmt].dst].data.label = loop_end_label;
                 }
 
-                while (da_size(continue_statement_idxs) > curr_continue_statement_size) {
-                    size_t cont_stmt = da_pop(continue_statement_idxs);
-                    addr_list[(*list)[cont_stmt].dst].data.label = header_start_label;
+                while (da_size(compilation->continue_statement_idxs) > curr_continue_statement_size) {
+                    size_t cont_stmt = da_pop(compilation->continue_statement_idxs);
+                    compilation->addr_list[(*list)[cont_stmt].dst].data.label = header_start_label;
                 }
             }
             break;
         case BREAK_STATEMENT:
             {
                 size_t idx = tac_emit(list, TAC_GOTO, 0, 0, new_label_ref(0));
-                da_append(break_statement_idxs, idx);
+                da_append(compilation->break_statement_idxs, idx);
             }
             break;
         case CONTINUE_STATEMENT:
             {
                 size_t idx = tac_emit(list, TAC_GOTO, 0, 0, new_label_ref(0));
-                da_append(continue_statement_idxs, idx);
+                da_append(compilation->continue_statement_idxs, idx);
             }
             break;
         default:
-            fprintf(stderr, "generate_node_code: Unhandled node type: %s\n", NODE_TYPE_NAMES[node->type]);
+            fprintf(stderr, "generate_node_code: Unhandled node type: %s\n", NODE_TYPE_NAMES[NODE(node).type]);
             exit(EXIT_FAILURE);
     }
 }
 
-static size_t generate_valued_code(tac_t** list, node_t* node) {
-    switch (node->type) {
+static size_t generate_valued_code(tac_t** list, node_id_t node) {
+    switch (NODE(node).type) {
         case IDENTIFIER:
             {
-                return get_symbol_addr(node->symbol);
+                return get_symbol_addr(node_symbol(node));
             }
             break;
         case INTEGER_LITERAL:
             {
-                return new_int_const(node->data.int_literal_value);
+                return new_int_const(NODE(node).data.int_literal_value);
             }
             break;
         case REAL_LITERAL:
             {
-                return new_real_const(node->data.real_literal_value);
+                return new_real_const(NODE(node).data.real_literal_value);
             }
             break;
         case STRING_LITERAL:
             {
-                return new_string_idx_const(node->data.string_literal_idx);
+                return new_string_idx_const(NODE(node).data.string_literal_idx);
             }
             break;
         case BOOL_LITERAL:
             {
-                return new_bool_const(node->data.bool_literal_value);
+                return new_bool_const(NODE(node).data.bool_literal_value);
             }
             break;
         case CHAR_LITERAL:
             {
-                return new_char_const(node->data.char_literal_value);
+                return new_char_const(NODE(node).data.char_literal_value);
             }
             break;;
         case CAST_EXPRESSION:
             {
-                size_t to_cast_addr = generate_valued_code(list, node->children[1]);
-                assert(node->children[0]->type_info->type_class == TC_BASIC 
-                    || node->children[0]->type_info->type_class == TC_POINTER);
-                size_t result_addr = new_temp(node->children[0]->type_info->info.info_basic);
+                size_t to_cast_addr = generate_valued_code(list, node_child(node, 1));
+                assert(node_type_info(node_child(node, 0))->type_class == TC_BASIC 
+                    || node_type_info(node_child(node, 0))->type_class == TC_POINTER);
+                size_t result_addr = new_temp(node_type_info(node_child(node, 0))->info.info_basic);
                 generate_cast_expr(
                     list, 
-                    node->children[1]->type_info, 
+                    node_type_info(node_child(node, 1)), 
                     to_cast_addr, 
-                    node->children[0]->type_info,
+                    node_type_info(node_child(node, 0)),
                     result_addr);
                 return result_addr;
             }
@@ -358,17 +355,17 @@ static size_t generate_valued_code(tac_t** list, node_t* node) {
                 size_t addr_function, addr_arg_list;
                 generate_function_call_setup(list, node, &addr_function, &addr_arg_list);
 
-                if (node->type_info->type_class == TC_BASIC && node->type_info->info.info_basic == TYPE_VOID) {
+                if (node_type_info(node)->type_class == TC_BASIC && node_type_info(node)->info.info_basic == TYPE_VOID) {
                     // Don't really know if this actually can happen
-                    fail_node(node, "Expected %s to return a value, but return type is void\n", node->children[0]->symbol->name);
+                    fail_node(node, "Expected %s to return a value, but return type is void\n", node_symbol(node_child(node, 0))->name);
                     exit(EXIT_FAILURE);
                 }
 
-                if (node->type_info->type_class == TC_BASIC) {
-                    size_t ret_addr = new_temp(node->type_info->info.info_basic);
+                if (node_type_info(node)->type_class == TC_BASIC) {
+                    size_t ret_addr = new_temp(node_type_info(node)->info.info_basic);
                     tac_emit(list, TAC_CALL, addr_function, addr_arg_list, ret_addr);
                     return ret_addr;
-                } else if (node->type_info->type_class == TC_POINTER) {
+                } else if (node_type_info(node)->type_class == TC_POINTER) {
                     size_t ret_addr = new_temp(TYPE_SIZE);
                     tac_emit(list, TAC_CALL, addr_function, addr_arg_list, ret_addr);
                     return ret_addr;
@@ -379,15 +376,15 @@ static size_t generate_valued_code(tac_t** list, node_t* node) {
             break;
         case OPERATOR:
             {
-                if (da_size(node->children) == 1) {
+                if (node_n_children(node) == 1) {
                     // Unary
-                    size_t src1_addr = generate_valued_code(list, node->children[0]);
+                    size_t src1_addr = generate_valued_code(list, node_child(node, 0));
 
                     basic_type_t dst_type;
 
-                    if (node->type_info->type_class == TC_BASIC) {
-                        dst_type = node->type_info->info.info_basic;
-                    } else if (node->type_info->type_class == TC_POINTER) {
+                    if (node_type_info(node)->type_class == TC_BASIC) {
+                        dst_type = node_type_info(node)->info.info_basic;
+                    } else if (node_type_info(node)->type_class == TC_POINTER) {
                         dst_type = TYPE_SIZE;
                     } else {
                         assert(false && "Not implemented");
@@ -395,40 +392,40 @@ static size_t generate_valued_code(tac_t** list, node_t* node) {
 
                     size_t dst_addr = new_temp(dst_type);
 
-                    tac_emit(list, instr_from_node_operator(node->data.operator), src1_addr, 0, dst_addr);
+                    tac_emit(list, instr_from_node_operator(NODE(node).data.operator), src1_addr, 0, dst_addr);
                     return dst_addr;
                 } else {
                     // Binary
 
                     // short circuit operators
-                    if (node->data.operator == BINARY_OR || node->data.operator == BINARY_AND) {
+                    if (NODE(node).data.operator == BINARY_OR || NODE(node).data.operator == BINARY_AND) {
                         size_t dst_addr = generate_or_or_and(list, node);
                         return dst_addr;
                     }
-                    size_t src1_addr = generate_valued_code(list, node->children[0]);
-                    size_t src2_addr = generate_valued_code(list, node->children[1]);
-                    size_t dst_addr = new_temp(node->type_info->info.info_basic);
-                    tac_emit(list, instr_from_node_operator(node->data.operator), src1_addr, src2_addr, dst_addr);
+                    size_t src1_addr = generate_valued_code(list, node_child(node, 0));
+                    size_t src2_addr = generate_valued_code(list, node_child(node, 1));
+                    size_t dst_addr = new_temp(node_type_info(node)->info.info_basic);
+                    tac_emit(list, instr_from_node_operator(NODE(node).data.operator), src1_addr, src2_addr, dst_addr);
                     return dst_addr;
                 }
             }
             break;
         case PARENTHESIZED_EXPRESSION:
             {
-                return generate_valued_code(list, node->children[0]);
+                return generate_valued_code(list, node_child(node, 0));
             }
             break;
         case ARRAY_INDEXING:
             {
-                node_t* identifier = node->children[0];
+                node_id_t identifier = node_child(node, 0);
 
-                size_t arr_addr = get_symbol_addr(identifier->symbol);
-                if (identifier->type_info->type_class != TC_ARRAY) {
+                size_t arr_addr = get_symbol_addr(node_symbol(identifier));
+                if (node_type_info(identifier)->type_class != TC_ARRAY) {
                     fprintf(stderr, "generate_node_code: Invalid type class for array indexing\n");
                     exit(EXIT_FAILURE);
                 }
-                assert(identifier->type_info->info.info_array->subtype->type_class == TC_BASIC);
-                basic_type_t array_type = identifier->type_info->info.info_array->subtype->info.info_basic;
+                assert(node_type_info(identifier)->info.info_array->subtype->type_class == TC_BASIC);
+                basic_type_t array_type = node_type_info(identifier)->info.info_array->subtype->info.info_basic;
 
                 size_t loc_addr = new_temp(TYPE_SIZE);
                 size_t index_addr = generate_indexing(list, node);
@@ -446,9 +443,9 @@ static size_t generate_valued_code(tac_t** list, node_t* node) {
                 size_t struct_addr;
                 size_t offset;
                 get_struct_addr_offset(node, &struct_addr, &offset);
-                node_t* last = node->children[1];
-                assert(last->type_info->type_class == TC_BASIC && "Unhandled result type");
-                size_t dst_addr = new_temp(last->type_info->info.info_basic);
+                node_id_t last = node_child(node, 1);
+                assert(node_type_info(last)->type_class == TC_BASIC && "Unhandled result type");
+                size_t dst_addr = new_temp(node_type_info(last)->info.info_basic);
                 size_t loc_addr = new_temp(TYPE_SIZE);
                 tac_emit(list, TAC_LOCOF, struct_addr, 0, loc_addr);
                 tac_emit(list, TAC_LOAD, loc_addr, new_size_const(offset), dst_addr);
@@ -457,18 +454,18 @@ static size_t generate_valued_code(tac_t** list, node_t* node) {
             break;
         case ALLOC_EXPRESSION:
             {
-                type_info_t* allocate_type = node->children[0]->type_info;
+                type_info_t* allocate_type = node_type_info(node_child(node, 0));
                 size_t allocate_type_size = type_sizeof(allocate_type);
                 size_t type_size_addr = new_size_const(allocate_type_size);
 
                 size_t num_bytes_addr;
 
-                if (da_size(node->children) == 1) {
+                if (node_n_children(node) == 1) {
                     // e.g. allocate(int)
                     num_bytes_addr = type_size_addr;
                 } else {
                     // e.g. allocate(int, 2 + 3)
-                    size_t num_els_addr = generate_valued_code(list, node->children[1]);
+                    size_t num_els_addr = generate_valued_code(list, node_child(node, 1));
                     num_bytes_addr = new_temp(TYPE_SIZE);
                     tac_emit(list, TAC_BINARY_MUL, num_els_addr, type_size_addr, num_bytes_addr);
                 }
@@ -479,33 +476,33 @@ static size_t generate_valued_code(tac_t** list, node_t* node) {
             }
             break;
         default:
-            fprintf(stderr, "generate_valued_code: Unhandled node type: %s\n", NODE_TYPE_NAMES[node->type]);
+            fprintf(stderr, "generate_valued_code: Unhandled node type: %s\n", NODE_TYPE_NAMES[NODE(node).type]);
             exit(EXIT_FAILURE);
     }
 }
 
-symbol_t* foo(node_t* node, size_t* struct_addr, size_t* offset) {
-    if (node->type != DOT_ACCESS) {
-        assert(node->symbol != NULL);
-        *struct_addr = get_symbol_addr(node->symbol);
-        return node->symbol;
+symbol_t* foo(node_id_t node, size_t* struct_addr, size_t* offset) {
+    if (NODE(node).type != DOT_ACCESS) {
+        assert(node_symbol(node) != NULL);
+        *struct_addr = get_symbol_addr(node_symbol(node));
+        return node_symbol(node);
     }
 
-    symbol_t *prev = foo(node->children[0], struct_addr, offset);
+    symbol_t *prev = foo(node_child(node, 0), struct_addr, offset);
 
-    node_t* access_node = node->children[1];
-    assert(access_node->symbol != NULL);
+    node_id_t access_node = node_child(node, 1);
+    assert(node_symbol(access_node) != NULL);
 
-    node_t* definition = access_node->symbol->node;
-    assert(type_penetrate_tagged(prev->node->type_info)->type_class == TC_STRUCT);
-    node_t* field_decl = definition->parent;
-    assert(type_penetrate_tagged(field_decl->type_info)->type_class == TC_STRUCT_FIELD);
-    *offset += type_penetrate_tagged(field_decl->type_info)->info.info_struct_field->offset;
-    return definition->symbol;
+    node_id_t definition = node_symbol(access_node)->node;
+    assert(type_penetrate_tagged(node_type_info(prev->node))->type_class == TC_STRUCT);
+    node_id_t field_decl = node_parent(definition);
+    assert(type_penetrate_tagged(node_type_info(field_decl))->type_class == TC_STRUCT_FIELD);
+    *offset += type_penetrate_tagged(node_type_info(field_decl))->info.info_struct_field->offset;
+    return node_symbol(definition);
 }
 
 // retrieve the offset of the accessed field as well as the addr for the struct variable
-static void get_struct_addr_offset(node_t* dot_access, size_t *struct_addr, size_t *offset) {
+static void get_struct_addr_offset(node_id_t dot_access, size_t *struct_addr, size_t *offset) {
     *offset = 0;
     foo(dot_access, struct_addr, offset);
 }
@@ -513,7 +510,7 @@ static void get_struct_addr_offset(node_t* dot_access, size_t *struct_addr, size
 static size_t tac_emit(tac_t** list, instruction_t instr, size_t src1, size_t src2, size_t dst) {
     size_t insert_idx = da_size(*list);
     tac_t tac = (tac_t){
-        .label = TAC_NEXT_LABEL++,
+        .label = compilation->next_label++,
         .instr = instr,
         .src1  = src1,
         .src2  = src2,
@@ -524,100 +521,99 @@ static size_t tac_emit(tac_t** list, instruction_t instr, size_t src1, size_t sr
 }
 
 static size_t new_temp(basic_type_t type_info) {
-    static size_t tmp_count = 0;
-    size_t idx = da_size(addr_list);
+    size_t idx = da_size(compilation->addr_list);
     addr_t tmp_addr = (addr_t){
         .type = ADDR_TEMP,
         .type_info = type_info,
-        .data.temp_id = tmp_count++
+        .data.temp_id = compilation->next_temp++
     };
-    da_append(addr_list, tmp_addr);
+    da_append(compilation->addr_list, tmp_addr);
     return idx;
 }
 
 static size_t new_int_const(long value) {
-    size_t idx = da_size(addr_list);
+    size_t idx = da_size(compilation->addr_list);
     addr_t addr = (addr_t){
         .type = ADDR_INT_CONST,
         .type_info = TYPE_INT,
         .data.int_const = value
     };
-    da_append(addr_list, addr);
+    da_append(compilation->addr_list, addr);
     return idx;
 }
 
 static size_t new_real_const(double value) {
-    size_t idx = da_size(addr_list);
+    size_t idx = da_size(compilation->addr_list);
     addr_t addr = (addr_t){
         .type = ADDR_REAL_CONST,
         .type_info = TYPE_REAL,
         .data.real_const = value
     };
-    da_append(addr_list, addr);
+    da_append(compilation->addr_list, addr);
     return idx;
 }
 
 static size_t new_string_idx_const(size_t string_idx) {
-    size_t idx = da_size(addr_list);
+    size_t idx = da_size(compilation->addr_list);
     addr_t addr = (addr_t) {
         .type = ADDR_STRING_CONST,
         .type_info = TYPE_STRING,
         .data.string_idx_const = string_idx
     };
-    da_append(addr_list, addr);
+    da_append(compilation->addr_list, addr);
     return idx;
 }
 
 static size_t new_bool_const(bool value) {
-    size_t idx = da_size(addr_list);
+    size_t idx = da_size(compilation->addr_list);
     addr_t addr = (addr_t) {
         .type = ADDR_BOOL_CONST,
         .type_info = TYPE_BOOL,
         .data.bool_const = value
     };
-    da_append(addr_list, addr);
+    da_append(compilation->addr_list, addr);
     return idx;
 }
 
 static size_t new_char_const(char value) {
-    size_t idx = da_size(addr_list);
+    size_t idx = da_size(compilation->addr_list);
     addr_t addr = (addr_t) {
         .type = ADDR_CHAR_CONST,
         .type_info = TYPE_CHAR,
         .data.char_const = value
     };
-    da_append(addr_list, addr);
+    da_append(compilation->addr_list, addr);
     return idx;
 }
 
 static size_t new_size_const(size_t value) {
-    size_t idx = da_size(addr_list);
+    size_t idx = da_size(compilation->addr_list);
     addr_t addr = (addr_t){
         .type = ADDR_SIZE_CONST,
         .type_info = TYPE_SIZE,
         .data.size_const = value
     };
-    da_append(addr_list, addr);
+    da_append(compilation->addr_list, addr);
     return idx;
 }
 
 static size_t new_label_ref(size_t label) {
-    size_t idx = da_size(addr_list);
+    size_t idx = da_size(compilation->addr_list);
     addr_t addr = (addr_t) {
         .type = ADDR_LABEL,
         .data.label = label
     };
-    da_append(addr_list, addr);
+    da_append(compilation->addr_list, addr);
     return idx;
 }
 
 static size_t new_arg_list() {
-    size_t idx = da_size(addr_list);
+    size_t idx = da_size(compilation->addr_list);
     addr_t addr = (addr_t) {
         .type = ADDR_ARG_LIST
     };
     addr.data.arg_addr_list = 0;
-    da_append(addr_list, addr);
+    da_append(compilation->addr_list, addr);
     return idx;
 }
 
@@ -665,24 +661,24 @@ static basic_type_t type_info_to_addr_type(type_info_t *type_info) {
 static size_t get_symbol_addr(symbol_t* symbol) {
     assert(symbol != NULL);
     // TODO: its quadratic...
-    for (size_t i = 0; i < da_size(addr_list); ++i) {
-        addr_t addr = addr_list[i];
+    for (size_t i = 0; i < da_size(compilation->addr_list); ++i) {
+        addr_t addr = compilation->addr_list[i];
         if (addr.type != ADDR_SYMBOL) continue;
         if (addr.data.symbol != symbol) continue;
         return i;
     }
-    size_t idx = da_size(addr_list);
+    size_t idx = da_size(compilation->addr_list);
     addr_t addr = (addr_t) {
         .type = ADDR_SYMBOL,
         .data.symbol = symbol
     };
 
     if (symbol->type != SYMBOL_FUNCTION) {
-        assert(symbol->node != NULL);
-        addr.type_info = type_info_to_addr_type(symbol->node->type_info);
+        assert(symbol->node != 0);
+        addr.type_info = type_info_to_addr_type(node_type_info(symbol->node));
     }
 
-    da_append(addr_list, addr);
+    da_append(compilation->addr_list, addr);
     return idx;
 }
 
@@ -715,21 +711,21 @@ static void generate_cast_expr(tac_t** list, type_info_t* info_src, size_t addr_
     assert(false && "Unhandled cast expr gen");
 }
 
-static size_t generate_indexing(tac_t** list, node_t* array_indexing) {
+static size_t generate_indexing(tac_t** list, node_id_t array_indexing) {
     // int[10, 20, 30] arr
     // idx1 * 20 * 30 + idx2 * 30 + idx3?
     // t1 = idx3
     // t2 = 30
     //
-    type_info_t* type_info = array_indexing->children[0]->type_info;
+    type_info_t* type_info = node_type_info(node_child(array_indexing, 0));
     assert(type_info->type_class == TC_ARRAY);
     type_array_t* array_info = type_info->info.info_array;
-    node_t* indexing_list = array_indexing->children[1];
+    node_id_t indexing_list = node_child(array_indexing, 1);
 
     long mul = 1;
     long prev_idx = -1;
     for (long i = (long)da_size(array_info->dims) - 1; i >= 0; --i) {
-        size_t idx_addr = generate_valued_code(list, indexing_list->children[i]);
+        size_t idx_addr = generate_valued_code(list, node_child(indexing_list, i));
         if (mul > 1) {
             size_t tmp = new_temp(TYPE_INT);
             tac_emit(list, TAC_BINARY_MUL, idx_addr, new_int_const(mul), tmp);
@@ -757,15 +753,15 @@ static size_t generate_indexing(tac_t** list, node_t* array_indexing) {
  * The purpose is to be able to short circuit evaluation 
  * if applicable.
  */
-static size_t generate_or_or_and(tac_t** list, node_t* node) {
-    if (node->data.operator == BINARY_OR) {
+static size_t generate_or_or_and(tac_t** list, node_id_t node) {
+    if (NODE(node).data.operator == BINARY_OR) {
         // A || B
         size_t res_addr = new_temp(TYPE_BOOL);
         tac_emit(list, TAC_COPY, new_bool_const(false), 0, res_addr);
 
         // A
 
-        size_t src1_addr = generate_valued_code(list, node->children[0]);
+        size_t src1_addr = generate_valued_code(list, node_child(node, 0));
 
         // if A is false, evaluate B
         size_t if_a_false_idx = tac_emit(list, TAC_IF_FALSE, src1_addr, 0, new_label_ref(0));
@@ -776,10 +772,10 @@ static size_t generate_or_or_and(tac_t** list, node_t* node) {
         // B evaluation path
 
         // backpatch if_a_false_idx -> next instruction
-        addr_list[(*list)[if_a_false_idx].dst].data.label = TAC_NEXT_LABEL;
+        compilation->addr_list[(*list)[if_a_false_idx].dst].data.label = compilation->next_label;
 
         // evaluate B
-        size_t src2_addr = generate_valued_code(list, node->children[1]);
+        size_t src2_addr = generate_valued_code(list, node_child(node, 1));
 
         // if B is (also) false, skip setting result to true
         size_t if_b_false_idx = tac_emit(list, TAC_IF_FALSE, src2_addr, 0, new_label_ref(0));
@@ -792,25 +788,25 @@ static size_t generate_or_or_and(tac_t** list, node_t* node) {
         size_t end_idx = tac_emit(list, TAC_NOP, 0, 0, 0);
 
         // backpatch goto_idx -> end_if_true (the skipping of B)
-        addr_list[(*list)[goto_idx].dst].data.label = (*list)[end_if_true_idx].label;
+        compilation->addr_list[(*list)[goto_idx].dst].data.label = (*list)[end_if_true_idx].label;
 
         // backpatch if_b_false_idx -> end_idx (the skipping of setting to true)
-        addr_list[(*list)[if_b_false_idx].dst].data.label = (*list)[end_idx].label;
+        compilation->addr_list[(*list)[if_b_false_idx].dst].data.label = (*list)[end_idx].label;
 
         return res_addr;
-    } else if (node->data.operator == BINARY_AND) {
+    } else if (NODE(node).data.operator == BINARY_AND) {
         // A && B
         size_t res_addr = new_temp(TYPE_BOOL);
         tac_emit(list, TAC_COPY, new_bool_const(false), 0, res_addr);
 
         // A
-        size_t src1_addr = generate_valued_code(list, node->children[0]);
+        size_t src1_addr = generate_valued_code(list, node_child(node, 0));
 
         // if A is false, skip evaluation of B
         size_t if_a_false_idx = tac_emit(list, TAC_IF_FALSE, src1_addr, 0, new_label_ref(0));
 
         // B
-        size_t src2_addr = generate_valued_code(list, node->children[1]);
+        size_t src2_addr = generate_valued_code(list, node_child(node, 1));
 
         // if B is false, skip setting to true
         size_t if_b_false_idx = tac_emit(list, TAC_IF_FALSE, src2_addr, 0, new_label_ref(0));
@@ -822,8 +818,8 @@ static size_t generate_or_or_and(tac_t** list, node_t* node) {
         size_t end_idx = tac_emit(list, TAC_NOP, 0, 0, 0);
 
         // backpatch both jumps to go to end
-        addr_list[(*list)[if_a_false_idx].dst].data.label = (*list)[end_idx].label;
-        addr_list[(*list)[if_b_false_idx].dst].data.label = (*list)[end_idx].label;
+        compilation->addr_list[(*list)[if_a_false_idx].dst].data.label = (*list)[end_idx].label;
+        compilation->addr_list[(*list)[if_b_false_idx].dst].data.label = (*list)[end_idx].label;
 
         return res_addr;
     } else {
@@ -831,9 +827,159 @@ static size_t generate_or_or_and(tac_t** list, node_t* node) {
     }
 }
 
+size_t tac_def(tac_t tac) {
+    switch (tac.instr) {
+        case TAC_DECLARE_PARAM:
+            return tac.src1;
+        case TAC_BINARY_ADD:
+        case TAC_BINARY_SUB:
+        case TAC_BINARY_MUL:
+        case TAC_BINARY_DIV:
+        case TAC_BINARY_MOD:
+        case TAC_BINARY_GT:
+        case TAC_BINARY_LT:
+        case TAC_BINARY_GEQ:
+        case TAC_BINARY_LEQ:
+        case TAC_BINARY_EQ:
+        case TAC_BINARY_NEQ:
+        case TAC_UNARY_SUB:
+        case TAC_UNARY_NEG:
+        case TAC_CALL:
+        case TAC_COPY:
+        case TAC_CAST_REAL_INT:
+        case TAC_CAST_INT_CHAR:
+        case TAC_CAST_CHAR_INT:
+        case TAC_LOCOF:
+        case TAC_LOAD:
+        case TAC_ALLOC:
+            return tac.dst;
+        case TAC_NOP:
+        case TAC_RETURN:
+        case TAC_CALL_VOID:
+        case TAC_IF_FALSE:
+        case TAC_GOTO:
+        case TAC_STORE:
+            return 0;
+    }
+    return 0;
+}
+
+void tac_uses(tac_t tac, size_t** uses) {
+    switch (tac.instr) {
+        case TAC_NOP:
+        case TAC_GOTO:
+        case TAC_DECLARE_PARAM:
+            break;
+        case TAC_CALL:
+        case TAC_CALL_VOID:
+            {
+                // src1 is the function
+                addr_t arg_list = compilation->addr_list[tac.src2];
+                da_extend(*uses, arg_list.data.arg_addr_list);
+            }
+            break;
+        case TAC_LOCOF:
+            // Takes the location of src1, its value is not read
+            break;
+        case TAC_STORE:
+            da_append(*uses, tac.dst);
+            // fallthrough
+        default:
+            if (tac.src1 != 0) da_append(*uses, tac.src1);
+            if (tac.src2 != 0) da_append(*uses, tac.src2);
+            break;
+    }
+}
+
+void tac_use_slots(tac_t* tac, size_t*** slots) {
+    switch (tac->instr) {
+        case TAC_NOP:
+        case TAC_GOTO:
+        case TAC_DECLARE_PARAM:
+        case TAC_LOCOF:
+            break;
+        case TAC_CALL:
+        case TAC_CALL_VOID:
+            {
+                size_t* args = compilation->addr_list[tac->src2].data.arg_addr_list;
+                for (size_t i = 0; i < da_size(args); ++i) {
+                    da_append(*slots, &args[i]);
+                }
+            }
+            break;
+        case TAC_STORE:
+            da_append(*slots, &tac->dst);
+            // fallthrough
+        default:
+            if (tac->src1 != 0) da_append(*slots, &tac->src1);
+            if (tac->src2 != 0) da_append(*slots, &tac->src2);
+            break;
+    }
+}
+
+// Scalars whose every access goes through the addr. Arrays, structs and
+// strings are used by location, globals can change in any call.
+static bool is_scalar_var(size_t addr_idx) {
+    addr_t addr = compilation->addr_list[addr_idx];
+    if (addr.type == ADDR_TEMP) {
+        return addr.type_info != TYPE_STRING && addr.type_info != TYPE_VOID;
+    }
+    if (addr.type != ADDR_SYMBOL) return false;
+
+    symbol_t* sym = addr.data.symbol;
+    if (sym->type != SYMBOL_LOCAL_VAR && sym->type != SYMBOL_PARAMETER) return false;
+    type_info_t* type = type_penetrate_tagged(node_type_info(sym->node));
+    if (type->type_class == TC_POINTER) return true;
+    return type->type_class == TC_BASIC && type->info.info_basic != TYPE_STRING && type->info.info_basic != TYPE_VOID;
+}
+
+void tac_scalar_vars(tac_t* tac_list, size_t** vars) {
+    size_t* located = 0; // addrs whose location is taken, they have to stay in memory
+    size_t* uses = 0;
+    for (size_t i = 0; i < da_size(tac_list); ++i) {
+        tac_t tac = tac_list[i];
+        if (tac.instr == TAC_LOCOF) {
+            da_append(located, tac.src1);
+        }
+
+        da_clear(uses);
+        tac_uses(tac, &uses);
+        size_t def = tac_def(tac);
+        if (def != 0) da_append(uses, def);
+        for (size_t u = 0; u < da_size(uses); ++u) {
+            if (is_scalar_var(uses[u])) da_append(*vars, uses[u]);
+        }
+    }
+    da_sort_unique(*vars);
+    da_sort_unique(located);
+
+    // Drop the located ones, both lists are sorted
+    size_t kept = 0;
+    size_t l = 0;
+    for (size_t v = 0; v < da_size(*vars); ++v) {
+        while (l < da_size(located) && located[l] < (*vars)[v]) ++l;
+        if (l < da_size(located) && located[l] == (*vars)[v]) continue;
+        (*vars)[kept++] = (*vars)[v];
+    }
+    if (*vars) da_header(*vars)->size = kept;
+
+    da_deinit(located);
+    da_deinit(uses);
+}
+
+size_t tac_var_index(size_t* vars, size_t addr) {
+    size_t lo = 0, hi = da_size(vars);
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (vars[mid] < addr) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo < da_size(vars) && vars[lo] == addr ? lo : da_size(vars);
+}
+
 void print_tac_addr(size_t addr_idx) {
     //if (addr_idx == 0) return;
-    addr_t addr = addr_list[addr_idx];
+    addr_t addr = compilation->addr_list[addr_idx];
     switch(addr.type) {
         case ADDR_UNUSED:
             {
@@ -862,7 +1008,7 @@ void print_tac_addr(size_t addr_idx) {
             break;
         case ADDR_STRING_CONST:
             {
-                printf("#s%zu [%s]", addr.data.string_idx_const, global_string_list[addr.data.string_idx_const]);
+                printf("#s%zu [%s]", addr.data.string_idx_const, compilation->global_string_list[addr.data.string_idx_const]);
             }
             break;
         case ADDR_BOOL_CONST:
@@ -901,7 +1047,7 @@ void print_tac_addr(size_t addr_idx) {
     //printf(" t: %s", BASIC_TYPE_NAMES[addr.type_info]);
 }
 
-static void print_tac_impl(tac_t tac) {
+void print_tac_instruction(tac_t tac) {
     printf("%s", TAC_INSTRUCTION_NAMES[tac.instr]);
     printf(", ");print_tac_addr(tac.src1);
     printf(", ");print_tac_addr(tac.src2);
@@ -909,23 +1055,24 @@ static void print_tac_impl(tac_t tac) {
     puts("");
 }
 
-void print_tac() {
+void print_tac(compilation_t* c) {
+    compilation = c;
     printf("=== NAMES ===\n");
-    for (size_t i = 0; i < da_size(addr_list); ++i) {
+    for (size_t i = 0; i < da_size(compilation->addr_list); ++i) {
 
-        if (addr_list[i].type_info < 7)
-            printf("%3zu: %s ", i, BASIC_TYPE_NAMES[addr_list[i].type_info]);
+        if (compilation->addr_list[i].type_info < 7)
+            printf("%3zu: %s ", i, BASIC_TYPE_NAMES[compilation->addr_list[i].type_info]);
         else
             printf("%3zu: WTF", i);
         print_tac_addr(i);
         puts("");
     }
-    for (size_t func_idx = 0; func_idx < da_size(function_codes); ++func_idx) {
-        printf("=== FUNCTION %s ===\n", function_codes[func_idx].function_symbol->name);
+    for (size_t func_idx = 0; func_idx < da_size(compilation->function_codes); ++func_idx) {
+        printf("=== FUNCTION %s ===\n", compilation->function_codes[func_idx].function_symbol->name);
 
-        for (size_t i = 0; i < da_size(function_codes[func_idx].tac_list); ++i) {
-            printf("%3zu:  ", function_codes[func_idx].tac_list[i].label);
-            print_tac_impl(function_codes[func_idx].tac_list[i]);
+        for (size_t i = 0; i < da_size(compilation->function_codes[func_idx].tac_list); ++i) {
+            printf("%3zu:  ", compilation->function_codes[func_idx].tac_list[i].label);
+            print_tac_instruction(compilation->function_codes[func_idx].tac_list[i]);
         }
     }
 }
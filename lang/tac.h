@@ -2,6 +2,7 @@
 #define TAC_H
 
 #include "langc.h"
+#include "cfg.h"
 #include "type.h"
 
 #include <stdbool.h>
@@ -80,15 +81,32 @@ struct tac_t {
 struct function_code_t {
     symbol_t* function_symbol;
     tac_t* tac_list;
+    cfg_t cfg;      // see cfg.h
+    size_t frame_size;          // bytes below rbp, filled in by gen.c
+    size_t unshared_frame_size; // the same with every value in its own 8 byte slot, for --stats
+    size_t generated_size;      // instructions before optimize (opt.h), for --stats
 };
 
 // list of all possible addresses
-extern addr_t* addr_list;
-extern function_code_t* function_codes;
+// Fills in the function codes and the addr list of the compilation
+void generate_function_codes(compilation_t* c);
 
-void generate_function_codes();
+// The addr the instruction writes, 0 if it writes none
+size_t tac_def(tac_t tac);
+// Appends the addrs the instruction reads to uses (da), call arguments included
+void tac_uses(tac_t tac, size_t** uses);
+// The same operands in the same order, as pointers to them so they can be replaced
+void tac_use_slots(tac_t* tac, size_t*** slots);
+
+// Appends the sorted addrs of the temps, scalar locals and parameters of
+// tac_list whose location is never taken to vars (da). Every access to
+// them goes through their addr.
+void tac_scalar_vars(tac_t* tac_list, size_t** vars);
+// Index of addr in the sorted vars, da_size(vars) if it is not there
+size_t tac_var_index(size_t* vars, size_t addr);
 
 void print_tac_addr(size_t addr_idx);
-void print_tac();
+void print_tac_instruction(tac_t tac);
+void print_tac(compilation_t* c);
 
 #endif // TAC_H
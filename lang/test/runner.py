@@ -1,7 +1,7 @@
 import json
 import subprocess
 
-def test_file(filename: str, expected_stdout: str, expected_stderr: str):
+def test_file(filename: str, expected_stdout: str, expected_stderr: str, expected_returncode):
     def compare_output(stdout: str, stderr: str):
         if stdout != expected_stdout:
             print(f"Expected: '{expected_stdout}', got '{stdout}'")
@@ -34,6 +34,11 @@ def test_file(filename: str, expected_stdout: str, expected_stderr: str):
         text=True
     )
 
+    # A signal shows as its negated number, -8 for SIGFPE
+    if expected_returncode is not None and result.returncode != expected_returncode:
+        print(f"Expected exit code {expected_returncode}, got {result.returncode}")
+        return False
+
     return compare_output(result.stdout, result.stderr)
 
 tests = json.load(open("./test/tests.json"))
@@ -43,7 +48,8 @@ for test in tests:
     success = test_file(
         fn, 
         test.get("expect-stdout", ""),
-        test.get("expect-stderr", "")
+        test.get("expect-stderr", ""),
+        test.get("expect-returncode")
     )
 
     if success:
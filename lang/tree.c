@@ -1,3 +1,4 @@
+#include "compilation.h"
 #include "da.h"
 #include "lex.h"
 #include "symbol.h"
@@ -6,8 +7,6 @@
 #include <stdio.h>
 #include <string.h>
 
-node_t* root;
-
 // This is the values from 
 // https://en.cppreference.com/w/cpp/language/operator_precedence.html
 const int OPERATOR_PRECEDENCE[] = {
@@ -93,100 +92,206 @@ char* OPERATOR_TYPE_NAMES[] = {
     "unary_deref"
 };
 
-node_t* node_create(node_type_t type) {
-    node_t* node = malloc(sizeof(node_t));
-    node->type = type;
-    node->children = NULL;
-    node->symbol = NULL;
-    node->type_info = NULL;
-    node->pos = (token_t){0};
-    node->leaf = false;
+static node_id_t node_create_slot() {
+    node_id_t node = da_size(compilation->node_pool.nodes);
+    da_append(compilation->node_pool.nodes, (node_t){0});
+    da_append(compilation->node_pool.children_cap, 0);
+    da_append(compilation->node_pool.type_info, NULL);
+    da_append(compilation->node_pool.symbol, NULL);
+    da_append(compilation->node_pool.pos, (token_t){0});
+    da_append(compilation->node_pool.parent, 0);
     return node;
 }
 
-node_t* node_create_leaf(node_type_t type, token_t token) {
-    node_t* node = node_create(type);
-    node->pos = token;
-    node->leaf = true;
+node_id_t node_create(node_type_t type) {
+    if (da_size(compilation->node_pool.nodes) == 0) {
+        // Id 0 is no node
+        node_create_slot();
+    }
+    node_id_t node = node_create_slot();
+    NODE(node).type = type;
     return node;
 }
 
-node_t* node_deep_copy(node_t* node) {
-    node_t* new_node = node_create(node->type);
-    memcpy(new_node, node, sizeof(node_t));
-    new_node->children = 0;
+node_id_t node_create_leaf(node_type_t type, token_t token) {
+    node_id_t node = node_create(type);
+    node_pos(node) = token;
+    NODE(node).leaf = true;
+    return node;
+}
 
-    for (size_t i = 0; i < da_size(node->children); ++i) {
-        node_t* child_cpy = node_deep_copy(node->children[i]);
-        da_append(new_node->children, child_cpy);
-    }
+node_id_t node_deep_copy(node_id_t node) {
+    node_id_t new_node = node_create(NODE(node).type);
+    NODE(new_node).leaf = NODE(node).leaf;
+    NODE(new_node).data = NODE(node).data;
+    node_type_info(new_node) = node_type_info(node);
+    node_symbol(new_node) = node_symbol(node);
+    node_pos(new_node) = node_pos(node);
+    node_parent(new_node) = node_parent(node);
 
-    if (node->type == STRING_LITERAL && node->data.string_literal_value != NULL) {
-        node->data.string_literal_value = strdup(node->data.string_literal_value);
+    for (size_t i = 0; i < node_n_children(node); ++i) {
+        node_id_t child_cpy = node_deep_copy(node_child(node, i));
+        node_add_child(new_node, child_cpy);
     }
 
-    if (node->type == IDENTIFIER && node->data.identifier_str != NULL) {
-        node->data.identifier_str = strdup(node->data.identifier_str);
-    }
+    // Identifiers and string literals are atoms, the copy can share them
 
     return new_node;
 }
 
-static void print_tree_impl(FILE *stream, node_t* node, int indent) {
+static void print_tree_impl(FILE *stream, node_id_t node, int indent) {
     for (int i = 0; i < indent; ++i)
         fprintf(stream, " ");
-    fprintf(stream, "%s", NODE_TYPE_NAMES[node->type]);
-
-    if (node->type == IDENTIFIER) {
-        fprintf(stream, " (%s)", node->data.identifier_str);
-    } else if (node->type == OPERATOR) {
-        fprintf(stream, " (%s)", OPERATOR_TYPE_NAMES[node->data.operator]);
-    } else if (node->type == INTEGER_LITERAL) {
-        fprintf(stream, " (%ld)", node->data.int_literal_value);
-    } else if (node->type == CHAR_LITERAL) {
-        fprintf(stream, " (%c)", node->data.char_literal_value);
-    } else if (node->type == STRING_LITERAL) {
-        if (global_string_list == NULL) {
-            fprintf(stream, " (%s)", node->data.string_literal_value);
+    fprintf(stream, "%s", NODE_TYPE_NAMES[NODE(node).type]);
+
+    if (NODE(node).type == IDENTIFIER) {
+        fprintf(stream, " (%s)", NODE(node).data.identifier_str);
+    } else if (NODE(node).type == OPERATOR) {
+        fprintf(stream, " (%s)", OPERATOR_TYPE_NAMES[NODE(node).data.operator]);
+    } else if (NODE(node).type == INTEGER_LITERAL) {
+        fprintf(stream, " (%ld)", NODE(node).data.int_literal_value);
+    } else if (NODE(node).type == CHAR_LITERAL) {
+        fprintf(stream, " (%c)", NODE(node).data.char_literal_value);
+    } else if (NODE(node).type == STRING_LITERAL) {
+        if (compilation->global_string_list == NULL) {
+            fprintf(stream, " (%s)", NODE(node).data.string_literal_value);
         } else {
-            fprintf(stream, " (%s)", global_string_list[node->data.string_literal_idx]);
+            fprintf(stream, " (%s)", compilation->global_string_list[NODE(node).data.string_literal_idx]);
         }
-    } else if (node->type == BOOL_LITERAL) {
-        fprintf(stream, " (%s)", node->data.bool_literal_value ? "true" : "false");
+    } else if (NODE(node).type == BOOL_LITERAL) {
+        fprintf(stream, " (%s)", NODE(node).data.bool_literal_value ? "true" : "false");
     }
 
-    if (node->symbol != NULL) {
-        fprintf(stream, " -> [%s] %s", SYMBOL_TYPE_NAMES[node->symbol->type], node->symbol->name);
+    if (node_symbol(node) != NULL) {
+        fprintf(stream, " -> [%s] %s", SYMBOL_TYPE_NAMES[node_symbol(node)->type], node_symbol(node)->name);
     }
 
     fprintf(stream, "\n");
 
-    for (size_t i = 0; i < da_size(node->children); ++i) {
-        print_tree_impl(stream, node->children[i], indent + 2);
+    for (size_t i = 0; i < node_n_children(node); ++i) {
+        print_tree_impl(stream, node_child(node, i), indent + 2);
     }
 }
 
-void print_tree(FILE* stream, node_t* node) {
+void print_tree(FILE* stream, node_id_t node) {
     print_tree_impl(stream, node, 0);
 }
 
-void node_find_range(node_t* node, range_t* range) {
-    node_t *ptr_lft = node, *ptr_rgt = node;
+void node_find_range(node_id_t node, range_t* range) {
+    node_id_t ptr_lft = node, ptr_rgt = node;
 
-    while (!ptr_lft->leaf) {
-        ptr_lft = ptr_lft->children[0];
+    while (!NODE(ptr_lft).leaf) {
+        ptr_lft = node_child(ptr_lft, 0);
     }
 
-    while (!ptr_rgt->leaf) {
-        ptr_rgt = ptr_rgt->children[da_size(ptr_rgt->children) - 1];
+    while (!NODE(ptr_rgt).leaf) {
+        ptr_rgt = node_child(ptr_rgt, node_n_children(ptr_rgt) - 1);
     }
 
-    range->start = lexer_offset_location(ptr_lft->pos.begin_offset);
-    range->end   = lexer_offset_location(ptr_rgt->pos.end_offset - 1);
+    range->start = lexer_offset_location(node_pos(ptr_lft).begin_offset);
+    range->end   = lexer_offset_location(node_pos(ptr_rgt).end_offset - 1);
+
+}
+
+// Appends n unused slots to the children pool, returns the first
+static uint32_t children_grow(uint32_t n) {
+    da_reserve_n(compilation->node_pool.children, n);
+    uint32_t first = da_size(compilation->node_pool.children);
+    da_header(compilation->node_pool.children)->size += n;
+    return first;
+}
+
+void node_add_child(node_id_t parent, node_id_t child) {
+    node_t* p = &NODE(parent);
+    uint32_t cap = compilation->node_pool.children_cap[parent];
+    if (p->n_children == cap) {
+        uint32_t new_cap = cap ? 2 * cap : 2;
+        if (cap > 0 && p->first_child + cap == da_size(compilation->node_pool.children)) {
+            // Last list in the pool, grow it in place
+            children_grow(new_cap - cap);
+        } else {
+            // Move the list to the end of the pool. Its old slots stay
+            // unused until node_compact_children.
+            uint32_t first = children_grow(new_cap);
+            memmove(&compilation->node_pool.children[first], &compilation->node_pool.children[p->first_child], cap * sizeof(node_id_t));
+            p->first_child = first;
+        }
+        compilation->node_pool.children_cap[parent] = new_cap;
+    }
+    compilation->node_pool.children[p->first_child + p->n_children++] = child;
+    node_parent(child) = parent;
+}
+
+static void compact_children_impl(node_id_t node, node_id_t** pool) {
+    node_t* n = &NODE(node);
+    uint32_t first = da_size(*pool);
+    da_append_n(*pool, &compilation->node_pool.children[n->first_child], n->n_children);
+    n->first_child = first;
+    compilation->node_pool.children_cap[node] = n->n_children;
+    for (uint32_t i = 0; i < n->n_children; ++i) {
+        compact_children_impl((*pool)[first + i], pool);
+    }
+}
+
+void node_compact_children(node_id_t node) {
+    node_id_t* pool = NULL;
+    da_reserve(pool, da_size(compilation->node_pool.children));
+    compact_children_impl(node, &pool);
+    da_deinit(compilation->node_pool.children);
+    compilation->node_pool.children = pool;
+}
+
+node_id_t node_pool_splice(const node_pool_t* from) {
+    size_t n = da_size(from->nodes);
+    if (n <= 1) return 0;
+    if (da_size(compilation->node_pool.nodes) == 0) {
+        node_create_slot();
+    }
+
+    node_id_t id_offset = da_size(compilation->node_pool.nodes) - 1;
+    uint32_t child_offset = da_size(compilation->node_pool.children);
+
+    // Id 0 of `from` is its own no node
+    da_append_n(compilation->node_pool.nodes, &from->nodes[1], n - 1);
+    da_append_n(compilation->node_pool.children_cap, &from->children_cap[1], n - 1);
+    da_append_n(compilation->node_pool.type_info, &from->type_info[1], n - 1);
+    da_append_n(compilation->node_pool.symbol, &from->symbol[1], n - 1);
+    da_append_n(compilation->node_pool.pos, &from->pos[1], n - 1);
+    da_append_n(compilation->node_pool.parent, &from->parent[1], n - 1);
+    if (from->children) {
+        da_append_n(compilation->node_pool.children, from->children, da_size(from->children));
+    }
+
+    for (node_id_t node = id_offset + 1; node < da_size(compilation->node_pool.nodes); ++node) {
+        NODE(node).first_child += child_offset;
+        for (uint32_t i = 0; i < node_n_children(node); ++i) {
+            node_child(node, i) += id_offset;
+        }
+        if (node_parent(node)) {
+            node_parent(node) += id_offset;
+        }
+    }
+    return id_offset;
+}
 
+void node_pool_reserve(size_t n_nodes, size_t n_children) {
+    size_t nodes = da_size(compilation->node_pool.nodes) + n_nodes;
+    da_reserve(compilation->node_pool.nodes, nodes);
+    da_reserve(compilation->node_pool.children_cap, nodes);
+    da_reserve(compilation->node_pool.type_info, nodes);
+    da_reserve(compilation->node_pool.symbol, nodes);
+    da_reserve(compilation->node_pool.pos, nodes);
+    da_reserve(compilation->node_pool.parent, nodes);
+    da_reserve(compilation->node_pool.children, da_size(compilation->node_pool.children) + n_children);
 }
 
-void node_add_child(node_t *parent, node_t *child) {
-    da_append(parent->children, child);
-    child->parent = parent;
+void node_pool_release(node_pool_t* pool) {
+    da_deinit(pool->nodes);
+    da_deinit(pool->children);
+    da_deinit(pool->children_cap);
+    da_deinit(pool->type_info);
+    da_deinit(pool->symbol);
+    da_deinit(pool->pos);
+    da_deinit(pool->parent);
+    *pool = (node_pool_t){0};
 }
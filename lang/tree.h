@@ -66,15 +66,18 @@ extern const int OPERATOR_PRECEDENCE[];
 extern char* NODE_TYPE_NAMES[];
 extern char* OPERATOR_TYPE_NAMES[];
 
+// Nodes are 32-bit ids into the node_pool of the compilation, 0 is no node.
+// The fields every pass reads live in one dense array of node_t,
+// the rest in parallel arrays indexed by the same id.
 struct node_t {
-    node_type_t type;
-
-    node_t** children;
-    node_t* parent;
+    uint8_t type; // node_type_t
+    bool leaf;
 
-    type_info_t* type_info;
+    // Children are node_pool.children[first_child : first_child + n_children]
+    uint32_t n_children;
+    uint32_t first_child;
 
-    // All pointers are owned.
+    // Identifiers and string literals are atoms, nothing here is owned.
     union {
         long int_literal_value;
         char* string_literal_value;
@@ -86,26 +89,55 @@ struct node_t {
         operator_t operator;
         type_class_t type_class;
     } data;
-
-    bool leaf;
-    token_t pos;
-
-    // Only in use if type == IDENTIFIER
-    symbol_t* symbol;
 };
 
-// root: LIST node of either FUNCTION_DECLARATION or VARIABLE_DECLARATION
-extern node_t* root;
-
-node_t* node_create(node_type_t type);
-node_t* node_create_leaf(node_type_t type, token_t token);
-void node_add_child(node_t*, node_t*);
-
-node_t* node_deep_copy(node_t* node);
+typedef struct {
+    node_t* nodes;            // da
+    node_id_t* children;      // da, the children lists of all nodes
+    uint32_t* children_cap;   // da, room reserved in children for each node
+
+    // Cold fields
+    type_info_t** type_info;  // da
+    symbol_t** symbol;        // da, only in use if type == IDENTIFIER
+    token_t* pos;             // da
+    node_id_t* parent;        // da
+} node_pool_t;
+
+// The nodes of the current compilation (see compilation.h), parser worker
+// threads build theirs in a pool of their own. All of these are lvalues. Creating nodes or adding children may move the
+// pool, so do not hold on to one across node_create or node_add_child.
+#define NODE(id)             (compilation->node_pool.nodes[id])
+#define node_child(id, i)    (compilation->node_pool.children[NODE(id).first_child + (i)])
+#define node_n_children(id)  (NODE(id).n_children)
+#define node_type_info(id)   (compilation->node_pool.type_info[id])
+#define node_symbol(id)      (compilation->node_pool.symbol[id])
+#define node_pos(id)         (compilation->node_pool.pos[id])
+#define node_parent(id)      (compilation->node_pool.parent[id])
+
+node_id_t node_create(node_type_t type);
+node_id_t node_create_leaf(node_type_t type, token_t token);
+void node_add_child(node_id_t, node_id_t);
+
+node_id_t node_deep_copy(node_id_t node);
+
+// Rewrites node_pool.children in preorder from node, dropping the space
+// left behind by lists that moved while growing. Called after parsing.
+void node_compact_children(node_id_t node);
+
+// Appends the nodes of `from` (built in another thread's node_pool) to
+// node_pool. Returns the offset to add to the ids of `from`.
+// `from` is left as it was.
+node_id_t node_pool_splice(const node_pool_t* from);
+
+// Room for n_nodes more nodes and n_children more children slots in node_pool
+void node_pool_reserve(size_t n_nodes, size_t n_children);
+
+// Frees the pool, node ids from it are invalid afterwards
+void node_pool_release(node_pool_t* pool);
 
 // Returns INCLUSIVE range (first and last character)
-void node_find_range(node_t* node, range_t* range);
+void node_find_range(node_id_t node, range_t* range);
 
-void print_tree(FILE* stream, node_t* node);
+void print_tree(FILE* stream, node_id_t node);
 
 #endif // TREE_H
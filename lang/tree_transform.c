@@ -1,4 +1,5 @@
 #include "tree_transform.h"
+#include "compilation.h"
 #include "da.h"
 #include "tree.h"
 #include "type.h"
@@ -6,15 +7,21 @@
 #include <assert.h>
 #include <stdlib.h>
 
-static void transform_pointer_indexing(node_t*);
-static void transform_pointer_arithmetic(node_t*);
+static void transform_node(node_id_t);
+static void transform_pointer_indexing(node_id_t);
+static void transform_pointer_arithmetic(node_id_t);
+
+void tree_transform(compilation_t* c) {
+    compilation = c;
+    transform_node(c->root);
+}
 
 // Hmm not sure how I want to do this
-void tree_transform(node_t* node) {
+static void transform_node(node_id_t node) {
     // Pre visit transforms
 
-    for (size_t i = 0; i < da_size(node->children); ++i) {
-        tree_transform(node->children[i]);
+    for (size_t i = 0; i < node_n_children(node); ++i) {
+        transform_node(node_child(node, i));
     }
 
     // Post visit transforms
@@ -23,84 +30,87 @@ void tree_transform(node_t* node) {
     // which is actually disallowed by the type checking,
     // but we run after that muahahah.
     // Maybe I will shoot myself in the foot with this idk
-    if ( node->type == ARRAY_INDEXING
-      && node->children[0]->type_info->type_class == TC_POINTER) {
+    if ( NODE(node).type == ARRAY_INDEXING
+      && node_type_info(node_child(node, 0))->type_class == TC_POINTER) {
         transform_pointer_indexing(node);
     }
 
     if (
-        node->type == OPERATOR 
-     && node->data.operator == BINARY_ADD
-     && node->children[0]->type_info->type_class == TC_POINTER
-     && node->children[1]->type_info->type_class == TC_BASIC
-     && node->children[1]->type_info->info.info_basic == TYPE_INT) {
+        NODE(node).type == OPERATOR 
+     && NODE(node).data.operator == BINARY_ADD
+     && node_type_info(node_child(node, 0))->type_class == TC_POINTER
+     && node_type_info(node_child(node, 1))->type_class == TC_BASIC
+     && node_type_info(node_child(node, 1))->info.info_basic == TYPE_INT) {
         transform_pointer_arithmetic(node);
     }
 }
 
 // Sadly basically slower than IR gen ...
-static void transform_pointer_indexing(node_t* node) {
-    assert(da_size(node->children[1]->children) == 1); // from type check
-    assert(node->parent != NULL);
+static void transform_pointer_indexing(node_id_t node) {
+    assert(node_n_children(node_child(node, 1)) == 1); // from type check
+    assert(node_parent(node) != 0);
 
     // change indexing [ identifier, list [ expression ]]
     // to     operator (deref) [ operator (add) [ identifier, operator (mul) [ expression, sizeof(ptr->inner) ] ] ]
-    node_t* identifier_node = node->children[0];
-    type_info_t* ptr_type = identifier_node->type_info;
-    node_t* expression_node = node->children[1]->children[0];
+    node_id_t identifier_node = node_child(node, 0);
+    type_info_t* ptr_type = node_type_info(identifier_node);
+    node_id_t expression_node = node_child(node_child(node, 1), 0);
 
-    node_t* deref_node = node_create(OPERATOR);
-    deref_node->data.operator = UNARY_DEREF;
-    deref_node->parent = node->parent;
+    node_id_t deref_node = node_create(OPERATOR);
+    NODE(deref_node).data.operator = UNARY_DEREF;
+    node_parent(deref_node) = node_parent(node);
 
-    node_t* add_node = node_create(OPERATOR);
-    add_node->data.operator = BINARY_ADD;
+    node_id_t add_node = node_create(OPERATOR);
+    NODE(add_node).data.operator = BINARY_ADD;
 
-    node_t* mul_node = node_create(OPERATOR);
-    mul_node->data.operator = BINARY_MUL;
+    node_id_t mul_node = node_create(OPERATOR);
+    NODE(mul_node).data.operator = BINARY_MUL;
 
-    node_t* literal_node = node_create(INTEGER_LITERAL);
-    literal_node->data.int_literal_value = type_sizeof(ptr_type->info.info_pointer->inner);
-    literal_node->type_info = expression_node->type_info;
+    node_id_t literal_node = node_create(INTEGER_LITERAL);
+    NODE(literal_node).data.int_literal_value = type_sizeof(ptr_type->info.info_pointer->inner);
+    node_type_info(literal_node) = node_type_info(expression_node);
 
     node_add_child(mul_node, expression_node);
     node_add_child(mul_node, literal_node);
-    mul_node->type_info = expression_node->type_info;
+    node_type_info(mul_node) = node_type_info(expression_node);
 
     node_add_child(add_node, identifier_node);
     node_add_child(add_node, mul_node);
-    add_node->type_info = mul_node->type_info;
+    node_type_info(add_node) = node_type_info(mul_node);
 
     node_add_child(deref_node, add_node);
-    deref_node->type_info = ptr_type->info.info_pointer->inner;
+    node_type_info(deref_node) = ptr_type->info.info_pointer->inner;
 
-    long insert_idx = da_indexof(node->parent->children, &node);
-    assert(insert_idx >= 0);
-    assert(node->parent->children[insert_idx] == node);
-    node->parent->children[insert_idx] = deref_node;
+    node_id_t parent = node_parent(node);
+    uint32_t insert_idx = 0;
+    while (insert_idx < node_n_children(parent) && node_child(parent, insert_idx) != node) {
+        ++insert_idx;
+    }
+    assert(insert_idx < node_n_children(parent));
+    node_child(parent, insert_idx) = deref_node;
 
     // node should actually now be totally done :O
     // free(node); but fuck free'ing
 }
 
-static void transform_pointer_arithmetic(node_t* op_node) {
-    type_info_t *lhs_type = op_node->children[0]->type_info;
+static void transform_pointer_arithmetic(node_id_t op_node) {
+    type_info_t *lhs_type = node_type_info(node_child(op_node, 0));
     assert(lhs_type->type_class == TC_POINTER);
 
-    node_t *expression_node = op_node->children[1];
+    node_id_t expression_node = node_child(op_node, 1);
 
     size_t subtype_sz = type_sizeof(lhs_type->info.info_pointer->inner);
 
-    node_t *mul_node = node_create(OPERATOR);
-    mul_node->data.operator = BINARY_MUL;
-    mul_node->type_info = expression_node->type_info;
+    node_id_t mul_node = node_create(OPERATOR);
+    NODE(mul_node).data.operator = BINARY_MUL;
+    node_type_info(mul_node) = node_type_info(expression_node);
 
-    node_t *literal_node = node_create(INTEGER_LITERAL);
-    literal_node->data.int_literal_value = subtype_sz;
-    literal_node->type_info = expression_node->type_info;
+    node_id_t literal_node = node_create(INTEGER_LITERAL);
+    NODE(literal_node).data.int_literal_value = subtype_sz;
+    node_type_info(literal_node) = node_type_info(expression_node);
     node_add_child(mul_node, literal_node);
     node_add_child(mul_node, expression_node);
 
-    op_node->children[1] = mul_node;
-    mul_node->parent = op_node;
+    node_child(op_node, 1) = mul_node;
+    node_parent(mul_node) = op_node;
 }
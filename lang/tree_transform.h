@@ -8,6 +8,6 @@
  * after type checking.
  */
 
-void tree_transform(node_t* node);
+void tree_transform(compilation_t* c);
 
 #endif // TREE_TRANSFORM_H
@@ -5,6 +5,8 @@
 #include <assert.h>
 
 #include "type.h"
+#include "arena.h"
+#include "compilation.h"
 #include "da.h"
 #include "fail.h"
 #include "langc.h"
@@ -27,142 +29,133 @@ char* BASIC_TYPE_NAMES[] = {
     "size"
 };
 
-symbol_table_t *global_type_table = 0;
 
-static void register_type_node(node_t*);
-static void handle_builtin_function_type(node_t*, symbol_t*);
+static void register_type_node(node_id_t);
+static void handle_builtin_function_type(node_id_t, symbol_t*);
 static bool types_equivalent(type_info_t* type_a, type_info_t* type_b);
 static bool can_cast(type_info_t* type_dst, type_info_t* type_src);
 type_info_t* type_create_basic(basic_type_t basic_type);
-static type_info_t* create_type_function();
-static type_info_t* create_type_array(type_info_t*, node_t*);
+static type_info_t* create_type_function(type_info_t** arg_types, type_info_t* return_type);
+static type_info_t* create_type_array(type_info_t*, node_id_t);
 static type_info_t* create_type_pointer(type_info_t*);
-static type_info_t* create_type_struct(node_t*);
+static type_info_t* create_type_struct(node_id_t);
 static type_info_t* create_type_tagged(size_t, type_info_t* type);
-static type_tuple_t* create_tuple();
+static type_info_t* type_intern(type_info_t* candidate);
 static basic_type_t is_basic_type(const char* identifier_str);
 
 
-void register_types() {
-    for (size_t i = 0; i < da_size(root->children); ++i) {
-        register_type_node(root->children[i]);
+void register_types(compilation_t* c) {
+    compilation = c;
+    for (size_t i = 0; i < node_n_children(compilation->root); ++i) {
+        register_type_node(node_child(compilation->root, i));
     }
 }
 
-// Points to the DECLARATION of the curr function
-node_t* current_function_type_node = NULL;
+static void register_type_node(node_id_t node) {
+    if (node_type_info(node) != NULL) return;
 
-static void register_type_node(node_t* node) {
-    if (node->type_info != NULL) return;
-
-    switch (node->type) {
+    switch (NODE(node).type) {
         case DECLARATION:
             {
                 // Type node
-                register_type_node(node->children[1]);
-                node_t* old_function_node = current_function_type_node;
+                register_type_node(node_child(node, 1));
+                node_id_t old_function_node = compilation->current_function_type_node;
 
-                if (da_size(node->children) == 3) {
-                    bool is_function = node->children[1]->type == TYPE 
-                        && node->children[1]->data.type_class == TC_FUNCTION;
+                if (node_n_children(node) == 3) {
+                    bool is_function = NODE(node_child(node, 1)).type == TYPE 
+                        && NODE(node_child(node, 1)).data.type_class == TC_FUNCTION;
                     if (is_function) {
-                        old_function_node = current_function_type_node;
-                        current_function_type_node = node->children[1];
+                        old_function_node = compilation->current_function_type_node;
+                        compilation->current_function_type_node = node_child(node, 1);
                     }
 
                     // we need to save it here because if we have a 
                     // recursive function, we need to 'memoize' the type info
                     // so that we don't recurse infinitely
 
-                    assert(node->children[1]->type == TYPE 
+                    assert(NODE(node_child(node, 1)).type == TYPE 
                             && "When declaration has three children I expect middle one to be type");
 
-                    node->type_info = node->children[1]->type_info;
-                    node->children[0]->type_info = node->type_info;
+                    node_type_info(node) = node_type_info(node_child(node, 1));
+                    node_type_info(node_child(node, 0)) = node_type_info(node);
 
                     // identifier: type = expression
                     // Check if expression has same type as declared
-                    register_type_node(node->children[2]);
+                    register_type_node(node_child(node, 2));
 
-                    if (!is_function && !types_equivalent(node->children[1]->type_info, node->children[2]->type_info)) {
+                    if (!is_function && !types_equivalent(node_type_info(node_child(node, 1)), node_type_info(node_child(node, 2)))) {
                         // TODO: better error
                         char *msg = 0;
                         da_strcat(&msg, "Cannot assign ");
-                        da_strcat(&msg, node->children[0]->data.identifier_str);
+                        da_strcat(&msg, NODE(node_child(node, 0)).data.identifier_str);
                         da_strcat(&msg, " of type ");
-                        type_print(&msg, node->children[1]->type_info);
+                        type_print(&msg, node_type_info(node_child(node, 1)));
                         da_strcat(&msg, " to expression of type ");
-                        type_print(&msg, node->children[2]->type_info);
+                        type_print(&msg, node_type_info(node_child(node, 2)));
                         da_strcat(&msg, "\n");
-                        fail_node(node, "%s", msg);
+                        fail_node(node, "%.*s", (int)da_size(msg), msg);
                     }
                 }
 
-                if (node->children[1]->type != TYPE) {
-                    if (node->children[1]->type_info == NULL) {
-                        fail_node(node->children[1], "Could not infer type of expression.");
+                if (NODE(node_child(node, 1)).type != TYPE) {
+                    if (node_type_info(node_child(node, 1)) == NULL) {
+                        fail_node(node_child(node, 1), "Could not infer type of expression.");
                     }
                 }
-                node->type_info = node->children[1]->type_info;
-                node->children[0]->type_info = node->type_info;
+                node_type_info(node) = node_type_info(node_child(node, 1));
+                node_type_info(node_child(node, 0)) = node_type_info(node);
 
-                current_function_type_node = old_function_node;
+                compilation->current_function_type_node = old_function_node;
                 return;
             }
             break;
         case TYPE:
             {
-                if (node->data.type_class == TC_FUNCTION) {
-                    for (size_t i = 0; i < da_size(node->children); ++i) {
-                        register_type_node(node->children[i]);
+                if (NODE(node).data.type_class == TC_FUNCTION) {
+                    for (size_t i = 0; i < node_n_children(node); ++i) {
+                        register_type_node(node_child(node, i));
                     }
 
-                    node->type_info = create_type_function();
-                    node->type_info->info.info_function->return_type 
-                        = node->children[1]->type_info;
-
-                    for (size_t i = 0; i < da_size(node->children[0]->children); ++i) {
-                        da_append(
-                            node->type_info->info.info_function->arg_types->elems,
-                            node->children[0]->children[i]->type_info
-                        );
+                    type_info_t** arg_types = 0;
+                    for (size_t i = 0; i < node_n_children(node_child(node, 0)); ++i) {
+                        da_append(arg_types, node_type_info(node_child(node_child(node, 0), i)));
                     }
-                    // TODO: arg types
+                    node_type_info(node) = create_type_function(arg_types, node_type_info(node_child(node, 1)));
                     return;
-                } else if (node->data.type_class == TC_UNKNOWN) {
-                    assert(da_size(node->children) == 1);
+                } else if (NODE(node).data.type_class == TC_UNKNOWN) {
+                    assert(node_n_children(node) == 1);
 
-                    node_t* identifier = node->children[0];
-                    assert(identifier->type == IDENTIFIER);
+                    node_id_t identifier = node_child(node, 0);
+                    assert(NODE(identifier).type == IDENTIFIER);
 
-                    basic_type_t basic_type = is_basic_type(identifier->data.identifier_str);
+                    basic_type_t basic_type = is_basic_type(NODE(identifier).data.identifier_str);
                     if (((int)(basic_type) >= 0)) {
-                        node->type_info = type_create_basic(basic_type);
+                        node_type_info(node) = type_create_basic(basic_type);
                         break;
                     }
 
-                    symbol_t* type_symbol = symbol_hashmap_lookup(global_type_table->hashmap, identifier->data.identifier_str);
+                    symbol_t* type_symbol = symbol_hashmap_lookup(compilation->global_type_table->hashmap, NODE(identifier).data.identifier_str);
 
                     if (type_symbol != NULL) {
-                        node_t* decl_node = type_symbol->node;
-                        assert(decl_node->type_info != NULL);
-                        assert(decl_node->type_info->type_class == TC_TAGGED);
-                        node->type_info = decl_node->type_info;
+                        node_id_t decl_node = type_symbol->node;
+                        assert(node_type_info(decl_node) != NULL);
+                        assert(node_type_info(decl_node)->type_class == TC_TAGGED);
+                        node_type_info(node) = node_type_info(decl_node);
                         break;
                     }
 
-                    fail_node(identifier, "Unknown type %s", identifier->data.identifier_str);
-                } else if (node->data.type_class == TC_ARRAY) {
+                    fail_node(identifier, "Unknown type %s", NODE(identifier).data.identifier_str);
+                } else if (NODE(node).data.type_class == TC_ARRAY) {
                     // first child: (sybtype, second: list)
-                    register_type_node(node->children[0]);
-                    register_type_node(node->children[1]);
-                    node->type_info = create_type_array(node->children[0]->type_info, node->children[1]);
-                } else if (node->data.type_class == TC_POINTER) {
+                    register_type_node(node_child(node, 0));
+                    register_type_node(node_child(node, 1));
+                    node_type_info(node) = create_type_array(node_type_info(node_child(node, 0)), node_child(node, 1));
+                } else if (NODE(node).data.type_class == TC_POINTER) {
                     // only child: subtype
-                    register_type_node(node->children[0]);
-                    node->type_info = create_type_pointer(node->children[0]->type_info);
-                } else if (node->data.type_class == TC_STRUCT) {
-                    node->type_info = create_type_struct(node);
+                    register_type_node(node_child(node, 0));
+                    node_type_info(node) = create_type_pointer(node_type_info(node_child(node, 0)));
+                } else if (NODE(node).data.type_class == TC_STRUCT) {
+                    node_type_info(node) = create_type_struct(node);
                 } else {
                     assert(false && "Unhandled type class from parsing stage");
                 }
@@ -172,106 +165,106 @@ static void register_type_node(node_t* node) {
             break;
         case TYPE_DECLARATION:
             {
-                register_type_node(node->children[1]);
-                node->type_info = create_type_tagged(
-                    node->symbol->sequence_number, 
-                    node->children[1]->type_info
+                register_type_node(node_child(node, 1));
+                node_type_info(node) = create_type_tagged(
+                    node_symbol(node)->sequence_number, 
+                    node_type_info(node_child(node, 1))
                 );
             }
             break;
         case INTEGER_LITERAL:
             {
-                node->type_info = type_create_basic(TYPE_INT);
+                node_type_info(node) = type_create_basic(TYPE_INT);
                 return;
             }
             break;
         case REAL_LITERAL:
             {
-                node->type_info = type_create_basic(TYPE_REAL);
+                node_type_info(node) = type_create_basic(TYPE_REAL);
                 return;
             }
             break;
         case STRING_LITERAL:
             {
-                node->type_info = type_create_basic(TYPE_STRING);
+                node_type_info(node) = type_create_basic(TYPE_STRING);
                 return;
             }
             break;
         case BOOL_LITERAL:
             {
-                node->type_info = type_create_basic(TYPE_BOOL);
+                node_type_info(node) = type_create_basic(TYPE_BOOL);
                 return;
             }
             break;
         case CHAR_LITERAL:
             {
-                node->type_info = type_create_basic(TYPE_CHAR);
+                node_type_info(node) = type_create_basic(TYPE_CHAR);
                 return;
             }
             break;
         case DECLARATION_LIST:
             {
-                for (size_t i = 0; i < da_size(node->children); ++i) {
-                    register_type_node(node->children[i]);
+                for (size_t i = 0; i < node_n_children(node); ++i) {
+                    register_type_node(node_child(node, i));
                 }
                 // TODO
-                node->type_info = type_create_basic(TYPE_VOID);
+                node_type_info(node) = type_create_basic(TYPE_VOID);
                 return;
             }
             break;
         case BLOCK:
             {
                 // Should the block itself have a return type? Last statment in block?
-                for (size_t i = 0; i < da_size(node->children); ++i) {
-                    register_type_node(node->children[i]);
+                for (size_t i = 0; i < node_n_children(node); ++i) {
+                    register_type_node(node_child(node, i));
                 }
             }
             break;
         case RETURN_STATEMENT:
             {
                 // Type of return statement is the type of the returned expression
-                if (da_size(node->children) > 0) {
-                    register_type_node(node->children[0]);
-                    node->type_info = node->children[0]->type_info;
+                if (node_n_children(node) > 0) {
+                    register_type_node(node_child(node, 0));
+                    node_type_info(node) = node_type_info(node_child(node, 0));
                 } else {
-                    node->type_info = type_create_basic(TYPE_VOID);
+                    node_type_info(node) = type_create_basic(TYPE_VOID);
                 }
-                if (current_function_type_node == NULL) {
+                if (compilation->current_function_type_node == 0) {
                     fail_node(node, "Return statement not allowed outside function");
                 }
-                type_info_t* required_return_type = current_function_type_node->type_info->info.info_function->return_type;
+                type_info_t* required_return_type = node_type_info(compilation->current_function_type_node)->info.info_function->return_type;
                 // TODO: is broken
-                if (!types_equivalent(node->type_info, required_return_type)) {
+                if (!types_equivalent(node_type_info(node), required_return_type)) {
                     char *msg = 0;
                     da_strcat(&msg, "Function '");
-                    da_strcat(&msg, current_function_type_node->parent->children[0]->data.identifier_str);
+                    da_strcat(&msg, NODE(node_child(node_parent(compilation->current_function_type_node), 0)).data.identifier_str);
                     da_strcat(&msg, "', with return type '");
                     type_print(&msg, required_return_type);
                     da_strcat(&msg, "', cannot return '");
-                    type_print(&msg, node->type_info);
+                    type_print(&msg, node_type_info(node));
                     da_strcat(&msg, "'\n");
-                    fail_node(node, "%s", msg);
+                    fail_node(node, "%.*s", (int)da_size(msg), msg);
                 }
                 return;
             }
             break;
         case OPERATOR:
             {
-                register_type_node(node->children[0]);
-                if (da_size(node->children) == 2) {
-                    register_type_node(node->children[1]);
+                register_type_node(node_child(node, 0));
+                if (node_n_children(node) == 2) {
+                    register_type_node(node_child(node, 1));
                 }
 
                 // TODO: Automatic cast?
                 char* opstr;
-                switch (node->data.operator) {
+                switch (NODE(node).data.operator) {
                     case BINARY_ADD:
                     case BINARY_SUB:
                     case BINARY_MUL:
                     case BINARY_DIV:
                     case BINARY_MOD:
                         {
-                            switch(node->data.operator) {
+                            switch(NODE(node).data.operator) {
                                 case BINARY_ADD:
                                     opstr = "add";
                                     break;
@@ -292,24 +285,24 @@ static void register_type_node(node_t* node) {
                             }
 
                             bool is_ptr_int = 
-                                node->data.operator == BINARY_ADD 
-                                && node->children[0]->type_info->type_class == TC_POINTER
-                                && node->children[1]->type_info->type_class == TC_BASIC
-                                && node->children[1]->type_info->info.info_basic == TYPE_INT;
+                                NODE(node).data.operator == BINARY_ADD 
+                                && node_type_info(node_child(node, 0))->type_class == TC_POINTER
+                                && node_type_info(node_child(node, 1))->type_class == TC_BASIC
+                                && node_type_info(node_child(node, 1))->info.info_basic == TYPE_INT;
 
-                            if (!is_ptr_int && !types_equivalent(node->children[0]->type_info, node->children[1]->type_info)) {
+                            if (!is_ptr_int && !types_equivalent(node_type_info(node_child(node, 0)), node_type_info(node_child(node, 1)))) {
                                 char *msg = 0;
                                 da_strcat(&msg, "Cannot ");
                                 da_strcat(&msg, opstr);
                                 da_strcat(&msg, " ");
-                                type_print(&msg, node->children[0]->type_info);
+                                type_print(&msg, node_type_info(node_child(node, 0)));
                                 da_strcat(&msg, " and ");
-                                type_print(&msg, node->children[1]->type_info);
+                                type_print(&msg, node_type_info(node_child(node, 1)));
                                 da_strcat(&msg, "\n");
-                                fail_node(node, "%s", msg);
+                                fail_node(node, "%.*s", (int)da_size(msg), msg);
                             }
 
-                            node->type_info = node->children[0]->type_info;
+                            node_type_info(node) = node_type_info(node_child(node, 0));
                             return;
                         }
                         break;
@@ -320,71 +313,71 @@ static void register_type_node(node_t* node) {
                     case BINARY_EQ:
                     case BINARY_NEQ:
                         {
-                            if (!types_equivalent(node->children[0]->type_info, node->children[1]->type_info)) {
+                            if (!types_equivalent(node_type_info(node_child(node, 0)), node_type_info(node_child(node, 1)))) {
                                 char *msg = 0;
                                 da_strcat(&msg, "Cannot combine ");
-                                type_print(&msg, node->children[0]->type_info);
+                                type_print(&msg, node_type_info(node_child(node, 0)));
                                 da_strcat(&msg, " and ");
-                                type_print(&msg, node->children[1]->type_info);
+                                type_print(&msg, node_type_info(node_child(node, 1)));
                                 da_strcat(&msg, "\n");
-                                fail_node(node, "%s", msg);
+                                fail_node(node, "%.*s", (int)da_size(msg), msg);
                             }
 
-                            node->type_info = type_create_basic(TYPE_BOOL);
+                            node_type_info(node) = type_create_basic(TYPE_BOOL);
                             return;
                         }
                         break;
                     case BINARY_OR:
                     case BINARY_AND:
                         {
-                            if (node->children[0]->type_info->type_class != TC_BASIC
-                              || node->children[0]->type_info->info.info_basic != TYPE_BOOL) {
+                            if (node_type_info(node_child(node, 0))->type_class != TC_BASIC
+                              || node_type_info(node_child(node, 0))->info.info_basic != TYPE_BOOL) {
                                 char *msg = 0;
                                 da_strcat(&msg, "Expected bool, got '");
-                                type_print(&msg, node->children[0]->type_info);
+                                type_print(&msg, node_type_info(node_child(node, 0)));
                                 da_strcat(&msg, "' as a logical operand.\n");
-                                fail_node(node->children[0], "%s", msg);
+                                fail_node(node_child(node, 0), "%.*s", (int)da_size(msg), msg);
                             }
-                            if (node->children[1]->type_info->type_class != TC_BASIC
-                              || node->children[1]->type_info->info.info_basic != TYPE_BOOL) {
+                            if (node_type_info(node_child(node, 1))->type_class != TC_BASIC
+                              || node_type_info(node_child(node, 1))->info.info_basic != TYPE_BOOL) {
                                 char *msg = 0;
                                 da_strcat(&msg, "Expected bool, got '");
-                                type_print(&msg, node->children[1]->type_info);
+                                type_print(&msg, node_type_info(node_child(node, 1)));
                                 da_strcat(&msg, "' as a logical operand.\n");
-                                fail_node(node->children[1], "%s", msg);
+                                fail_node(node_child(node, 1), "%.*s", (int)da_size(msg), msg);
                             }
 
-                            node->type_info = type_create_basic(TYPE_BOOL);
+                            node_type_info(node) = type_create_basic(TYPE_BOOL);
                             return;
                         }
                         break;
                     case UNARY_SUB:
                     case UNARY_NEG:
                         {
-                            node->type_info = node->children[0]->type_info;
+                            node_type_info(node) = node_type_info(node_child(node, 0));
                             return;
                         }
                         break;
                     case UNARY_DEREF:
                         {
-                            node_t* inner = node->children[0];
-                            if (inner->type_info->type_class != TC_POINTER) {
+                            node_id_t inner = node_child(node, 0);
+                            if (node_type_info(inner)->type_class != TC_POINTER) {
                                 fail_node(node, "Cannot dereference this");
                             }
 
-                            node->type_info = inner->type_info->info.info_pointer->inner;
+                            node_type_info(node) = node_type_info(inner)->info.info_pointer->inner;
                             return;
                         }
                         break;
                     case UNARY_STAR:
                         {
-                            node_t* inner = node->children[0];
-                            node->type_info = create_type_pointer(inner->type_info);
+                            node_id_t inner = node_child(node, 0);
+                            node_type_info(node) = create_type_pointer(node_type_info(inner));
                             return;
                         }
                     default:
                         {
-                            fail("Not implemented operator type check: %s", OPERATOR_TYPE_NAMES[node->data.operator]);
+                            fail("Not implemented operator type check: %s", OPERATOR_TYPE_NAMES[NODE(node).data.operator]);
                         }
                         break;
                 }
@@ -392,52 +385,52 @@ static void register_type_node(node_t* node) {
             break;
         case IDENTIFIER:
             {
-                assert(node->symbol != NULL && "Bind references has not succeeded");
-                node_t* symbol_definition_node = node->symbol->node;
+                assert(node_symbol(node) != NULL && "Bind references has not succeeded");
+                node_id_t symbol_definition_node = node_symbol(node)->node;
 
-                if (symbol_definition_node->type_info == NULL) {
-                    fprintf(stderr, "%s\n", node->data.identifier_str);
+                if (node_type_info(symbol_definition_node) == NULL) {
+                    fprintf(stderr, "%s\n", NODE(node).data.identifier_str);
                 }
-                assert(symbol_definition_node->type_info != NULL);
-                node->type_info = symbol_definition_node->type_info;
+                assert(node_type_info(symbol_definition_node) != NULL);
+                node_type_info(node) = node_type_info(symbol_definition_node);
             }
             break;
         case FUNCTION_CALL:
             {
                 // Type of function call: Return type of the called function
                 // Register args
-                register_type_node(node->children[1]);
+                register_type_node(node_child(node, 1));
 
-                assert(node->children[0]->symbol != NULL);
-                symbol_t *function_symbol = node->children[0]->symbol;
-                node_t *symbol_definition_node = function_symbol->node;
+                assert(node_symbol(node_child(node, 0)) != NULL);
+                symbol_t *function_symbol = node_symbol(node_child(node, 0));
+                node_id_t symbol_definition_node = function_symbol->node;
 
                 if (function_symbol->is_builtin) {
                     handle_builtin_function_type(node, function_symbol);
                     return;
                 } 
 
-                if (symbol_definition_node->type_info == NULL) {
+                if (node_type_info(symbol_definition_node) == NULL) {
                     register_type_node(symbol_definition_node);
                 }
-                assert(symbol_definition_node->type_info != NULL);
-                assert(symbol_definition_node->type_info->type_class == TC_FUNCTION);
+                assert(node_type_info(symbol_definition_node) != NULL);
+                assert(node_type_info(symbol_definition_node)->type_class == TC_FUNCTION);
 
-                type_function_t* info_function = symbol_definition_node->type_info->info.info_function;
+                type_function_t* info_function = node_type_info(symbol_definition_node)->info.info_function;
 
-                node_t* args_list= node->children[1];
+                node_id_t args_list= node_child(node, 1);
 
-                if (da_size(args_list->children) != da_size(info_function->arg_types->elems)) {
+                if (node_n_children(args_list) != da_size(info_function->arg_types->elems)) {
                     fail_node(args_list, 
                         "Function %s requires exactly %zu arguments, but was called with %zu",
                         function_symbol->name,
                         da_size(info_function->arg_types->elems),
-                        da_size(args_list->children)
+                        node_n_children(args_list)
                     );
                 }
 
-                for (size_t i = 0; i < da_size(args_list->children); ++i) {
-                    if (!types_equivalent(args_list->children[i]->type_info, info_function->arg_types->elems[i])) {
+                for (size_t i = 0; i < node_n_children(args_list); ++i) {
+                    if (!types_equivalent(node_type_info(node_child(args_list, i)), info_function->arg_types->elems[i])) {
                         char buf[1024];
                         char *msg = 0;
                         da_strcat(&msg, "Argument ");
@@ -448,115 +441,115 @@ static void register_type_node(node_t* node) {
                         da_strcat(&msg, " has the wrong type. Required: '");
                         type_print(&msg, info_function->arg_types->elems[i]);
                         da_strcat(&msg, "', Got: '");
-                        type_print(&msg, args_list->children[i]->type_info);
+                        type_print(&msg, node_type_info(node_child(args_list, i)));
                         da_strcat(&msg, "'\n");
-                        fail_node(args_list->children[i], "%s", msg);
+                        fail_node(node_child(args_list, i), "%.*s", (int)da_size(msg), msg);
                     }
                 }
 
-                node->type_info = info_function->return_type;
+                node_type_info(node) = info_function->return_type;
             }
             break;
         case PARENTHESIZED_EXPRESSION:
             {
-                register_type_node(node->children[0]);
-                node->type_info = node->children[0]->type_info;
+                register_type_node(node_child(node, 0));
+                node_type_info(node) = node_type_info(node_child(node, 0));
             }
             break;
         case ASSIGNMENT_STATEMENT:
             {
                 // lhs := rhs
-                register_type_node(node->children[0]);
-                register_type_node(node->children[1]);
+                register_type_node(node_child(node, 0));
+                register_type_node(node_child(node, 1));
 
-                if (!types_equivalent(node->children[0]->type_info, node->children[1]->type_info)) {
+                if (!types_equivalent(node_type_info(node_child(node, 0)), node_type_info(node_child(node, 1)))) {
                     char *msg = 0;
                     da_strcat(&msg, "Cannot assign expression of type '");
-                    type_print(&msg, node->children[1]->type_info);
+                    type_print(&msg, node_type_info(node_child(node, 1)));
                     da_strcat(&msg, "' to element of type '");
-                    type_print(&msg, node->children[0]->type_info);
+                    type_print(&msg, node_type_info(node_child(node, 0)));
                     da_strcat(&msg, "'\n");
-                    fail_node(node, "%s", msg);
+                    fail_node(node, "%.*s", (int)da_size(msg), msg);
                 }
 
                 // Should it be void or type of assignment?
-                node->type_info = type_create_basic(TYPE_VOID);
+                node_type_info(node) = type_create_basic(TYPE_VOID);
             }
             break;
         case CAST_EXPRESSION:
             {
-                register_type_node(node->children[0]);
-                register_type_node(node->children[1]);
+                register_type_node(node_child(node, 0));
+                register_type_node(node_child(node, 1));
 
-                if (!can_cast(node->children[1]->type_info, node->children[0]->type_info)) {
+                if (!can_cast(node_type_info(node_child(node, 1)), node_type_info(node_child(node, 0)))) {
                     char *msg = 0;
                     da_strcat(&msg, "Cannot cast '");
-                    type_print(&msg, node->children[1]->type_info);
+                    type_print(&msg, node_type_info(node_child(node, 1)));
                     da_strcat(&msg, "' to '");
-                    type_print(&msg, node->children[0]->type_info);
+                    type_print(&msg, node_type_info(node_child(node, 0)));
                     da_strcat(&msg, "'\n");
-                    fail_node(node, "%s", node);
+                    fail_node(node, "%.*s", (int)da_size(msg), msg);
                 }
 
-                node->type_info = node->children[0]->type_info;
+                node_type_info(node) = node_type_info(node_child(node, 0));
             }
             break;
         case ALLOC_EXPRESSION:
             {
-                for (size_t i = 0; i < da_size(node->children); ++i) {
-                    register_type_node(node->children[i]);
+                for (size_t i = 0; i < node_n_children(node); ++i) {
+                    register_type_node(node_child(node, i));
                 }
-                node->type_info = create_type_pointer(node->children[0]->type_info);
+                node_type_info(node) = create_type_pointer(node_type_info(node_child(node, 0)));
             }
             break;
         case LIST:
             {
-                for (size_t i = 0; i < da_size(node->children); ++i) {
-                    register_type_node(node->children[i]);
+                for (size_t i = 0; i < node_n_children(node); ++i) {
+                    register_type_node(node_child(node, i));
                 }
                 // TODO: tuple type here in some cases?
-                node->type_info = type_create_basic(TYPE_VOID);
+                node_type_info(node) = type_create_basic(TYPE_VOID);
             }
             break;
         case IF_STATEMENT:
             {
-                for (size_t i = 0; i < da_size(node->children); ++i) {
-                    register_type_node(node->children[i]);
+                for (size_t i = 0; i < node_n_children(node); ++i) {
+                    register_type_node(node_child(node, i));
                 }
 
                 // first child has to have boolean type
-                if (node->children[0]->type_info->type_class != TC_BASIC
-                 || node->children[0]->type_info->info.info_basic != TYPE_BOOL) {
+                if (node_type_info(node_child(node, 0))->type_class != TC_BASIC
+                 || node_type_info(node_child(node, 0))->info.info_basic != TYPE_BOOL) {
                     fail_node(node, "Condition of if statement must be boolean.");
                 }
-                node->type_info = type_create_basic(TYPE_VOID);
+                node_type_info(node) = type_create_basic(TYPE_VOID);
             }
             break;
         case ARRAY_INDEXING:
             {
-                register_type_node(node->children[0]);
-                register_type_node(node->children[1]);
+                register_type_node(node_child(node, 0));
+                register_type_node(node_child(node, 1));
 
-                type_info_t* array_type = node->children[0]->type_info;
-                node_t* dim_list = node->children[1];
+                type_info_t* array_type = node_type_info(node_child(node, 0));
+                node_id_t dim_list = node_child(node, 1);
 
                 if (array_type->type_class == TC_ARRAY) {
-                    if (da_size(dim_list->children) != da_size(array_type->info.info_array->dims)) {
+                    if (node_n_children(dim_list) != da_size(array_type->info.info_array->dims)) {
                         fail_node(node, "Wrong number of dimensions");
                     }
-                    node->type_info = node->children[0]->type_info->info.info_array->subtype;
+                    node_type_info(node) = node_type_info(node_child(node, 0))->info.info_array->subtype;
                 } else if (array_type->type_class == TC_POINTER) {
-                    if (da_size(dim_list->children) != 1) {
+                    if (node_n_children(dim_list) != 1) {
                         fail_node(node, "Indexing a pointer can only be done with exactly one dimension");
                     }
-                    node->type_info = node->children[0]->type_info->info.info_pointer->inner;
+                    node_type_info(node) = node_type_info(node_child(node, 0))->info.info_pointer->inner;
                 } else {
                     fail_node(node, "Attempt to index non-indexable");
                 }
 
-                for (size_t i = 0; i < da_size(dim_list->children); ++i) {
-                    if (dim_list->children[i]->type_info->type_class != TC_BASIC || dim_list->children[i]->type_info->info.info_basic != TYPE_INT) {
-                        fail_node(dim_list->children[i], "Array indices must be integers");
+                for (size_t i = 0; i < node_n_children(dim_list); ++i) {
+                    if (node_type_info(node_child(dim_list, i))->type_class != TC_BASIC || node_type_info(node_child(dim_list, i))->info.info_basic != TYPE_INT) {
+                        fail_node(node_child(dim_list, i), "Array indices must be integers");
                     }
                 }
 
@@ -564,63 +557,63 @@ static void register_type_node(node_t* node) {
             break;
         case WHILE_STATEMENT:
             {
-                for (size_t i = 0; i < da_size(node->children); ++i) {
-                    register_type_node(node->children[i]);
+                for (size_t i = 0; i < node_n_children(node); ++i) {
+                    register_type_node(node_child(node, i));
                 }
 
-                if (node->children[0]->type_info->type_class != TC_BASIC
-                 || node->children[0]->type_info->info.info_basic != TYPE_BOOL) {
+                if (node_type_info(node_child(node, 0))->type_class != TC_BASIC
+                 || node_type_info(node_child(node, 0))->info.info_basic != TYPE_BOOL) {
                     fail_node(node, "Condition of while statement must be boolean.");
                 }
-                node->type_info = type_create_basic(TYPE_VOID);
+                node_type_info(node) = type_create_basic(TYPE_VOID);
             }
             break;
         case BREAK_STATEMENT:
             {
-                node->type_info = type_create_basic(TYPE_VOID);
+                node_type_info(node) = type_create_basic(TYPE_VOID);
             }
             break;
         case CONTINUE_STATEMENT:
             {
-                node->type_info = type_create_basic(TYPE_VOID);
+                node_type_info(node) = type_create_basic(TYPE_VOID);
             }
             break;
         case DOT_ACCESS:
             {
-                register_type_node(node->children[0]);
-                register_type_node(node->children[1]);
-                node->type_info = node->children[1]->type_info;
+                register_type_node(node_child(node, 0));
+                register_type_node(node_child(node, 1));
+                node_type_info(node) = node_type_info(node_child(node, 1));
             }
             break;
         default:
-            fail("Not implemented type check: %s", NODE_TYPE_NAMES[node->type]);
+            fail("Not implemented type check: %s", NODE_TYPE_NAMES[NODE(node).type]);
     }
 }
 
-static void handle_builtin_function_type(node_t* node, symbol_t* function_symbol) {
+static void handle_builtin_function_type(node_id_t node, symbol_t* function_symbol) {
     if (strcmp(function_symbol->name, "println") == 0) {
-        node->type_info = type_create_basic(TYPE_VOID);
+        node_type_info(node) = type_create_basic(TYPE_VOID);
         return;
     }
 
     if (strcmp(function_symbol->name, "print") == 0) {
-        node->type_info = type_create_basic(TYPE_VOID);
+        node_type_info(node) = type_create_basic(TYPE_VOID);
         return;
     } 
 
     if (strcmp(function_symbol->name, "delete") == 0) {
-        node->type_info = type_create_basic(TYPE_VOID);
+        node_type_info(node) = type_create_basic(TYPE_VOID);
 
-        node_t* args_list= node->children[1];
+        node_id_t args_list= node_child(node, 1);
 
-        if (da_size(args_list->children) != 1) {
+        if (node_n_children(args_list) != 1) {
             fail_node(node, "Function %s requires exactly 1 argument, but was called with %zu\n",
                 function_symbol->name,
-                da_size(args_list->children)
+                node_n_children(args_list)
             );
         }
 
-        if (args_list->children[0]->type_info->type_class != TC_POINTER) {
+        if (node_type_info(node_child(args_list, 0))->type_class != TC_POINTER) {
             fail_node(node, "Attempt to delete non-pointer");
         }
 
@@ -632,14 +625,14 @@ static void handle_builtin_function_type(node_t* node, symbol_t* function_symbol
     }
 
     if (strcmp(function_symbol->name, "readchar") == 0) {
-        node->type_info = type_create_basic(TYPE_CHAR);
+        node_type_info(node) = type_create_basic(TYPE_CHAR);
 
-        node_t* args_list= node->children[1];
+        node_id_t args_list= node_child(node, 1);
 
-        if (da_size(args_list->children) != 0) {
+        if (node_n_children(args_list) != 0) {
             fail_node(node, "Function %s accepts no arguments, but was called with %zu\n",
                 function_symbol->name,
-                da_size(args_list->children));
+                node_n_children(args_list));
         }
         return;
     }
@@ -647,63 +640,9 @@ static void handle_builtin_function_type(node_t* node, symbol_t* function_symbol
     fail("Not implemented builtin function type: %s", function_symbol->name);
 }
 
+// Types are interned, equal types are the same object
 static bool types_equivalent(type_info_t* type_a, type_info_t* type_b) {
-    if (type_a->type_class != type_b->type_class) return false;
-
-    type_class_t type_class = type_a->type_class;
-    if (type_class == TC_BASIC) {
-        return type_a->info.info_basic == type_b->info.info_basic;
-    } else if (type_class == TC_ARRAY) {
-        type_array_t* array_a = type_a->info.info_array;
-        type_array_t* array_b = type_b->info.info_array;
-
-        if (da_size(array_a->dims) != da_size(array_b->dims)) return false;
-        for (size_t i = 0; i < da_size(array_a->dims); ++i) {
-            if (array_a->dims[i] != array_b->dims[i]) return false;
-        }
-        return types_equivalent(array_a->subtype, array_b->subtype);
-    } else if (type_class == TC_POINTER) {
-        return types_equivalent(
-            type_a->info.info_pointer->inner,
-            type_b->info.info_pointer->inner
-        );
-    } else if (type_class == TC_STRUCT) {
-        type_struct_t *struct_a = type_a->info.info_struct;
-        type_struct_t *struct_b = type_b->info.info_struct;
-
-        if (da_size(struct_a->fields) != da_size(struct_b->fields)) 
-            return false;
-
-        for (size_t i = 0; i < da_size(struct_a->fields); ++i) {
-            type_struct_field_t *field_a = struct_a->fields[i];
-            type_struct_field_t *field_b = struct_b->fields[i];
-
-            if (field_a->offset != field_b->offset)
-                return false;
-
-            if (!types_equivalent(field_a->type, field_b->type))
-                return false;
-
-            if (strcmp(field_a->name, field_b->name))
-                return false;
-        }
-
-        return true;
-    } else if (type_class == TC_TAGGED) {
-        size_t id_a = type_a->info.info_tagged->type_id;
-        size_t id_b = type_b->info.info_tagged->type_id;
-
-        if (id_a != id_b) {
-            return false;
-        }
-
-        return true;
-    } else {
-        char *msg = 0;
-        type_print(&msg, type_a);
-        fprintf(stderr, "Not implemented type class equivalency: %s\n", msg);
-        exit(EXIT_FAILURE);
-    }
+    return type_a == type_b;
 }
 
 static bool can_cast(type_info_t* type_dst, type_info_t* type_src) {
@@ -732,87 +671,257 @@ static bool can_cast(type_info_t* type_dst, type_info_t* type_src) {
 }
 
 type_info_t* type_create_basic(basic_type_t basic_type) {
-    type_info_t* type_info = malloc(sizeof(type_info_t));
-    type_info->type_class = TC_BASIC;
-    type_info->info.info_basic = basic_type;
-    return type_info;
+    type_info_t candidate = { .type_class = TC_BASIC, .info.info_basic = basic_type };
+    return type_intern(&candidate);
 }
 
-static type_info_t* create_type_function() {
-    type_info_t *type_info = malloc(sizeof(type_info_t));
-    type_info->type_class = TC_FUNCTION;
-
-    type_info->info.info_function = malloc(sizeof(type_function_t));
-    type_info->info.info_function->arg_types = create_tuple();
-    return type_info;
+// arg_types is a da, the function type takes it over
+static type_info_t* create_type_function(type_info_t** arg_types, type_info_t* return_type) {
+    type_tuple_t tuple = { .elems = arg_types };
+    type_function_t function = { .arg_types = &tuple, .return_type = return_type };
+    type_info_t candidate = { .type_class = TC_FUNCTION, .info.info_function = &function };
+    return type_intern(&candidate);
 }
 
-static type_info_t* create_type_array(type_info_t* subtype, node_t* dim_list_node) {
-    type_info_t *type_info = malloc(sizeof(type_info_t));
-    type_info->type_class = TC_ARRAY;
-    type_info->info.info_array = malloc(sizeof(type_array_t));
-    type_info->info.info_array->dims = 0;
-    for (size_t i = 0; i < da_size(dim_list_node->children); ++i) {
-        da_append(type_info->info.info_array->dims, (size_t)dim_list_node->children[i]->data.int_literal_value);
+static type_info_t* create_type_array(type_info_t* subtype, node_id_t dim_list_node) {
+    type_array_t array = { .subtype = subtype, .dims = 0 };
+    for (size_t i = 0; i < node_n_children(dim_list_node); ++i) {
+        da_append(array.dims, (size_t)NODE(node_child(dim_list_node, i)).data.int_literal_value);
     }
-    type_info->info.info_array->subtype = subtype;
-    return type_info;
+    type_info_t candidate = { .type_class = TC_ARRAY, .info.info_array = &array };
+    return type_intern(&candidate);
 }
 
 static type_info_t* create_type_pointer(type_info_t* subtype) {
-    type_info_t *type_info = malloc(sizeof(type_info_t));
-    type_info->type_class = TC_POINTER;
-    type_info->info.info_pointer = malloc(sizeof(type_pointer_t));
-    type_info->info.info_pointer->inner = subtype;
-    return type_info;
+    type_pointer_t pointer = { .inner = subtype };
+    type_info_t candidate = { .type_class = TC_POINTER, .info.info_pointer = &pointer };
+    return type_intern(&candidate);
 }
 
-static type_tuple_t* create_tuple() {
-    type_tuple_t* tuple = malloc(sizeof(type_tuple_t));
-    tuple->elems = 0;
-    return tuple;
-}
+static type_info_t* create_type_struct(node_id_t type_node) {
+    node_id_t decl_list = node_child(type_node, 0);
 
-static type_info_t* create_type_struct(node_t* type_node) {
-    type_info_t *type_info = malloc(sizeof(type_info_t));
-    type_info->type_class = TC_STRUCT;
-    type_info->info.info_struct = malloc(sizeof(type_struct_t));
-    type_info->info.info_struct->fields = 0;
+    type_struct_t structure = { .fields = 0 };
+    for (size_t i = 0; i < node_n_children(decl_list); ++i) {
+        node_id_t decl = node_child(decl_list, i);
+        assert(NODE(node_child(decl, 1)).type == TYPE);
+        register_type_node(node_child(decl, 1));
+        assert(node_type_info(node_child(decl, 1)) != NULL);
 
-    node_t* decl_list = type_node->children[0];
+        node_type_info(node_child(decl, 0)) = node_type_info(node_child(decl, 1));
 
-    size_t offset = 0;
-    for (size_t i = 0; i < da_size(decl_list->children); ++i) {
-        node_t* decl = decl_list->children[i];
-        char* identifier = decl->children[0]->data.identifier_str;
-        assert(decl->children[1]->type == TYPE);
-        register_type_node(decl->children[1]);
-        assert(decl->children[1]->type_info != NULL);
+        type_struct_field_t *field_type = arena_new(&compilation->arena, type_struct_field_t);
+        field_type->name = NODE(node_child(decl, 0)).data.identifier_str;
+        field_type->type = node_type_info(node_child(decl, 1));
+        da_append(structure.fields, field_type);
+    }
+    type_info_t candidate = { .type_class = TC_STRUCT, .info.info_struct = &structure };
+    type_info_t* type_info = type_intern(&candidate);
+
+    // The offsets live on the fields of the canonical struct
+    for (size_t i = 0; i < node_n_children(decl_list); ++i) {
+        node_id_t decl = node_child(decl_list, i);
+        node_type_info(decl) = arena_new(&compilation->arena, type_info_t);
+        node_type_info(decl)->type_class = TC_STRUCT_FIELD;
+        node_type_info(decl)->untagged = node_type_info(decl);
+        node_type_info(decl)->info.info_struct_field = type_info->info.info_struct->fields[i];
+    }
+    return type_info;
+}
+
+static type_info_t* create_type_tagged(size_t sequence_number, type_info_t* type) {
+    type_tagged_t tagged = { .type_id = sequence_number, .type = type };
+    type_info_t candidate = { .type_class = TC_TAGGED, .info.info_tagged = &tagged };
+    return type_intern(&candidate);
+}
 
-        decl->children[0]->type_info = decl->children[1]->type_info;
+// The components of a type are canonical by the time the type itself is
+// interned, so hashing and comparing them by address is enough. Field
+// names are atoms.
+static uint64_t type_hash(const void* key) {
+    const type_info_t* type = *(type_info_t* const*)key;
+    uint64_t hash = type->type_class;
+#define MIX(value) hash = hash * 31 + (uint64_t)(value)
+    switch (type->type_class) {
+        case TC_BASIC:
+            MIX(type->info.info_basic);
+            break;
+        case TC_POINTER:
+            MIX((uintptr_t)type->info.info_pointer->inner);
+            break;
+        case TC_ARRAY:
+            MIX((uintptr_t)type->info.info_array->subtype);
+            for (size_t i = 0; i < da_size(type->info.info_array->dims); ++i) {
+                MIX(type->info.info_array->dims[i]);
+            }
+            break;
+        case TC_STRUCT:
+            for (size_t i = 0; i < da_size(type->info.info_struct->fields); ++i) {
+                MIX((uintptr_t)type->info.info_struct->fields[i]->name);
+                MIX((uintptr_t)type->info.info_struct->fields[i]->type);
+            }
+            break;
+        case TC_FUNCTION:
+            MIX((uintptr_t)type->info.info_function->return_type);
+            for (size_t i = 0; i < da_size(type->info.info_function->arg_types->elems); ++i) {
+                MIX((uintptr_t)type->info.info_function->arg_types->elems[i]);
+            }
+            break;
+        case TC_TAGGED:
+            MIX(type->info.info_tagged->type_id);
+            break;
+        default:
+            assert(false && "Type class is not interned");
+    }
+#undef MIX
+    return hash;
+}
 
-        type_struct_field_t *field_type = malloc(sizeof(type_struct_field_t));
-        field_type->name = identifier;
-        field_type->type = decl->children[1]->type_info;
-        field_type->offset = offset;
+static int type_eq(const void* key_a, const void* key_b) {
+    const type_info_t* type_a = *(type_info_t* const*)key_a;
+    const type_info_t* type_b = *(type_info_t* const*)key_b;
+    if (type_a->type_class != type_b->type_class) return false;
 
-        decl->type_info = malloc(sizeof(type_info_t));
-        decl->type_info->type_class = TC_STRUCT_FIELD;
-        decl->type_info->info.info_struct_field = field_type;
+    switch (type_a->type_class) {
+        case TC_BASIC:
+            return type_a->info.info_basic == type_b->info.info_basic;
+        case TC_POINTER:
+            return type_a->info.info_pointer->inner == type_b->info.info_pointer->inner;
+        case TC_ARRAY:
+            {
+                type_array_t* array_a = type_a->info.info_array;
+                type_array_t* array_b = type_b->info.info_array;
+                if (array_a->subtype != array_b->subtype) return false;
+                if (da_size(array_a->dims) != da_size(array_b->dims)) return false;
+                for (size_t i = 0; i < da_size(array_a->dims); ++i) {
+                    if (array_a->dims[i] != array_b->dims[i]) return false;
+                }
+                return true;
+            }
+        case TC_STRUCT:
+            {
+                type_struct_field_t** fields_a = type_a->info.info_struct->fields;
+                type_struct_field_t** fields_b = type_b->info.info_struct->fields;
+                if (da_size(fields_a) != da_size(fields_b)) return false;
+                for (size_t i = 0; i < da_size(fields_a); ++i) {
+                    if (fields_a[i]->name != fields_b[i]->name) return false;
+                    if (fields_a[i]->type != fields_b[i]->type) return false;
+                }
+                return true;
+            }
+        case TC_FUNCTION:
+            {
+                type_function_t* function_a = type_a->info.info_function;
+                type_function_t* function_b = type_b->info.info_function;
+                if (function_a->return_type != function_b->return_type) return false;
+                if (da_size(function_a->arg_types->elems) != da_size(function_b->arg_types->elems)) return false;
+                for (size_t i = 0; i < da_size(function_a->arg_types->elems); ++i) {
+                    if (function_a->arg_types->elems[i] != function_b->arg_types->elems[i]) return false;
+                }
+                return true;
+            }
+        case TC_TAGGED:
+            return type_a->info.info_tagged->type_id == type_b->info.info_tagged->type_id;
+        default:
+            assert(false && "Type class is not interned");
+    }
+}
 
-        da_append(type_info->info.info_struct->fields, field_type);
+static void* arena_dup(const void* object, size_t size) {
+    void* copy = arena_alloc(&compilation->arena, size);
+    memcpy(copy, object, size);
+    return copy;
+}
 
-        offset += type_sizeof(field_type->type);
+// Size, alignment and field offsets. Every value is laid out in 8 byte
+// slots except char, array elements always take a slot and structs are
+// packed; gen and tac depend on that.
+static void type_layout(type_info_t* type) {
+    type->untagged = type;
+    switch (type->type_class) {
+        case TC_BASIC:
+            type->size = type->info.info_basic == TYPE_CHAR ? 1 : 8;
+            type->align = type->size;
+            break;
+        case TC_POINTER:
+            type->size = 8;
+            type->align = 8;
+            break;
+        case TC_ARRAY:
+            type->size = 8;
+            for (size_t i = 0; i < da_size(type->info.info_array->dims); ++i) {
+                type->size *= type->info.info_array->dims[i];
+            }
+            type->align = 8;
+            break;
+        case TC_STRUCT:
+            type->size = 0;
+            type->align = 1;
+            for (size_t i = 0; i < da_size(type->info.info_struct->fields); ++i) {
+                type_struct_field_t* field = type->info.info_struct->fields[i];
+                field->offset = type->size;
+                type->size += field->type->size;
+                if (field->type->align > type->align) {
+                    type->align = field->type->align;
+                }
+            }
+            break;
+        case TC_TAGGED:
+            type->size = type->info.info_tagged->type->size;
+            type->align = type->info.info_tagged->type->align;
+            type->untagged = type->info.info_tagged->type->untagged;
+            break;
+        default:
+            break;
     }
-    return type_info;
 }
 
-static type_info_t* create_type_tagged(size_t sequence_number, type_info_t* type) {
-    type_info_t *type_info = malloc(sizeof(type_info_t));
-    type_info->type_class = TC_TAGGED;
-    type_info->info.info_tagged = malloc(sizeof(type_tagged_t));
-    type_info->info.info_tagged->type_id = sequence_number;
-    type_info->info.info_tagged->type = type;
+// Returns the canonical type equal to candidate. The candidate and its info
+// may live on the stack, a new canonical type is copied into the arena and
+// takes over the candidate's da's, otherwise they are freed.
+static type_info_t* type_intern(type_info_t* candidate) {
+    da_map_t* table = &compilation->type_intern;
+    if (!da_map_is_init(table)) {
+        da_map_init(table, type_info_t*, type_info_t*, type_hash, type_eq);
+    }
+
+    type_info_t** canonical = da_map_get(table, &candidate);
+    if (canonical != NULL) {
+        switch (candidate->type_class) {
+            case TC_ARRAY:    da_deinit(candidate->info.info_array->dims); break;
+            case TC_STRUCT:   da_deinit(candidate->info.info_struct->fields); break;
+            case TC_FUNCTION: da_deinit(candidate->info.info_function->arg_types->elems); break;
+            default: break;
+        }
+        return *canonical;
+    }
+
+    type_info_t* type_info = arena_dup(candidate, sizeof *candidate);
+    switch (type_info->type_class) {
+        case TC_POINTER:
+            type_info->info.info_pointer = arena_dup(candidate->info.info_pointer, sizeof(type_pointer_t));
+            break;
+        case TC_ARRAY:
+            type_info->info.info_array = arena_dup(candidate->info.info_array, sizeof(type_array_t));
+            arena_own_da(&compilation->arena, &type_info->info.info_array->dims);
+            break;
+        case TC_STRUCT:
+            type_info->info.info_struct = arena_dup(candidate->info.info_struct, sizeof(type_struct_t));
+            arena_own_da(&compilation->arena, &type_info->info.info_struct->fields);
+            break;
+        case TC_FUNCTION:
+            type_info->info.info_function = arena_dup(candidate->info.info_function, sizeof(type_function_t));
+            type_info->info.info_function->arg_types = arena_dup(candidate->info.info_function->arg_types, sizeof(type_tuple_t));
+            arena_own_da(&compilation->arena, &type_info->info.info_function->arg_types->elems);
+            break;
+        case TC_TAGGED:
+            type_info->info.info_tagged = arena_dup(candidate->info.info_tagged, sizeof(type_tagged_t));
+            break;
+        default:
+            break;
+    }
+    type_layout(type_info);
+    da_map_put(table, &type_info, &type_info);
     return type_info;
 }
 
@@ -896,7 +1005,7 @@ void type_print(char **str, type_info_t* type) {
             }
         case TC_TAGGED:
             {
-                daprintf(str, "%s", global_type_table->symbols[type->info.info_tagged->type_id]->name);
+                daprintf(str, "%s", compilation->global_type_table->symbols[type->info.info_tagged->type_id]->name);
             }
             break;
     }
@@ -920,39 +1029,14 @@ static basic_type_t is_basic_type(const char* identifier_str) {
 }
 
 type_info_t* type_penetrate_tagged(type_info_t *type_info) {
-    if (type_info->type_class != TC_TAGGED) {
-        return type_info;
-    }
-    return type_penetrate_tagged(type_info->info.info_tagged->type);
+    return type_info->untagged;
 }
 
 size_t type_sizeof(type_info_t* type) {
-    // TODO: may be beneficial to store alongside the type info?
-
-    if (type->type_class == TC_BASIC) {
-        if (type->info.info_basic == TYPE_CHAR) {
-            return 1;
-        }
-        return 8;
-    } else if (type->type_class == TC_ARRAY) {
-        size_t total_size = 1;
-        for (size_t j = 0; j < da_size(type->info.info_array->dims); ++j) {
-            total_size *= type->info.info_array->dims[j];
-        }
-        total_size *= 8;
-        return total_size;
-    } else if (type->type_class == TC_POINTER) {
-        return 8;
-    } else if (type->type_class == TC_STRUCT) {
-        // TODO: padding?
-        size_t total_size = 0;
-        for (size_t i = 0; i < da_size(type->info.info_struct->fields); ++i) {
-            total_size += type_sizeof(type->info.info_struct->fields[i]->type);
-        }
-        return total_size;
-    } else if (type->type_class == TC_TAGGED) {
-        return type_sizeof(type->info.info_tagged->type);
-    } else {
-        assert(false && "Not implemented");
-    }
+    assert(type->type_class != TC_FUNCTION
+        && type->type_class != TC_STRUCT_FIELD
+        && type->type_class != TC_TUPLE
+        && type->type_class != TC_UNKNOWN
+        && "Not implemented");
+    return type->size;
 }
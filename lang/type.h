@@ -27,8 +27,16 @@ typedef enum {
     TC_UNKNOWN
 } type_class_t;
 
+// Types are hash-consed: register_types creates at most one type_info_t per
+// distinct type, so two types are equal exactly when the pointers are. Size,
+// alignment and (for structs) field offsets are laid out once, when the
+// canonical type is created. The TC_STRUCT_FIELD infos hung off struct
+// member declarations are the exception, those are not interned.
 struct type_info_t {
     type_class_t type_class;
+    size_t size;
+    size_t align;
+    type_info_t* untagged;  // the type with every TC_TAGGED layer removed
     union {
         basic_type_t info_basic;
         struct type_array_t* info_array;
@@ -75,14 +83,15 @@ typedef struct type_tagged_t {
 } type_tagged_t;
 
 extern char* BASIC_TYPE_NAMES[];
-extern symbol_table_t* global_type_table;
 
-void register_types();
+void register_types(compilation_t* c);
 
 type_info_t* type_create_basic(basic_type_t basic_type);
 
+// The type a named type stands for
 type_info_t* type_penetrate_tagged(type_info_t *type_info);
 
+// Bytes a value of the type occupies, not defined for functions
 size_t type_sizeof(type_info_t*);
 
 void type_print(char**, type_info_t*);
@@ -1,5 +1,7 @@
 #include "dfa.h"
 #include "da.h"
+#include "da_map.h"
+#include "da_bitset.h"
 #include "nfa.h"
 #include <stdlib.h>
 #include <stdio.h>
@@ -8,19 +10,11 @@
 
 typedef struct node_subset_t node_subset_t;
 struct node_subset_t {
-    nfa_node_t** nodes;
+    da_bitset_t nodes; // set of nfa_node_t ids
     node_subset_t* trans[256];
+    int index; // index in the resulting dfa
 };
 
-int node_ptr_cmp(const void* node_ptr_a, const void* node_ptr_b) {
-    nfa_node_t* a = *(nfa_node_t**)node_ptr_a;
-    nfa_node_t* b = *(nfa_node_t**)node_ptr_b;
-    if (a < b) return -1;
-    if (a == b) return 0;
-    return 1;
-}
-
-
 node_subset_t* make_subset() {
     node_subset_t* subset = malloc(sizeof(node_subset_t));
     subset->nodes = 0;
@@ -28,55 +22,43 @@ node_subset_t* make_subset() {
 }
 
 void subset_deinit(node_subset_t* subset) {
-    da_deinit(subset->nodes);
+    da_bitset_deinit(subset->nodes);
     free(subset);
 }
 
 int node_subset_contains(node_subset_t* subset, nfa_node_t* node) {
-    // Could binary search but...
-    for (int i = 0; i < da_size(subset->nodes); ++i) {
-        nfa_node_t* cur = subset->nodes[i];
-        if (cur == node) return 1;
-    }
-    return 0;
+    return da_bitset_test(subset->nodes, node->id);
 }
 
 void node_subset_add(node_subset_t* subset, nfa_node_t* node) {
-    da_append(subset->nodes, node);
-    // Stay sorted
-    qsort(subset->nodes, da_size(subset->nodes), sizeof(nfa_node_t*), node_ptr_cmp);
+    assert(node->id >= 0); // Node is not in the nfa node list
+    da_bitset_set(&subset->nodes, node->id);
 }
 
 int node_subset_equals(node_subset_t* subset_a, node_subset_t* subset_b) {
-    if (da_size(subset_a->nodes) != da_size(subset_b->nodes)) return 0;
+    return da_bitset_equals(subset_a->nodes, subset_b->nodes);
+}
 
-    // Assume sorted
-    for (int i = 0; i < da_size(subset_a->nodes); ++i) {
-        nfa_node_t* node_a = subset_a->nodes[i];
-        nfa_node_t* node_b = subset_b->nodes[i];
-        if (node_a != node_b) return 0;
-    }
-    return 1;
+// For da_map keyed on node_subset_t*, by set contents
+uint64_t node_subset_hash(const void* key) {
+    return da_bitset_hash((*(node_subset_t**)key)->nodes);
+}
+
+int node_subset_eq(const void* key_a, const void* key_b) {
+    return node_subset_equals(*(node_subset_t**)key_a, *(node_subset_t**)key_b);
 }
 
 void epsilon_closure(nfa_node_t* node, node_subset_t* subset) {
     if (node_subset_contains(subset, node)) return;
     node_subset_add(subset, node);
 
-    for (int i = 0; i < da_size(node->transitions); ++i) {
+    for (size_t i = 0; i < da_size(node->transitions); ++i) {
         transition_t trans = node->transitions[i];
         if (trans.c != NFA_TRANS_EPS) continue;
         epsilon_closure(trans.next_node, subset);
     }
 }
 
-void subset_epsilon_closure(node_subset_t* subset) {
-    for (int i = 0; i < da_size(subset->nodes); ++i) {
-        nfa_node_t* node = subset->nodes[i];
-        epsilon_closure(node, subset);
-    }
-}
-
 // Subset construction algorithm
 //  - The subset of nodes in the same epsilon closure (reachable by only traversing epsilon transitions)
 //    form a separate node in the dfa
@@ -86,7 +68,12 @@ void subset_epsilon_closure(node_subset_t* subset) {
 //      - The algorithm terminates when all reachable subsets have been checked
 //      - Worst case should be 2^n possible subsets, but typically terminates way faster
 //  - If a subset contains the accepting state of the nfa, that node is accepting in the resulting dfa.
-dfa_t* dfa_from_nfa(nfa_t* nfa) {
+//    With several accepting states, the first one in the subset decides the node_token.
+static dfa_t* dfa_from_nfa_accepting(nfa_t* nfa, nfa_node_t** accepting, int num_accepting) {
+    // Subsets are bitsets over node ids
+    for (size_t i = 0; i < da_size(nfa->nodes); ++i) {
+        nfa->nodes[i]->id = i;
+    }
 
     node_subset_t* node_empty = make_subset();
     for (int i = 0; i < 256; ++i) {
@@ -96,6 +83,7 @@ dfa_t* dfa_from_nfa(nfa_t* nfa) {
 
     node_subset_t** subset_nodes = 0;
     da_append(subset_nodes, node_empty);
+    node_empty->index = 0;
 
     node_subset_t* node_init = make_subset();
     // Default is to go to empty
@@ -103,12 +91,19 @@ dfa_t* dfa_from_nfa(nfa_t* nfa) {
         node_init->trans[i] = node_empty;
     }
     da_append(subset_nodes, node_init);
+    node_init->index = 1;
 
     epsilon_closure(nfa->initial_state, node_init);
 
+    // Subset contents -> subset, to find out if a subset has been seen before
+    da_map_t subset_map;
+    da_map_init(&subset_map, node_subset_t*, node_subset_t*, node_subset_hash, node_subset_eq);
+    da_map_put(&subset_map, &node_empty, &node_empty);
+    da_map_put(&subset_map, &node_init, &node_init);
+
     nfa_node_t** next_set = 0;
 
-    for (int i = 1; i < da_size(subset_nodes); ++i) {
+    for (size_t i = 1; i < da_size(subset_nodes); ++i) {
         node_subset_t* cur_subset = subset_nodes[i];
         for (int c = 0; c < 256; ++c) {
             // Special case: c == EPS would cause wrongful transitions
@@ -118,30 +113,23 @@ dfa_t* dfa_from_nfa(nfa_t* nfa) {
             }
             // Transition all nodes in current subset on character c
             da_clear(next_set);
-            for (int j = 0; j < da_size(cur_subset->nodes); ++j) {
-                nfa_node_t* cur_node = cur_subset->nodes[j];
+            da_bitset_foreach(cur_subset->nodes, j) {
+                nfa_node_t* cur_node = nfa->nodes[j];
                 nfa_node_transition(cur_node, c, &next_set);
             }
 
             // Get the epsilon closure of the new set
             node_subset_t* next_subset_cand = make_subset();
-            for (int j = 0; j < da_size(next_set); ++j) {
+            for (size_t j = 0; j < da_size(next_set); ++j) {
                 nfa_node_t* node = next_set[j];
                 epsilon_closure(node, next_subset_cand);
             }
 
-            node_subset_t* next_subset = NULL;
             // Check if the resulting subset already exists
-            for (int j = 0; j < da_size(subset_nodes); ++j) {
-                node_subset_t* existing = subset_nodes[j];
-                if (node_subset_equals(next_subset_cand, existing)) {
-                    next_subset = existing;
-                    break;
-                }
-            }
-            if (next_subset == NULL) {
+            node_subset_t* next_subset = *(node_subset_t**)da_map_get_or_put(&subset_map, &next_subset_cand, &next_subset_cand);
+            if (next_subset == next_subset_cand) {
+                next_subset->index = da_size(subset_nodes);
                 da_append(subset_nodes, next_subset_cand);
-                next_subset = next_subset_cand;
             } else {
                 subset_deinit(next_subset_cand);
             }
@@ -150,6 +138,7 @@ dfa_t* dfa_from_nfa(nfa_t* nfa) {
         }
     }
     da_deinit(next_set);
+    da_map_deinit(&subset_map);
 
     dfa_t* dfa = malloc(sizeof(dfa_t));
     dfa->num_nodes = da_size(subset_nodes);
@@ -157,6 +146,7 @@ dfa_t* dfa_from_nfa(nfa_t* nfa) {
     dfa->trans = malloc(dfa->num_nodes * sizeof(int*));
     dfa->node_flag = malloc(dfa->num_nodes * sizeof(int));
     memset(dfa->node_flag, 0, dfa->num_nodes * sizeof(int));
+    dfa->node_token = malloc(dfa->num_nodes * sizeof(int));
 
     dfa->node_flag[0] = DFA_FLAG_ERROR;
     dfa->node_flag[1] = DFA_FLAG_INITIAL;
@@ -165,32 +155,44 @@ dfa_t* dfa_from_nfa(nfa_t* nfa) {
         dfa->trans[i] = malloc(256 * sizeof(int));
 
         node_subset_t* cur_subset = subset_nodes[i];
-        if (node_subset_contains(cur_subset, nfa->accepting_state)) {
-            assert(i > 0);
-            dfa->node_flag[i] |= DFA_FLAG_ACCEPT;
+        dfa->node_token[i] = -1;
+        for (int r = 0; r < num_accepting; ++r) {
+            if (node_subset_contains(cur_subset, accepting[r])) {
+                assert(i > 0);
+                dfa->node_flag[i] |= DFA_FLAG_ACCEPT;
+                dfa->node_token[i] = r;
+                break;
+            }
         }
 
         for (int c = 0; c < 256; ++c) {
-            node_subset_t* next = cur_subset->trans[c];
-            size_t index = da_indexof(subset_nodes, &next);
-            assert(index != -1);
-            dfa->trans[i][c] = index;
+            dfa->trans[i][c] = cur_subset->trans[c]->index;
         }
-
-        subset_deinit(cur_subset);
     }
 
+    // Separate pass, transitions read the index of every subset
+    for (int i = 0; i < dfa->num_nodes; ++i) {
+        subset_deinit(subset_nodes[i]);
+    }
     da_deinit(subset_nodes);
 
     return dfa;
 }
 
+dfa_t* dfa_from_nfa(nfa_t* nfa) {
+    return dfa_from_nfa_accepting(nfa, &nfa->accepting_state, 1);
+}
+
 void dfa_swap_nodes(dfa_t* dfa, int node_a, int node_b) {
     if (node_a == node_b) return;
     dfa->node_flag[node_a] ^= dfa->node_flag[node_b];
     dfa->node_flag[node_b] ^= dfa->node_flag[node_a];
     dfa->node_flag[node_a] ^= dfa->node_flag[node_b];
 
+    int token = dfa->node_token[node_a];
+    dfa->node_token[node_a] = dfa->node_token[node_b];
+    dfa->node_token[node_b] = token;
+
     for (int i = 0; i < 256; ++i) {
         dfa->trans[node_a][i] ^= dfa->trans[node_b][i];
         dfa->trans[node_b][i] ^= dfa->trans[node_a][i];
@@ -209,7 +211,7 @@ void dfa_swap_nodes(dfa_t* dfa, int node_a, int node_b) {
 // Myhill-Nerode "Table-filling" algorithm
 // Mark pairs of nodes as equivalent: two nodes are equivalent iff they are not distinguishable
 // A pair of nodes (q_a, q_b) are distinguishable if:
-// - One is final (accepting) and the other one is not (base case)
+// - One is final (accepting) and the other one is not, or they accept different regexes (base case)
 // - (trans[q_a][c], trans[q_b][c]) are distinguishable for some c in the alphabet
 //
 // Not a very effective implementation, but a simple one
@@ -223,7 +225,8 @@ void dfa_minimize(dfa_t* dfa) {
     // Initial base case
     for (int i = 0; i < dfa->num_nodes; ++i) {
         for (int j = i + 1; j < dfa->num_nodes; ++j) {
-            if ((dfa->node_flag[i] & DFA_FLAG_ACCEPT) ^ (dfa->node_flag[j] & DFA_FLAG_ACCEPT)) {
+            if ((dfa->node_flag[i] & DFA_FLAG_ACCEPT) ^ (dfa->node_flag[j] & DFA_FLAG_ACCEPT)
+             || dfa->node_token[i] != dfa->node_token[j]) {
                 distinguishable[i][j] = 1;
             }
         }
@@ -298,6 +301,7 @@ void dfa_minimize(dfa_t* dfa) {
     // reallocarray is apparently smarter than realloc by handling overflow??
     dfa->trans     = reallocarray(dfa->trans, ptr, sizeof(int*));
     dfa->node_flag = reallocarray(dfa->node_flag, ptr, sizeof(int));
+    dfa->node_token = reallocarray(dfa->node_token, ptr, sizeof(int));
 
     dfa->num_nodes = ptr;
 }
@@ -314,11 +318,43 @@ dfa_t* dfa_from_regex(char* regex_string, size_t size) {
     return dfa;
 }
 
+dfa_t* dfa_from_regex_set(char** regex_strings, size_t* sizes, int num_regexes) {
+    // Union of all the nfas, but each keeps its own accepting state
+    //   INIT---EPS-->NFA_0
+    //     \---EPS-->NFA_1
+    //      ...
+    nfa_t nfa;
+    nfa_init(&nfa);
+    nfa.initial_state = malloc(sizeof(nfa_node_t));
+    nfa_node_init(nfa.initial_state);
+    da_append(nfa.nodes, nfa.initial_state);
+    nfa.accepting_state = 0;
+
+    nfa_node_t** accepting = malloc(num_regexes * sizeof(nfa_node_t*));
+    for (int r = 0; r < num_regexes; ++r) {
+        nfa_t sub_nfa;
+        nfa_init(&sub_nfa);
+        nfa_from_regex(regex_strings[r], sizes[r], &sub_nfa);
+
+        nfa_node_add_transition(nfa.initial_state, NFA_TRANS_EPS, sub_nfa.initial_state);
+        da_append_n(nfa.nodes, sub_nfa.nodes, da_size(sub_nfa.nodes));
+        accepting[r] = sub_nfa.accepting_state;
+        nfa_deinit(&sub_nfa);
+    }
+
+    dfa_t* dfa = dfa_from_nfa_accepting(&nfa, accepting, num_regexes);
+    dfa_minimize(dfa);
+    free(accepting);
+    nfa_free_nodes(&nfa);
+    nfa_deinit(&nfa);
+    return dfa;
+}
+
 int dfa_accepts(dfa_t* dfa, char* string, size_t size) {
     int cur_state = 1; // Assumes initial state is 1
 
-    for (int i = 0; i < size; ++i) {
-        char c = string[i];
+    for (size_t i = 0; i < size; ++i) {
+        unsigned char c = string[i];
         cur_state = dfa->trans[cur_state][c];
         // Break early on error
         if (cur_state == 0) return 0;
@@ -327,17 +363,24 @@ int dfa_accepts(dfa_t* dfa, char* string, size_t size) {
 }
 
 size_t dfa_match(dfa_t *dfa, char *string, size_t max_len) {
+    int token;
+    return dfa_match_token(dfa, string, max_len, &token);
+}
+
+size_t dfa_match_token(dfa_t *dfa, char *string, size_t max_len, int* token) {
     int cur_state = 1;
 
     size_t last_match = 0;
+    *token = -1;
     for (size_t i = 0; i < max_len; ++i) {
-        char c = string[i];
+        unsigned char c = string[i];
         cur_state = dfa->trans[cur_state][c];
 
         if (cur_state == 0) return last_match;
 
         if (dfa->node_flag[cur_state] & DFA_FLAG_ACCEPT) {
             last_match = i + 1;
+            *token = dfa->node_token[cur_state];
         }
     }
 
@@ -350,4 +393,5 @@ void dfa_deinit(dfa_t *dfa) {
     }
     free(dfa->trans);
     free(dfa->node_flag);
+    free(dfa->node_token);
 }
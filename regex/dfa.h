@@ -16,14 +16,22 @@ struct dfa_t {
     // num_nodes x 256 table
     int** trans;
     int* node_flag;
+    // Index of the regex an accepting node accepts, -1 for other nodes.
+    // Always 0 for dfas of a single regex.
+    int* node_token;
 };
 
 dfa_t* dfa_from_nfa(nfa_t* nfa);
 dfa_t* dfa_from_regex(char* regex_string, size_t size);
+// One minimized dfa accepting any of the regexes. A node that accepts several
+// of them accepts the one with the lowest index, so the order is the priority.
+dfa_t* dfa_from_regex_set(char** regex_strings, size_t* sizes, int num_regexes);
 void dfa_minimize(dfa_t* dfa);
 int    dfa_accepts(dfa_t* dfa, char* string, size_t size);
 // Match maximal prefix of string. Return the length of the match.
 size_t dfa_match(dfa_t* dfa, char* string, size_t max_len);
+// dfa_match that also gives the node_token of the match, -1 if there is none
+size_t dfa_match_token(dfa_t* dfa, char* string, size_t max_len, int* token);
 void   dfa_deinit(dfa_t* dfa);
 
 #endif // DFA_H
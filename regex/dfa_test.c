@@ -12,6 +12,8 @@
 
 #define DFA_MATCH_TEST(dfa, str, result) { size_t ret = dfa_match(dfa, str, strlen(str)); printf("\"%s\" should match %zu characters %s \x1b[0m(matched %zu)\n", str, result, (ret == result ? "and it\x1b[1;32m does" : "but it\x1b[1;31m doesn't"), ret); }
 
+#define DFA_TOKEN_TEST(dfa, str, len, tok) { int t; size_t ret = dfa_match_token(dfa, str, strlen(str), &t); printf("\"%s\" should match %zu characters as %d %s \x1b[0m(matched %zu as %d)\n", str, (size_t)len, tok, (ret == len && t == tok ? "and it\x1b[1;32m does" : "but it\x1b[1;31m doesn't"), ret, t); }
+
 #define WALLTIME(t) ((double)(t).tv_sec + 1e-6 * (double)(t).tv_usec)
 
 void debug_nfa(nfa_t* nfa) {
@@ -332,6 +334,22 @@ void dfa_class_test() {
     printf("\n\n\n");
 }
 
+void dfa_negated_class_test() {
+    char* regex = "\"[^\"]*\"";
+
+    printf("===== %s =====\n", regex);
+    dfa_t* dfa = dfa_from_regex(regex, strlen(regex));
+    printf("Num nodes: %d\n\n", dfa->num_nodes);
+
+    DFA_PRINT_TEST(dfa, "\"\"", 1);
+    DFA_PRINT_TEST(dfa, "\"abc 123 \\n\"", 1);
+    DFA_PRINT_TEST(dfa, "\"abc\"def\"", 0);
+    DFA_PRINT_TEST(dfa, "\"unterminated", 0);
+
+    dfa_deinit(dfa);
+    free(dfa);
+}
+
 void dfa_class2_test() {
     char* regex = "[--e]*"; // characters in the range '-' (45) to 'e' (101)
 
@@ -489,6 +507,29 @@ void dfa_match_test() {
     free(dfa);
 }
 
+void dfa_regex_set_test() {
+    // Keywords before identifiers, so "if" is token 0 and "iffy" token 1
+    char* regexes[] = {"if", "[a-z]+", "\\d+", "\\d+\\.\\d*", " +"};
+    size_t sizes[5];
+    for (int i = 0; i < 5; ++i) sizes[i] = strlen(regexes[i]);
+
+    printf("===== regex set =====\n");
+    dfa_t* dfa = dfa_from_regex_set(regexes, sizes, 5);
+    printf("Num nodes: %d\n\n", dfa->num_nodes);
+
+    DFA_TOKEN_TEST(dfa, "if (x)", 2, 0);
+    DFA_TOKEN_TEST(dfa, "iffy", 4, 1);
+    DFA_TOKEN_TEST(dfa, "i", 1, 1);
+    DFA_TOKEN_TEST(dfa, "123+4", 3, 2);
+    DFA_TOKEN_TEST(dfa, "12.5;", 4, 3);
+    DFA_TOKEN_TEST(dfa, "12.x", 3, 3);
+    DFA_TOKEN_TEST(dfa, "   x", 3, 4);
+    DFA_TOKEN_TEST(dfa, "+", 0, -1);
+
+    dfa_deinit(dfa);
+    free(dfa);
+}
+
 int main(int argc, char** argv) {
     dfa_concat_test();
     dfa_paren_test();
@@ -503,9 +544,11 @@ int main(int argc, char** argv) {
     dfa_word_test();
     dfa_class_test();
     dfa_class2_test();
+    dfa_negated_class_test();
     dfa_var_test();
     dfa_fat_test();
     dfa_linear_test();
     dfa_match_test();
+    dfa_regex_set_test();
     dfa_timing_test();
 }
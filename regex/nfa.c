@@ -20,14 +20,15 @@ void nfa_deinit(nfa_t *nfa) {
 void nfa_free_nodes(nfa_t *nfa) {
     // Separate from deinit, because sometimes nodes need to live longer
     // mindfuck lifetime business
-    for (int i = 0; i < da_size(nfa->nodes); ++i) {
+    for (size_t i = 0; i < da_size(nfa->nodes); ++i) {
         nfa_node_t* node = nfa->nodes[i];
         nfa_node_free(node);
     }
 }
 
 void nfa_node_init(nfa_node_t* node) {
-    node->transitions = 0;
+    node->id = -1;
+    da_init_inline(node->transitions, node->transitions_buf);
 }
 
 void nfa_node_free(nfa_node_t* node) {
@@ -49,7 +50,7 @@ int nfa_accepts_impl(nfa_t* nfa, nfa_node_t* cur_state, char* string, size_t siz
     }
 
     int ret = 0;
-    for (int i = 0; i < da_size(cur_state->transitions); ++i) {
+    for (size_t i = 0; i < da_size(cur_state->transitions); ++i) {
         transition_t trans = cur_state->transitions[i];
         if (size > 0 && trans.c == string[0]) {
             ret |= nfa_accepts_impl(nfa, trans.next_node, string+1, size - 1);
@@ -68,7 +69,7 @@ int nfa_accepts(nfa_t* nfa, char* string, size_t size) {
 }
 
 void nfa_node_transition(nfa_node_t* node, char c, nfa_node_t*** result) {
-    for (int i = 0; i < da_size(node->transitions); ++i) {
+    for (size_t i = 0; i < da_size(node->transitions); ++i) {
 
         transition_t trans = node->transitions[i];
         if (trans.c == c) {
@@ -82,7 +83,7 @@ int* regex_paren_match(char* regex_string, size_t size) {
     memset(paren_match, -1, size * sizeof(int));
     int* paren_stack = 0;
 
-    for (int i = 0; i < size; ++i) {
+    for (size_t i = 0; i < size; ++i) {
         if (regex_string[i] == '(') {
             da_append(paren_stack, i);
         } else if (regex_string[i] == ')') {
@@ -91,7 +92,7 @@ int* regex_paren_match(char* regex_string, size_t size) {
             int loc = paren_stack[da_size(paren_stack) - 1];
             paren_match[loc] = i;
             paren_match[i] = loc;
-            da_pop(paren_stack);
+            (void)da_pop(paren_stack);
         }
     }
 
@@ -103,12 +104,12 @@ int* regex_paren_match(char* regex_string, size_t size) {
 
 nfa_t* concat_nfas(nfa_t** concat_list) {
     nfa_t* ret = concat_list[0];
-    for (int i = 1; i < da_size(concat_list); ++i) {
+    for (size_t i = 1; i < da_size(concat_list); ++i) {
         nfa_t* cur = concat_list[i];
         nfa_node_add_transition(ret->accepting_state, NFA_TRANS_EPS, cur->initial_state);
         ret->accepting_state = cur->accepting_state;
 
-        for (int j = 0; j < da_size(cur->nodes); ++j) {
+        for (size_t j = 0; j < da_size(cur->nodes); ++j) {
             da_append(ret->nodes, cur->nodes[j]);
         }
         nfa_deinit(cur);
@@ -199,7 +200,7 @@ void nfa_from_regex_impl(regex_t regex, size_t start, size_t end, nfa_t* nfa) {
     // List of expressions that are supposed to be concatenated
     nfa_t** concat_list = 0;
 
-    for (int i = start; i < end; ) {
+    for (size_t i = start; i < end; ) {
         regex_symbol_t symbol = regex_symbol_at(&regex, i);
         switch (symbol.symbol_type) {
             case CLASS:
@@ -258,7 +259,7 @@ void nfa_from_regex_impl(regex_t regex, size_t start, size_t end, nfa_t* nfa) {
     assert(da_size(union_list) > 0);
 
     nfa_t* ret = union_list[0];
-    for (int i = 1; i < da_size(union_list); ++i) {
+    for (size_t i = 1; i < da_size(union_list); ++i) {
         nfa_t* cur = union_list[i];
         nfa_node_t* union_enter = malloc(sizeof(nfa_node_t));
         nfa_node_init(union_enter);
@@ -277,7 +278,7 @@ void nfa_from_regex_impl(regex_t regex, size_t start, size_t end, nfa_t* nfa) {
         da_append(ret->nodes, union_enter);
         da_append(ret->nodes, union_exit);
 
-        for (int j = 0; j < da_size(cur->nodes); ++j) {
+        for (size_t j = 0; j < da_size(cur->nodes); ++j) {
             da_append(ret->nodes, cur->nodes[j]);
         }
         nfa_deinit(cur);
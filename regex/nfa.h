@@ -2,6 +2,7 @@
 #define NFA_H
 
 #include "preprocess.h"
+#include "da.h"
 #include <stddef.h>
 
 typedef struct nfa_node_t nfa_node_t;
@@ -15,8 +16,14 @@ struct transition_t {
     nfa_node_t* next_node;
 };
 
+#define NFA_NODE_INLINE_TRANSITIONS 2
+
 struct nfa_node_t {
+    int id; // index in nfa_t.nodes, assigned by dfa_from_nfa
     transition_t* transitions;
+    // Thompson construction never gives a node more than two transitions,
+    // so they normally never leave the node allocation.
+    DA_INLINE(transition_t, NFA_NODE_INLINE_TRANSITIONS) transitions_buf;
 };
 
 struct nfa_t {
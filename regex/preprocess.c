@@ -27,7 +27,7 @@ void regex_init(regex_t* regex) {
 void regex_preprocess(char* string, size_t length, regex_t* regex) {
     size_t* paren_stack = 0;
 
-    for (int i = 0; i < length;) {
+    for (size_t i = 0; i < length;) {
         char c = string[i];
 
         switch (c) {
@@ -87,7 +87,7 @@ void regex_preprocess(char* string, size_t length, regex_t* regex) {
                     FAIL("Unmatched ')'");
                 }
                 size_t matching_index = paren_stack[da_size(paren_stack) - 1];
-                da_pop(paren_stack);
+                (void)da_pop(paren_stack);
 
                 regex_symbol_t symbol = {
                     .symbol_type = RPAREN,
@@ -101,7 +101,7 @@ void regex_preprocess(char* string, size_t length, regex_t* regex) {
                 ++i;
             } break;
             case '[': {
-                int end_index = i+1;
+                size_t end_index = i+1;
                 while (end_index < length && string[end_index] != ']')++end_index;
                 if (end_index == length) {
                     FAIL("Unmatched '['");
@@ -110,6 +110,9 @@ void regex_preprocess(char* string, size_t length, regex_t* regex) {
                     FAIL("Empty class [] not allowed.");
                 }
                 ++i;
+                // [^...] matches every character not in the class
+                int negated = string[i] == '^' && i + 1 < end_index;
+                if (negated) ++i;
                 regex_symbol_t symbol = empty_class_symbol();
                 // TODO: handle ] in class
                 while (i < end_index) {
@@ -122,6 +125,14 @@ void regex_preprocess(char* string, size_t length, regex_t* regex) {
                         ++i;
                     }
                 }
+                if (negated) {
+                    regex_symbol_t complement = empty_class_symbol();
+                    for (int c = 0; c < 256; ++c) {
+                        if ((unsigned char)c == (unsigned char)NFA_TRANS_EPS) continue;
+                        if (!class_has_char(&symbol, c)) class_set_char(&complement, c);
+                    }
+                    symbol = complement;
+                }
                 da_append(regex->symbols, symbol);
                 i = end_index + 1;
             } break;